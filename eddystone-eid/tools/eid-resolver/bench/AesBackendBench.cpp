@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the AES backends on the two batched EID steps, and a cross
+ * check that every backend produces the same output as the reference. Every
+ * backend, and the reference, must first give the known answers of
+ * KnownAnswers.h.
+ *
+ *  - keys:   encryptKeys, one temporary key block under each identity key
+ *  - blocks: encryptBlocks, a window of EID blocks under one temporary key
+ *
+ * Usage: aes_backend_bench [keys] [windowBlocks]
+ */
+
+#include "AesBackend.h"
+#include "Aes128.h"
+#include "KnownAnswers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void fill(std::vector<uint8_t> &buf, uint64_t seed)
+{
+    for (size_t i = 0; i < buf.size(); i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        buf[i] = (uint8_t)(seed >> 56);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numKeys = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    size_t windowBlocks = (argc > 2) ? strtoul(argv[2], NULL, 0) : 5;
+    const size_t repeats = 3;
+
+    std::vector<uint8_t> keys(numKeys * Aes128::KEY_SIZE);
+    std::vector<uint8_t> blocks(numKeys * Aes128::BLOCK_SIZE);
+    std::vector<uint8_t> expected(numKeys * Aes128::BLOCK_SIZE);
+    std::vector<uint8_t> output(numKeys * Aes128::BLOCK_SIZE);
+    fill(keys, 1);
+    fill(blocks, 2);
+
+    const AesBackend *backends[] = { &AesBackend::getReference(), AesBackend::getAesNi(), &AesBackend::getBitsliced() };
+    int rc = 0;
+    printf("keys=%zu window=%zu blocks, selected backend: %s\n", numKeys, windowBlocks, AesBackend::get().getName());
+    printf("backend     keys (Mblk/s)  same block (Mblk/s)  window (Mblk/s)\n");
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        const AesBackend *backend = backends[b];
+        if (backend == NULL) {
+            printf("aes-ni      not supported\n");
+            continue;
+        }
+        if (!KnownAnswers::checkAes(*backend)) {
+            rc = 1;
+        }
+
+        // Many keys, one block per key
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repeats; r++) {
+            backend->encryptKeys(&keys[0], &blocks[0], Aes128::BLOCK_SIZE, numKeys, &output[0]);
+        }
+        double keysRate = repeats * numKeys / secondsSince(start) / 1e6;
+        if (b == 0) {
+            expected = output;
+        } else if (output != expected) {
+            printf("%s: encryptKeys mismatch\n", backend->getName());
+            rc = 1;
+        }
+
+        // Many keys, the same block (temporary key step for one epoch)
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repeats; r++) {
+            backend->encryptKeys(&keys[0], &blocks[0], 0, numKeys, &output[0]);
+        }
+        double sameRate = repeats * numKeys / secondsSince(start) / 1e6;
+        for (size_t i = 0; i < 16 && i < numKeys; i++) {
+            uint8_t check[16];
+            Aes128::encrypt(&keys[i * Aes128::KEY_SIZE], &blocks[0], check);
+            if (memcmp(check, &output[i * Aes128::BLOCK_SIZE], sizeof(check)) != 0) {
+                printf("%s: encryptKeys (stride 0) mismatch\n", backend->getName());
+                rc = 1;
+                break;
+            }
+        }
+
+        // One key per window of blocks (EID step)
+        size_t windows = numKeys / windowBlocks;
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repeats; r++) {
+            for (size_t w = 0; w < windows; w++) {
+                backend->encryptBlocks(&keys[w * Aes128::KEY_SIZE], &blocks[w * windowBlocks * Aes128::BLOCK_SIZE],
+                                       windowBlocks, &output[w * windowBlocks * Aes128::BLOCK_SIZE]);
+            }
+        }
+        double windowRate = repeats * windows * windowBlocks / secondsSince(start) / 1e6;
+        for (size_t w = 0; w < windows && w < 16; w++) {
+            Aes128 aes(&keys[w * Aes128::KEY_SIZE]);
+            for (size_t i = 0; i < windowBlocks; i++) {
+                uint8_t check[16];
+                aes.encryptBlock(&blocks[(w * windowBlocks + i) * Aes128::BLOCK_SIZE], check);
+                if (memcmp(check, &output[(w * windowBlocks + i) * Aes128::BLOCK_SIZE], sizeof(check)) != 0) {
+                    printf("%s: encryptBlocks mismatch\n", backend->getName());
+                    rc = 1;
+                    w = windows;
+                    break;
+                }
+            }
+        }
+
+        printf("%-10s  %13.1f  %19.1f  %15.1f\n", backend->getName(), keysRate, sameRate, windowRate);
+    }
+    return rc;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * One time step across many identity keys, as at a rotation boundary when
+ * every beacon of a fleet whose clocks are in step moves to its next EID:
+ *
+ *  - tempkey: the temporary key of every beacon (same block, many keys)
+ *  - eid:     then the EID of every beacon under its temporary key
+ *
+ * Compared: per key AES-NI, and the bitsliced kernel at 64, 128 and 256 keys
+ * per pass, with the key schedule run per pass or precomputed once per group
+ * of identity keys. Every output is checked against the reference, and
+ * EidGenerator and every width against the known answers of KnownAnswers.h.
+ *
+ * Usage: bitsliced_bench [keys] [steps]
+ */
+
+#include "BitslicedAes.h"
+#include "AesBackend.h"
+#include "EidGenerator.h"
+#include "Aes128.h"
+#include "KnownAnswers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+const uint8_t ROTATION_EXP = 10;
+const uint32_t START_TIME = 0x12340000;
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void fill(std::vector<uint8_t> &buf, uint64_t seed)
+{
+    for (size_t i = 0; i < buf.size(); i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        buf[i] = (uint8_t)(seed >> 56);
+    }
+}
+
+uint32_t stepTime(size_t step)
+{
+    // One epoch per step, so that every step needs new temporary keys
+    return START_TIME + (uint32_t)(step << 16);
+}
+
+/**
+ * Time step through a per key backend: both stages use encryptKeys with the
+ * same block for every key.
+ */
+void stepBackend(const AesBackend &backend, const std::vector<uint8_t> &keys, size_t numKeys, uint32_t beaconTime,
+                 std::vector<uint8_t> &tmpKeys, std::vector<uint8_t> &eids)
+{
+    uint8_t block[16];
+    EidGenerator::temporaryKeyBlock(beaconTime, block);
+    backend.encryptKeys(&keys[0], block, 0, numKeys, &tmpKeys[0]);
+    EidGenerator::eidBlock(ROTATION_EXP, beaconTime, block);
+    backend.encryptKeys(&tmpKeys[0], block, 0, numKeys, &eids[0]);
+}
+
+/**
+ * Time step with the identity key schedules precomputed in groups. The
+ * temporary keys change at every step and stay bitsliced between the stages.
+ */
+void stepPrecomputed(const std::vector<BitslicedAes> &groups, BitslicedAes &tmpKeys, uint32_t beaconTime,
+                     std::vector<uint8_t> &eids)
+{
+    size_t offset = 0;
+    for (size_t g = 0; g < groups.size(); g++) {
+        EidGenerator::computeEids(groups[g], ROTATION_EXP, beaconTime, &eids[offset * EidGenerator::EID_LENGTH],
+                                  tmpKeys);
+        offset += groups[g].getKeyCount();
+    }
+}
+
+bool check(const std::vector<uint8_t> &keys, size_t numKeys, uint32_t beaconTime, const std::vector<uint8_t> &eids,
+           size_t eidStride)
+{
+    for (size_t i = 0; i < numKeys; i += 1 + numKeys / 64) {
+        uint8_t eid[EidGenerator::EID_LENGTH];
+        EidGenerator::computeEid(&keys[i * 16], ROTATION_EXP, beaconTime, eid);
+        if (memcmp(eid, &eids[i * eidStride], sizeof(eid)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numKeys = (argc > 1) ? strtoul(argv[1], NULL, 0) : 262144;
+    size_t steps = (argc > 2) ? strtoul(argv[2], NULL, 0) : 4;
+
+    std::vector<uint8_t> keys(numKeys * 16);
+    std::vector<uint8_t> tmpKeys(numKeys * 16);
+    std::vector<uint8_t> eids(numKeys * 16);
+    fill(keys, 1);
+    int rc = 0;
+    if (!KnownAnswers::checkEids()) {
+        rc = 1;
+    }
+
+    printf("keys=%zu steps=%zu, widest bitsliced pass: %zu keys\n", numKeys, steps, BitslicedAes::getMaxLanes());
+    printf("method                  setup (s)  step (ms)  Mkeys/s\n");
+
+    const AesBackend *aesNi = AesBackend::getAesNi();
+    if (aesNi != NULL) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < steps; s++) {
+            stepBackend(*aesNi, keys, numKeys, stepTime(s), tmpKeys, eids);
+        }
+        double secs = secondsSince(start);
+        if (!check(keys, numKeys, stepTime(steps - 1), eids, 16)) {
+            printf("aes-ni mismatch\n");
+            rc = 1;
+        }
+        printf("aes-ni per key          %9s  %9.2f  %7.2f\n", "-", secs / steps * 1e3, steps * numKeys / secs / 1e6);
+    } else {
+        printf("aes-ni per key          not supported\n");
+    }
+
+    const size_t widths[] = { 64, 128, 256 };
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        size_t lanes = widths[w];
+        if (lanes > BitslicedAes::getMaxLanes()) {
+            printf("bitsliced %3zu           not supported\n", lanes);
+            continue;
+        }
+        if (!KnownAnswers::checkEids(lanes)) {
+            rc = 1;
+        }
+
+        // Key schedule of identity and temporary keys run at every pass
+        BitslicedAes aes(lanes);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < steps; s++) {
+            uint8_t tmpBlock[16], eidBlock[16];
+            EidGenerator::temporaryKeyBlock(stepTime(s), tmpBlock);
+            EidGenerator::eidBlock(ROTATION_EXP, stepTime(s), eidBlock);
+            for (size_t i = 0; i < numKeys; i += lanes) {
+                aes.setKeys(&keys[i * 16], numKeys - i);
+                aes.encrypt(tmpBlock, 0, &tmpKeys[i * 16]);
+                aes.setKeys(&tmpKeys[i * 16], aes.getKeyCount());
+                aes.encrypt(eidBlock, 0, &eids[i * 16]);
+            }
+        }
+        double secs = secondsSince(start);
+        if (!check(keys, numKeys, stepTime(steps - 1), eids, 16)) {
+            printf("bitsliced %zu mismatch\n", lanes);
+            rc = 1;
+        }
+        printf("bitsliced %3zu per pass  %9s  %9.2f  %7.2f\n", lanes, "-", secs / steps * 1e3,
+               steps * numKeys / secs / 1e6);
+
+        // Identity key schedules precomputed once per group
+        start = std::chrono::steady_clock::now();
+        std::vector<BitslicedAes> groups;
+        for (size_t i = 0; i < numKeys; i += lanes) {
+            groups.push_back(BitslicedAes(lanes));
+            groups.back().setKeys(&keys[i * 16], numKeys - i);
+        }
+        double setupSecs = secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < steps; s++) {
+            stepPrecomputed(groups, aes, stepTime(s), eids);
+        }
+        secs = secondsSince(start);
+        if (!check(keys, numKeys, stepTime(steps - 1), eids, EidGenerator::EID_LENGTH)) {
+            printf("bitsliced %zu precomputed mismatch\n", lanes);
+            rc = 1;
+        }
+        printf("bitsliced %3zu schedule  %9.3f  %9.2f  %7.2f\n", lanes, setupSecs, secs / steps * 1e3,
+               steps * numKeys / secs / 1e6);
+    }
+    return rc;
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Fixed against clock tracking windows on a simulated fleet. Every beacon
+ * rotates every 1024 s and its clock runs off by up to +/-40 ppm. Some
+ * beacons lose power and restart from their last saved time, up to a day
+ * behind (see "Recovering from power loss" in eid-computation.md), and a
+ * few are never seen again after the first day. Scanners observe each beacon about every
+ * 30 minutes, and the resolver advances every 2 minutes.
+ *
+ * The fleet was registered during the hour before the run. Both resolvers
+ * use a window of windowPeriods, by default enough to cover the day of a
+ * power loss; the tracking one only applies it to slots that stopped
+ * resolving. Reported: index size and memory, AES work, the share of
+ * observations resolved, and the mean/max time from a power loss to the
+ * next resolution of the beacon.
+ *
+ * Usage: clock_bench [beacons] [days] [windowPeriods]
+ */
+
+#include "EidResolver.h"
+#include "EidGenerator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+const uint8_t ROTATION_EXP = 10;
+const uint64_t ADVANCE_SECS = 120;
+const uint64_t OBSERVE_SECS = 1800;
+const int32_t MAX_TRUE_DRIFT_PPM = 40;
+const uint64_t DAY = 24 * 3600;
+
+/** xorshift64* generator so that runs are reproducible */
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) { }
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+};
+
+/**
+ * The actual clock of a simulated beacon.
+ */
+struct BeaconClock {
+    uint64_t startSecs;
+    int64_t  offsetSecs;
+    int32_t  driftPpm;
+    /**
+     * Resolver time of the next power loss, and the time lost then.
+     */
+    uint64_t powerLossSecs;
+    int64_t  lossSecs;
+    bool     lost;
+
+    uint32_t beaconTime(uint64_t t) const {
+        int64_t elapsed = (int64_t)(t - startSecs);
+        return (uint32_t)((int64_t)startSecs + offsetSecs + elapsed + driftPpm * elapsed / 1000000);
+    }
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Run {
+    size_t   peakIndex;
+    double   meanIndex;
+    size_t   peakMemory;
+    uint64_t precomputedEids;
+    uint64_t computedEids;
+    double   precomputeSecs;
+    double   advanceSecs;
+    size_t   observations;
+    size_t   resolved;
+    size_t   resolvedAfterLoss;
+    size_t   observedAfterLoss;
+    /**
+     * Time from a power loss to the first resolution after it.
+     */
+    double   meanReacquireSecs;
+    uint64_t maxReacquireSecs;
+};
+
+Run simulate(const std::vector<BeaconRegistration> &fleet, std::vector<BeaconClock> clocks, uint32_t windowPeriods,
+             bool tracking, uint64_t start, uint64_t days)
+{
+    Run run = Run();
+    EidResolver resolver(windowPeriods);
+    if (tracking) {
+        resolver.setClockTracking(EidResolver::ClockTracking());
+    }
+    for (size_t i = 0; i < fleet.size(); i++) {
+        resolver.addBeacon(fleet[i]);
+    }
+    std::chrono::steady_clock::time_point timer = std::chrono::steady_clock::now();
+    resolver.precompute(start);
+    run.precomputeSecs = secondsSince(timer);
+    run.precomputedEids = resolver.getComputedEids();
+
+    Random rnd(0xc10c);
+    std::vector<uint64_t> reacquired(fleet.size(), 0);
+    double indexSum = 0;
+    size_t steps = 0;
+    uint64_t end = start + days * DAY;
+    for (uint64_t t = start + ADVANCE_SECS; t <= end; t += ADVANCE_SECS) {
+        timer = std::chrono::steady_clock::now();
+        resolver.advance(t);
+        run.advanceSecs += secondsSince(timer);
+        indexSum += resolver.getIndexSize();
+        steps++;
+        if (resolver.getIndexSize() > run.peakIndex) {
+            run.peakIndex = resolver.getIndexSize();
+        }
+        if (resolver.getIndexMemoryBytes() > run.peakMemory) {
+            run.peakMemory = resolver.getIndexMemoryBytes();
+        }
+
+        for (size_t i = 0; i < fleet.size(); i++) {
+            BeaconClock &clock = clocks[i];
+            if (!clock.lost && t >= clock.powerLossSecs) {
+                clock.offsetSecs -= clock.lossSecs;
+                clock.lost = true;
+            }
+            // Beacons with powerLossSecs == 0 are gone after the first day
+            if (clock.powerLossSecs == 0 && t > start + DAY) {
+                continue;
+            }
+            if (rnd.next() % (OBSERVE_SECS / ADVANCE_SECS) != 0) {
+                continue;
+            }
+            const BeaconRegistration &reg = fleet[i];
+            uint8_t eid[EidGenerator::EID_LENGTH];
+            uint32_t beaconTime = clock.beaconTime(t);
+            EidGenerator::computeEid(reg.eidIdentityKey, reg.rotationPeriodExp,
+                                     beaconTime >> reg.rotationPeriodExp << reg.rotationPeriodExp, eid);
+            EidResolver::Resolution result;
+            bool found = resolver.resolveAt(eid, t, result) && result.beaconId == reg.beaconId;
+            run.observations++;
+            run.resolved += found ? 1 : 0;
+            if (clock.lost && clock.powerLossSecs != 0) {
+                run.observedAfterLoss++;
+                run.resolvedAfterLoss += found ? 1 : 0;
+                if (found && reacquired[i] == 0) {
+                    reacquired[i] = t;
+                }
+            }
+        }
+    }
+    run.meanIndex = indexSum / steps;
+    size_t losses = 0;
+    for (size_t i = 0; i < fleet.size(); i++) {
+        if (reacquired[i] != 0) {
+            uint64_t secs = reacquired[i] - clocks[i].powerLossSecs;
+            run.meanReacquireSecs += secs;
+            run.maxReacquireSecs = (secs > run.maxReacquireSecs) ? secs : run.maxReacquireSecs;
+            losses++;
+        }
+    }
+    run.meanReacquireSecs = losses ? run.meanReacquireSecs / losses : 0;
+    run.computedEids = resolver.getComputedEids();
+    return run;
+}
+
+void printRun(const char *name, const Run &run, size_t beacons)
+{
+    printf("%-9s %9zu %9.0f %9.1f %8.1f %11llu %9.3f %11llu %9.2f %8.3f%% %8.3f%% %7.1f/%.1f h\n", name,
+           run.peakIndex,
+           run.meanIndex, run.meanIndex / beacons, run.peakMemory / 1e6, (unsigned long long)run.precomputedEids,
+           run.precomputeSecs, (unsigned long long)(run.computedEids - run.precomputedEids), run.advanceSecs,
+           100.0 * run.resolved / run.observations,
+           run.observedAfterLoss ? 100.0 * run.resolvedAfterLoss / run.observedAfterLoss : 100.0,
+           run.meanReacquireSecs / 3600, run.maxReacquireSecs / 3600.0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numBeacons = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    uint64_t days = (argc > 2) ? strtoull(argv[2], NULL, 0) : 7;
+    uint32_t windowPeriods = (argc > 3) ? strtoul(argv[3], NULL, 0) : (uint32_t)(DAY >> ROTATION_EXP) + 1;
+
+    const uint64_t start = 1480000000ULL;
+    Random rnd(0xf1ee7);
+    std::vector<BeaconRegistration> fleet(numBeacons);
+    std::vector<BeaconClock> clocks(numBeacons);
+    size_t losses = 0, gone = 0;
+    for (size_t i = 0; i < numBeacons; i++) {
+        BeaconRegistration &reg = fleet[i];
+        reg.beaconId = i;
+        reg.slot = 0;
+        for (size_t j = 0; j < sizeof(reg.eidIdentityKey); j++) {
+            reg.eidIdentityKey[j] = (uint8_t)rnd.next();
+        }
+        reg.rotationPeriodExp = ROTATION_EXP;
+        reg.initialBeaconTimeSecs = (uint32_t)(rnd.next() % 0x1000000);
+        reg.initialServiceTimeSecs = start - (rnd.next() % 3600);
+
+        BeaconClock &clock = clocks[i];
+        clock.startSecs = reg.initialServiceTimeSecs;
+        clock.offsetSecs = (int64_t)reg.initialBeaconTimeSecs - (int64_t)reg.initialServiceTimeSecs;
+        clock.driftPpm = (int32_t)(rnd.next() % (2 * MAX_TRUE_DRIFT_PPM + 1)) - MAX_TRUE_DRIFT_PPM;
+        clock.lost = false;
+        uint64_t fate = rnd.next() % 100;
+        if (fate < 5) {
+            // Power loss at some point of the run, losing up to a day
+            clock.powerLossSecs = start + rnd.next() % (days * DAY);
+            clock.lossSecs = (int64_t)(rnd.next() % DAY);
+            losses++;
+        } else {
+            clock.powerLossSecs = (fate < 7) ? 0 : UINT64_MAX;
+            clock.lossSecs = 0;
+            gone += (fate < 7) ? 1 : 0;
+        }
+    }
+
+    printf("fleet=%zu days=%llu window=+/-%u periods of %u s, %zu power losses, %zu beacons gone after a day\n",
+           numBeacons, (unsigned long long)days, windowPeriods, 1u << ROTATION_EXP, losses, gone);
+    printf("window    peak EIDs mean EIDs EIDs/slot  peak MB precomputed   prec (s)    advanced  adv (s) "
+           "resolved after loss reacquire\n");
+    Run fixed = simulate(fleet, clocks, windowPeriods, false, start, days);
+    printRun("fixed", fixed, numBeacons);
+    Run tracked = simulate(fleet, clocks, windowPeriods, true, start, days);
+    printRun("tracking", tracked, numBeacons);
+    return 0;
+}
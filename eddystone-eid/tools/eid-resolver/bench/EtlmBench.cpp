@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ETLM decryption cost with a per key EAX context (EtlmDecryptor) against the
+ * per call EAX of eddy_aes_authcrypt_eax, which expands the key, recomputes
+ * the CMAC subkeys for each of its three CMACs and the empty header MAC on
+ * every frame.
+ *
+ * Build with -DAES128_STATS to also report AES operations per frame.
+ *
+ * Usage: etlm_bench [keys] [framesPerKey]
+ */
+
+#include "AesEax.h"
+#include "EtlmDecryptor.h"
+#include "Aes128.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+const size_t TLM_DATA_LEN = 12;
+
+/** Straight port of compute_cmac_ in implementations/mbed/source/aes_eax.cpp */
+void referenceCmac(const Aes128 &aes, const uint8_t *input, size_t length, uint8_t param, uint8_t *mac)
+{
+    uint8_t buf[16], iv[16], pad[16];
+    memset(buf, 0, sizeof(buf));
+    buf[15] = param;
+    memset(iv, 0, sizeof(iv));
+    length += 16;
+
+    memset(pad, 0, sizeof(pad));
+    aes.encryptBlock(pad, pad);
+    for (int doublings = (length & 15) ? 2 : 1; doublings > 0; doublings--) {
+        int carry = pad[0] >> 7;
+        int xv = (-carry) & 0x87;
+        for (int i = 15; i >= 0; i--) {
+            carry = pad[i] >> 7;
+            pad[i] = (uint8_t)((pad[i] << 1) ^ xv);
+            xv = carry;
+        }
+    }
+    if (length & 15) {
+        pad[length & 15] ^= 0x80;
+    }
+
+    const uint8_t *tmpInput = buf;
+    while (length > 16) {
+        for (int i = 0; i < 16; i++) {
+            iv[i] ^= tmpInput[i];
+        }
+        aes.encryptBlock(iv, iv);
+        tmpInput = (tmpInput == buf) ? input : tmpInput + 16;
+        length -= 16;
+    }
+    for (size_t i = 0; i < length; i++) {
+        pad[i] ^= tmpInput[i];
+    }
+    for (int i = 0; i < 16; i++) {
+        iv[i] ^= pad[i];
+    }
+    aes.encryptBlock(iv, mac);
+}
+
+/** Per call EAX decryption, as eddy_aes_authcrypt_eax with a fresh key schedule */
+bool referenceDecrypt(const uint8_t *key, const uint8_t *nonce, const uint8_t *input, const uint8_t *tag,
+                      uint8_t *output)
+{
+    Aes128 aes(key);
+    uint8_t headerMac[16], nonceMac[16], ciphertextMac[16];
+    referenceCmac(aes, NULL, 0, 1, headerMac);
+    referenceCmac(aes, nonce, 6, 0, nonceMac);
+    referenceCmac(aes, input, TLM_DATA_LEN, 2, ciphertextMac);
+    if (((headerMac[0] ^ nonceMac[0] ^ ciphertextMac[0]) != tag[0]) ||
+        ((headerMac[1] ^ nonceMac[1] ^ ciphertextMac[1]) != tag[1])) {
+        return false;
+    }
+    uint8_t keystream[16];
+    aes.encryptBlock(nonceMac, keystream);
+    for (size_t i = 0; i < TLM_DATA_LEN; i++) {
+        output[i] = input[i] ^ keystream[i];
+    }
+    return true;
+}
+
+struct Frame {
+    size_t  keyIndex;
+    uint8_t rotationPeriodExp;
+    uint32_t beaconTimeSecs;
+    uint8_t data[EtlmDecryptor::FRAME_SIZE_ETLM];
+};
+
+void nonceOf(const Frame &frame, uint8_t *nonce)
+{
+    uint32_t scaledTime = (frame.beaconTimeSecs >> frame.rotationPeriodExp) << frame.rotationPeriodExp;
+    nonce[0] = (scaledTime >> 24) & 0xff;
+    nonce[1] = (scaledTime >> 16) & 0xff;
+    nonce[2] = (scaledTime >> 8) & 0xff;
+    nonce[3] = scaledTime & 0xff;
+    nonce[4] = frame.data[14];
+    nonce[5] = frame.data[15];
+}
+
+void resetStats()
+{
+#ifdef AES128_STATS
+    Aes128::keyExpansions = 0;
+    Aes128::blockEncryptions = 0;
+#endif
+}
+
+void printStats(const char *mode, double secs, size_t frames)
+{
+#ifdef AES128_STATS
+    printf("%-10s %7.1f ns/frame  %6.3f aes/frame  %6.3f keyexp/frame\n", mode, secs * 1e9 / frames,
+           (double)Aes128::blockEncryptions / frames, (double)Aes128::keyExpansions / frames);
+#else
+    printf("%-10s %7.1f ns/frame\n", mode, secs * 1e9 / frames);
+#endif
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numKeys = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+    size_t framesPerKey = (argc > 2) ? strtoul(argv[2], NULL, 0) : 200;
+
+    uint64_t state = 0x5eed;
+    std::vector<uint8_t> keys(numKeys * Aes128::KEY_SIZE);
+    for (size_t i = 0; i < keys.size(); i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        keys[i] = (uint8_t)(state >> 56);
+    }
+
+    // Encrypt a stream of frames the way TLMFrame::encryptData does
+    std::vector<Frame> frames(numKeys * framesPerKey);
+    for (size_t i = 0; i < frames.size(); i++) {
+        Frame &frame = frames[i];
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        frame.keyIndex = i % numKeys;
+        frame.rotationPeriodExp = 10;
+        frame.beaconTimeSecs = 1000000 + (uint32_t)(i / numKeys) * 10;
+        frame.data[0] = EtlmDecryptor::FRAME_TYPE_TLM;
+        frame.data[1] = EtlmDecryptor::ETLM_VERSION;
+        uint8_t tlm[TLM_DATA_LEN];
+        for (size_t j = 0; j < TLM_DATA_LEN; j++) {
+            tlm[j] = (uint8_t)(state >> (j * 5));
+        }
+        frame.data[14] = (uint8_t)(state >> 8);
+        frame.data[15] = (uint8_t)state;
+        uint8_t nonce[6];
+        nonceOf(frame, nonce);
+        AesEax eax(&keys[frame.keyIndex * Aes128::KEY_SIZE]);
+        eax.encrypt(nonce, sizeof(nonce), tlm, TLM_DATA_LEN, frame.data + 2, frame.data + 16, 2);
+    }
+
+    std::vector<EtlmDecryptor> decryptors;
+    decryptors.reserve(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+        decryptors.push_back(EtlmDecryptor(&keys[i * Aes128::KEY_SIZE]));
+    }
+
+    printf("keys=%zu frames=%zu\n", numKeys, frames.size());
+    size_t failures = 0;
+    uint32_t checksum = 0;
+
+    resetStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame &frame = frames[i];
+        uint8_t nonce[6];
+        uint8_t tlm[TLM_DATA_LEN];
+        nonceOf(frame, nonce);
+        if (!referenceDecrypt(&keys[frame.keyIndex * Aes128::KEY_SIZE], nonce, frame.data + 2, frame.data + 16, tlm)) {
+            failures++;
+        }
+        checksum += tlm[4] | (tlm[11] << 8);
+    }
+    printStats("per call", secondsSince(start), frames.size());
+
+    resetStats();
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame &frame = frames[i];
+        TlmData tlm;
+        if (decryptors[frame.keyIndex].decrypt(frame.data, sizeof(frame.data), frame.rotationPeriodExp,
+                                               frame.beaconTimeSecs, tlm) != EtlmDecryptor::ETLM_SUCCESS) {
+            failures++;
+        }
+        checksum -= (tlm.pduCount >> 24) | ((tlm.timeSinceBoot & 0xff) << 8);
+    }
+    printStats("cached", secondsSince(start), frames.size());
+
+    if (failures || checksum) {
+        printf("%zu frames failed to decrypt, checksum %u\n", failures, checksum);
+        return 1;
+    }
+    return 0;
+}
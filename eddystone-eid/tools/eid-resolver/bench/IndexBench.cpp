@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * EidIndex against std::unordered_map<uint64_t, ...> as the resolver index.
+ * Keys are random 64-bit words, like EIDs. For each size the table is filled
+ * (with the capacity reserved up front, as precompute() does), then random
+ * keys are looked up: present keys, absent keys, and present keys through
+ * EidIndex::findBatch(). Memory is the allocated size: slot arrays for
+ * EidIndex; bucket array plus one 32-byte heap node per entry (24 bytes
+ * rounded up by malloc) for std::unordered_map.
+ *
+ * Usage: index_bench [entries...]   (default: 1000000 10000000)
+ *
+ * std::unordered_map needs about 50 bytes per entry, counting the
+ * allocator's own overhead, and is skipped above MAP_MEMORY_LIMIT; EidIndex
+ * needs 16 bytes per slot, 21 to 43 per entry.
+ */
+
+#include "EidIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const size_t LOOKUPS = 4000000;
+const size_t BATCH = 256;
+const uint64_t MAP_MEMORY_LIMIT = 2000000000ULL;
+
+struct Entry {
+    uint32_t beaconIndex;
+    uint32_t beaconTimeSecs;
+};
+
+/** Key number i: splitmix64, so that any key can be regenerated */
+uint64_t keyOf(uint64_t i)
+{
+    uint64_t z = i * 0x9e3779b97f4a7c15ULL + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * LOOKUPS keys, present ones (numbers below n) or absent ones.
+ */
+std::vector<uint64_t> queries(size_t n, bool present, uint64_t seed)
+{
+    std::vector<uint64_t> keys(LOOKUPS);
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        uint64_t r = keyOf(seed + i);
+        keys[i] = present ? keyOf(r % n) : keyOf(n + r % (UINT64_MAX / 2));
+    }
+    return keys;
+}
+
+void printRow(const char *name, size_t n, double insertSecs, size_t memory, double hitNs, double missNs,
+              double batchNs, size_t found)
+{
+    printf("%-14s %11zu %9.2f %9.1f %8.1f %8.1f", name, n, n / insertSecs / 1e6, (double)memory / n, hitNs, missNs);
+    if (batchNs > 0) {
+        printf(" %8.1f", batchNs);
+    } else {
+        printf(" %8s", "-");
+    }
+    printf("   %zu\n", found);
+}
+
+bool benchIndex(size_t n, const std::vector<uint64_t> &hits, const std::vector<uint64_t> &misses)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EidIndex index;
+    index.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        index.insert(keyOf(i), (uint32_t)i, (uint32_t)(i * 1024));
+    }
+    double insertSecs = secondsSince(start);
+    size_t memory = index.getMemoryBytes();
+
+    size_t found = 0;
+    bool ok = true;
+    uint32_t beaconIndex, beaconTime;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        found += index.find(hits[i], beaconIndex, beaconTime) ? 1 : 0;
+    }
+    double hitNs = secondsSince(start) * 1e9 / LOOKUPS;
+    ok = ok && found == LOOKUPS;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        found += index.find(misses[i], beaconIndex, beaconTime) ? 1 : 0;
+    }
+    double missNs = secondsSince(start) * 1e9 / LOOKUPS;
+    ok = ok && found == LOOKUPS;
+
+    uint32_t beaconIndexes[BATCH], beaconTimes[BATCH];
+    uint64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; i += BATCH) {
+        found += index.findBatch(&hits[i], BATCH, beaconIndexes, beaconTimes);
+        checksum += beaconIndexes[0];
+    }
+    double batchNs = secondsSince(start) * 1e9 / LOOKUPS;
+    ok = ok && found == 2 * LOOKUPS && checksum > 0;
+
+    printRow("EidIndex", n, insertSecs, memory, hitNs, missNs, batchNs, found);
+    return ok;
+}
+
+bool benchMap(size_t n, const std::vector<uint64_t> &hits, const std::vector<uint64_t> &misses)
+{
+    if ((uint64_t)n * 50 > MAP_MEMORY_LIMIT) {
+        printf("%-14s %11zu   skipped, needs about %.1f GB\n", "unordered_map", n, n * 50 / 1e9);
+        return true;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::unordered_map<uint64_t, Entry> map;
+    map.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        Entry entry = { (uint32_t)i, (uint32_t)(i * 1024) };
+        map.insert(std::make_pair(keyOf(i), entry));
+    }
+    double insertSecs = secondsSince(start);
+    size_t memory = map.bucket_count() * sizeof(void *) + map.size() * 32;
+
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        found += (map.find(hits[i]) != map.end()) ? 1 : 0;
+    }
+    double hitNs = secondsSince(start) * 1e9 / LOOKUPS;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        found += (map.find(misses[i]) != map.end()) ? 1 : 0;
+    }
+    double missNs = secondsSince(start) * 1e9 / LOOKUPS;
+
+    printRow("unordered_map", n, insertSecs, memory, hitNs, missNs, 0, found);
+    return found == LOOKUPS;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(strtoul(argv[i], NULL, 0));
+    }
+    if (sizes.empty()) {
+        sizes.push_back(1000000);
+        sizes.push_back(10000000);
+    }
+
+    int rc = 0;
+    printf("lookups=%zu, batches of %zu\n", LOOKUPS, BATCH);
+    printf("table              entries  Minsert/s  B/entry   hit ns  miss ns batch ns   found\n");
+    for (size_t s = 0; s < sizes.size(); s++) {
+        size_t n = sizes[s];
+        std::vector<uint64_t> hits = queries(n, true, 1000000007ULL * (s + 1));
+        std::vector<uint64_t> misses = queries(n, false, 2000000011ULL * (s + 1));
+        if (!benchMap(n, hits, misses) || !benchIndex(n, hits, misses)) {
+            printf("lookup mismatch\n");
+            rc = 1;
+        }
+    }
+    return rc;
+}
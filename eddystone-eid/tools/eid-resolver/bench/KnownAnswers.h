@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOWNANSWERS_H__
+#define __KNOWNANSWERS_H__
+
+/*
+ * Known answer checks shared by the benches. The benches cross check every
+ * backend against Aes128, which would not catch a bug in Aes128 itself; these
+ * compare with fixed vectors instead: FIPS-197 appendix C.1 for AES-128, and
+ * the test vectors of eid-computation.md for the temporary key and the EID.
+ * Each check prints the first mismatch and returns false.
+ */
+
+#include "AesBackend.h"
+#include "Aes128.h"
+#include "BitslicedAes.h"
+#include "EidGenerator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace KnownAnswers {
+
+struct EidVector {
+    const char *identityKey;
+    uint8_t     rotationPeriodExp;
+    uint32_t    beaconTimeSecs;
+    const char *tmpKey;
+    const char *eid;
+};
+
+/** The test vectors of eid-computation.md; the first three share a key. */
+static const EidVector EID_VECTORS[] = {
+    { "000102030405060708090a0b0c0d0e0f", 10, 0x00000000, "68d14ef25b6abcc46b96568081ec8a52", "df8e76bbfec4efc5" },
+    { "000102030405060708090a0b0c0d0e0f", 10, 0x0000ff00, "68d14ef25b6abcc46b96568081ec8a52", "3439c83a6564bfdf" },
+    { "000102030405060708090a0b0c0d0e0f", 10, 0x00010000, "89b9b57c9f9b105a9541f31958492269", "ec31ae4cb8abc2d8" },
+    { "e2b9d1f0a23c4d5e6f708192a3b4c5d6", 15, 0x12345678, "6e709039f8cdb6c6cecbbb3c910676e0", "d7a11ce76cdb21a8" },
+};
+static const size_t EID_VECTOR_COUNT = sizeof(EID_VECTORS) / sizeof(EID_VECTORS[0]);
+
+/** FIPS-197 appendix C.1. */
+static const char *const FIPS197_KEY = "000102030405060708090a0b0c0d0e0f";
+static const char *const FIPS197_PLAINTEXT = "00112233445566778899aabbccddeeff";
+static const char *const FIPS197_CIPHERTEXT = "69c4e0d86a7b0430d8cdb78070b4c55a";
+
+/** Parse 2 * length hex digits into out. */
+inline void fromHex(const char *hex, uint8_t *out, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        char byte[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+        out[i] = (uint8_t) strtoul(byte, NULL, 16);
+    }
+}
+
+inline bool same(const char *what, const char *name, const uint8_t *actual, const char *expectedHex, size_t length)
+{
+    uint8_t expected[16];
+    fromHex(expectedHex, expected, length);
+    if (memcmp(actual, expected, length) != 0) {
+        printf("%s: %s differs from the known answer %s\n", name, what, expectedHex);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * AES vectors: FIPS-197 C.1, then the temporary key of every EID vector,
+ * which is the encryption of the temporary key block under the identity key.
+ */
+inline size_t aesVectors(uint8_t *keys, uint8_t *blocks, const char **ciphertexts)
+{
+    fromHex(FIPS197_KEY, keys, 16);
+    fromHex(FIPS197_PLAINTEXT, blocks, 16);
+    ciphertexts[0] = FIPS197_CIPHERTEXT;
+    for (size_t i = 0; i < EID_VECTOR_COUNT; i++) {
+        fromHex(EID_VECTORS[i].identityKey, keys + 16 * (i + 1), 16);
+        EidGenerator::temporaryKeyBlock(EID_VECTORS[i].beaconTimeSecs, blocks + 16 * (i + 1));
+        ciphertexts[i + 1] = EID_VECTORS[i].tmpKey;
+    }
+    return EID_VECTOR_COUNT + 1;
+}
+
+/**
+ * Check Aes128 and the batched calls of an AES backend.
+ */
+inline bool checkAes(const AesBackend &backend)
+{
+    uint8_t keys[16 * (EID_VECTOR_COUNT + 1)];
+    uint8_t blocks[16 * (EID_VECTOR_COUNT + 1)];
+    uint8_t output[16 * (EID_VECTOR_COUNT + 1)];
+    const char *ciphertexts[EID_VECTOR_COUNT + 1];
+    size_t count = aesVectors(keys, blocks, ciphertexts);
+
+    backend.encryptKeys(keys, blocks, 16, count, output);
+    for (size_t i = 0; i < count; i++) {
+        uint8_t single[16];
+        Aes128::encrypt(keys + 16 * i, blocks + 16 * i, single);
+        if (!same("Aes128::encrypt", "reference", single, ciphertexts[i], 16) ||
+            !same("encryptKeys", backend.getName(), output + 16 * i, ciphertexts[i], 16)) {
+            return false;
+        }
+        backend.encryptBlocks(keys + 16 * i, blocks + 16 * i, 1, single);
+        if (!same("encryptBlocks", backend.getName(), single, ciphertexts[i], 16)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check the temporary keys and EIDs of EidGenerator, with and without the
+ * temporary key cache, through every AES backend, and through a BitslicedAes
+ * of the given number of lanes (0 for the widest).
+ */
+inline bool checkEids(size_t lanes = 0)
+{
+    const AesBackend *backends[] = { &AesBackend::getReference(), AesBackend::getAesNi(), &AesBackend::getBitsliced() };
+    EidGenerator::TemporaryKeyCache cache;
+    BitslicedAes identityKeys(lanes);
+    BitslicedAes tmpKeys(lanes);
+
+    for (size_t i = 0; i < EID_VECTOR_COUNT; i++) {
+        const EidVector &vector = EID_VECTORS[i];
+        uint8_t identityKey[16];
+        uint8_t tmpKey[16];
+        uint8_t eid[EidGenerator::EID_LENGTH];
+        fromHex(vector.identityKey, identityKey, sizeof(identityKey));
+        if (i > 0 && strcmp(vector.identityKey, EID_VECTORS[i - 1].identityKey) != 0) {
+            cache = EidGenerator::TemporaryKeyCache();
+        }
+
+        EidGenerator::computeTemporaryKey(identityKey, vector.beaconTimeSecs, tmpKey);
+        if (!same("temporary key", "EidGenerator", tmpKey, vector.tmpKey, sizeof(tmpKey))) {
+            return false;
+        }
+        EidGenerator::computeEid(identityKey, vector.rotationPeriodExp, vector.beaconTimeSecs, eid);
+        if (!same("EID", "EidGenerator", eid, vector.eid, sizeof(eid))) {
+            return false;
+        }
+        EidGenerator::computeEid(identityKey, vector.rotationPeriodExp, vector.beaconTimeSecs, eid, cache);
+        if (!same("EID with the temporary key cache", "EidGenerator", eid, vector.eid, sizeof(eid))) {
+            return false;
+        }
+        for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+            if (backends[b] == NULL) {
+                continue;
+            }
+            EidGenerator::computeEids(tmpKey, vector.rotationPeriodExp,
+                                      vector.beaconTimeSecs >> vector.rotationPeriodExp, 1, eid, *backends[b]);
+            if (!same("EID of computeEids", backends[b]->getName(), eid, vector.eid, sizeof(eid))) {
+                return false;
+            }
+        }
+        identityKeys.setKeys(identityKey, 1);
+        EidGenerator::computeEids(identityKeys, vector.rotationPeriodExp, vector.beaconTimeSecs, eid, tmpKeys);
+        if (!same("EID of computeEids", "BitslicedAes", eid, vector.eid, sizeof(eid))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace KnownAnswers
+
+#endif  /* __KNOWNANSWERS_H__ */
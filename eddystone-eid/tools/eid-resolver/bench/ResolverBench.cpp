@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput benchmark for EidResolver against a synthetic fleet: full
+ * precompute, lookups, and sliding the window with advance() one minute at a
+ * time, cross checked against a full rebuild at the final time.
+ *
+ * Usage: resolver_bench [beacons] [windowPeriods] [lookups] [reference|aes-ni|bitsliced]
+ */
+
+#include "EidResolver.h"
+#include "EidGenerator.h"
+#include "AesBackend.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+/** xorshift64* generator so that runs are reproducible */
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) { }
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+    void fill(uint8_t *buf, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = (uint8_t)next();
+        }
+    }
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numBeacons = (argc > 1) ? strtoul(argv[1], NULL, 0) : 50000;
+    uint32_t windowPeriods = (argc > 2) ? strtoul(argv[2], NULL, 0) : EidResolver::DEFAULT_WINDOW_PERIODS;
+    size_t numLookups = (argc > 3) ? strtoul(argv[3], NULL, 0) : 2000000;
+    const AesBackend *backend = &AesBackend::get();
+    if (argc > 4) {
+        if (strcmp(argv[4], "reference") == 0) {
+            backend = &AesBackend::getReference();
+        } else if (strcmp(argv[4], "bitsliced") == 0) {
+            backend = &AesBackend::getBitsliced();
+        } else {
+            backend = AesBackend::getAesNi();
+        }
+        if (backend == NULL) {
+            printf("AES backend %s is not supported\n", argv[4]);
+            return 1;
+        }
+    }
+
+    const uint64_t serviceNow = 1480000000ULL;
+    Random rnd(0x5eed);
+    EidResolver resolver(windowPeriods);
+    resolver.setAesBackend(*backend);
+    std::vector<BeaconRegistration> fleet(numBeacons);
+
+    for (size_t i = 0; i < numBeacons; i++) {
+        BeaconRegistration &reg = fleet[i];
+        reg.beaconId = i;
+        reg.slot = (uint8_t)(i % 4);
+        rnd.fill(reg.eidIdentityKey, sizeof(reg.eidIdentityKey));
+        reg.rotationPeriodExp = 10 + (uint8_t)(rnd.next() % 6);
+        reg.initialBeaconTimeSecs = (uint32_t)(rnd.next() % 0x1000000);
+        reg.initialServiceTimeSecs = serviceNow - (rnd.next() % (90 * 24 * 3600));
+        resolver.addBeacon(reg);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    resolver.precompute(serviceNow);
+    double precomputeSecs = secondsSince(start);
+    printf("fleet=%zu window=+/-%u index=%zu aes=%s\n", numBeacons, windowPeriods, resolver.getIndexSize(),
+           backend->getName());
+    printf("precompute: %.3f s (%.0f EIDs/s)\n", precomputeSecs, resolver.getIndexSize() / precomputeSecs);
+
+    // Observations: half broadcast by the fleet right now, half random noise
+    std::vector<uint8_t> observed(numLookups * EidGenerator::EID_LENGTH);
+    for (size_t i = 0; i < numLookups; i++) {
+        uint8_t *eid = &observed[i * EidGenerator::EID_LENGTH];
+        if (i & 1) {
+            rnd.fill(eid, EidGenerator::EID_LENGTH);
+        } else {
+            const BeaconRegistration &reg = fleet[rnd.next() % numBeacons];
+            EidGenerator::computeEid(reg.eidIdentityKey, reg.rotationPeriodExp,
+                                     EidResolver::expectedBeaconTime(reg, serviceNow), eid);
+        }
+    }
+
+    size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numLookups; i++) {
+        EidResolver::Resolution result;
+        if (resolver.resolve(&observed[i * EidGenerator::EID_LENGTH], result)) {
+            hits++;
+        }
+    }
+    double lookupSecs = secondsSince(start);
+    printf("resolve: %zu lookups, %zu hits, %.3f s (%.0f lookups/s)\n",
+           numLookups, hits, lookupSecs, numLookups / lookupSecs);
+
+    std::vector<EidResolver::Resolution> results(numLookups);
+    bool *found = new bool[numLookups];
+    start = std::chrono::steady_clock::now();
+    size_t batchHits = resolver.resolveBatch(&observed[0], numLookups, &results[0], found);
+    lookupSecs = secondsSince(start);
+    printf("resolveBatch: %zu lookups, %zu hits, %.3f s (%.0f lookups/s)\n",
+           numLookups, batchHits, lookupSecs, numLookups / lookupSecs);
+    delete[] found;
+    if (batchHits != hits) {
+        printf("resolveBatch and resolve disagree\n");
+        return 1;
+    }
+
+    // Slide the window through one hour of resolver time
+    const size_t advanceSteps = 60;
+    const uint64_t advanceStepSecs = 60;
+    size_t sizeBefore = resolver.getIndexSize();
+    start = std::chrono::steady_clock::now();
+    for (size_t s = 1; s <= advanceSteps; s++) {
+        resolver.advance(serviceNow + s * advanceStepSecs);
+    }
+    double advanceSecs = secondsSince(start);
+    uint64_t serviceEnd = serviceNow + advanceSteps * advanceStepSecs;
+
+    EidResolver rebuilt(windowPeriods);
+    rebuilt.setAesBackend(*backend);
+    for (size_t i = 0; i < numBeacons; i++) {
+        rebuilt.addBeacon(fleet[i]);
+    }
+    start = std::chrono::steady_clock::now();
+    rebuilt.precompute(serviceEnd);
+    double rebuildSecs = secondsSince(start);
+
+    // Every EID of the rebuilt index must resolve identically after advance()
+    bool same = (rebuilt.getIndexSize() == resolver.getIndexSize());
+    for (size_t i = 0; i < numBeacons && same; i += 1 + numBeacons / 1000) {
+        const BeaconRegistration &reg = fleet[i];
+        uint32_t quantum = EidResolver::expectedBeaconTime(reg, serviceEnd) >> reg.rotationPeriodExp;
+        for (uint32_t q = quantum - windowPeriods; q <= quantum + windowPeriods; q++) {
+            uint8_t eid[EidGenerator::EID_LENGTH];
+            EidGenerator::computeEid(reg.eidIdentityKey, reg.rotationPeriodExp, q << reg.rotationPeriodExp, eid);
+            EidResolver::Resolution expected, actual;
+            bool inRebuilt = rebuilt.resolve(eid, expected);
+            bool inAdvanced = resolver.resolve(eid, actual);
+            if (inRebuilt != inAdvanced ||
+                (inRebuilt && (expected.beaconId != actual.beaconId || expected.beaconTimeSecs != actual.beaconTimeSecs))) {
+                same = false;
+                break;
+            }
+        }
+    }
+    printf("advance: %zu steps of %llu s, %.3f ms/step, full rebuild %.3f ms, index %zu -> %zu (%s)\n",
+           advanceSteps, (unsigned long long)advanceStepSecs, advanceSecs / advanceSteps * 1e3, rebuildSecs * 1e3,
+           sizeBefore, resolver.getIndexSize(), same ? "matches rebuild" : "MISMATCH");
+
+    return (hits == (numLookups + 1) / 2 && same) ? 0 : 1;
+}
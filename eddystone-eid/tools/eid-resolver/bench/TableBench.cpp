@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Resolver restart from an EID table file. A resolver for a synthetic fleet
+ * saves its index; a "restarted" process then maps the table and serves
+ * lookups from it, while a background thread verifies the payload, restores
+ * a resolver from the table and advances it to the current time. The result
+ * is compared with a resolver precomputed from scratch.
+ *
+ * Usage: table_bench [beacons] [windowPeriods] [downtimeSecs] [path]
+ */
+
+#include "EidResolver.h"
+#include "EidTable.h"
+#include "EidGenerator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/** xorshift64* generator so that runs are reproducible */
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) { }
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+    void fill(uint8_t *buf, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = (uint8_t)next();
+        }
+    }
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numBeacons = (argc > 1) ? strtoul(argv[1], NULL, 0) : 200000;
+    uint32_t windowPeriods = (argc > 2) ? strtoul(argv[2], NULL, 0) : EidResolver::DEFAULT_WINDOW_PERIODS;
+    uint64_t downtimeSecs = (argc > 3) ? strtoull(argv[3], NULL, 0) : 600;
+    const char *path = (argc > 4) ? argv[4] : "eid_table.bin";
+
+    const uint64_t serviceSaved = 1480000000ULL;
+    const uint64_t serviceRestart = serviceSaved + downtimeSecs;
+    Random rnd(0x5eed);
+    std::vector<BeaconRegistration> fleet(numBeacons);
+    for (size_t i = 0; i < numBeacons; i++) {
+        BeaconRegistration &reg = fleet[i];
+        reg.beaconId = i;
+        reg.slot = (uint8_t)(i % 4);
+        rnd.fill(reg.eidIdentityKey, sizeof(reg.eidIdentityKey));
+        reg.rotationPeriodExp = 10 + (uint8_t)(rnd.next() % 6);
+        reg.initialBeaconTimeSecs = (uint32_t)(rnd.next() % 0x1000000);
+        reg.initialServiceTimeSecs = serviceSaved - (rnd.next() % (90 * 24 * 3600));
+    }
+
+    // Before the restart: precompute and save
+    {
+        EidResolver resolver(windowPeriods);
+        for (size_t i = 0; i < numBeacons; i++) {
+            resolver.addBeacon(fleet[i]);
+        }
+        resolver.precompute(serviceSaved);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (resolver.saveTable(path) != EidResolver::RESOLVER_SUCCESS) {
+            printf("cannot write %s\n", path);
+            return 1;
+        }
+        printf("fleet=%zu window=+/-%u index=%zu, saved in %.1f ms\n", numBeacons, windowPeriods,
+               resolver.getIndexSize(), secondsSince(start) * 1e3);
+    }
+
+    // Restart: map the table and answer a first query
+    std::chrono::steady_clock::time_point restart = std::chrono::steady_clock::now();
+    EidTable table;
+    int rc = table.open(path);
+    if (rc != EidTable::TABLE_SUCCESS) {
+        printf("cannot open %s: %d\n", path, rc);
+        return 1;
+    }
+    const BeaconRegistration &probe = fleet[numBeacons / 2];
+    uint8_t eid[EidGenerator::EID_LENGTH];
+    EidGenerator::computeEid(probe.eidIdentityKey, probe.rotationPeriodExp,
+                             EidResolver::expectedBeaconTime(probe, serviceSaved), eid);
+    EidResolver::Resolution result;
+    bool found = table.resolve(eid, result) && result.beaconId == probe.beaconId;
+    printf("restart: table mapped and first lookup %s after %.3f ms\n", found ? "resolved" : "FAILED",
+           secondsSince(restart) * 1e3);
+
+    // Background catch-up while lookups are served from the table
+    EidResolver restored(windowPeriods);
+    std::atomic<bool> caughtUp(false);
+    int verifyRc = EidTable::TABLE_SUCCESS;
+    double catchUpSecs = 0;
+    std::thread worker([&]() {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        verifyRc = table.verify();
+        if (verifyRc == EidTable::TABLE_SUCCESS && restored.loadTable(table) == EidResolver::RESOLVER_SUCCESS) {
+            restored.advance(serviceRestart);
+        }
+        catchUpSecs = secondsSince(start);
+        caughtUp = true;
+    });
+    size_t served = 0, hits = 0;
+    while (!caughtUp) {
+        const BeaconRegistration &reg = fleet[rnd.next() % numBeacons];
+        EidGenerator::computeEid(reg.eidIdentityKey, reg.rotationPeriodExp,
+                                 EidResolver::expectedBeaconTime(reg, serviceRestart), eid);
+        hits += table.resolve(eid, result) ? 1 : 0;
+        served++;
+    }
+    worker.join();
+    printf("catch-up: verify %s, restored and advanced %llu s in %.1f ms, served %zu lookups meanwhile (%zu hits)\n",
+           (verifyRc == EidTable::TABLE_SUCCESS) ? "ok" : "FAILED", (unsigned long long)downtimeSecs,
+           catchUpSecs * 1e3, served, hits);
+
+    // The same catch-up without lookups competing for the core
+    EidResolver sequential(windowPeriods);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sequential.loadTable(table);
+    double loadSecs = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    sequential.advance(serviceRestart);
+    printf("catch-up alone: loadTable %.1f ms, advance %.1f ms\n", loadSecs * 1e3, secondsSince(start) * 1e3);
+
+    // Reference: precompute from scratch at the restart time
+    EidResolver scratch(windowPeriods);
+    for (size_t i = 0; i < numBeacons; i++) {
+        scratch.addBeacon(fleet[i]);
+    }
+    start = std::chrono::steady_clock::now();
+    scratch.precompute(serviceRestart);
+    printf("from scratch: precompute in %.1f ms\n", secondsSince(start) * 1e3);
+
+    bool same = found && verifyRc == EidTable::TABLE_SUCCESS && scratch.getIndexSize() == restored.getIndexSize();
+    for (size_t i = 0; i < numBeacons && same; i += 1 + numBeacons / 1000) {
+        const BeaconRegistration &reg = fleet[i];
+        EidGenerator::computeEid(reg.eidIdentityKey, reg.rotationPeriodExp,
+                                 EidResolver::expectedBeaconTime(reg, serviceRestart), eid);
+        EidResolver::Resolution expected;
+        same = scratch.resolve(eid, expected) && restored.resolve(eid, result) &&
+               expected.beaconId == result.beaconId && expected.beaconTimeSecs == result.beaconTimeSecs;
+    }
+    printf("restored index %s the precomputed one\n", same ? "matches" : "DOES NOT MATCH");
+    remove(path);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of one EID rotation with and without the temporary key cache, for the
+ * shortest (k=10) and longest (k=15) rotation periods. Every identity key is
+ * rotated through consecutive periods, as EddystoneService::swapAdvertisedFrame
+ * does on the beacon.
+ *
+ * Build with -DAES128_STATS to also report AES operations per rotation.
+ * EidGenerator must also give the known answers of KnownAnswers.h.
+ *
+ * Usage: tempkey_bench [keys] [rotations]
+ */
+
+#include "EidGenerator.h"
+#include "Aes128.h"
+#include "KnownAnswers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+namespace {
+
+uint64_t cycles()
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Result {
+    double   nsPerRotation;
+    double   cyclesPerRotation;
+    double   blocksPerRotation;
+    double   expansionsPerRotation;
+    uint64_t checksum;
+};
+
+Result run(const std::vector<uint8_t> &keys, size_t numKeys, size_t rotations, uint8_t k, bool cached)
+{
+    const uint32_t startTime = 0x01000000 - (1u << 15);
+    std::vector<EidGenerator::TemporaryKeyCache> caches(numKeys);
+    Result result;
+    result.checksum = 0;
+
+#ifdef AES128_STATS
+    Aes128::keyExpansions = 0;
+    Aes128::blockEncryptions = 0;
+#endif
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t startCycles = cycles();
+    for (size_t i = 0; i < numKeys; i++) {
+        const uint8_t *key = &keys[i * EidGenerator::KEY_LENGTH];
+        for (size_t r = 0; r < rotations; r++) {
+            uint32_t timeSecs = startTime + ((uint32_t)r << k);
+            uint8_t eid[EidGenerator::EID_LENGTH];
+            if (cached) {
+                EidGenerator::computeEid(key, k, timeSecs, eid, caches[i]);
+            } else {
+                EidGenerator::computeEid(key, k, timeSecs, eid);
+            }
+            uint64_t word;
+            memcpy(&word, eid, sizeof(word));
+            result.checksum ^= word + r;
+        }
+    }
+    uint64_t elapsedCycles = cycles() - startCycles;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double total = (double)numKeys * rotations;
+    result.nsPerRotation = secs * 1e9 / total;
+    result.cyclesPerRotation = elapsedCycles / total;
+#ifdef AES128_STATS
+    result.blocksPerRotation = Aes128::blockEncryptions / total;
+    result.expansionsPerRotation = Aes128::keyExpansions / total;
+#else
+    result.blocksPerRotation = 0;
+    result.expansionsPerRotation = 0;
+#endif
+    return result;
+}
+
+void print(uint8_t k, const char *mode, const Result &result)
+{
+#ifdef AES128_STATS
+    printf(" %2u  %s %7.1f  %10.0f  %7.3f  %10.3f\n", k, mode, result.nsPerRotation,
+           result.cyclesPerRotation, result.blocksPerRotation, result.expansionsPerRotation);
+#else
+    printf(" %2u  %s %7.1f  %10.0f      n/a         n/a\n", k, mode, result.nsPerRotation,
+           result.cyclesPerRotation);
+#endif
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t numKeys = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000;
+    size_t rotations = (argc > 2) ? strtoul(argv[2], NULL, 0) : 256;
+
+    std::vector<uint8_t> keys(numKeys * EidGenerator::KEY_LENGTH);
+    uint64_t state = 0x5eed;
+    for (size_t i = 0; i < keys.size(); i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        keys[i] = (uint8_t)(state >> 56);
+    }
+
+    const uint8_t exps[] = { 10, 15 };
+    int rc = 0;
+    printf("keys=%zu rotations=%zu\n", numKeys, rotations);
+    printf("  k  mode      ns/rot  cycles/rot  aes/rot  keyexp/rot\n");
+    for (size_t e = 0; e < sizeof(exps); e++) {
+        Result before = run(keys, numKeys, rotations, exps[e], false);
+        Result after = run(keys, numKeys, rotations, exps[e], true);
+        print(exps[e], "uncached", before);
+        print(exps[e], "cached  ", after);
+        if (before.checksum != after.checksum) {
+            printf("EID mismatch for k=%u\n", exps[e]);
+            rc = 1;
+        }
+    }
+    if (!KnownAnswers::checkEids()) {
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Aes128.h"
+#include <string.h>
+
+namespace {
+
+const uint8_t SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+const uint32_t RCON[10] = {
+    0x01000000, 0x02000000, 0x04000000, 0x08000000, 0x10000000,
+    0x20000000, 0x40000000, 0x80000000, 0x1b000000, 0x36000000
+};
+
+/**
+ * Round tables combining SubBytes, ShiftRows and MixColumns. Built once from
+ * the S-box at static initialization time.
+ */
+struct EncryptionTables {
+    uint32_t te0[256];
+    uint32_t te1[256];
+    uint32_t te2[256];
+    uint32_t te3[256];
+
+    EncryptionTables() {
+        for (int i = 0; i < 256; i++) {
+            uint32_t s = SBOX[i];
+            uint32_t s2 = ((s << 1) ^ ((s & 0x80) ? 0x1b : 0)) & 0xff;
+            uint32_t s3 = s2 ^ s;
+            uint32_t t = (s2 << 24) | (s << 16) | (s << 8) | s3;
+            te0[i] = t;
+            te1[i] = (t >> 8) | (t << 24);
+            te2[i] = (t >> 16) | (t << 16);
+            te3[i] = (t >> 24) | (t << 8);
+        }
+    }
+};
+
+const EncryptionTables tables;
+
+inline uint32_t load32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline void store32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+inline uint32_t subWord(uint32_t w)
+{
+    return ((uint32_t)SBOX[w >> 24] << 24) |
+           ((uint32_t)SBOX[(w >> 16) & 0xff] << 16) |
+           ((uint32_t)SBOX[(w >> 8) & 0xff] << 8) |
+           (uint32_t)SBOX[w & 0xff];
+}
+
+} // namespace
+
+#ifdef AES128_STATS
+uint64_t Aes128::keyExpansions = 0;
+uint64_t Aes128::blockEncryptions = 0;
+#endif
+
+Aes128::Aes128()
+{
+    memset(roundKeys, 0, sizeof(roundKeys));
+}
+
+Aes128::Aes128(const uint8_t *key)
+{
+    setKey(key);
+}
+
+void Aes128::setKey(const uint8_t *key)
+{
+#ifdef AES128_STATS
+    keyExpansions++;
+#endif
+    uint32_t *w = roundKeys;
+    w[0] = load32(key);
+    w[1] = load32(key + 4);
+    w[2] = load32(key + 8);
+    w[3] = load32(key + 12);
+    for (int i = 0; i < ROUNDS; i++, w += 4) {
+        uint32_t t = w[3];
+        w[4] = w[0] ^ subWord((t << 8) | (t >> 24)) ^ RCON[i];
+        w[5] = w[1] ^ w[4];
+        w[6] = w[2] ^ w[5];
+        w[7] = w[3] ^ w[6];
+    }
+}
+
+void Aes128::encryptBlock(const uint8_t *input, uint8_t *output) const
+{
+#ifdef AES128_STATS
+    blockEncryptions++;
+#endif
+    const uint32_t *rk = roundKeys;
+    uint32_t s0 = load32(input)      ^ rk[0];
+    uint32_t s1 = load32(input + 4)  ^ rk[1];
+    uint32_t s2 = load32(input + 8)  ^ rk[2];
+    uint32_t s3 = load32(input + 12) ^ rk[3];
+
+    for (int round = 1; round < ROUNDS; round++) {
+        rk += 4;
+        uint32_t t0 = tables.te0[s0 >> 24] ^ tables.te1[(s1 >> 16) & 0xff] ^
+                      tables.te2[(s2 >> 8) & 0xff] ^ tables.te3[s3 & 0xff] ^ rk[0];
+        uint32_t t1 = tables.te0[s1 >> 24] ^ tables.te1[(s2 >> 16) & 0xff] ^
+                      tables.te2[(s3 >> 8) & 0xff] ^ tables.te3[s0 & 0xff] ^ rk[1];
+        uint32_t t2 = tables.te0[s2 >> 24] ^ tables.te1[(s3 >> 16) & 0xff] ^
+                      tables.te2[(s0 >> 8) & 0xff] ^ tables.te3[s1 & 0xff] ^ rk[2];
+        uint32_t t3 = tables.te0[s3 >> 24] ^ tables.te1[(s0 >> 16) & 0xff] ^
+                      tables.te2[(s1 >> 8) & 0xff] ^ tables.te3[s2 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // Final round has no MixColumns
+    rk += 4;
+    store32(output,      (((uint32_t)SBOX[s0 >> 24] << 24) | ((uint32_t)SBOX[(s1 >> 16) & 0xff] << 16) |
+                          ((uint32_t)SBOX[(s2 >> 8) & 0xff] << 8) | (uint32_t)SBOX[s3 & 0xff]) ^ rk[0]);
+    store32(output + 4,  (((uint32_t)SBOX[s1 >> 24] << 24) | ((uint32_t)SBOX[(s2 >> 16) & 0xff] << 16) |
+                          ((uint32_t)SBOX[(s3 >> 8) & 0xff] << 8) | (uint32_t)SBOX[s0 & 0xff]) ^ rk[1]);
+    store32(output + 8,  (((uint32_t)SBOX[s2 >> 24] << 24) | ((uint32_t)SBOX[(s3 >> 16) & 0xff] << 16) |
+                          ((uint32_t)SBOX[(s0 >> 8) & 0xff] << 8) | (uint32_t)SBOX[s1 & 0xff]) ^ rk[2]);
+    store32(output + 12, (((uint32_t)SBOX[s3 >> 24] << 24) | ((uint32_t)SBOX[(s0 >> 16) & 0xff] << 16) |
+                          ((uint32_t)SBOX[(s1 >> 8) & 0xff] << 8) | (uint32_t)SBOX[s2 & 0xff]) ^ rk[3]);
+}
+
+void Aes128::encrypt(const uint8_t *key, const uint8_t *input, uint8_t *output)
+{
+    Aes128 aes(key);
+    aes.encryptBlock(input, output);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES128_H__
+#define __AES128_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Table driven AES-128 block encryption, used by the resolver for the EID and
+ * ETLM computations. Only the forward (encrypt) direction is needed: the
+ * temporary key, the EID and the EAX keystream are all produced by encrypting.
+ */
+class Aes128
+{
+public:
+    static const size_t KEY_SIZE = 16;
+    static const size_t BLOCK_SIZE = 16;
+    static const int ROUNDS = 10;
+
+    /**
+     * Construct an instance with an all zero key.
+     */
+    Aes128();
+
+    /**
+     * Construct an instance and expand the given key.
+     *
+     * @param[in] key
+     *              The 128-bit AES key.
+     */
+    explicit Aes128(const uint8_t *key);
+
+    /**
+     * Run the key schedule for a new key.
+     *
+     * @param[in] key
+     *              The 128-bit AES key.
+     */
+    void setKey(const uint8_t *key);
+
+    /**
+     * AES128 ECB encrypts a single 16-byte block. input and output may alias.
+     *
+     * @param[in] input
+     *              The 16-byte plaintext block.
+     * @param[out] output
+     *              The 16-byte ciphertext block.
+     */
+    void encryptBlock(const uint8_t *input, uint8_t *output) const;
+
+    /**
+     * One-shot helper: expand key and encrypt a single block.
+     */
+    static void encrypt(const uint8_t *key, const uint8_t *input, uint8_t *output);
+
+#ifdef AES128_STATS
+    /**
+     * Operation counters, only compiled in for the benchmarks.
+     */
+    static uint64_t keyExpansions;
+    static uint64_t blockEncryptions;
+#endif
+
+private:
+    uint32_t roundKeys[4 * (ROUNDS + 1)];
+};
+
+#endif  /* __AES128_H__ */
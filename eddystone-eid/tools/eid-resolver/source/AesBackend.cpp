@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AesBackend.h"
+#include "Aes128.h"
+
+namespace {
+
+class ReferenceAesBackend : public AesBackend
+{
+public:
+    virtual const char *getName() const
+    {
+        return "reference";
+    }
+
+    virtual void encryptKeys(const uint8_t *keys, const uint8_t *blocks, size_t blockStride,
+                             size_t count, uint8_t *output) const
+    {
+        for (size_t i = 0; i < count; i++) {
+            Aes128 aes(keys + i * Aes128::KEY_SIZE);
+            aes.encryptBlock(blocks + i * blockStride, output + i * Aes128::BLOCK_SIZE);
+        }
+    }
+
+    virtual void encryptBlocks(const uint8_t *key, const uint8_t *input, size_t count,
+                               uint8_t *output) const
+    {
+        Aes128 aes(key);
+        for (size_t i = 0; i < count; i++) {
+            aes.encryptBlock(input + i * Aes128::BLOCK_SIZE, output + i * Aes128::BLOCK_SIZE);
+        }
+    }
+};
+
+const ReferenceAesBackend referenceBackend;
+
+} // namespace
+
+const AesBackend &AesBackend::getReference()
+{
+    return referenceBackend;
+}
+
+const AesBackend &AesBackend::get()
+{
+    static const AesBackend *best = getAesNi() ? getAesNi() : &referenceBackend;
+    return *best;
+}
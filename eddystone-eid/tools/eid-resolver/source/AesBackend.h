@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AESBACKEND_H__
+#define __AESBACKEND_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Batched AES-128 encryption used for the bulk EID computation. The two EID
+ * steps map onto the two entry points:
+ *
+ *  - temporary keys: one block under many identity keys (encryptKeys)
+ *  - EIDs: many blocks under one temporary key (encryptBlocks)
+ *
+ * Implementations keep several independent blocks in flight so that the AES
+ * round latency is hidden. get() returns the fastest backend supported by the
+ * CPU the code runs on.
+ */
+class AesBackend
+{
+public:
+    virtual ~AesBackend() { }
+
+    /**
+     * Name of the backend, for diagnostics.
+     */
+    virtual const char *getName() const = 0;
+
+    /**
+     * Encrypt one block under each of count keys:
+     * output[i] = AES(keys[i], blocks + i * blockStride).
+     *
+     * @param[in] keys
+     *              count consecutive 16-byte keys.
+     * @param[in] blocks
+     *              The plaintext blocks.
+     * @param[in] blockStride
+     *              Distance in bytes between plaintext blocks: 16 for one
+     *              block per key, 0 to encrypt the same block under all keys.
+     * @param[in] count
+     *              Number of keys.
+     * @param[out] output
+     *              count consecutive 16-byte ciphertext blocks.
+     */
+    virtual void encryptKeys(const uint8_t *keys, const uint8_t *blocks, size_t blockStride,
+                             size_t count, uint8_t *output) const = 0;
+
+    /**
+     * Encrypt count consecutive blocks under a single key (ECB).
+     *
+     * @param[in] key
+     *              The 16-byte key.
+     * @param[in] input
+     *              count consecutive 16-byte plaintext blocks.
+     * @param[in] count
+     *              Number of blocks.
+     * @param[out] output
+     *              count consecutive 16-byte ciphertext blocks. May alias input.
+     */
+    virtual void encryptBlocks(const uint8_t *key, const uint8_t *input, size_t count,
+                               uint8_t *output) const = 0;
+
+    /**
+     * The fastest backend available on this CPU, detected on first use.
+     */
+    static const AesBackend &get();
+
+    /**
+     * Portable table driven backend, available everywhere.
+     */
+    static const AesBackend &getReference();
+
+    /**
+     * AES-NI backend, or NULL if the CPU or compiler does not support it.
+     */
+    static const AesBackend *getAesNi();
+
+    /**
+     * Bitsliced backend (see BitslicedAes), for encryptKeys on large batches.
+     * Available everywhere; 256 keys per pass with AVX2.
+     */
+    static const AesBackend &getBitsliced();
+};
+
+#endif  /* __AESBACKEND_H__ */
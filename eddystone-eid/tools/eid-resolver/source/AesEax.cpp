@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AesEax.h"
+#include <string.h>
+
+namespace {
+
+/** Multiply by x in GF(2^128), as gf128_double_ in the firmware */
+void gf128Double(uint8_t *val)
+{
+    int carry = val[0] >> 7;
+    int xv = (-carry) & 0x87;
+    for (int i = 15; i >= 0; i--) {
+        carry = val[i] >> 7;
+        val[i] = (uint8_t)((val[i] << 1) ^ xv);
+        xv = carry;
+    }
+}
+
+void xorBlock(uint8_t *dst, const uint8_t *src)
+{
+    for (size_t i = 0; i < Aes128::BLOCK_SIZE; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+} // namespace
+
+AesEax::AesEax()
+{
+    uint8_t zeroKey[Aes128::KEY_SIZE];
+    memset(zeroKey, 0, sizeof(zeroKey));
+    setKey(zeroKey);
+}
+
+AesEax::AesEax(const uint8_t *key)
+{
+    setKey(key);
+}
+
+void AesEax::setKey(const uint8_t *key)
+{
+    aes.setKey(key);
+    memset(padFull, 0, sizeof(padFull));
+    aes.encryptBlock(padFull, padFull);
+    gf128Double(padFull);
+    memcpy(padPartial, padFull, sizeof(padPartial));
+    gf128Double(padPartial);
+    omac(1, NULL, 0, headerMac);
+}
+
+void AesEax::omac(uint8_t param, const uint8_t *data, size_t length, uint8_t *mac) const
+{
+    // The first CMAC block is [param]_16
+    uint8_t state[Aes128::BLOCK_SIZE];
+    memset(state, 0, sizeof(state));
+    state[15] = param;
+
+    if (length == 0) {
+        // [param]_16 is the last block and it is complete
+        xorBlock(state, padFull);
+        aes.encryptBlock(state, mac);
+        return;
+    }
+
+    while (length > Aes128::BLOCK_SIZE) {
+        aes.encryptBlock(state, state);
+        xorBlock(state, data);
+        data += Aes128::BLOCK_SIZE;
+        length -= Aes128::BLOCK_SIZE;
+    }
+
+    aes.encryptBlock(state, state);
+    if (length == Aes128::BLOCK_SIZE) {
+        xorBlock(state, data);
+        xorBlock(state, padFull);
+    } else {
+        for (size_t i = 0; i < length; i++) {
+            state[i] ^= data[i];
+        }
+        state[length] ^= 0x80;
+        xorBlock(state, padPartial);
+    }
+    aes.encryptBlock(state, mac);
+}
+
+void AesEax::ctr(const uint8_t *nonceMac, const uint8_t *input, size_t length, uint8_t *output) const
+{
+    uint8_t counter[Aes128::BLOCK_SIZE];
+    uint8_t keystream[Aes128::BLOCK_SIZE];
+    memcpy(counter, nonceMac, sizeof(counter));
+
+    for (size_t offset = 0; offset < length; offset += Aes128::BLOCK_SIZE) {
+        aes.encryptBlock(counter, keystream);
+        size_t n = length - offset < Aes128::BLOCK_SIZE ? length - offset : Aes128::BLOCK_SIZE;
+        for (size_t i = 0; i < n; i++) {
+            output[offset + i] = input[offset + i] ^ keystream[i];
+        }
+        // Big endian increment over the whole block, as mbedtls_aes_crypt_ctr
+        for (int i = Aes128::BLOCK_SIZE - 1; i >= 0; i--) {
+            if (++counter[i] != 0) {
+                break;
+            }
+        }
+    }
+}
+
+void AesEax::encrypt(const uint8_t *nonce, size_t nonceLength, const uint8_t *input, size_t length,
+                     uint8_t *output, uint8_t *tag, size_t tagLength) const
+{
+    uint8_t nonceMac[Aes128::BLOCK_SIZE];
+    uint8_t ciphertextMac[Aes128::BLOCK_SIZE];
+    omac(0, nonce, nonceLength, nonceMac);
+    ctr(nonceMac, input, length, output);
+    omac(2, output, length, ciphertextMac);
+    for (size_t i = 0; i < tagLength && i < TAG_MAX_LENGTH; i++) {
+        tag[i] = headerMac[i] ^ nonceMac[i] ^ ciphertextMac[i];
+    }
+}
+
+int AesEax::decrypt(const uint8_t *nonce, size_t nonceLength, const uint8_t *input, size_t length,
+                    uint8_t *output, const uint8_t *tag, size_t tagLength) const
+{
+    uint8_t nonceMac[Aes128::BLOCK_SIZE];
+    uint8_t ciphertextMac[Aes128::BLOCK_SIZE];
+    omac(0, nonce, nonceLength, nonceMac);
+    omac(2, input, length, ciphertextMac);
+    uint8_t diff = 0;
+    for (size_t i = 0; i < tagLength && i < TAG_MAX_LENGTH; i++) {
+        diff |= headerMac[i] ^ nonceMac[i] ^ ciphertextMac[i] ^ tag[i];
+    }
+    if (diff) {
+        return EAX_AUTH_FAILED;
+    }
+    ctr(nonceMac, input, length, output);
+    return EAX_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AESEAX_H__
+#define __AESEAX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Aes128.h"
+
+/**
+ * AES-EAX with an empty header, as used for Eddystone-ETLM. Host side port of
+ * eddy_eax_authcrypt (implementations/mbed/source/aes_eax.cpp).
+ *
+ * Everything that only depends on the key is computed once in setKey(): the
+ * expanded key, the CMAC padding subkeys 2L and 4L (L = AES_K(0)) and the MAC
+ * of the empty header. A short message then costs one CMAC block for the
+ * nonce, one for the ciphertext and one CTR block per 16 bytes of message.
+ */
+class AesEax
+{
+public:
+    static const int EAX_SUCCESS = 0;
+    static const int EAX_AUTH_FAILED = -1;
+    static const size_t TAG_MAX_LENGTH = 16;
+
+    /**
+     * Construct an instance with an all zero key.
+     */
+    AesEax();
+
+    /**
+     * Construct an instance and precompute the key dependent state.
+     *
+     * @param[in] key
+     *              The 128-bit AES key.
+     */
+    explicit AesEax(const uint8_t *key);
+
+    /**
+     * Precompute the key dependent state for a new key.
+     *
+     * @param[in] key
+     *              The 128-bit AES key.
+     */
+    void setKey(const uint8_t *key);
+
+    /**
+     * Encrypt and authenticate a message.
+     *
+     * @param[in] nonce
+     *              The nonce.
+     * @param[in] nonceLength
+     *              Length of the nonce in bytes.
+     * @param[in] input
+     *              The plaintext.
+     * @param[in] length
+     *              Length of input and output in bytes.
+     * @param[out] output
+     *              The ciphertext.
+     * @param[out] tag
+     *              The (truncated) authentication tag.
+     * @param[in] tagLength
+     *              Length of the tag, at most TAG_MAX_LENGTH.
+     */
+    void encrypt(const uint8_t *nonce, size_t nonceLength, const uint8_t *input, size_t length,
+                 uint8_t *output, uint8_t *tag, size_t tagLength) const;
+
+    /**
+     * Verify and decrypt a message. output is only written if the tag matches.
+     *
+     * @return EAX_SUCCESS or EAX_AUTH_FAILED.
+     */
+    int decrypt(const uint8_t *nonce, size_t nonceLength, const uint8_t *input, size_t length,
+                uint8_t *output, const uint8_t *tag, size_t tagLength) const;
+
+private:
+    /**
+     * OMAC^param of data: CMAC over a block holding param, followed by data.
+     */
+    void omac(uint8_t param, const uint8_t *data, size_t length, uint8_t *mac) const;
+
+    /**
+     * CTR mode keystream starting from the nonce MAC.
+     */
+    void ctr(const uint8_t *nonceMac, const uint8_t *input, size_t length, uint8_t *output) const;
+
+    Aes128  aes;
+    uint8_t padFull[Aes128::BLOCK_SIZE];
+    uint8_t padPartial[Aes128::BLOCK_SIZE];
+    uint8_t headerMac[Aes128::BLOCK_SIZE];
+};
+
+#endif  /* __AESEAX_H__ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AES-NI backend. The functions are compiled for the AES-NI target with
+ * function attributes, so the rest of the library builds without -maes and
+ * this backend is only used after the CPU was checked to support it.
+ */
+
+#include "AesBackend.h"
+#include "Aes128.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#define AESNI_TARGET __attribute__((target("aes,ssse3")))
+
+namespace {
+
+/**
+ * Independent blocks kept in flight. aesenc has a latency of 4 to 7 cycles
+ * and a throughput of 1 or 2 per cycle on current cores, so 8 blocks are
+ * enough to keep the AES unit busy.
+ */
+const size_t LANES = 8;
+const int ROUNDS = Aes128::ROUNDS;
+
+AESNI_TARGET inline __m128i expandStep(__m128i key, __m128i subRot)
+{
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, subRot);
+}
+
+/**
+ * Key schedule without aeskeygenassist, whose low throughput would serialize
+ * the expansion of independent keys: pshufb broadcasts RotWord of the last
+ * word to all columns, so ShiftRows in aesenclast is a no-op and it computes
+ * SubWord(RotWord(w)) ^ rcon.
+ */
+AESNI_TARGET inline void expandKey(const uint8_t *key, __m128i *rk)
+{
+    const __m128i rotWord = _mm_set1_epi32(0x0c0f0e0d);
+    __m128i rcon = _mm_set1_epi32(0x01);
+    rk[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key));
+    for (int r = 1; r <= ROUNDS; r++) {
+        if (r == 9) {
+            rcon = _mm_set1_epi32(0x1b);
+        }
+        __m128i subRot = _mm_aesenclast_si128(_mm_shuffle_epi8(rk[r - 1], rotWord), rcon);
+        rk[r] = expandStep(rk[r - 1], subRot);
+        rcon = _mm_slli_epi32(rcon, 1);
+    }
+}
+
+AESNI_TARGET inline __m128i encryptOne(const __m128i *rk, __m128i block)
+{
+    block = _mm_xor_si128(block, rk[0]);
+    for (int r = 1; r < ROUNDS; r++) {
+        block = _mm_aesenc_si128(block, rk[r]);
+    }
+    return _mm_aesenclast_si128(block, rk[ROUNDS]);
+}
+
+class AesNiBackend : public AesBackend
+{
+public:
+    virtual const char *getName() const
+    {
+        return "aes-ni";
+    }
+
+    AESNI_TARGET virtual void encryptKeys(const uint8_t *keys, const uint8_t *blocks, size_t blockStride,
+                                          size_t count, uint8_t *output) const
+    {
+        // The round keys of each lane are generated on the fly, one round at
+        // a time across all lanes, so that the key schedules overlap
+        const __m128i rotWord = _mm_set1_epi32(0x0c0f0e0d);
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            __m128i rk[LANES];
+            __m128i state[LANES];
+            for (size_t j = 0; j < LANES; j++) {
+                rk[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + (i + j) * Aes128::KEY_SIZE));
+                state[j] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + (i + j) * blockStride)),
+                                         rk[j]);
+            }
+            __m128i rcon = _mm_set1_epi32(0x01);
+            for (int r = 1; r <= ROUNDS; r++) {
+                if (r == 9) {
+                    rcon = _mm_set1_epi32(0x1b);
+                }
+                for (size_t j = 0; j < LANES; j++) {
+                    rk[j] = expandStep(rk[j], _mm_aesenclast_si128(_mm_shuffle_epi8(rk[j], rotWord), rcon));
+                    state[j] = (r < ROUNDS) ? _mm_aesenc_si128(state[j], rk[j]) : _mm_aesenclast_si128(state[j], rk[j]);
+                }
+                rcon = _mm_slli_epi32(rcon, 1);
+            }
+            for (size_t j = 0; j < LANES; j++) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (i + j) * Aes128::BLOCK_SIZE), state[j]);
+            }
+        }
+        for (; i < count; i++) {
+            __m128i rk[ROUNDS + 1];
+            expandKey(keys + i * Aes128::KEY_SIZE, rk);
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + i * blockStride));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i * Aes128::BLOCK_SIZE), encryptOne(rk, block));
+        }
+#ifdef AES128_STATS
+        Aes128::keyExpansions += count;
+        Aes128::blockEncryptions += count;
+#endif
+    }
+
+    AESNI_TARGET virtual void encryptBlocks(const uint8_t *key, const uint8_t *input, size_t count,
+                                            uint8_t *output) const
+    {
+        __m128i rk[ROUNDS + 1];
+        expandKey(key, rk);
+
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            __m128i state[LANES];
+            for (size_t j = 0; j < LANES; j++) {
+                state[j] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + (i + j) * Aes128::BLOCK_SIZE)),
+                                         rk[0]);
+            }
+            for (int r = 1; r < ROUNDS; r++) {
+                for (size_t j = 0; j < LANES; j++) {
+                    state[j] = _mm_aesenc_si128(state[j], rk[r]);
+                }
+            }
+            for (size_t j = 0; j < LANES; j++) {
+                state[j] = _mm_aesenclast_si128(state[j], rk[ROUNDS]);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (i + j) * Aes128::BLOCK_SIZE), state[j]);
+            }
+        }
+        for (; i < count; i++) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i * Aes128::BLOCK_SIZE));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i * Aes128::BLOCK_SIZE), encryptOne(rk, block));
+        }
+#ifdef AES128_STATS
+        Aes128::keyExpansions++;
+        Aes128::blockEncryptions += count;
+#endif
+    }
+};
+
+const AesNiBackend aesNiBackend;
+
+} // namespace
+
+const AesBackend *AesBackend::getAesNi()
+{
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("aes") && __builtin_cpu_supports("ssse3")) ? &aesNiBackend : NULL;
+}
+
+#else
+
+const AesBackend *AesBackend::getAesNi()
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BitslicedAes.h"
+#include "BitslicedAesKernel.h"
+#include "AesBackend.h"
+#include "Aes128.h"
+#include <string.h>
+
+namespace {
+
+/**
+ * 128 lanes use the generic vector extension, which is SSE2 on x86-64 and
+ * NEON on ARM. 64 lanes run on plain 64-bit integers.
+ */
+typedef uint64_t BitslicedV128 __attribute__((vector_size(16)));
+
+const BitslicedKernelOps kernel64 = {
+    64, expandKeys<uint64_t>, encryptLanes<uint64_t>, deriveKeys<uint64_t>
+};
+const BitslicedKernelOps kernel128 = {
+    128, expandKeys<BitslicedV128>, encryptLanes<BitslicedV128>, deriveKeys<BitslicedV128>
+};
+
+const size_t SCHEDULE_ALIGNMENT = 32;
+
+const BitslicedKernelOps *selectKernel(size_t lanes)
+{
+    const BitslicedKernelOps *avx2 = getBitslicedAvx2Kernel();
+    if ((lanes == 0 || lanes >= 256) && avx2 != NULL) {
+        return avx2;
+    }
+    return (lanes == 0 || lanes >= 128) ? &kernel128 : &kernel64;
+}
+
+/**
+ * AesBackend on top of BitslicedAes. Only encryptKeys benefits from the
+ * bitsliced layout; batches too small to fill a quarter of the lanes, and
+ * the single key encryptBlocks, go to the fastest per key backend.
+ */
+class BitslicedAesBackend : public AesBackend
+{
+public:
+    virtual const char *getName() const
+    {
+        return "bitsliced";
+    }
+
+    virtual void encryptKeys(const uint8_t *keys, const uint8_t *blocks, size_t blockStride,
+                             size_t count, uint8_t *output) const
+    {
+        BitslicedAes aes;
+        size_t lanes = aes.getLanes();
+        if (count < lanes / 4) {
+            perKeyBackend().encryptKeys(keys, blocks, blockStride, count, output);
+            return;
+        }
+        for (size_t i = 0; i < count; i += lanes) {
+            size_t n = (count - i < lanes) ? count - i : lanes;
+            aes.setKeys(keys + i * Aes128::KEY_SIZE, n);
+            aes.encrypt(blocks + i * blockStride, blockStride, output + i * Aes128::BLOCK_SIZE);
+        }
+#ifdef AES128_STATS
+        Aes128::keyExpansions += count;
+        Aes128::blockEncryptions += count;
+#endif
+    }
+
+    virtual void encryptBlocks(const uint8_t *key, const uint8_t *input, size_t count,
+                               uint8_t *output) const
+    {
+        perKeyBackend().encryptBlocks(key, input, count, output);
+    }
+
+private:
+    static const AesBackend &perKeyBackend()
+    {
+        return AesBackend::getAesNi() ? *AesBackend::getAesNi() : AesBackend::getReference();
+    }
+};
+
+const BitslicedAesBackend bitslicedBackend;
+
+} // namespace
+
+BitslicedAes::BitslicedAes(size_t lanes) :
+    kernel(selectKernel(lanes)),
+    keyCount(0),
+    schedule(getScheduleWords() + SCHEDULE_ALIGNMENT / 8)
+{
+}
+
+BitslicedAes::BitslicedAes(const BitslicedAes &other) :
+    kernel(other.kernel),
+    keyCount(0),
+    schedule(getScheduleWords() + SCHEDULE_ALIGNMENT / 8)
+{
+    *this = other;
+}
+
+BitslicedAes &BitslicedAes::operator=(const BitslicedAes &other)
+{
+    if (this != &other) {
+        // The aligned start of the schedule depends on where it was allocated
+        if (kernel != other.kernel) {
+            kernel = other.kernel;
+            schedule.assign(getScheduleWords() + SCHEDULE_ALIGNMENT / 8, 0);
+        }
+        keyCount = other.keyCount;
+        memcpy(getSchedule(), other.getSchedule(), getScheduleWords() * sizeof(uint64_t));
+    }
+    return *this;
+}
+
+size_t BitslicedAes::getMaxLanes()
+{
+    return selectKernel(0)->lanes;
+}
+
+size_t BitslicedAes::getLanes() const
+{
+    return kernel->lanes;
+}
+
+void BitslicedAes::setKeys(const uint8_t *keys, size_t count)
+{
+    keyCount = (count < kernel->lanes) ? count : kernel->lanes;
+    kernel->expandKeys(keys, Aes128::KEY_SIZE, keyCount, getSchedule());
+}
+
+void BitslicedAes::encrypt(const uint8_t *blocks, size_t blockStride, uint8_t *output) const
+{
+    if (keyCount == 0) {
+        return;
+    }
+    kernel->encrypt(getSchedule(), blocks, blockStride, keyCount, output);
+}
+
+void BitslicedAes::deriveKeys(const uint8_t *blocks, size_t blockStride, BitslicedAes &derived) const
+{
+    if (derived.kernel != kernel) {
+        uint8_t output[MAX_LANES * 16];
+        encrypt(blocks, blockStride, output);
+        derived.setKeys(output, keyCount);
+        return;
+    }
+    derived.keyCount = keyCount;
+    kernel->deriveKeys(getSchedule(), blocks, blockStride, keyCount, derived.getSchedule());
+}
+
+size_t BitslicedAes::getScheduleWords() const
+{
+    return BitslicedKernel<uint64_t>::SCHEDULE_WORDS * (kernel->lanes / 64);
+}
+
+const uint64_t *BitslicedAes::getSchedule() const
+{
+    uintptr_t p = reinterpret_cast<uintptr_t>(&schedule[0]);
+    return reinterpret_cast<const uint64_t *>((p + SCHEDULE_ALIGNMENT - 1) & ~(uintptr_t)(SCHEDULE_ALIGNMENT - 1));
+}
+
+uint64_t *BitslicedAes::getSchedule()
+{
+    return const_cast<uint64_t *>(static_cast<const BitslicedAes *>(this)->getSchedule());
+}
+
+const AesBackend &AesBackend::getBitsliced()
+{
+    return bitslicedBackend;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BITSLICEDAES_H__
+#define __BITSLICEDAES_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+struct BitslicedKernelOps;
+
+/**
+ * Bitsliced AES-128 for the "one block under many keys" shape of the EID
+ * temporary key step: at a rotation boundary the same beacon time is
+ * encrypted under the identity key of every beacon.
+ *
+ * Up to getLanes() keys (64, 128 or 256) are processed in one pass, one key
+ * per bit lane of a 64-bit word, an SSE2 or an AVX2 register. The round
+ * functions become boolean operations on whole registers, with no table
+ * lookups, so the code is also constant time.
+ *
+ * setKeys() transposes the keys and runs the key schedule once. The bitsliced
+ * round keys are kept, so that the identity keys of a group of beacons are
+ * expanded once and every later time step only costs the encryption.
+ */
+class BitslicedAes
+{
+public:
+    static const size_t MAX_LANES = 256;
+
+    /**
+     * @param[in] lanes
+     *              Keys per pass: 64, 128 or 256. 0 selects the widest width
+     *              supported by the CPU, see getMaxLanes().
+     */
+    explicit BitslicedAes(size_t lanes = 0);
+
+    BitslicedAes(const BitslicedAes &other);
+
+    BitslicedAes &operator=(const BitslicedAes &other);
+
+    /**
+     * Widest width supported on this CPU: 256 with AVX2, 128 otherwise.
+     */
+    static size_t getMaxLanes();
+
+    size_t getLanes() const;
+
+    size_t getKeyCount() const { return keyCount; }
+
+    /**
+     * Load a group of keys and precompute their bitsliced key schedule.
+     *
+     * @param[in] keys
+     *              count consecutive 16-byte keys.
+     * @param[in] count
+     *              Number of keys, at most getLanes().
+     */
+    void setKeys(const uint8_t *keys, size_t count);
+
+    /**
+     * Encrypt one block under each of the loaded keys:
+     * output[i] = AES(key[i], blocks + i * blockStride).
+     *
+     * @param[in] blocks
+     *              The plaintext blocks.
+     * @param[in] blockStride
+     *              Distance in bytes between plaintext blocks: 16 for one
+     *              block per key, 0 to encrypt the same block under all keys.
+     * @param[out] output
+     *              getKeyCount() consecutive 16-byte ciphertext blocks.
+     */
+    void encrypt(const uint8_t *blocks, size_t blockStride, uint8_t *output) const;
+
+    /**
+     * Encrypt one block under each of the loaded keys and load the results
+     * as the keys of derived, without transposing them out of the bitsliced
+     * form. This chains the two EID stages: identity key to temporary key,
+     * then temporary key to EID.
+     *
+     * @param[in] blocks
+     *              The plaintext blocks, see encrypt().
+     * @param[in] blockStride
+     *              Distance in bytes between plaintext blocks.
+     * @param[out] derived
+     *              Receives getKeyCount() keys and their key schedule.
+     */
+    void deriveKeys(const uint8_t *blocks, size_t blockStride, BitslicedAes &derived) const;
+
+private:
+    size_t getScheduleWords() const;
+    const uint64_t *getSchedule() const;
+    uint64_t *getSchedule();
+
+    const BitslicedKernelOps    *kernel;
+    size_t                      keyCount;
+    /**
+     * Bitsliced round keys, 11 * 128 registers of lanes bits. Over allocated
+     * so that the schedule can be aligned for the vector loads.
+     */
+    std::vector<uint64_t>       schedule;
+};
+
+#endif  /* __BITSLICEDAES_H__ */
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * 256 lane bitsliced kernel. Everything after the target pragma is compiled
+ * for AVX2, so this file must not instantiate anything shared with other
+ * translation units: the kernel header only has internal linkage functions
+ * and no standard library templates are used here. The kernel is only handed
+ * out after the CPU was checked to support AVX2.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#pragma GCC target("avx2")
+
+#include "BitslicedAesKernel.h"
+
+namespace {
+
+typedef uint64_t BitslicedV256 __attribute__((vector_size(32)));
+
+const BitslicedKernelOps kernel256 = {
+    256, expandKeys<BitslicedV256>, encryptLanes<BitslicedV256>, deriveKeys<BitslicedV256>
+};
+
+} // namespace
+
+const BitslicedKernelOps *getBitslicedAvx2Kernel()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? &kernel256 : NULL;
+}
+
+#else
+
+#include "BitslicedAesKernel.h"
+
+const BitslicedKernelOps *getBitslicedAvx2Kernel()
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bitsliced AES-128 kernel shared by BitslicedAes.cpp and
+ * BitslicedAesAvx2.cpp. Every function has internal linkage, so that each
+ * translation unit gets its own copy compiled for its own target.
+ *
+ * A bitsliced state is 128 words of type V (a 64, 128 or 256-bit vector).
+ * Word p * 8 + b holds bit b of byte p of the AES state, for every lane, and
+ * lane j of every word belongs to the same key. The round functions are then
+ * plain boolean operations on whole words and process all lanes at once.
+ */
+
+#ifndef __BITSLICEDAESKERNEL_H__
+#define __BITSLICEDAESKERNEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Entry points of one kernel width, selected at runtime by BitslicedAes.
+ */
+struct BitslicedKernelOps {
+    size_t lanes;
+    void (*expandKeys)(const uint8_t *keys, size_t keyStride, size_t count, uint64_t *schedule);
+    void (*encrypt)(const uint64_t *schedule, const uint8_t *blocks, size_t blockStride, size_t count,
+                    uint8_t *output);
+    void (*deriveKeys)(const uint64_t *schedule, const uint8_t *blocks, size_t blockStride, size_t count,
+                       uint64_t *derivedSchedule);
+};
+
+/**
+ * 256 lane kernel from BitslicedAesAvx2.cpp, or NULL if the CPU or compiler
+ * does not support AVX2.
+ */
+const BitslicedKernelOps *getBitslicedAvx2Kernel();
+
+namespace {
+
+template <typename V>
+struct BitslicedKernel {
+    static const size_t LANES = sizeof(V) * 8;
+    static const size_t WORDS = sizeof(V) / 8;
+    static const int ROUNDS = 10;
+    static const size_t STATE_WORDS = 128;
+    static const size_t SCHEDULE_WORDS = (ROUNDS + 1) * STATE_WORDS;
+
+    static V allOnes()
+    {
+        V v;
+        memset(&v, 0xff, sizeof(v));
+        return v;
+    }
+
+    static V zero()
+    {
+        V v;
+        memset(&v, 0, sizeof(v));
+        return v;
+    }
+
+    /**
+     * AES S-box on the 8 bit planes q[0] (LSB) .. q[7] (MSB) of a byte, using
+     * the 113 gate circuit of Boyar and Peralta.
+     */
+    static void sbox(V *q)
+    {
+        V x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+        V x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+        // Top linear transformation
+        V y14 = x3 ^ x5;
+        V y13 = x0 ^ x6;
+        V y9 = x0 ^ x3;
+        V y8 = x0 ^ x5;
+        V t0 = x1 ^ x2;
+        V y1 = t0 ^ x7;
+        V y4 = y1 ^ x3;
+        V y12 = y13 ^ y14;
+        V y2 = y1 ^ x0;
+        V y5 = y1 ^ x6;
+        V y3 = y5 ^ y8;
+        V t1 = x4 ^ y12;
+        V y15 = t1 ^ x5;
+        V y20 = t1 ^ x1;
+        V y6 = y15 ^ x7;
+        V y10 = y15 ^ t0;
+        V y11 = y20 ^ y9;
+        V y7 = x7 ^ y11;
+        V y17 = y10 ^ y11;
+        V y19 = y10 ^ y8;
+        V y16 = t0 ^ y11;
+        V y21 = y13 ^ y16;
+        V y18 = x0 ^ y16;
+
+        // Non-linear section
+        V t2 = y12 & y15;
+        V t3 = y3 & y6;
+        V t4 = t3 ^ t2;
+        V t5 = y4 & x7;
+        V t6 = t5 ^ t2;
+        V t7 = y13 & y16;
+        V t8 = y5 & y1;
+        V t9 = t8 ^ t7;
+        V t10 = y2 & y7;
+        V t11 = t10 ^ t7;
+        V t12 = y9 & y11;
+        V t13 = y14 & y17;
+        V t14 = t13 ^ t12;
+        V t15 = y8 & y10;
+        V t16 = t15 ^ t12;
+        V t17 = t4 ^ t14;
+        V t18 = t6 ^ t16;
+        V t19 = t9 ^ t14;
+        V t20 = t11 ^ t16;
+        V t21 = t17 ^ y20;
+        V t22 = t18 ^ y19;
+        V t23 = t19 ^ y21;
+        V t24 = t20 ^ y18;
+
+        V t25 = t21 ^ t22;
+        V t26 = t21 & t23;
+        V t27 = t24 ^ t26;
+        V t28 = t25 & t27;
+        V t29 = t28 ^ t22;
+        V t30 = t23 ^ t24;
+        V t31 = t22 ^ t26;
+        V t32 = t31 & t30;
+        V t33 = t32 ^ t24;
+        V t34 = t23 ^ t33;
+        V t35 = t27 ^ t33;
+        V t36 = t24 & t35;
+        V t37 = t36 ^ t34;
+        V t38 = t27 ^ t36;
+        V t39 = t29 & t38;
+        V t40 = t25 ^ t39;
+
+        V t41 = t40 ^ t37;
+        V t42 = t29 ^ t33;
+        V t43 = t29 ^ t40;
+        V t44 = t33 ^ t37;
+        V t45 = t42 ^ t41;
+        V z0 = t44 & y15;
+        V z1 = t37 & y6;
+        V z2 = t33 & x7;
+        V z3 = t43 & y16;
+        V z4 = t40 & y1;
+        V z5 = t29 & y7;
+        V z6 = t42 & y11;
+        V z7 = t45 & y17;
+        V z8 = t41 & y10;
+        V z9 = t44 & y12;
+        V z10 = t37 & y3;
+        V z11 = t33 & y4;
+        V z12 = t43 & y13;
+        V z13 = t40 & y5;
+        V z14 = t29 & y2;
+        V z15 = t42 & y9;
+        V z16 = t45 & y14;
+        V z17 = t41 & y8;
+
+        // Bottom linear transformation
+        V t46 = z15 ^ z16;
+        V t47 = z10 ^ z11;
+        V t48 = z5 ^ z13;
+        V t49 = z9 ^ z10;
+        V t50 = z2 ^ z12;
+        V t51 = z2 ^ z5;
+        V t52 = z7 ^ z8;
+        V t53 = z0 ^ z3;
+        V t54 = z6 ^ z7;
+        V t55 = z16 ^ z17;
+        V t56 = z12 ^ t48;
+        V t57 = t50 ^ t53;
+        V t58 = z4 ^ t46;
+        V t59 = z3 ^ t54;
+        V t60 = t46 ^ t57;
+        V t61 = z14 ^ t57;
+        V t62 = t52 ^ t58;
+        V t63 = t49 ^ t58;
+        V t64 = z4 ^ t59;
+        V t65 = t61 ^ t62;
+        V t66 = z1 ^ t63;
+        V s0 = t59 ^ t63;
+        V s6 = t56 ^ ~t62;
+        V s7 = t48 ^ ~t60;
+        V t67 = t64 ^ t65;
+        V s3 = t53 ^ t66;
+        V s4 = t51 ^ t66;
+        V s5 = t47 ^ t65;
+        V s1 = t64 ^ ~s3;
+        V s2 = t55 ^ ~t67;
+
+        q[7] = s0; q[6] = s1; q[5] = s2; q[4] = s3;
+        q[3] = s4; q[2] = s5; q[1] = s6; q[0] = s7;
+    }
+
+    /**
+     * SubBytes followed by ShiftRows: byte (row r, column c) of the result is
+     * S(byte (r, c + r mod 4)) of the input. Byte index is r + 4 * c.
+     */
+    static void subBytesShiftRows(const V *in, V *out)
+    {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                const V *src = in + (r + 4 * ((c + r) & 3)) * 8;
+                V *dst = out + (r + 4 * c) * 8;
+                for (int b = 0; b < 8; b++) {
+                    dst[b] = src[b];
+                }
+                sbox(dst);
+            }
+        }
+    }
+
+    /**
+     * MixColumns: b_i = 2 * (a_i ^ a_i+1) ^ a_i+1 ^ a_i+2 ^ a_i+3
+     */
+    static void mixColumns(V *st)
+    {
+        for (int c = 0; c < 4; c++) {
+            V *a[4];
+            for (int i = 0; i < 4; i++) {
+                a[i] = st + (4 * c + i) * 8;
+            }
+            V out[4][8];
+            for (int i = 0; i < 4; i++) {
+                const V *a1 = a[(i + 1) & 3], *a2 = a[(i + 2) & 3], *a3 = a[(i + 3) & 3];
+                V t[8];
+                for (int b = 0; b < 8; b++) {
+                    t[b] = a[i][b] ^ a1[b];
+                }
+                // xtime: multiply by x modulo x^8 + x^4 + x^3 + x + 1
+                V xt[8];
+                xt[0] = t[7];
+                xt[1] = t[0] ^ t[7];
+                xt[2] = t[1];
+                xt[3] = t[2] ^ t[7];
+                xt[4] = t[3] ^ t[7];
+                xt[5] = t[4];
+                xt[6] = t[5];
+                xt[7] = t[6];
+                for (int b = 0; b < 8; b++) {
+                    out[i][b] = xt[b] ^ a1[b] ^ a2[b] ^ a3[b];
+                }
+            }
+            for (int i = 0; i < 4; i++) {
+                for (int b = 0; b < 8; b++) {
+                    a[i][b] = out[i][b];
+                }
+            }
+        }
+    }
+
+    static void addRoundKey(V *st, const V *rk)
+    {
+        for (size_t i = 0; i < STATE_WORDS; i++) {
+            st[i] ^= rk[i];
+        }
+    }
+
+    /**
+     * Expand bitsliced keys (128 words) into the bitsliced schedule of all
+     * rounds (SCHEDULE_WORDS words).
+     */
+    static void expandKey(const V *key, V *rk)
+    {
+        static const uint8_t RCON[ROUNDS] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+        for (size_t i = 0; i < STATE_WORDS; i++) {
+            rk[i] = key[i];
+        }
+        for (int round = 0; round < ROUNDS; round++) {
+            const V *prev = rk + round * STATE_WORDS;
+            V *next = rk + (round + 1) * STATE_WORDS;
+
+            // SubWord(RotWord(w3)) ^ rcon
+            V temp[32];
+            for (int i = 0; i < 4; i++) {
+                const V *src = prev + (12 + ((i + 1) & 3)) * 8;
+                for (int b = 0; b < 8; b++) {
+                    temp[i * 8 + b] = src[b];
+                }
+                sbox(temp + i * 8);
+            }
+            for (int b = 0; b < 8; b++) {
+                if (RCON[round] & (1 << b)) {
+                    temp[b] = ~temp[b];
+                }
+            }
+
+            for (int i = 0; i < 32; i++) {
+                next[i] = prev[i] ^ temp[i];
+            }
+            for (int i = 32; i < 128; i++) {
+                next[i] = prev[i] ^ next[i - 32];
+            }
+        }
+    }
+
+    static void encrypt(const V *rk, V *st)
+    {
+        V tmp[STATE_WORDS];
+        V *in = st, *out = tmp;
+        addRoundKey(in, rk);
+        for (int round = 1; round <= ROUNDS; round++) {
+            subBytesShiftRows(in, out);
+            if (round < ROUNDS) {
+                mixColumns(out);
+            }
+            addRoundKey(out, rk + round * STATE_WORDS);
+            V *swap = in;
+            in = out;
+            out = swap;
+        }
+        // ROUNDS is even, so the result is back in st
+    }
+
+    /**
+     * In place transpose of a 64x64 bit matrix: bit j of a[i] moves to bit i
+     * of a[j].
+     */
+    static void transpose64(uint64_t *a)
+    {
+        uint64_t m = 0x00000000ffffffffULL;
+        for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+            for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+                uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+                a[k] ^= t << j;
+                a[k | j] ^= t;
+            }
+        }
+    }
+
+    /**
+     * Load count 16-byte blocks (blockStride bytes apart) into a bitsliced
+     * state. Lanes count and above are zero. A stride of 0 broadcasts one
+     * block to all lanes without transposing.
+     */
+    static void load(const uint8_t *blocks, size_t blockStride, size_t count, V *st)
+    {
+        if (blockStride == 0) {
+            for (size_t i = 0; i < STATE_WORDS; i++) {
+                st[i] = ((blocks[i >> 3] >> (i & 7)) & 1) ? allOnes() : zero();
+            }
+            return;
+        }
+        uint64_t *words = reinterpret_cast<uint64_t *>(st);
+        for (size_t chunk = 0; chunk < WORDS; chunk++) {
+            for (size_t half = 0; half < 2; half++) {
+                uint64_t m[64];
+                for (size_t j = 0; j < 64; j++) {
+                    size_t lane = chunk * 64 + j;
+                    m[j] = 0;
+                    if (lane < count) {
+                        memcpy(&m[j], blocks + lane * blockStride + half * 8, 8);
+                    }
+                }
+                transpose64(m);
+                for (size_t i = 0; i < 64; i++) {
+                    words[(half * 64 + i) * WORDS + chunk] = m[i];
+                }
+            }
+        }
+    }
+
+    /**
+     * Store the first count lanes of a bitsliced state as 16-byte blocks.
+     */
+    static void store(const V *st, size_t count, uint8_t *output)
+    {
+        const uint64_t *words = reinterpret_cast<const uint64_t *>(st);
+        for (size_t chunk = 0; chunk * 64 < count; chunk++) {
+            for (size_t half = 0; half < 2; half++) {
+                uint64_t m[64];
+                for (size_t i = 0; i < 64; i++) {
+                    m[i] = words[(half * 64 + i) * WORDS + chunk];
+                }
+                transpose64(m);
+                for (size_t j = 0; j < 64 && chunk * 64 + j < count; j++) {
+                    memcpy(output + (chunk * 64 + j) * 16 + half * 8, &m[j], 8);
+                }
+            }
+        }
+    }
+};
+
+/**
+ * Transpose count keys into lanes and expand them into schedule, which must
+ * be aligned to sizeof(V).
+ */
+template <typename V>
+void expandKeys(const uint8_t *keys, size_t keyStride, size_t count, uint64_t *schedule)
+{
+    typedef BitslicedKernel<V> Kernel;
+    V key[Kernel::STATE_WORDS];
+    Kernel::load(keys, keyStride, count, key);
+    Kernel::expandKey(key, reinterpret_cast<V *>(schedule));
+}
+
+template <typename V>
+void encryptLanes(const uint64_t *schedule, const uint8_t *blocks, size_t blockStride, size_t count,
+                  uint8_t *output)
+{
+    typedef BitslicedKernel<V> Kernel;
+    V state[Kernel::STATE_WORDS];
+    Kernel::load(blocks, blockStride, count, state);
+    Kernel::encrypt(reinterpret_cast<const V *>(schedule), state);
+    Kernel::store(state, count, output);
+}
+
+/**
+ * Encrypt and expand the ciphertexts as the keys of derivedSchedule, without
+ * transposing them out of the bitsliced form.
+ */
+template <typename V>
+void deriveKeys(const uint64_t *schedule, const uint8_t *blocks, size_t blockStride, size_t count,
+                uint64_t *derivedSchedule)
+{
+    typedef BitslicedKernel<V> Kernel;
+    V state[Kernel::STATE_WORDS];
+    Kernel::load(blocks, blockStride, count, state);
+    Kernel::encrypt(reinterpret_cast<const V *>(schedule), state);
+    Kernel::expandKey(state, reinterpret_cast<V *>(derivedSchedule));
+}
+
+} // namespace
+
+#endif  /* __BITSLICEDAESKERNEL_H__ */
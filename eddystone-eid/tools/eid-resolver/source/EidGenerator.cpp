@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidGenerator.h"
+#include "Aes128.h"
+#include "AesBackend.h"
+#include "BitslicedAes.h"
+#include <string.h>
+
+void EidGenerator::temporaryKeyBlock(uint32_t beaconTimeSecs, uint8_t *block)
+{
+    memset(block, 0, 16);
+    block[11] = SALT;
+    block[14] = (beaconTimeSecs >> 24) & 0xff;
+    block[15] = (beaconTimeSecs >> 16) & 0xff;
+}
+
+void EidGenerator::eidBlock(uint8_t rotationPeriodExp, uint32_t beaconTimeSecs, uint8_t *block)
+{
+    uint32_t scaledTime = (beaconTimeSecs >> rotationPeriodExp) << rotationPeriodExp;
+    memset(block, 0, 16);
+    block[11] = rotationPeriodExp;
+    block[12] = (scaledTime >> 24) & 0xff;
+    block[13] = (scaledTime >> 16) & 0xff;
+    block[14] = (scaledTime >> 8) & 0xff;
+    block[15] = scaledTime & 0xff;
+}
+
+void EidGenerator::computeTemporaryKey(const uint8_t *eidIdentityKey, uint32_t beaconTimeSecs, uint8_t *tmpKey)
+{
+    uint8_t tmpEidDS1[16];
+    temporaryKeyBlock(beaconTimeSecs, tmpEidDS1);
+    Aes128::encrypt(eidIdentityKey, tmpEidDS1, tmpKey);
+}
+
+void EidGenerator::computeEid(const uint8_t *eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs, uint8_t *eid)
+{
+    uint8_t tmpKey[16];
+    computeTemporaryKey(eidIdentityKey, beaconTimeSecs, tmpKey);
+    computeEidWithTemporaryKey(tmpKey, rotationPeriodExp, beaconTimeSecs, eid);
+}
+
+void EidGenerator::computeEid(const uint8_t *eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                              uint8_t *eid, TemporaryKeyCache &cache)
+{
+    uint16_t epoch = beaconTimeSecs >> 16;
+    if (!cache.valid || cache.epoch != epoch) {
+        computeTemporaryKey(eidIdentityKey, beaconTimeSecs, cache.key);
+        cache.epoch = epoch;
+        cache.valid = true;
+    }
+    computeEidWithTemporaryKey(cache.key, rotationPeriodExp, beaconTimeSecs, eid);
+}
+
+void EidGenerator::computeEidWithTemporaryKey(const uint8_t *tmpKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                                              uint8_t *eid)
+{
+    uint8_t tmpEidDS2[16];
+    eidBlock(rotationPeriodExp, beaconTimeSecs, tmpEidDS2);
+    uint8_t full[16];
+    Aes128::encrypt(tmpKey, tmpEidDS2, full);
+
+    // Only the leading 8 bytes of the AES output are broadcast
+    memcpy(eid, full, EID_LENGTH);
+}
+
+void EidGenerator::computeEids(const uint8_t *tmpKey, uint8_t rotationPeriodExp, uint32_t firstQuantum, size_t count,
+                               uint8_t *eids, const AesBackend &backend)
+{
+    static const size_t CHUNK_BLOCKS = 32;
+    uint8_t blocks[CHUNK_BLOCKS * 16];
+
+    for (size_t done = 0; done < count; ) {
+        size_t n = (count - done < CHUNK_BLOCKS) ? count - done : CHUNK_BLOCKS;
+        for (size_t i = 0; i < n; i++) {
+            eidBlock(rotationPeriodExp, (firstQuantum + (uint32_t)(done + i)) << rotationPeriodExp, blocks + i * 16);
+        }
+        backend.encryptBlocks(tmpKey, blocks, n, blocks);
+        for (size_t i = 0; i < n; i++) {
+            // Only the leading 8 bytes of the AES output are broadcast
+            memcpy(eids + (done + i) * EID_LENGTH, blocks + i * 16, EID_LENGTH);
+        }
+        done += n;
+    }
+}
+
+void EidGenerator::computeEids(const BitslicedAes &identityKeys, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                               uint8_t *eids, BitslicedAes &tmpKeys)
+{
+    uint8_t block[16];
+    uint8_t output[BitslicedAes::MAX_LANES * 16];
+
+    temporaryKeyBlock(beaconTimeSecs, block);
+    identityKeys.deriveKeys(block, 0, tmpKeys);
+    eidBlock(rotationPeriodExp, beaconTimeSecs, block);
+    tmpKeys.encrypt(block, 0, output);
+    for (size_t i = 0; i < tmpKeys.getKeyCount(); i++) {
+        memcpy(eids + i * EID_LENGTH, output + i * 16, EID_LENGTH);
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EIDGENERATOR_H__
+#define __EIDGENERATOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+class AesBackend;
+class BitslicedAes;
+
+/**
+ * Host side port of the two stage EID computation performed on the beacon by
+ * EIDFrame::update (implementations/mbed/source/EIDFrame.cpp). The data
+ * blocks are laid out exactly as in the firmware and in eidtools.py so that
+ * the resolver produces bit-identical EIDs. For more information refer to
+ * https://github.com/google/eddystone/blob/master/eddystone-eid/eid-computation.md.
+ */
+class EidGenerator
+{
+public:
+    static const uint8_t SALT = 0xff;
+    static const uint8_t EID_LENGTH = 8;
+    static const uint8_t KEY_LENGTH = 16;
+    static const uint8_t MAX_ROTATION_PERIOD_EXP = 15;
+
+    /**
+     * The temporary key only depends on the top 16 bits of the beacon time,
+     * so one computed key serves every rotation in the same 65536 second
+     * epoch. Mirrors EidTempKey_t in the firmware.
+     */
+    struct TemporaryKeyCache {
+        bool     valid;
+        uint16_t epoch;
+        uint8_t  key[KEY_LENGTH];
+
+        TemporaryKeyCache() : valid(false), epoch(0) { }
+    };
+
+    /**
+     * Build the temporary key data block: 11 zero bytes, SALT, 2 zero bytes
+     * and the top 16 bits of the beacon time (big endian).
+     *
+     * @param[in] beaconTimeSecs
+     *              Beacon time in seconds.
+     * @param[out] block
+     *              The 16-byte block to be encrypted under the identity key.
+     */
+    static void temporaryKeyBlock(uint32_t beaconTimeSecs, uint8_t *block);
+
+    /**
+     * Build the EID data block: 11 zero bytes, the rotation exponent, then the
+     * beacon time (big endian) with its low rotationPeriodExp bits cleared.
+     *
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] beaconTimeSecs
+     *              Beacon time in seconds.
+     * @param[out] block
+     *              The 16-byte block to be encrypted under the temporary key.
+     */
+    static void eidBlock(uint8_t rotationPeriodExp, uint32_t beaconTimeSecs, uint8_t *block);
+
+    /**
+     * Compute the temporary key for a given identity key and beacon time.
+     *
+     * @param[in] eidIdentityKey
+     *              The 16-byte identity key shared with the beacon.
+     * @param[in] beaconTimeSecs
+     *              Beacon time in seconds.
+     * @param[out] tmpKey
+     *              The 16-byte temporary key.
+     */
+    static void computeTemporaryKey(const uint8_t *eidIdentityKey, uint32_t beaconTimeSecs, uint8_t *tmpKey);
+
+    /**
+     * Compute the 8-byte EID broadcast by a beacon, equivalent to the value
+     * written into the frame by EIDFrame::update.
+     *
+     * @param[in] eidIdentityKey
+     *              The 16-byte identity key shared with the beacon.
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] beaconTimeSecs
+     *              Beacon time in seconds.
+     * @param[out] eid
+     *              The 8-byte EID.
+     */
+    static void computeEid(const uint8_t *eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs, uint8_t *eid);
+
+    /**
+     * As computeEid above, but reuse the temporary key held in cache when
+     * beaconTimeSecs falls in the epoch it was computed for. A rotation then
+     * costs one AES operation instead of two. The cache must be reset when the
+     * identity key changes.
+     *
+     * @param[in,out] cache
+     *              Temporary key cache of this identity key.
+     */
+    static void computeEid(const uint8_t *eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                           uint8_t *eid, TemporaryKeyCache &cache);
+
+    /**
+     * Compute the EIDs of consecutive rotation periods that all lie in the
+     * same 65536 second epoch, and so share one temporary key. The EID blocks
+     * are encrypted with a single batched call to the backend.
+     *
+     * @param[in] tmpKey
+     *              The 16-byte temporary key of the epoch.
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] firstQuantum
+     *              Index of the first rotation period (beacon time >> k).
+     * @param[in] count
+     *              Number of consecutive rotation periods.
+     * @param[out] eids
+     *              count consecutive 8-byte EIDs.
+     * @param[in] backend
+     *              The AES implementation to use.
+     */
+    static void computeEids(const uint8_t *tmpKey, uint8_t rotationPeriodExp, uint32_t firstQuantum, size_t count,
+                            uint8_t *eids, const AesBackend &backend);
+
+    /**
+     * Compute the EIDs of a group of beacons whose clocks are in the same
+     * rotation period: one time step across many identity keys. The identity
+     * keys are loaded once into a BitslicedAes, whose precomputed bitsliced
+     * key schedule is reused at every step; the temporary keys stay in
+     * bitsliced form between the two stages.
+     *
+     * @param[in] identityKeys
+     *              The identity keys of the group (BitslicedAes::setKeys).
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] beaconTimeSecs
+     *              Beacon time in seconds, common to the group.
+     * @param[out] eids
+     *              identityKeys.getKeyCount() consecutive 8-byte EIDs.
+     * @param[in,out] tmpKeys
+     *              Scratch instance that receives the temporary keys, with
+     *              the same number of lanes as identityKeys.
+     */
+    static void computeEids(const BitslicedAes &identityKeys, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                            uint8_t *eids, BitslicedAes &tmpKeys);
+
+private:
+    static void computeEidWithTemporaryKey(const uint8_t *tmpKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                                           uint8_t *eid);
+};
+
+#endif  /* __EIDGENERATOR_H__ */
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidIndex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define EIDINDEX_HAVE_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2,bmi")))
+#endif
+
+static_assert(EidIndex::GROUP_SLOTS * sizeof(uint64_t) == 64, "a key group must fill one cache line");
+
+namespace {
+
+const size_t GROUP_SLOTS = EidIndex::GROUP_SLOTS;
+const size_t CACHE_LINE = 64;
+
+/**
+ * Arrays of at least this size are aligned to and advised for transparent
+ * huge pages: random probes into a large index otherwise miss the TLB on
+ * almost every lookup.
+ */
+const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+/**
+ * Lookups started ahead of the current one by findBatch().
+ */
+const size_t PREFETCH_DISTANCE = 16;
+
+/**
+ * Probe the groups from the home group of key. The probe path of key starts
+ * at its home slot, so only empty slots at or after it end the search;
+ * matches anywhere in a group are valid since keys are unique.
+ */
+size_t findSlotGeneric(const uint64_t *keys, size_t mask, uint64_t key)
+{
+    size_t home = key & mask;
+    size_t group = home & ~(GROUP_SLOTS - 1);
+    size_t first = home - group;
+    for (size_t probed = 0; probed <= mask; probed += GROUP_SLOTS) {
+        for (size_t j = 0; j < GROUP_SLOTS; j++) {
+            uint64_t slotKey = keys[group + j];
+            if (slotKey == key) {
+                return group + j;
+            }
+            if (slotKey == EidIndex::EMPTY_KEY && j >= first) {
+                return mask + 1;
+            }
+        }
+        group = (group + GROUP_SLOTS) & mask;
+        first = 0;
+    }
+    return mask + 1;
+}
+
+#ifdef EIDINDEX_HAVE_AVX2
+
+/**
+ * Same search, comparing the 8 keys of a group with the key and with
+ * EMPTY_KEY in four AVX2 compares.
+ */
+AVX2_TARGET size_t findSlotAvx2(const uint64_t *keys, size_t mask, uint64_t key)
+{
+    const __m256i wanted = _mm256_set1_epi64x((long long)key);
+    const __m256i empty = _mm256_setzero_si256();
+    size_t home = key & mask;
+    size_t group = home & ~(GROUP_SLOTS - 1);
+    unsigned stopMask = (0xffu << (home - group)) & 0xffu;
+    for (size_t probed = 0; probed <= mask; probed += GROUP_SLOTS) {
+        __m256i k0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + group));
+        __m256i k1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + group + 4));
+        unsigned match = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(k0, wanted))) |
+                         ((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(k1, wanted))) << 4);
+        if (match != 0) {
+            return group + (size_t)__builtin_ctz(match);
+        }
+        unsigned empties = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(k0, empty))) |
+                           ((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(k1, empty))) << 4);
+        if ((empties & stopMask) != 0) {
+            return mask + 1;
+        }
+        group = (group + GROUP_SLOTS) & mask;
+        stopMask = 0xffu;
+    }
+    return mask + 1;
+}
+
+#endif
+
+typedef size_t (*FindSlotFn)(const uint64_t *, size_t, uint64_t);
+
+FindSlotFn selectFindSlot()
+{
+#ifdef EIDINDEX_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) {
+        return findSlotAvx2;
+    }
+#endif
+    return findSlotGeneric;
+}
+
+template <typename T>
+T *allocateAligned(size_t n)
+{
+    size_t bytes = n * sizeof(T);
+    size_t alignment = (bytes >= HUGE_PAGE) ? HUGE_PAGE : CACHE_LINE;
+    void *p = NULL;
+    if (posix_memalign(&p, alignment, bytes) != 0) {
+        abort();
+    }
+#ifdef MADV_HUGEPAGE
+    if (alignment == HUGE_PAGE) {
+        madvise(p, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return static_cast<T *>(p);
+}
+
+} // namespace
+
+EidIndex::EidIndex() :
+    keys(NULL),
+    values(NULL),
+    capacity(0),
+    count(0),
+    findSlotFn(selectFindSlot())
+{
+    allocate(MIN_CAPACITY);
+}
+
+EidIndex::~EidIndex()
+{
+    free(keys);
+    free(values);
+}
+
+void EidIndex::allocate(size_t newCapacity)
+{
+    keys = allocateAligned<uint64_t>(newCapacity);
+    values = allocateAligned<Value>(newCapacity);
+    capacity = newCapacity;
+    count = 0;
+    memset(keys, 0, newCapacity * sizeof(uint64_t));
+}
+
+void EidIndex::reserve(size_t entries)
+{
+    // At most 3/4 full: probes stay within one or two groups
+    size_t needed = MIN_CAPACITY;
+    while (needed / 4 * 3 < entries) {
+        needed *= 2;
+    }
+    if (needed > capacity) {
+        rehash(needed);
+    }
+}
+
+void EidIndex::rehash(size_t newCapacity)
+{
+    uint64_t *oldKeys = keys;
+    Value *oldValues = values;
+    size_t oldCapacity = capacity;
+
+    allocate(newCapacity);
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (oldKeys[i] == EMPTY_KEY) {
+            continue;
+        }
+        size_t slot = oldKeys[i] & mask;
+        while (keys[slot] != EMPTY_KEY) {
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = oldKeys[i];
+        values[slot] = oldValues[i];
+        count++;
+    }
+    free(oldKeys);
+    free(oldValues);
+}
+
+void EidIndex::clear()
+{
+    memset(keys, 0, capacity * sizeof(uint64_t));
+    count = 0;
+}
+
+size_t EidIndex::findSlot(uint64_t key) const
+{
+    return findSlotFn(keys, capacity - 1, key);
+}
+
+bool EidIndex::insert(uint64_t key, uint32_t beaconIndex, uint32_t beaconTimeSecs)
+{
+    if (key == EMPTY_KEY || findSlot(key) != capacity) {
+        return false;
+    }
+    if ((count + 1) > capacity / 4 * 3) {
+        rehash(capacity * 2);
+    }
+    size_t mask = capacity - 1;
+    size_t slot = key & mask;
+    while (keys[slot] != EMPTY_KEY) {
+        slot = (slot + 1) & mask;
+    }
+    keys[slot] = key;
+    values[slot].beaconIndex = beaconIndex;
+    values[slot].beaconTimeSecs = beaconTimeSecs;
+    count++;
+    return true;
+}
+
+bool EidIndex::find(uint64_t key, uint32_t &beaconIndex, uint32_t &beaconTimeSecs) const
+{
+    // The entry is nearly always in the home group: fetch its value line
+    // while the keys are compared instead of after
+    __builtin_prefetch(values + (key & (capacity - 1)));
+    size_t slot = findSlot(key);
+    if (slot == capacity || key == EMPTY_KEY) {
+        return false;
+    }
+    beaconIndex = values[slot].beaconIndex;
+    beaconTimeSecs = values[slot].beaconTimeSecs;
+    return true;
+}
+
+size_t EidIndex::findBatch(const uint64_t *batchKeys, size_t n, uint32_t *beaconIndexes, uint32_t *beaconTimes) const
+{
+    size_t mask = capacity - 1;
+    size_t hits = 0;
+    for (size_t i = 0; i < n && i < PREFETCH_DISTANCE; i++) {
+        size_t home = batchKeys[i] & mask;
+        __builtin_prefetch(keys + home);
+        __builtin_prefetch(values + home);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (i + PREFETCH_DISTANCE < n) {
+            // Most lookups hit, so the value line is worth fetching too
+            size_t home = batchKeys[i + PREFETCH_DISTANCE] & mask;
+            __builtin_prefetch(keys + home);
+            __builtin_prefetch(values + home);
+        }
+        size_t slot = findSlotFn(keys, mask, batchKeys[i]);
+        if (slot == capacity || batchKeys[i] == EMPTY_KEY) {
+            beaconIndexes[i] = EMPTY;
+            continue;
+        }
+        beaconIndexes[i] = values[slot].beaconIndex;
+        beaconTimes[i] = values[slot].beaconTimeSecs;
+        hits++;
+    }
+    return hits;
+}
+
+bool EidIndex::erase(uint64_t key, uint32_t beaconIndex, uint32_t beaconTimeSecs)
+{
+    size_t slot = findSlot(key);
+    if (slot == capacity || key == EMPTY_KEY || values[slot].beaconIndex != beaconIndex ||
+        values[slot].beaconTimeSecs != beaconTimeSecs) {
+        return false;
+    }
+
+    // Backward shift: move later entries of the cluster into the hole when
+    // the hole lies on their probe path, i.e. cyclically in [home, slot)
+    size_t mask = capacity - 1;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; keys[next] != EMPTY_KEY; next = (next + 1) & mask) {
+        size_t home = keys[next] & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            keys[hole] = keys[next];
+            values[hole] = values[next];
+            hole = next;
+        }
+    }
+    keys[hole] = EMPTY_KEY;
+    count--;
+    return true;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EIDINDEX_H__
+#define __EIDINDEX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Open addressing hash table from 8-byte EIDs to (beacon index, beacon time),
+ * built for the resolver index.
+ *
+ * EIDs are AES output and so already uniformly distributed: the home slot of
+ * a key is its low bits, with no further hashing. The slots are two parallel
+ * arrays, the 64-bit keys and the (beacon index, beacon time) values, and the
+ * key array is aligned so that a group of GROUP_SLOTS keys fills one cache
+ * line. Probing is linear, one group at a time, and compares all keys of a
+ * group at once (AVX2 when the CPU supports it), so a miss usually reads one
+ * cache line and a hit two. Removal shifts the following entries back
+ * instead of leaving tombstones, so lookups never slow down as the window
+ * slides.
+ *
+ * Key 0 marks an empty slot. An EID whose 8 bytes are all zero (2^-64
+ * likely) is therefore not indexed, as if it collided with another EID.
+ *
+ * findBatch() prefetches the home groups of the keys a few lookups ahead, so
+ * that the DRAM latency of a large index overlaps across lookups.
+ */
+class EidIndex
+{
+public:
+    static const uint64_t EMPTY_KEY = 0;
+    static const uint32_t EMPTY = UINT32_MAX;
+    static const size_t GROUP_SLOTS = 8;
+    static const size_t MIN_CAPACITY = 64;
+
+    EidIndex();
+
+    ~EidIndex();
+
+    /**
+     * Make room for at least entries entries without growing.
+     */
+    void reserve(size_t entries);
+
+    /**
+     * Remove all entries, keeping the capacity.
+     */
+    void clear();
+
+    size_t size() const { return count; }
+
+    /**
+     * Number of slots, a power of two.
+     */
+    size_t getCapacity() const { return capacity; }
+
+    /**
+     * Bytes allocated for the slots.
+     */
+    size_t getMemoryBytes() const { return capacity * (sizeof(uint64_t) + sizeof(Value)); }
+
+    /**
+     * Add an entry unless the key is already present.
+     *
+     * @param[in] key
+     *              The EID as a little endian word.
+     * @param[in] beaconIndex
+     *              Beacon index, anything but EMPTY.
+     * @param[in] beaconTimeSecs
+     *              Start of the rotation period of the EID.
+     *
+     * @return true if inserted, false if the key was present (it keeps its
+     *         value) or is EMPTY_KEY.
+     */
+    bool insert(uint64_t key, uint32_t beaconIndex, uint32_t beaconTimeSecs);
+
+    /**
+     * Look up a key.
+     *
+     * @return true if found, with the entry in beaconIndex and beaconTimeSecs.
+     */
+    bool find(uint64_t key, uint32_t &beaconIndex, uint32_t &beaconTimeSecs) const;
+
+    /**
+     * Look up n keys, prefetching ahead. Misses get EMPTY as beaconIndex.
+     *
+     * @return Number of keys found.
+     */
+    size_t findBatch(const uint64_t *keys, size_t n, uint32_t *beaconIndexes, uint32_t *beaconTimes) const;
+
+    /**
+     * Remove the entry of key if it is the given (beaconIndex, beaconTimeSecs).
+     *
+     * @return true if removed.
+     */
+    bool erase(uint64_t key, uint32_t beaconIndex, uint32_t beaconTimeSecs);
+
+    /**
+     * Slot accessors, for serializing the table. A slot is in use when its
+     * key is not EMPTY_KEY.
+     */
+    uint64_t getSlotKey(size_t slot) const { return keys[slot]; }
+
+    uint32_t getSlotBeaconIndex(size_t slot) const { return values[slot].beaconIndex; }
+
+    uint32_t getSlotBeaconTime(size_t slot) const { return values[slot].beaconTimeSecs; }
+
+private:
+    struct Value {
+        uint32_t beaconIndex;
+        uint32_t beaconTimeSecs;
+    };
+
+    EidIndex(const EidIndex &);
+    EidIndex &operator=(const EidIndex &);
+
+    /**
+     * Slot holding key, or capacity if absent.
+     */
+    size_t findSlot(uint64_t key) const;
+
+    void allocate(size_t newCapacity);
+
+    void rehash(size_t newCapacity);
+
+    uint64_t    *keys;
+    Value       *values;
+    size_t      capacity;
+    size_t      count;
+    size_t      (*findSlotFn)(const uint64_t *keys, size_t mask, uint64_t key);
+};
+
+#endif  /* __EIDINDEX_H__ */
@@ -0,0 +1,782 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidResolver.h"
+#include "EidGenerator.h"
+#include "EidTable.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+namespace {
+
+/**
+ * Beacon clock values outside the 32-bit clock are pinned to its ends.
+ */
+int64_t clampBeaconTime(int64_t beaconTime)
+{
+    if (beaconTime < 0) {
+        return 0;
+    }
+    if (beaconTime > (int64_t)UINT32_MAX) {
+        return (int64_t)UINT32_MAX;
+    }
+    return beaconTime;
+}
+
+/**
+ * Seconds from x to the next multiple of period, in (0, period].
+ */
+int64_t toNextBoundary(int64_t x, int64_t period)
+{
+    return period - (((x % period) + period) % period);
+}
+
+} // namespace
+
+EidResolver::EidResolver(uint32_t windowPeriodsIn) :
+    windowPeriods(windowPeriodsIn),
+    aesBackend(&AesBackend::get()),
+    inlineColumns(2 * windowPeriodsIn + 1),
+    ringSize(2 * windowPeriodsIn + 1),
+    scheduledBeacons(0),
+    computedEids(0),
+    indexTimeSecs(0),
+    indexTimeValid(false)
+{
+    clockTracking.enabled = false;
+}
+
+int EidResolver::addBeacon(const BeaconRegistration &registration)
+{
+    if (registration.rotationPeriodExp > EidGenerator::MAX_ROTATION_PERIOD_EXP) {
+        return RESOLVER_INVALID_EXP;
+    }
+    beacons.push_back(registration);
+    tempKeys.push_back(EidGenerator::TemporaryKeyCache());
+
+    // The registration tells the beacon time at one resolver time
+    ClockEstimate clock;
+    memset(&clock, 0, sizeof(clock));
+    clock.anchorServiceTimeSecs = registration.initialServiceTimeSecs;
+    clock.offsetLoSecs = (int64_t)registration.initialBeaconTimeSecs - (int64_t)registration.initialServiceTimeSecs;
+    clock.offsetHiSecs = clock.offsetLoSecs;
+    clock.lastResolvedSecs = registration.initialServiceTimeSecs;
+    clock.locked = true;
+    clock.lockServiceTimeSecs = registration.initialServiceTimeSecs;
+    clock.lockOffsetLoSecs = clock.offsetLoSecs;
+    clock.lockOffsetHiSecs = clock.offsetHiSecs;
+    clocks.push_back(clock);
+
+    SlotWindow window = { 0, 0, false, NO_WIDE_RING, 0 };
+    windows.push_back(window);
+    ring.resize(ring.size() + inlineColumns);
+    return RESOLVER_SUCCESS;
+}
+
+void EidResolver::setClockTracking(const ClockTracking &tracking)
+{
+    clockTracking = tracking;
+    inlineColumns = ringSize;
+    if (tracking.enabled && ringSize > INLINE_RING_COLUMNS) {
+        inlineColumns = INLINE_RING_COLUMNS;
+    }
+    resetIndex();
+    indexTimeValid = false;
+}
+
+void EidResolver::resetIndex()
+{
+    index.clear();
+    ring.assign(beacons.size() * inlineColumns, 0);
+    wideRings.clear();
+    freeWideRings.clear();
+    schedule.clear();
+    for (size_t i = 0; i < windows.size(); i++) {
+        SlotWindow window = { 0, 0, false, NO_WIDE_RING, 0 };
+        windows[i] = window;
+    }
+    scheduledBeacons = 0;
+}
+
+uint32_t EidResolver::expectedBeaconTime(const BeaconRegistration &registration, uint64_t serviceTimeSecs)
+{
+    // Beacon time advances at the same rate as the resolver clock
+    int64_t elapsed = (int64_t)(serviceTimeSecs - registration.initialServiceTimeSecs);
+    return (uint32_t)clampBeaconTime((int64_t)registration.initialBeaconTimeSecs + elapsed);
+}
+
+uint32_t EidResolver::estimatedBeaconTime(size_t i, uint64_t serviceTimeSecs) const
+{
+    int64_t lo, hi;
+    predictOffset(i, serviceTimeSecs, lo, hi);
+    return (uint32_t)clampBeaconTime((int64_t)serviceTimeSecs + lo + (hi - lo) / 2);
+}
+
+void EidResolver::predictOffset(size_t beaconIndex, uint64_t serviceTimeSecs, int64_t &lo, int64_t &hi) const
+{
+    if (!clockTracking.enabled) {
+        const BeaconRegistration &beacon = beacons[beaconIndex];
+        lo = (int64_t)beacon.initialBeaconTimeSecs - (int64_t)beacon.initialServiceTimeSecs;
+        hi = lo;
+        return;
+    }
+    predictClock(beaconIndex, serviceTimeSecs, lo, hi);
+}
+
+void EidResolver::predictClock(size_t beaconIndex, uint64_t serviceTimeSecs, int64_t &lo, int64_t &hi) const
+{
+    const ClockEstimate &clock = clocks[beaconIndex];
+    int64_t elapsed = (int64_t)(serviceTimeSecs - clock.anchorServiceTimeSecs);
+    int64_t span = (elapsed < 0) ? -elapsed : elapsed;
+    int64_t shift = clock.driftPpm * elapsed / 1000000;
+    int64_t grow = ((int64_t)clockTracking.maxDriftPpm * span + 999999) / 1000000;
+    lo = clock.offsetLoSecs + shift - grow;
+    hi = clock.offsetHiSecs + shift + grow;
+}
+
+void EidResolver::windowOf(size_t beaconIndex, uint64_t serviceTimeSecs, uint32_t &first, uint32_t &last) const
+{
+    uint8_t k = beacons[beaconIndex].rotationPeriodExp;
+    int64_t lo, hi;
+    predictOffset(beaconIndex, serviceTimeSecs, lo, hi);
+    int64_t now = (int64_t)serviceTimeSecs;
+    int64_t quantum = clampBeaconTime(now + lo + (hi - lo) / 2) >> k;
+    int64_t qFirst = quantum - (int64_t)windowPeriods;
+    int64_t qLast = quantum + (int64_t)windowPeriods;
+    if (clockTracking.enabled && serviceTimeSecs <= clocks[beaconIndex].lastResolvedSecs + clockTracking.silenceSecs) {
+        // Narrow window: the periods the offset interval allows
+        int64_t tolerance = clockTracking.toleranceSecs;
+        qFirst = std::max(qFirst, clampBeaconTime(now + lo - tolerance) >> k);
+        qLast = std::min(qLast, clampBeaconTime(now + hi + tolerance) >> k);
+    }
+    int64_t maxQuantum = (int64_t)(UINT32_MAX >> k);
+    first = (uint32_t)(qFirst < 0 ? 0 : qFirst);
+    last = (uint32_t)(qLast > maxQuantum ? maxQuantum : qLast);
+}
+
+uint64_t EidResolver::nextSlideTime(size_t beaconIndex, uint64_t serviceTimeSecs) const
+{
+    const ClockEstimate &clock = clocks[beaconIndex];
+    int64_t period = (int64_t)1 << beacons[beaconIndex].rotationPeriodExp;
+    int64_t lo, hi;
+    predictOffset(beaconIndex, serviceTimeSecs, lo, hi);
+    int64_t now = (int64_t)serviceTimeSecs;
+
+    // The window moves when its centre or, if narrow, one of its edges
+    // crosses a rotation period boundary
+    int64_t distance = toNextBoundary(now + lo + (hi - lo) / 2, period);
+    if (!clockTracking.enabled) {
+        return serviceTimeSecs + distance;
+    }
+    bool narrow = serviceTimeSecs <= clock.lastResolvedSecs + clockTracking.silenceSecs;
+    if (narrow) {
+        int64_t tolerance = clockTracking.toleranceSecs;
+        distance = std::min(distance, toNextBoundary(now + lo - tolerance, period));
+        distance = std::min(distance, toNextBoundary(now + hi + tolerance, period));
+    }
+
+    // Edges move by up to 1 + (|drift| + maxDrift) / 10^6 seconds per second,
+    // and up to two seconds more from rounding
+    int64_t drift = (clock.driftPpm < 0) ? -(int64_t)clock.driftPpm : clock.driftPpm;
+    int64_t wait = distance * 1000000 / (1000000 + drift + clockTracking.maxDriftPpm) - 2;
+    uint64_t next = serviceTimeSecs + (uint64_t)(wait < 1 ? 1 : wait);
+    if (narrow) {
+        next = std::min(next, clock.lastResolvedSecs + clockTracking.silenceSecs + 1);
+    }
+    return next;
+}
+
+void EidResolver::scheduleSlide(size_t beaconIndex, uint64_t timeSecs)
+{
+    windows[beaconIndex].nextSlideSecs = timeSecs;
+    SlideEntry entry = { timeSecs, (uint32_t)beaconIndex };
+    schedule.push_back(entry);
+    std::push_heap(schedule.begin(), schedule.end());
+
+    // Stale entries pile up when resolveAt() keeps moving slides forward
+    if (schedule.size() > 2 * windows.size() + 1024) {
+        rebuildSchedule();
+    }
+}
+
+void EidResolver::rebuildSchedule()
+{
+    schedule.clear();
+    for (size_t i = 0; i < windows.size(); i++) {
+        if (windows[i].indexed) {
+            SlideEntry entry = { windows[i].nextSlideSecs, (uint32_t)i };
+            schedule.push_back(entry);
+        }
+    }
+    std::make_heap(schedule.begin(), schedule.end());
+}
+
+void EidResolver::precompute(uint64_t serviceTimeSecs)
+{
+    resetIndex();
+    index.reserve(beacons.size() * inlineColumns);
+    precomputeRange(0, beacons.size(), serviceTimeSecs);
+    scheduledBeacons = beacons.size();
+    indexTimeSecs = serviceTimeSecs;
+    indexTimeValid = true;
+}
+
+void EidResolver::precomputeRange(size_t begin, size_t end, uint64_t serviceTimeSecs)
+{
+    for (; begin < end; begin += PRECOMPUTE_BATCH) {
+        size_t batchEnd = (begin + PRECOMPUTE_BATCH < end) ? begin + PRECOMPUTE_BATCH : end;
+        precomputeBatch(begin, batchEnd, serviceTimeSecs);
+    }
+}
+
+void EidResolver::advance(uint64_t serviceTimeSecs)
+{
+    if (!indexTimeValid) {
+        precompute(serviceTimeSecs);
+        return;
+    }
+
+    // Beacons registered since the last call get their full window
+    if (scheduledBeacons < beacons.size()) {
+        index.reserve(beacons.size() * inlineColumns);
+        precomputeRange(scheduledBeacons, beacons.size(), serviceTimeSecs);
+        scheduledBeacons = beacons.size();
+    }
+
+    advanceJobs.clear();
+    if (serviceTimeSecs < indexTimeSecs) {
+        // The resolver clock went back: any window may have moved
+        schedule.clear();
+        for (size_t i = 0; i < beacons.size(); i++) {
+            slideWindow(i, serviceTimeSecs);
+        }
+    } else {
+        while (!schedule.empty() && schedule.front().timeSecs <= serviceTimeSecs) {
+            SlideEntry entry = schedule.front();
+            std::pop_heap(schedule.begin(), schedule.end());
+            schedule.pop_back();
+            if (windows[entry.beaconIndex].nextSlideSecs == entry.timeSecs) {
+                slideWindow(entry.beaconIndex, serviceTimeSecs);
+            }
+        }
+    }
+    runAdvanceJobs();
+    indexTimeSecs = serviceTimeSecs;
+}
+
+uint64_t &EidResolver::ringColumn(size_t beaconIndex, uint32_t quantum)
+{
+    uint32_t wideRing = windows[beaconIndex].wideRing;
+    if (wideRing != NO_WIDE_RING) {
+        return wideRings[(size_t)wideRing * ringSize + quantum % ringSize];
+    }
+    return ring[beaconIndex * inlineColumns + quantum % inlineColumns];
+}
+
+void EidResolver::resizeRing(size_t beaconIndex, uint32_t first, uint32_t last)
+{
+    SlotWindow &window = windows[beaconIndex];
+    bool wide = last - first + 1 > inlineColumns;
+    if (wide == (window.wideRing != NO_WIDE_RING)) {
+        return;
+    }
+
+    uint32_t keepFirst = std::max(window.first, first);
+    uint32_t keepLast = std::min(window.last, last);
+    if (!window.indexed) {
+        keepFirst = 1;
+        keepLast = 0;
+    }
+    uint64_t *inlineRing = &ring[beaconIndex * inlineColumns];
+    if (wide) {
+        uint32_t wideRing;
+        if (!freeWideRings.empty()) {
+            wideRing = freeWideRings.back();
+            freeWideRings.pop_back();
+        } else {
+            wideRing = (uint32_t)(wideRings.size() / ringSize);
+            wideRings.resize(wideRings.size() + ringSize);
+        }
+        for (uint32_t q = keepFirst; q <= keepLast; q++) {
+            wideRings[(size_t)wideRing * ringSize + q % ringSize] = inlineRing[q % inlineColumns];
+        }
+        window.wideRing = wideRing;
+    } else {
+        for (uint32_t q = keepFirst; q <= keepLast; q++) {
+            inlineRing[q % inlineColumns] = wideRings[(size_t)window.wideRing * ringSize + q % ringSize];
+        }
+        freeWideRings.push_back(window.wideRing);
+        window.wideRing = NO_WIDE_RING;
+    }
+}
+
+void EidResolver::slideWindow(size_t beaconIndex, uint64_t serviceTimeSecs)
+{
+    SlotWindow &window = windows[beaconIndex];
+    uint32_t first, last;
+    windowOf(beaconIndex, serviceTimeSecs, first, last);
+    if (!window.indexed || window.first != first || window.last != last) {
+        if (window.indexed) {
+            for (uint32_t q = window.first; q <= window.last; q++) {
+                if (q < first || q > last) {
+                    evictEid(beaconIndex, q);
+                }
+            }
+        }
+        resizeRing(beaconIndex, first, last);
+        for (uint32_t q = first; q <= last; q++) {
+            if (!window.indexed || q < window.first || q > window.last) {
+                AdvanceJob job = { (uint32_t)beaconIndex, q, CACHED_TEMP_KEY };
+                advanceJobs.push_back(job);
+            }
+        }
+        window.first = first;
+        window.last = last;
+        window.indexed = true;
+    }
+    scheduleSlide(beaconIndex, nextSlideTime(beaconIndex, serviceTimeSecs));
+
+    if (advanceJobs.size() >= ADVANCE_BATCH) {
+        runAdvanceJobs();
+    }
+}
+
+void EidResolver::runAdvanceJobs()
+{
+    const size_t KEY_LENGTH = EidGenerator::KEY_LENGTH;
+    size_t jobs = advanceJobs.size();
+    if (jobs == 0) {
+        return;
+    }
+
+    // Temporary keys missing from the cache, one per beacon and epoch. Jobs
+    // of a beacon are queued in ascending order, so they share a key with
+    // the previous job when they are in the same epoch.
+    batchKeys.clear();
+    batchBlocks.clear();
+    for (size_t j = 0; j < jobs; j++) {
+        AdvanceJob &job = advanceJobs[j];
+        const BeaconRegistration &beacon = beacons[job.beaconIndex];
+        uint32_t epoch = (job.quantum << beacon.rotationPeriodExp) >> 16;
+        const EidGenerator::TemporaryKeyCache &cache = tempKeys[job.beaconIndex];
+        if (cache.valid && cache.epoch == epoch) {
+            job.tempKey = CACHED_TEMP_KEY;
+            continue;
+        }
+        if (j > 0) {
+            const AdvanceJob &prev = advanceJobs[j - 1];
+            if (prev.beaconIndex == job.beaconIndex && prev.tempKey != CACHED_TEMP_KEY &&
+                ((prev.quantum << beacon.rotationPeriodExp) >> 16) == epoch) {
+                job.tempKey = prev.tempKey;
+                continue;
+            }
+        }
+        job.tempKey = (uint32_t)(batchKeys.size() / KEY_LENGTH);
+        batchKeys.resize(batchKeys.size() + KEY_LENGTH);
+        batchBlocks.resize(batchBlocks.size() + 16);
+        memcpy(&batchKeys[job.tempKey * KEY_LENGTH], beacon.eidIdentityKey, KEY_LENGTH);
+        EidGenerator::temporaryKeyBlock(epoch << 16, &batchBlocks[job.tempKey * 16]);
+    }
+    size_t tempKeyJobs = batchKeys.size() / KEY_LENGTH;
+    batchTempKeys.resize(tempKeyJobs * 16);
+    if (tempKeyJobs > 0) {
+        aesBackend->encryptKeys(&batchKeys[0], &batchBlocks[0], 16, tempKeyJobs, &batchTempKeys[0]);
+    }
+
+    // One EID block under each job's temporary key (many keys, one block each)
+    batchKeys.resize(jobs * KEY_LENGTH);
+    batchBlocks.resize(jobs * 16);
+    batchOutput.resize(jobs * 16);
+    for (size_t j = 0; j < jobs; j++) {
+        const AdvanceJob &job = advanceJobs[j];
+        uint8_t k = beacons[job.beaconIndex].rotationPeriodExp;
+        const uint8_t *tmpKey = (job.tempKey == CACHED_TEMP_KEY) ? tempKeys[job.beaconIndex].key
+                                                                 : &batchTempKeys[job.tempKey * 16];
+        memcpy(&batchKeys[j * KEY_LENGTH], tmpKey, KEY_LENGTH);
+        EidGenerator::eidBlock(k, job.quantum << k, &batchBlocks[j * 16]);
+    }
+    aesBackend->encryptKeys(&batchKeys[0], &batchBlocks[0], 16, jobs, &batchOutput[0]);
+
+    for (size_t j = 0; j < jobs; j++) {
+        const AdvanceJob &job = advanceJobs[j];
+        indexEid(job.beaconIndex, job.quantum, &batchOutput[j * 16]);
+        if (job.tempKey != CACHED_TEMP_KEY) {
+            EidGenerator::TemporaryKeyCache &cache = tempKeys[job.beaconIndex];
+            memcpy(cache.key, &batchTempKeys[job.tempKey * 16], KEY_LENGTH);
+            cache.epoch = (uint16_t)((job.quantum << beacons[job.beaconIndex].rotationPeriodExp) >> 16);
+            cache.valid = true;
+        }
+    }
+    advanceJobs.clear();
+}
+
+void EidResolver::indexEid(size_t beaconIndex, uint32_t quantum, const uint8_t *eid)
+{
+    uint64_t key = eidToKey(eid);
+    ringColumn(beaconIndex, quantum) = key;
+    computedEids++;
+
+    // On a (2^-64 likely) collision the first registered slot wins
+    index.insert(key, (uint32_t)beaconIndex, quantum << beacons[beaconIndex].rotationPeriodExp);
+}
+
+void EidResolver::evictEid(size_t beaconIndex, uint32_t quantum)
+{
+    index.erase(ringColumn(beaconIndex, quantum), (uint32_t)beaconIndex,
+                quantum << beacons[beaconIndex].rotationPeriodExp);
+}
+
+void EidResolver::precomputeBatch(size_t begin, size_t end, uint64_t serviceTimeSecs)
+{
+    const size_t KEY_LENGTH = EidGenerator::KEY_LENGTH;
+
+    // Pass 1: queue the temporary keys of every epoch touched by a window that
+    // are not in the beacon's cache, and compute them in one batched call
+    // (many identity keys, one block each).
+    batchKeys.clear();
+    batchBlocks.clear();
+    for (size_t i = begin; i < end; i++) {
+        const BeaconRegistration &beacon = beacons[i];
+        uint8_t k = beacon.rotationPeriodExp;
+        uint32_t first, last;
+        windowOf(i, serviceTimeSecs, first, last);
+        for (uint32_t epoch = (first << k) >> 16; epoch <= (last << k) >> 16; epoch++) {
+            if (tempKeys[i].valid && tempKeys[i].epoch == epoch) {
+                continue;
+            }
+            size_t job = batchKeys.size() / KEY_LENGTH;
+            batchKeys.resize((job + 1) * KEY_LENGTH);
+            batchBlocks.resize((job + 1) * 16);
+            memcpy(&batchKeys[job * KEY_LENGTH], beacon.eidIdentityKey, KEY_LENGTH);
+            EidGenerator::temporaryKeyBlock(epoch << 16, &batchBlocks[job * 16]);
+        }
+    }
+    size_t jobs = batchKeys.size() / KEY_LENGTH;
+    batchTempKeys.resize(jobs * 16);
+    if (jobs > 0) {
+        aesBackend->encryptKeys(&batchKeys[0], &batchBlocks[0], 16, jobs, &batchTempKeys[0]);
+    }
+
+    // Pass 2: same walk, now computing the EIDs of each epoch with a batched
+    // call under its temporary key (one key, many blocks).
+    size_t job = 0;
+    uint8_t eids[64 * EidGenerator::EID_LENGTH];
+    for (size_t i = begin; i < end; i++) {
+        const BeaconRegistration &beacon = beacons[i];
+        uint8_t k = beacon.rotationPeriodExp;
+        uint32_t first, last;
+        windowOf(i, serviceTimeSecs, first, last);
+        EidGenerator::TemporaryKeyCache &cache = tempKeys[i];
+        resizeRing(i, first, last);
+        windows[i].first = first;
+        windows[i].last = last;
+        windows[i].indexed = true;
+        scheduleSlide(i, nextSlideTime(i, serviceTimeSecs));
+        for (uint32_t epoch = (first << k) >> 16; epoch <= (last << k) >> 16; epoch++) {
+            if (!cache.valid || cache.epoch != epoch) {
+                memcpy(cache.key, &batchTempKeys[job * 16], KEY_LENGTH);
+                cache.epoch = (uint16_t)epoch;
+                cache.valid = true;
+                job++;
+            }
+
+            // Rotation periods of the window inside this epoch
+            uint32_t epochFirst = (epoch << 16) >> k;
+            uint32_t epochLast = epochFirst + (1u << (16 - k)) - 1;
+            uint32_t q = (first > epochFirst) ? first : epochFirst;
+            uint32_t qEnd = (last < epochLast) ? last : epochLast;
+            while (q <= qEnd) {
+                size_t n = (qEnd - q + 1 < 64) ? qEnd - q + 1 : 64;
+                EidGenerator::computeEids(cache.key, k, q, n, eids, *aesBackend);
+                for (size_t e = 0; e < n; e++) {
+                    indexEid(i, q + (uint32_t)e, eids + e * EidGenerator::EID_LENGTH);
+                }
+                if (qEnd - q + 1 == n) {
+                    break;
+                }
+                q += (uint32_t)n;
+            }
+        }
+    }
+}
+
+int EidResolver::saveTable(const char *path) const
+{
+    EidTableHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EID_TABLE_MAGIC, sizeof(header.magic));
+    header.version = EID_TABLE_VERSION;
+    header.headerSize = sizeof(header);
+    header.windowPeriods = windowPeriods;
+    header.indexTimeSecs = indexTimeValid ? indexTimeSecs : 0;
+    header.beaconCount = beacons.size();
+    header.entryCount = index.size();
+    header.slotCount = 16;
+    while (header.slotCount < 2 * header.entryCount) {
+        header.slotCount *= 2;
+    }
+
+    std::vector<EidTableBeacon> records(beacons.size());
+    for (size_t i = 0; i < beacons.size(); i++) {
+        const BeaconRegistration &beacon = beacons[i];
+        EidTableBeacon &record = records[i];
+        memset(&record, 0, sizeof(record));
+        record.beaconId = beacon.beaconId;
+        record.initialServiceTimeSecs = beacon.initialServiceTimeSecs;
+        record.initialBeaconTimeSecs = beacon.initialBeaconTimeSecs;
+        record.windowFirst = windows[i].first;
+        record.windowLast = windows[i].last;
+        memcpy(record.eidIdentityKey, beacon.eidIdentityKey, sizeof(record.eidIdentityKey));
+        record.slot = beacon.slot;
+        record.rotationPeriodExp = beacon.rotationPeriodExp;
+        record.windowIndexed = windows[i].indexed ? 1 : 0;
+        const ClockEstimate &clock = clocks[i];
+        record.clockAnchorServiceTimeSecs = clock.anchorServiceTimeSecs;
+        record.clockOffsetLoSecs = clock.offsetLoSecs;
+        record.clockOffsetHiSecs = clock.offsetHiSecs;
+        record.clockLastResolvedSecs = clock.lastResolvedSecs;
+        record.clockLockServiceTimeSecs = clock.lockServiceTimeSecs;
+        record.clockLockOffsetLoSecs = clock.lockOffsetLoSecs;
+        record.clockLockOffsetHiSecs = clock.lockOffsetHiSecs;
+        record.clockDriftPpm = clock.driftPpm;
+        record.clockLocked = clock.locked ? 1 : 0;
+    }
+
+    EidTableSlot empty = { 0, EID_TABLE_EMPTY_SLOT, 0 };
+    std::vector<EidTableSlot> slots((size_t)header.slotCount, empty);
+    uint64_t mask = header.slotCount - 1;
+    for (size_t s = 0; s < index.getCapacity(); s++) {
+        if (index.getSlotKey(s) == EidIndex::EMPTY_KEY) {
+            continue;
+        }
+        uint64_t i = index.getSlotKey(s) & mask;
+        while (slots[i].beaconIndex != EID_TABLE_EMPTY_SLOT) {
+            i = (i + 1) & mask;
+        }
+        slots[i].eid = index.getSlotKey(s);
+        slots[i].beaconIndex = index.getSlotBeaconIndex(s);
+        slots[i].beaconTimeSecs = index.getSlotBeaconTime(s);
+    }
+
+    // The payload checksum runs over the records and slots as one stream
+    size_t recordBytes = records.size() * sizeof(EidTableBeacon);
+    std::vector<uint64_t> payload((recordBytes + slots.size() * sizeof(EidTableSlot)) / 8);
+    if (recordBytes > 0) {
+        memcpy(&payload[0], &records[0], recordBytes);
+    }
+    memcpy(reinterpret_cast<uint8_t *>(&payload[0]) + recordBytes, &slots[0], slots.size() * sizeof(EidTableSlot));
+    header.payloadChecksum = EidTable::checksum(&payload[0], payload.size() * 8);
+    header.headerChecksum = EidTable::checksum(&header, sizeof(header));
+
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "wb");
+    if (file == NULL) {
+        return RESOLVER_IO_ERROR;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(&payload[0], 8, payload.size(), file) == payload.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), path) != 0) {
+        remove(tmpPath.c_str());
+        return RESOLVER_IO_ERROR;
+    }
+    return RESOLVER_SUCCESS;
+}
+
+int EidResolver::loadTable(const EidTable &table)
+{
+    if (table.getWindowPeriods() != windowPeriods) {
+        return RESOLVER_WINDOW_MISMATCH;
+    }
+    for (size_t i = 0; i < table.getBeaconCount(); i++) {
+        if (table.getBeacon(i).rotationPeriodExp > EidGenerator::MAX_ROTATION_PERIOD_EXP) {
+            return RESOLVER_INVALID_EXP;
+        }
+    }
+
+    beacons.clear();
+    tempKeys.clear();
+    clocks.clear();
+    windows.clear();
+    resetIndex();
+    for (size_t i = 0; i < table.getBeaconCount(); i++) {
+        const EidTableBeacon &record = table.getBeacon(i);
+        BeaconRegistration beacon;
+        beacon.beaconId = record.beaconId;
+        beacon.slot = record.slot;
+        memcpy(beacon.eidIdentityKey, record.eidIdentityKey, sizeof(beacon.eidIdentityKey));
+        beacon.rotationPeriodExp = record.rotationPeriodExp;
+        beacon.initialBeaconTimeSecs = record.initialBeaconTimeSecs;
+        beacon.initialServiceTimeSecs = record.initialServiceTimeSecs;
+        addBeacon(beacon);
+
+        ClockEstimate &clock = clocks[i];
+        clock.anchorServiceTimeSecs = record.clockAnchorServiceTimeSecs;
+        clock.offsetLoSecs = record.clockOffsetLoSecs;
+        clock.offsetHiSecs = record.clockOffsetHiSecs;
+        clock.driftPpm = record.clockDriftPpm;
+        clock.lastResolvedSecs = record.clockLastResolvedSecs;
+        clock.locked = record.clockLocked != 0;
+        clock.lockServiceTimeSecs = record.clockLockServiceTimeSecs;
+        clock.lockOffsetLoSecs = record.clockLockOffsetLoSecs;
+        clock.lockOffsetHiSecs = record.clockLockOffsetHiSecs;
+
+        if (record.windowIndexed != 0 && record.windowFirst <= record.windowLast) {
+            resizeRing(i, record.windowFirst, record.windowLast);
+            windows[i].first = record.windowFirst;
+            windows[i].last = record.windowLast;
+            windows[i].indexed = true;
+        }
+    }
+
+    index.reserve(table.getEntryCount());
+    for (size_t i = 0; i < table.getSlotCount(); i++) {
+        const EidTableSlot &slot = table.getSlot(i);
+        if (slot.beaconIndex == EID_TABLE_EMPTY_SLOT || slot.beaconIndex >= beacons.size()) {
+            continue;
+        }
+        index.insert(slot.eid, slot.beaconIndex, slot.beaconTimeSecs);
+        uint32_t quantum = slot.beaconTimeSecs >> beacons[slot.beaconIndex].rotationPeriodExp;
+        ringColumn(slot.beaconIndex, quantum) = slot.eid;
+    }
+
+    // Windows not indexed when the table was written are filled in by the
+    // next advance()
+    for (size_t i = 0; i < windows.size(); i++) {
+        scheduleSlide(i, windows[i].indexed ? nextSlideTime(i, table.getIndexTimeSecs()) : table.getIndexTimeSecs());
+    }
+    scheduledBeacons = beacons.size();
+    indexTimeSecs = table.getIndexTimeSecs();
+    indexTimeValid = true;
+    return RESOLVER_SUCCESS;
+}
+
+size_t EidResolver::getIndexMemoryBytes() const
+{
+    return index.getMemoryBytes() + (ring.capacity() + wideRings.capacity()) * sizeof(uint64_t);
+}
+
+bool EidResolver::resolve(const uint8_t *eid, Resolution &result) const
+{
+    uint32_t beaconIndex, beaconTimeSecs;
+    if (!index.find(eidToKey(eid), beaconIndex, beaconTimeSecs)) {
+        return false;
+    }
+    const BeaconRegistration &beacon = beacons[beaconIndex];
+    result.beaconId = beacon.beaconId;
+    result.slot = beacon.slot;
+    result.beaconTimeSecs = beaconTimeSecs;
+    return true;
+}
+
+bool EidResolver::resolveAt(const uint8_t *eid, uint64_t serviceTimeSecs, Resolution &result)
+{
+    uint32_t beaconIndex, beaconTimeSecs;
+    if (!index.find(eidToKey(eid), beaconIndex, beaconTimeSecs)) {
+        return false;
+    }
+    const BeaconRegistration &beacon = beacons[beaconIndex];
+    result.beaconId = beacon.beaconId;
+    result.slot = beacon.slot;
+    result.beaconTimeSecs = beaconTimeSecs;
+
+    // The offset is in the observed rotation period, and in the prediction
+    // unless the clock stepped, e.g. restored from flash after a power loss
+    ClockEstimate &clock = clocks[beaconIndex];
+    int64_t lo, hi;
+    predictClock(beaconIndex, serviceTimeSecs, lo, hi);
+    int64_t observedLo = (int64_t)beaconTimeSecs - (int64_t)serviceTimeSecs;
+    int64_t observedHi = observedLo + ((int64_t)1 << beacon.rotationPeriodExp) - 1;
+    lo = std::max(lo, observedLo);
+    hi = std::min(hi, observedHi);
+    if (lo > hi) {
+        lo = observedLo;
+        hi = observedHi;
+        clock.locked = false;
+    }
+    clock.anchorServiceTimeSecs = serviceTimeSecs;
+    clock.offsetLoSecs = lo;
+    clock.offsetHiSecs = hi;
+    clock.lastResolvedSecs = std::max(clock.lastResolvedSecs, serviceTimeSecs);
+
+    // Drift from the offset change since the lock, once the baseline is long
+    // enough for the estimate to be within half of maxDriftPpm
+    if (hi - lo <= (int64_t)CLOCK_LOCK_WIDTH_SECS) {
+        int64_t maxDrift = clockTracking.maxDriftPpm;
+        int64_t baseline = (int64_t)(serviceTimeSecs - clock.lockServiceTimeSecs);
+        int64_t uncertainty = (hi - lo) + (clock.lockOffsetHiSecs - clock.lockOffsetLoSecs);
+        if (!clock.locked) {
+            clock.locked = true;
+            clock.lockServiceTimeSecs = serviceTimeSecs;
+            clock.lockOffsetLoSecs = lo;
+            clock.lockOffsetHiSecs = hi;
+        } else if (baseline > 0 && uncertainty * 1000000 <= maxDrift * baseline) {
+            int64_t change = (lo + hi) - (clock.lockOffsetLoSecs + clock.lockOffsetHiSecs);
+            int64_t drift = change * 1000000 / (2 * baseline);
+            clock.driftPpm = (int32_t)std::max(-maxDrift, std::min(maxDrift, drift));
+        }
+    }
+
+    // Move the window at the next advance() if the estimate moved it
+    const SlotWindow &window = windows[beaconIndex];
+    if (window.indexed) {
+        uint32_t first, last;
+        windowOf(beaconIndex, serviceTimeSecs, first, last);
+        uint64_t next = (first != window.first || last != window.last) ? serviceTimeSecs
+                                                                        : nextSlideTime(beaconIndex, serviceTimeSecs);
+        if (next < window.nextSlideSecs) {
+            scheduleSlide(beaconIndex, next);
+        }
+    }
+    return true;
+}
+
+size_t EidResolver::resolveBatch(const uint8_t *eids, size_t count, Resolution *results, bool *found) const
+{
+    uint64_t keys[RESOLVE_BATCH];
+    uint32_t beaconIndexes[RESOLVE_BATCH];
+    uint32_t beaconTimes[RESOLVE_BATCH];
+    size_t resolved = 0;
+    for (size_t begin = 0; begin < count; begin += RESOLVE_BATCH) {
+        size_t n = (count - begin < RESOLVE_BATCH) ? count - begin : RESOLVE_BATCH;
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = eidToKey(eids + (begin + i) * EidGenerator::EID_LENGTH);
+        }
+        resolved += index.findBatch(keys, n, beaconIndexes, beaconTimes);
+        for (size_t i = 0; i < n; i++) {
+            found[begin + i] = beaconIndexes[i] != EidIndex::EMPTY;
+            if (!found[begin + i]) {
+                continue;
+            }
+            const BeaconRegistration &beacon = beacons[beaconIndexes[i]];
+            Resolution &result = results[begin + i];
+            result.beaconId = beacon.beaconId;
+            result.slot = beacon.slot;
+            result.beaconTimeSecs = beaconTimes[i];
+        }
+    }
+    return resolved;
+}
+
+uint64_t EidResolver::eidToKey(const uint8_t *eid)
+{
+    uint64_t key;
+    memcpy(&key, eid, sizeof(key));
+    return key;
+}
@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EIDRESOLVER_H__
+#define __EIDRESOLVER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "EidGenerator.h"
+#include "AesBackend.h"
+#include "EidIndex.h"
+
+class EidTable;
+
+/**
+ * Everything the trusted resolver learns about an EID slot at registration
+ * time (see the "beacon" command of eidtools.py).
+ */
+struct BeaconRegistration {
+    /**
+     * Caller assigned identifier of the beacon.
+     */
+    uint64_t beaconId;
+
+    /**
+     * Slot of the beacon that broadcasts this EID.
+     */
+    uint8_t  slot;
+
+    /**
+     * The 128-bit EID Identity Key (big endian)
+     */
+    uint8_t  eidIdentityKey[16];
+
+    /**
+     * EID rotation time as an exponent k : 2^k seconds
+     */
+    uint8_t  rotationPeriodExp;
+
+    /**
+     * Beacon clock value reported at registration, in seconds.
+     */
+    uint32_t initialBeaconTimeSecs;
+
+    /**
+     * Resolver wall clock time at registration, in seconds.
+     */
+    uint64_t initialServiceTimeSecs;
+};
+
+/**
+ * Bulk EID resolver. The EIDs of every registered slot are precomputed across
+ * a window of +/- windowPeriods rotation periods around the expected beacon
+ * time and stored in an in-memory index, so that an observed 8-byte EID is
+ * resolved with a single hash lookup.
+ *
+ * The window slides with the resolver clock: advance() only computes the
+ * rotation periods that enter the window of a slot and evicts those that
+ * leave it. Each slot keeps the EIDs of its window in a ring, so evicting
+ * needs no AES work.
+ *
+ * With clock tracking enabled (setClockTracking), the resolver estimates the
+ * offset and drift of each beacon clock from the EIDs passed to resolveAt(),
+ * and only indexes the rotation periods that the estimate allows, typically
+ * one or two. A slot that has not resolved for a while, e.g. because its
+ * beacon lost time after a power loss, gets the full +/- windowPeriods
+ * window again until it is found.
+ */
+class EidResolver
+{
+public:
+    static const int RESOLVER_SUCCESS = 0;
+    static const int RESOLVER_INVALID_EXP = -1;
+    static const int RESOLVER_WINDOW_MISMATCH = -2;
+    static const int RESOLVER_IO_ERROR = -3;
+    static const uint32_t DEFAULT_WINDOW_PERIODS = 2;
+    static const uint32_t DEFAULT_TOLERANCE_SECS = 60;
+    static const uint32_t DEFAULT_MAX_DRIFT_PPM = 100;
+    static const uint32_t DEFAULT_SILENCE_SECS = 6 * 3600;
+
+    /**
+     * Result of a successful resolution.
+     */
+    struct Resolution {
+        uint64_t beaconId;
+        uint8_t  slot;
+        /**
+         * Start of the rotation period (in beacon time) the EID belongs to.
+         */
+        uint32_t beaconTimeSecs;
+    };
+
+    /**
+     * Parameters of the per beacon clock tracking, see setClockTracking().
+     */
+    struct ClockTracking {
+        /**
+         * Index a narrow window around the estimated beacon time. When false
+         * every slot gets +/- windowPeriods around the time expected from its
+         * registration.
+         */
+        bool     enabled;
+        /**
+         * Margin on each side of the estimated beacon time, in seconds.
+         */
+        uint32_t toleranceSecs;
+        /**
+         * Bound on the rate error of a beacon clock, in parts per million:
+         * the uncertainty of an estimate grows by this much while the slot
+         * does not resolve.
+         */
+        uint32_t maxDriftPpm;
+        /**
+         * A slot that has not resolved for this long gets the full window.
+         */
+        uint32_t silenceSecs;
+
+        ClockTracking() :
+            enabled(true),
+            toleranceSecs(DEFAULT_TOLERANCE_SECS),
+            maxDriftPpm(DEFAULT_MAX_DRIFT_PPM),
+            silenceSecs(DEFAULT_SILENCE_SECS)
+        {
+        }
+    };
+
+    /**
+     * What the resolver knows about the clock of a slot. The offset is beacon
+     * time minus resolver time; at anchorServiceTimeSecs it was in
+     * [offsetLoSecs, offsetHiSecs], and it moves by driftPpm from there.
+     */
+    struct ClockEstimate {
+        uint64_t anchorServiceTimeSecs;
+        int64_t  offsetLoSecs;
+        int64_t  offsetHiSecs;
+        int32_t  driftPpm;
+        /**
+         * Resolver time of the latest resolution, or of the registration.
+         */
+        uint64_t lastResolvedSecs;
+        /**
+         * Reference point for the drift estimate: the offset interval the
+         * first time since the last clock step that it was narrower than
+         * CLOCK_LOCK_WIDTH_SECS.
+         */
+        bool     locked;
+        uint64_t lockServiceTimeSecs;
+        int64_t  lockOffsetLoSecs;
+        int64_t  lockOffsetHiSecs;
+    };
+
+    /**
+     * Construct an empty resolver.
+     *
+     * @param[in] windowPeriodsIn
+     *              Number of rotation periods on each side of the expected
+     *              beacon time that are precomputed. With clock tracking it
+     *              is the window of slots that stopped resolving, and should
+     *              cover the time a beacon can lose on power loss.
+     */
+    explicit EidResolver(uint32_t windowPeriodsIn = DEFAULT_WINDOW_PERIODS);
+
+    /**
+     * Register an EID slot with the resolver. The index is not updated until
+     * the next call to precompute().
+     *
+     * @param[in] registration
+     *              The registration parameters of the slot.
+     *
+     * @return RESOLVER_SUCCESS or RESOLVER_INVALID_EXP if the rotation
+     *         exponent is out of range.
+     */
+    int addBeacon(const BeaconRegistration &registration);
+
+    /**
+     * Rebuild the index for the given resolver time.
+     *
+     * @param[in] serviceTimeSecs
+     *              Resolver wall clock time in seconds.
+     */
+    void precompute(uint64_t serviceTimeSecs);
+
+    /**
+     * Slide the index to a new resolver time. Each slot is scheduled at the
+     * next resolver time its window can change (a rotation period boundary
+     * of a window edge, or the slot falling silent), so only the slots due
+     * since the previous call are visited: the periods that left their
+     * window are evicted and those that entered it computed. Slots added
+     * since the previous call are indexed in full. The first call is
+     * equivalent to precompute().
+     *
+     * @param[in] serviceTimeSecs
+     *              Resolver wall clock time in seconds.
+     */
+    void advance(uint64_t serviceTimeSecs);
+
+    /**
+     * Write the registrations and the current index to an EID table file
+     * (see EidTable.h). The file is written next to path and renamed over it,
+     * so a reader never maps a partial table.
+     *
+     * @param[in] path
+     *              The table file.
+     *
+     * @return RESOLVER_SUCCESS or RESOLVER_IO_ERROR.
+     */
+    int saveTable(const char *path) const;
+
+    /**
+     * Replace the registrations and the index with those of a table, without
+     * computing any EID. A following advance() then only computes the
+     * rotation periods that entered the windows since the table was written.
+     *
+     * @param[in] table
+     *              An open table.
+     *
+     * @return RESOLVER_SUCCESS, RESOLVER_WINDOW_MISMATCH if the table was
+     *         written with another window size, or RESOLVER_INVALID_EXP if a
+     *         record has an out of range rotation exponent.
+     */
+    int loadTable(const EidTable &table);
+
+    /**
+     * Resolve an observed EID.
+     *
+     * @param[in] eid
+     *              The 8-byte EID as broadcast by the beacon.
+     * @param[out] result
+     *              The slot and the beacon time the EID belongs to.
+     *
+     * @return true if the EID is known to the resolver.
+     */
+    bool resolve(const uint8_t *eid, Resolution &result) const;
+
+    /**
+     * Resolve a batch of observed EIDs, as collected from a scanner uplink.
+     * The index lookups are prefetched ahead of each other, which hides most
+     * of the memory latency once the index is larger than the caches.
+     *
+     * @param[in] eids
+     *              count 8-byte EIDs, back to back.
+     * @param[in] count
+     *              Number of EIDs.
+     * @param[out] results
+     *              count resolutions; entries whose EID is unknown are left
+     *              untouched.
+     * @param[out] found
+     *              count flags, set if the EID is known to the resolver.
+     *
+     * @return Number of EIDs resolved.
+     */
+    size_t resolveBatch(const uint8_t *eids, size_t count, Resolution *results, bool *found) const;
+
+    /**
+     * Resolve an EID and refine the clock estimate of its slot. The beacon
+     * time of the slot at serviceTimeSecs is within the rotation period of
+     * the EID: the estimate is narrowed to it, or moved to it if the clock
+     * stepped. The window follows at the next advance().
+     *
+     * @param[in] eid
+     *              The 8-byte EID as broadcast by the beacon.
+     * @param[in] serviceTimeSecs
+     *              Resolver time at which the EID was observed.
+     * @param[out] result
+     *              The slot and the beacon time the EID belongs to.
+     *
+     * @return true if the EID is known to the resolver.
+     */
+    bool resolveAt(const uint8_t *eid, uint64_t serviceTimeSecs, Resolution &result);
+
+    /**
+     * Enable or tune clock tracking. The index is discarded and rebuilt by
+     * the next advance() or precompute(); clock estimates are kept.
+     */
+    void setClockTracking(const ClockTracking &tracking);
+
+    const ClockTracking &getClockTracking() const { return clockTracking; }
+
+    /**
+     * Clock estimate of the i-th registered slot.
+     */
+    const ClockEstimate &getClockEstimate(size_t i) const { return clocks[i]; }
+
+    /**
+     * Estimated beacon clock value of the i-th registered slot at a given
+     * resolver time.
+     */
+    uint32_t estimatedBeaconTime(size_t i, uint64_t serviceTimeSecs) const;
+
+    /**
+     * Number of EIDs computed by precompute() and advance() so far.
+     */
+    uint64_t getComputedEids() const { return computedEids; }
+
+    /**
+     * Bytes allocated for the index and the rings of the windows.
+     */
+    size_t getIndexMemoryBytes() const;
+
+    /**
+     * Expected beacon clock value of a registered slot at a given resolver
+     * time.
+     */
+    static uint32_t expectedBeaconTime(const BeaconRegistration &registration, uint64_t serviceTimeSecs);
+
+    size_t getBeaconCount() const { return beacons.size(); }
+
+    size_t getIndexSize() const { return index.size(); }
+
+    uint32_t getWindowPeriods() const { return windowPeriods; }
+
+    /**
+     * Select the AES implementation used by precompute(). Defaults to the
+     * fastest one supported by the CPU, see AesBackend::get().
+     */
+    void setAesBackend(const AesBackend &backend) { aesBackend = &backend; }
+
+    const AesBackend &getAesBackend() const { return *aesBackend; }
+
+private:
+    /**
+     * Number of beacons whose temporary keys are computed in one batch. Large
+     * enough to fill a pass of the 256 lane bitsliced backend.
+     */
+    static const size_t PRECOMPUTE_BATCH = 256;
+
+    /**
+     * Number of new columns computed in one batch by advance().
+     */
+    static const size_t ADVANCE_BATCH = 1024;
+
+    /**
+     * Marks an advance() job whose temporary key is in the beacon's cache.
+     */
+    static const uint32_t CACHED_TEMP_KEY = UINT32_MAX;
+
+    /**
+     * Ring columns kept inline per slot with clock tracking: enough for the
+     * narrow window of rotation periods of 1024 seconds or more. Wider
+     * windows get a ring of 2 * windowPeriods + 1 columns from a pool.
+     */
+    static const uint32_t INLINE_RING_COLUMNS = 3;
+
+    /**
+     * Marks a slot whose ring is inline.
+     */
+    static const uint32_t NO_WIDE_RING = UINT32_MAX;
+
+    /**
+     * Offset uncertainty below which a clock estimate becomes the reference
+     * for its drift estimate.
+     */
+    static const uint32_t CLOCK_LOCK_WIDTH_SECS = 120;
+
+    /**
+     * Number of EIDs looked up together by resolveBatch().
+     */
+    static const size_t RESOLVE_BATCH = 256;
+
+    /**
+     * Rotation periods currently indexed for a slot, where their EIDs are
+     * kept, and when the window next needs to move.
+     */
+    struct SlotWindow {
+        uint32_t first;
+        uint32_t last;
+        bool     indexed;
+        uint32_t wideRing;
+        uint64_t nextSlideSecs;
+    };
+
+    /**
+     * Entry of the advance() schedule. Entries whose time no longer matches
+     * the slot's nextSlideSecs are stale and skipped.
+     */
+    struct SlideEntry {
+        uint64_t timeSecs;
+        uint32_t beaconIndex;
+
+        bool operator<(const SlideEntry &other) const { return timeSecs > other.timeSecs; }
+    };
+
+    /**
+     * One EID that enters the window during advance().
+     */
+    struct AdvanceJob {
+        uint32_t beaconIndex;
+        uint32_t quantum;
+        /**
+         * Index of the temporary key in batchTempKeys, or CACHED_TEMP_KEY.
+         */
+        uint32_t tempKey;
+    };
+
+    /**
+     * EIDs are AES output, so their first 8 bytes are used directly as key.
+     */
+    static uint64_t eidToKey(const uint8_t *eid);
+
+    /**
+     * Offset interval of a slot's clock estimate at a resolver time, widened
+     * by maxDriftPpm for the time since it was last updated.
+     */
+    void predictClock(size_t beaconIndex, uint64_t serviceTimeSecs, int64_t &lo, int64_t &hi) const;
+
+    /**
+     * Offset interval the window of a slot is placed on: the estimate, or
+     * the registration when clock tracking is disabled.
+     */
+    void predictOffset(size_t beaconIndex, uint64_t serviceTimeSecs, int64_t &lo, int64_t &hi) const;
+
+    /**
+     * First and last rotation period (beacon time >> k) of the window of a
+     * slot, clipped to the 32-bit beacon clock.
+     */
+    void windowOf(size_t beaconIndex, uint64_t serviceTimeSecs, uint32_t &first, uint32_t &last) const;
+
+    /**
+     * Earliest resolver time after serviceTimeSecs at which windowOf() can
+     * change.
+     */
+    uint64_t nextSlideTime(size_t beaconIndex, uint64_t serviceTimeSecs) const;
+
+    /**
+     * Set the next slide time of a slot and queue it.
+     */
+    void scheduleSlide(size_t beaconIndex, uint64_t timeSecs);
+
+    /**
+     * Rebuild the schedule from the next slide times of the indexed slots.
+     */
+    void rebuildSchedule();
+
+    /**
+     * Ring cell of a rotation period of a slot.
+     */
+    uint64_t &ringColumn(size_t beaconIndex, uint32_t quantum);
+
+    /**
+     * Move the ring of a slot inline or to the pool as needed for a new
+     * window, keeping the EIDs of the periods it shares with the current one.
+     */
+    void resizeRing(size_t beaconIndex, uint32_t first, uint32_t last);
+
+    /**
+     * Index the EIDs of beacons [begin, end) for the given resolver time.
+     */
+    void precomputeBatch(size_t begin, size_t end, uint64_t serviceTimeSecs);
+
+    /**
+     * Index beacons [begin, end) in batches.
+     */
+    void precomputeRange(size_t begin, size_t end, uint64_t serviceTimeSecs);
+
+    /**
+     * Add an EID of a slot to the index and to the ring of its window.
+     */
+    void indexEid(size_t beaconIndex, uint32_t quantum, const uint8_t *eid);
+
+    /**
+     * Remove an EID of a slot from the index, if it is the one indexed.
+     */
+    void evictEid(size_t beaconIndex, uint32_t quantum);
+
+    /**
+     * Move the window of a slot: evict the periods that left it and queue
+     * jobs for the periods that entered it, then schedule its next move.
+     */
+    void slideWindow(size_t beaconIndex, uint64_t serviceTimeSecs);
+
+    /**
+     * Compute and index the queued advance() jobs.
+     */
+    void runAdvanceJobs();
+
+    /**
+     * Drop the index and the rings, keeping registrations and clocks.
+     */
+    void resetIndex();
+
+    /**
+     * Scratch space of precomputeBatch(): identity keys and data blocks of the
+     * temporary keys missing from the cache, and the computed keys.
+     */
+    std::vector<uint8_t>                        batchKeys;
+    std::vector<uint8_t>                        batchBlocks;
+    std::vector<uint8_t>                        batchTempKeys;
+    std::vector<uint8_t>                        batchOutput;
+    std::vector<AdvanceJob>                     advanceJobs;
+
+    uint32_t                                    windowPeriods;
+    const AesBackend                            *aesBackend;
+    std::vector<BeaconRegistration>             beacons;
+    /**
+     * Temporary key cache of each beacon, kept across precompute() calls.
+     */
+    std::vector<EidGenerator::TemporaryKeyCache> tempKeys;
+    ClockTracking                               clockTracking;
+    std::vector<ClockEstimate>                  clocks;
+    /**
+     * Indexed window of each beacon, and the ring of its EIDs. Inline, column
+     * quantum % inlineColumns of beacon i is ring[i * inlineColumns + column];
+     * in the pool, column quantum % ringSize of wide ring r is
+     * wideRings[r * ringSize + column].
+     */
+    std::vector<SlotWindow>                     windows;
+    std::vector<uint64_t>                       ring;
+    uint32_t                                    inlineColumns;
+    uint32_t                                    ringSize;
+    std::vector<uint64_t>                       wideRings;
+    std::vector<uint32_t>                       freeWideRings;
+    /**
+     * Min-heap of window moves. Beacons [0, scheduledBeacons) are in it.
+     */
+    std::vector<SlideEntry>                     schedule;
+    size_t                                      scheduledBeacons;
+    uint64_t                                    computedEids;
+    /**
+     * Resolver time of the last precompute() or advance().
+     */
+    uint64_t                                    indexTimeSecs;
+    bool                                        indexTimeValid;
+    /**
+     * EID key -> (beacon index, beacon time) of every indexed EID.
+     */
+    EidIndex                                    index;
+};
+
+#endif  /* __EIDRESOLVER_H__ */
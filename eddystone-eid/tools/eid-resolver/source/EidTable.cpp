@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidTable.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(EidTableHeader) % 8 == 0, "EID table sections must be multiples of 8 bytes");
+static_assert(sizeof(EidTableBeacon) == 112, "EidTableBeacon layout changed");
+static_assert(sizeof(EidTableSlot) == 16, "EidTableSlot layout changed");
+
+EidTable::EidTable() :
+    mapping(NULL),
+    mappingSize(0),
+    header(NULL),
+    beacons(NULL),
+    slots(NULL)
+{
+}
+
+EidTable::~EidTable()
+{
+    close();
+}
+
+int EidTable::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return TABLE_IO_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return TABLE_IO_ERROR;
+    }
+    if ((size_t)st.st_size < sizeof(EidTableHeader)) {
+        ::close(fd);
+        return TABLE_BAD_FORMAT;
+    }
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return TABLE_IO_ERROR;
+    }
+
+    const EidTableHeader *h = static_cast<const EidTableHeader *>(addr);
+    int rc = TABLE_SUCCESS;
+    EidTableHeader copy;
+    memcpy(&copy, h, sizeof(copy));
+    copy.headerChecksum = 0;
+    uint64_t payloadSize = h->beaconCount * sizeof(EidTableBeacon) + h->slotCount * sizeof(EidTableSlot);
+
+    if (memcmp(h->magic, EID_TABLE_MAGIC, sizeof(h->magic)) != 0) {
+        rc = TABLE_BAD_FORMAT;
+    } else if (h->version != EID_TABLE_VERSION) {
+        rc = TABLE_BAD_VERSION;
+    } else if (checksum(&copy, sizeof(copy)) != h->headerChecksum) {
+        rc = TABLE_BAD_CHECKSUM;
+    } else if (h->headerSize != sizeof(EidTableHeader) ||
+               h->slotCount == 0 || (h->slotCount & (h->slotCount - 1)) != 0 ||
+               h->entryCount > h->slotCount / 2 ||
+               h->beaconCount >= EID_TABLE_EMPTY_SLOT ||
+               (uint64_t)st.st_size != sizeof(EidTableHeader) + payloadSize) {
+        rc = TABLE_BAD_FORMAT;
+    }
+    if (rc != TABLE_SUCCESS) {
+        munmap(addr, (size_t)st.st_size);
+        return rc;
+    }
+
+    mapping = addr;
+    mappingSize = (size_t)st.st_size;
+    header = h;
+    beacons = reinterpret_cast<const EidTableBeacon *>(h + 1);
+    slots = reinterpret_cast<const EidTableSlot *>(beacons + h->beaconCount);
+    return TABLE_SUCCESS;
+}
+
+void EidTable::close()
+{
+    if (mapping != NULL) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = NULL;
+    mappingSize = 0;
+    header = NULL;
+    beacons = NULL;
+    slots = NULL;
+}
+
+int EidTable::verify() const
+{
+    if (header == NULL) {
+        return TABLE_IO_ERROR;
+    }
+    uint64_t sum = checksum(beacons, mappingSize - sizeof(EidTableHeader));
+    return (sum == header->payloadChecksum) ? TABLE_SUCCESS : TABLE_BAD_CHECKSUM;
+}
+
+bool EidTable::resolve(const uint8_t *eid, EidResolver::Resolution &result) const
+{
+    uint64_t key;
+    memcpy(&key, eid, sizeof(key));
+    uint64_t mask = header->slotCount - 1;
+    uint64_t i = key & mask;
+    // Bounded, so that a corrupt table (see verify()) cannot loop forever
+    for (uint64_t probes = 0; probes < header->slotCount; probes++, i = (i + 1) & mask) {
+        const EidTableSlot &slot = slots[i];
+        if (slot.beaconIndex == EID_TABLE_EMPTY_SLOT) {
+            return false;
+        }
+        if (slot.eid == key && slot.beaconIndex < header->beaconCount) {
+            const EidTableBeacon &beacon = beacons[slot.beaconIndex];
+            result.beaconId = beacon.beaconId;
+            result.slot = beacon.slot;
+            result.beaconTimeSecs = slot.beaconTimeSecs;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t EidTable::checksum(const void *data, size_t len)
+{
+    const uint64_t *words = static_cast<const uint64_t *>(data);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len / 8; i++) {
+        hash ^= words[i];
+        hash *= 0x100000001b3ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EIDTABLE_H__
+#define __EIDTABLE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "EidResolver.h"
+
+/*
+ * On-disk EID table, written by EidResolver::saveTable(). All fields are
+ * little endian and every section is a multiple of 8 bytes:
+ *
+ *  - EidTableHeader
+ *  - beaconCount EidTableBeacon records, in registration order
+ *  - slotCount EidTableSlot entries: an open addressing table with linear
+ *    probing, slot = EID & (slotCount - 1), at most half full
+ *
+ * The EID is stored as the 8 broadcast bytes read as a little endian word,
+ * the same key EidResolver uses. The header is covered by headerChecksum,
+ * the beacon records and slots by payloadChecksum (see EidTable::checksum).
+ */
+
+static const uint8_t  EID_TABLE_MAGIC[8] = { 'E', 'I', 'D', 'T', 'A', 'B', 'L', 'E' };
+static const uint32_t EID_TABLE_VERSION = 1;
+static const uint32_t EID_TABLE_EMPTY_SLOT = UINT32_MAX;
+
+struct EidTableHeader {
+    uint8_t  magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t windowPeriods;
+    uint32_t reserved;
+    /**
+     * Resolver time the table was computed for.
+     */
+    uint64_t indexTimeSecs;
+    uint64_t beaconCount;
+    uint64_t slotCount;
+    uint64_t entryCount;
+    uint64_t payloadChecksum;
+    /**
+     * Checksum of the header with this field set to zero.
+     */
+    uint64_t headerChecksum;
+};
+
+struct EidTableBeacon {
+    uint64_t beaconId;
+    uint64_t initialServiceTimeSecs;
+    uint32_t initialBeaconTimeSecs;
+    /**
+     * Rotation periods indexed for the slot, valid if windowIndexed is set.
+     */
+    uint32_t windowFirst;
+    uint32_t windowLast;
+    uint8_t  eidIdentityKey[16];
+    uint8_t  slot;
+    uint8_t  rotationPeriodExp;
+    uint8_t  windowIndexed;
+    uint8_t  reserved;
+    /**
+     * Clock estimate of the slot, see EidResolver::ClockEstimate.
+     */
+    uint64_t clockAnchorServiceTimeSecs;
+    int64_t  clockOffsetLoSecs;
+    int64_t  clockOffsetHiSecs;
+    uint64_t clockLastResolvedSecs;
+    uint64_t clockLockServiceTimeSecs;
+    int64_t  clockLockOffsetLoSecs;
+    int64_t  clockLockOffsetHiSecs;
+    int32_t  clockDriftPpm;
+    uint8_t  clockLocked;
+    uint8_t  reserved2[3];
+};
+
+struct EidTableSlot {
+    uint64_t eid;
+    /**
+     * Index of the beacon record, or EID_TABLE_EMPTY_SLOT.
+     */
+    uint32_t beaconIndex;
+    uint32_t beaconTimeSecs;
+};
+
+/**
+ * Read-only view of an EID table file. The file is mapped, not read: open()
+ * only checks the header, so that a restarted resolver serves lookups within
+ * milliseconds of starting, whatever the size of the fleet. The table never
+ * changes once opened, so resolve() may be called from any number of threads
+ * while a background thread restores an EidResolver from it
+ * (EidResolver::loadTable) and catches up with the current time.
+ */
+class EidTable
+{
+public:
+    static const int TABLE_SUCCESS = 0;
+    static const int TABLE_IO_ERROR = -1;
+    static const int TABLE_BAD_FORMAT = -2;
+    static const int TABLE_BAD_VERSION = -3;
+    static const int TABLE_BAD_CHECKSUM = -4;
+
+    EidTable();
+
+    ~EidTable();
+
+    /**
+     * Map a table file and check its header.
+     *
+     * @param[in] path
+     *              The file written by EidResolver::saveTable().
+     *
+     * @return TABLE_SUCCESS, or an error if the file cannot be mapped, is
+     *         not an EID table, has another version, is truncated or its
+     *         header checksum does not match.
+     */
+    int open(const char *path);
+
+    /**
+     * Unmap the file.
+     */
+    void close();
+
+    bool isOpen() const { return header != NULL; }
+
+    /**
+     * Check the payload checksum. This reads the whole file, so it is meant
+     * to run in the background after open().
+     *
+     * @return TABLE_SUCCESS or TABLE_BAD_CHECKSUM.
+     */
+    int verify() const;
+
+    /**
+     * Resolve an observed EID from the mapped table.
+     *
+     * @param[in] eid
+     *              The 8-byte EID as broadcast by the beacon.
+     * @param[out] result
+     *              The slot and the beacon time the EID belongs to.
+     *
+     * @return true if the EID is in the table.
+     */
+    bool resolve(const uint8_t *eid, EidResolver::Resolution &result) const;
+
+    uint64_t getIndexTimeSecs() const { return header->indexTimeSecs; }
+
+    uint32_t getWindowPeriods() const { return header->windowPeriods; }
+
+    size_t getBeaconCount() const { return (size_t)header->beaconCount; }
+
+    size_t getEntryCount() const { return (size_t)header->entryCount; }
+
+    size_t getSlotCount() const { return (size_t)header->slotCount; }
+
+    const EidTableBeacon &getBeacon(size_t i) const { return beacons[i]; }
+
+    const EidTableSlot &getSlot(size_t i) const { return slots[i]; }
+
+    /**
+     * Checksum used for the header and the payload: 64-bit FNV-1a over
+     * little endian 8-byte words, with an xor-shift after each multiply so
+     * that the high bits of a word reach the low bits of the hash.
+     *
+     * @param[in] data
+     *              The data, 8-byte aligned.
+     * @param[in] len
+     *              Length in bytes, a multiple of 8.
+     */
+    static uint64_t checksum(const void *data, size_t len);
+
+private:
+    EidTable(const EidTable &);
+    EidTable &operator=(const EidTable &);
+
+    void                    *mapping;
+    size_t                  mappingSize;
+    const EidTableHeader    *header;
+    const EidTableBeacon    *beacons;
+    const EidTableSlot      *slots;
+};
+
+#endif  /* __EIDTABLE_H__ */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EtlmDecryptor.h"
+
+EtlmDecryptor::EtlmDecryptor(const uint8_t *eidIdentityKey) :
+    eax(eidIdentityKey)
+{
+}
+
+int EtlmDecryptor::decrypt(const uint8_t *frame, size_t length, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                           TlmData &tlm) const
+{
+    if (length != FRAME_SIZE_ETLM || frame[0] != FRAME_TYPE_TLM || frame[1] != ETLM_VERSION) {
+        return ETLM_INVALID_FRAME;
+    }
+
+    // Nonce: start of the rotation period (big endian), then the salt
+    uint32_t scaledTime = (beaconTimeSecs >> rotationPeriodExp) << rotationPeriodExp;
+    uint8_t nonce[NONCE_LEN];
+    nonce[0] = (scaledTime >> 24) & 0xff;
+    nonce[1] = (scaledTime >> 16) & 0xff;
+    nonce[2] = (scaledTime >> 8) & 0xff;
+    nonce[3] = scaledTime & 0xff;
+    nonce[4] = frame[SALT_OFFSET];
+    nonce[5] = frame[SALT_OFFSET + 1];
+
+    uint8_t data[TLM_DATA_LEN];
+    if (eax.decrypt(nonce, sizeof(nonce), frame + DATA_OFFSET, TLM_DATA_LEN, data,
+                    frame + MIC_OFFSET, MIC_LEN) != AesEax::EAX_SUCCESS) {
+        return ETLM_AUTH_FAILED;
+    }
+
+    tlm.batteryVoltage = (uint16_t)((data[0] << 8) | data[1]);
+    tlm.beaconTemperature = (uint16_t)((data[2] << 8) | data[3]);
+    tlm.pduCount = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+    tlm.timeSinceBoot = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) | ((uint32_t)data[10] << 8) | data[11];
+    return ETLM_SUCCESS;
+}
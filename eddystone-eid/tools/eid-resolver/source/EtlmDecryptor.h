@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ETLMDECRYPTOR_H__
+#define __ETLMDECRYPTOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AesEax.h"
+
+/**
+ * Plaintext telemetry carried by an Eddystone-TLM frame.
+ */
+struct TlmData {
+    uint16_t batteryVoltage;
+    uint16_t beaconTemperature;
+    uint32_t pduCount;
+    uint32_t timeSinceBoot;
+};
+
+/**
+ * Decrypts the Eddystone-ETLM frames of one EID slot, the counterpart of
+ * TLMFrame::encryptData (implementations/mbed/source/TLMFrame.cpp). Keep one
+ * instance per identity key so that the EAX key setup is only done once.
+ */
+class EtlmDecryptor
+{
+public:
+    static const int ETLM_SUCCESS = 0;
+    static const int ETLM_INVALID_FRAME = -1;
+    static const int ETLM_AUTH_FAILED = -2;
+
+    static const uint8_t FRAME_TYPE_TLM = 0x20;
+    static const uint8_t ETLM_VERSION = 0x01;
+    /**
+     * Service data size: frame type, version, 12 encrypted bytes, the 16-bit
+     * salt and the 16-bit message integrity check.
+     */
+    static const uint8_t FRAME_SIZE_ETLM = 18;
+
+    /**
+     * Construct a decryptor for an EID slot.
+     *
+     * @param[in] eidIdentityKey
+     *              The 16-byte identity key shared with the beacon.
+     */
+    explicit EtlmDecryptor(const uint8_t *eidIdentityKey);
+
+    /**
+     * Verify and decrypt an ETLM frame.
+     *
+     * @param[in] frame
+     *              Eddystone service data, starting at the frame type byte.
+     * @param[in] length
+     *              Length of frame in bytes.
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] beaconTimeSecs
+     *              Beacon time in seconds, e.g. as resolved from the EID
+     *              broadcast in the same rotation period.
+     * @param[out] tlm
+     *              The decrypted telemetry.
+     *
+     * @return ETLM_SUCCESS, ETLM_INVALID_FRAME or ETLM_AUTH_FAILED.
+     */
+    int decrypt(const uint8_t *frame, size_t length, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs,
+                TlmData &tlm) const;
+
+private:
+    static const uint8_t DATA_OFFSET = 2;
+    static const uint8_t TLM_DATA_LEN = 12;
+    static const uint8_t SALT_OFFSET = DATA_OFFSET + TLM_DATA_LEN;
+    static const uint8_t MIC_OFFSET = SALT_OFFSET + 2;
+    static const uint8_t MIC_LEN = 2;
+    static const uint8_t NONCE_LEN = 6;
+
+    AesEax eax;
+};
+
+#endif  /* __ETLMDECRYPTOR_H__ */
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Per-slot interval accuracy of the advertising backends of
+ * EddystoneService, on eq::EventQueueClassic and the simulated stack of
+ * bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, a
+ * URL and a TLM slot, and advertised by the backend the controller allows:
+ * - legacy restart: no radio notification, LegacyAdvertisingBackend
+ *   restarts the legacy advertiser for every frame;
+ * - legacy in place: LegacyAdvertisingBackend swaps the payload at the end
+ *   of the advertising events, on the radio notification;
+ * - multi-set: the controller has 4 advertising sets, and
+ *   MultiSetAdvertisingBackend runs a set per slot.
+ * The simulated controller sends an advertising event every interval plus a
+ * random delay of 0 to 10 ms, and defers an event while the radio is busy
+ * with another one. The rest of the BLE stack posts 1 ms callbacks every
+ * 5 ms on average.
+ *
+ * The deviation of a slot is the difference between the time between two of
+ * its advertising events and its interval; calls counts the calls to Gap,
+ * and events the advertising events of each slot the controller sent. The
+ * PDU lag is the largest number of advertising events sent before a TLM
+ * frame and missing from its PDU count.
+ *
+ * The bench exits with 1 if a slot advertised by an advertising set deviates
+ * from its interval by more than MULTI_SET_MAX_DEVIATION_US (the random
+ * delay of up to 10 ms, plus an event of each other set the controller may
+ * run first), or if the PDU count of a TLM frame of any backend is more than
+ * the events sent before it, or lags them by more than the events of one
+ * TLM interval plus 2 per slot. The legacy backends serve the slots one
+ * frame at a time and have no interval bound.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -DADV_MULTI_SET -DADV_PAYLOAD_UPDATE_IN_PLACE -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/AdvBackendBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o adv_backend_bench
+ *
+ * Usage: adv_backend_bench [minutes]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace {
+
+typedef eq::EventQueueClassic<32> queue_t;
+
+const int SLOT_COUNT = 3;
+const uint64_t STACK_EVENT_MEAN_US = 5000;
+const uint64_t STACK_EVENT_COST_US = 1000;
+
+/// Offset of the PDU count in the advertising payload of a TLM frame.
+const uint8_t TLM_PDU_COUNT_OFFSET = sim_stack::FRAME_TYPE_OFFSET + 6;
+
+/// Largest deviation of a slot from its interval with a set per slot: the
+/// random delay of the specification plus an advertising event (at most
+/// 1.5 ms) of each of the other sets.
+const uint64_t MULTI_SET_MAX_DEVIATION_US = 10000 + (SLOT_COUNT - 1) * 1500;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+enum Backend {
+	LEGACY_RESTART,
+	LEGACY_IN_PLACE,
+	MULTI_SET
+};
+
+/// @return false if a check of the run failed.
+bool run(const char* name, const uint16_t* intervals, Backend backend, unsigned minutes) {
+	static const char* const BACKEND_NAMES[] = { "legacy restart", "legacy in place", "multi-set" };
+
+	BLE& ble = BLE::Instance();
+	ble.gap().simReset();
+	ble.gattServer().simReset();
+	ble.gap().simSetFeatures(backend == MULTI_SET, (backend == MULTI_SET) ? Gap::MAX_SETS : 1,
+		backend != LEGACY_RESTART);
+
+	queue_t queue;
+	sim_stack::StackLoad load(queue, STACK_EVENT_MEAN_US, STACK_EVENT_COST_US);
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, queue);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeUidUrlTlmSlots(intervals)) {
+		printf("slot configuration refused\n");
+		exit(1);
+	}
+
+	sim_stack::IntervalDeviation deviations[SLOT_COUNT];
+	uint64_t slot_events[SLOT_COUNT] = { 0 };
+	uint64_t events = 0;
+	uint64_t pdu_lag = 0;
+	bool pdu_over = false;
+	ble.gap().simOnAdvertisingEvent([&](const sim_ble::AdvertisingEvent& event) {
+		int slot = sim_stack::uidUrlTlmSlot(event);
+		if (slot >= 0) {
+			deviations[slot].add(event.us_time, intervals[slot]);
+			++slot_events[slot];
+		}
+		if (slot == 2 && event.payloadLen >= TLM_PDU_COUNT_OFFSET + 4) {
+			const uint8_t* count = event.payload + TLM_PDU_COUNT_OFFSET;
+			uint32_t pdus = ((uint32_t) count[0] << 24) | (count[1] << 16) | (count[2] << 8) | count[3];
+			if (pdus > events) {
+				pdu_over = true;
+			} else {
+				pdu_lag = std::max(pdu_lag, events - pdus);
+			}
+		}
+		++events;
+	});
+
+	uint64_t start = sim_hal::us_now();
+	uint32_t wakeups = queue.get_wakeup_count();
+	sim_ble::Counters counters = ble.gap().simCounters();
+	service->startEddystoneBeaconAdvertisements();
+	load.start();
+	sim_stack::dispatchUntil(queue, start + (uint64_t) minutes * 60 * 1000 * 1000);
+	double seconds = minutes * 60.0;
+	double wakeups_per_s = (queue.get_wakeup_count() - wakeups) / seconds;
+	double calls_per_s = (ble.gap().simCounters().gapCalls - counters.gapCalls) / seconds;
+	uint64_t deferred = ble.gap().simCounters().deferredEvents - counters.deferredEvents;
+
+	bool ok = true;
+	uint64_t max_pdu_lag = 0;
+	for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+		max_pdu_lag += intervals[2] / intervals[slot] + 2;
+	}
+	if (pdu_over || pdu_lag > max_pdu_lag) {
+		printf("FAIL: %s %s: TLM PDU count %s\n", name, BACKEND_NAMES[backend],
+			pdu_over ? "above the events sent" : "lagging behind the events sent");
+		ok = false;
+	}
+	for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+		const sim_stack::IntervalDeviation& deviation = deviations[slot];
+		if (slot == 0) {
+			printf("%-14s %-15s %9.2f %8.2f %8llu %7llu", name, BACKEND_NAMES[backend], wakeups_per_s, calls_per_s,
+				(unsigned long long) deferred, (unsigned long long) pdu_lag);
+		} else {
+			printf("%-14s %-15s %9s %8s %8s %7s", "", "", "", "", "", "");
+		}
+		printf(" %4d %6u %9.2f %9.2f %8.1f %8.1f\n", slot, (unsigned) intervals[slot],
+			1000.0 / intervals[slot], slot_events[slot] / seconds, deviation.mean_ms(), deviation.max_ms());
+		if (backend == MULTI_SET && (deviation.count() == 0 || deviation.max_ms() * 1000 > MULTI_SET_MAX_DEVIATION_US)) {
+			printf("FAIL: %s %s: slot %d deviates from its interval by more than %.1f ms\n", name,
+				BACKEND_NAMES[backend], slot, MULTI_SET_MAX_DEVIATION_US / 1000.0);
+			ok = false;
+		}
+	}
+
+	load.stop();
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+	return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned minutes = (argc > 1) ? atoi(argv[1]) : 60;
+	const uint16_t spread[SLOT_COUNT] = { 700, 1000, 1500 };
+	const uint16_t busy[SLOT_COUNT] = { 100, 200, 300 };
+	const uint16_t* const beacons[] = { spread, busy };
+	const char* const beacon_names[] = { "700/1000/1500", "100/200/300" };
+
+	printf("%u simulated minutes, deviations in ms\n", minutes);
+	printf("%-14s %-15s %9s %8s %8s %7s %4s %6s %9s %9s %8s %8s\n", "slots ms", "backend", "wakeups/s", "calls/s",
+		"deferred", "pdu lag", "slot", "ms", "target/s", "events/s", "mean dev", "max dev");
+	bool ok = true;
+	for (int beacon = 0; beacon < 2; ++beacon) {
+		ok = run(beacon_names[beacon], beacons[beacon], LEGACY_RESTART, minutes) && ok;
+		ok = run(beacon_names[beacon], beacons[beacon], LEGACY_IN_PLACE, minutes) && ok;
+		ok = run(beacon_names[beacon], beacons[beacon], MULTI_SET, minutes) && ok;
+	}
+	return ok ? 0 : 1;
+}
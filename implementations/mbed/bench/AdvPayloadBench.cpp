@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of the frame swaps of EddystoneService::manageRadio, with the
+ * advertising payloads prebuilt per slot, on eq::EventQueueClassic and the
+ * simulated stack of bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, a
+ * URL and a TLM slot, at 700, 1000 and 1500 ms, and advertised by
+ * LegacyAdvertisingBackend, restarting advertising for every frame. The
+ * payload of a UID or URL slot is built once; the TLM frame changes at
+ * every swap, so its payload is rebuilt for each. The costs of the stack are
+ * zeroed, so that the time of a swap is the host time of manageRadio and of
+ * the stand-ins it calls, which copy the payload as a controller would.
+ *
+ * A swap is a RADIO event which gives a payload to the controller; it is
+ * accounted to the frame of the next advertising event. Builds counts the
+ * payloads built (3 AD structures each), updates the payloads given to the
+ * controller and calls the calls to Gap.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/AdvPayloadBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o adv_payload_bench
+ *
+ * Usage: adv_payload_bench [hours]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "EventQueueProbe.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+typedef eq::EventQueueClassic<16> queue_t;
+typedef sim_stack::EventQueueProbe<16> probe_t;
+
+const int SLOT_COUNT = 3;
+const uint8_t AD_STRUCTURES_PER_PAYLOAD = 3;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+/// What the swaps of a frame did.
+struct Swaps {
+	uint64_t count;
+	uint64_t fields;
+	uint64_t updates;
+	uint64_t calls;
+	uint64_t ns_host;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned hours = (argc > 1) ? atoi(argv[1]) : 24;
+	const uint16_t intervals[SLOT_COUNT] = { 700, 1000, 1500 };
+	static const char* const FRAME_NAMES[SLOT_COUNT] = { "UID", "URL", "TLM" };
+
+	sim_stack::costs() = sim_stack::Costs();
+	BLE& ble = BLE::Instance();
+	queue_t queue;
+	probe_t probe(queue);
+
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, probe);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeUidUrlTlmSlots(intervals)) {
+		printf("slot configuration refused\n");
+		return 1;
+	}
+
+	// a swap is what a RADIO event did, accounted once its frame is on air
+	Swaps swaps[SLOT_COUNT] = {};
+	Swaps pending = {};
+	sim_ble::Counters gap = ble.gap().simCounters();
+	sim_stack::Counters stack = sim_stack::counters();
+	probe.on_record([&](const probe_t::Record& record) {
+		const sim_ble::Counters& gap_now = ble.gap().simCounters();
+		const sim_stack::Counters& stack_now = sim_stack::counters();
+		if (record.priority == probe_t::priority_t::RADIO && gap_now.payloadUpdates != gap.payloadUpdates) {
+			pending.count = 1;
+			pending.fields = stack_now.advDataFields - stack.advDataFields;
+			pending.updates = gap_now.payloadUpdates - gap.payloadUpdates;
+			pending.calls = gap_now.gapCalls - gap.gapCalls;
+			pending.ns_host = record.ns_host;
+		}
+		gap = gap_now;
+		stack = stack_now;
+	});
+	ble.gap().simOnAdvertisingEvent([&](const sim_ble::AdvertisingEvent& event) {
+		int slot = sim_stack::uidUrlTlmSlot(event);
+		if (slot >= 0 && pending.count) {
+			swaps[slot].count += pending.count;
+			swaps[slot].fields += pending.fields;
+			swaps[slot].updates += pending.updates;
+			swaps[slot].calls += pending.calls;
+			swaps[slot].ns_host += pending.ns_host;
+		}
+		pending = Swaps();
+	});
+
+	uint64_t start = sim_hal::us_now();
+	service->startEddystoneBeaconAdvertisements();
+	gap = ble.gap().simCounters();
+	stack = sim_stack::counters();
+	sim_stack::dispatchUntil(queue, start + (uint64_t) hours * 60 * 60 * 1000 * 1000);
+
+	printf("%u simulated hours, stack costs zeroed\n", hours);
+	printf("%-6s %9s %11s %12s %10s %12s\n", "frame", "swaps", "builds/swap", "updates/swap", "calls/swap",
+		"ns per swap");
+	for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+		const Swaps& frame = swaps[slot];
+		double count = frame.count ? (double) frame.count : 1;
+		printf("%-6s %9llu %11.2f %12.2f %10.2f %12.0f\n", FRAME_NAMES[slot], (unsigned long long) frame.count,
+			frame.fields / AD_STRUCTURES_PER_PAYLOAD / count, frame.updates / count, frame.calls / count,
+			frame.ns_host / count);
+	}
+
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+	return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Frame swaps of LegacyAdvertisingBackend, restarting advertising for every
+ * frame or swapping the payload of the running advertiser, on
+ * eq::EventQueueClassic and the simulated stack of bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, a
+ * URL and a TLM slot. Restart: the controller has no radio notification,
+ * advertising runs at the maximum interval and is stopped and restarted
+ * with the next frame 100 ms after each frame. In place
+ * (ADV_PAYLOAD_UPDATE_IN_PLACE): advertising runs at 100 ms, and the radio
+ * notification at the end of an advertising event swaps the next frame in
+ * the running advertiser. The simulated controller sends an advertising
+ * event every interval plus a random delay of 0 to 10 ms. The rest of the
+ * BLE stack posts 1 ms callbacks every 5 ms on average.
+ *
+ * A frame is a payload given to the controller; it is missed if it is
+ * replaced before an advertising event sends it. A frame is late by the
+ * time its first advertising event comes after the first event of the
+ * previous frame of its slot plus the slot interval. Swap is the run time
+ * of the RADIO events (manageRadio); calls counts the calls to Gap.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -DADV_PAYLOAD_UPDATE_IN_PLACE -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/AdvSwapBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o adv_swap_bench
+ *
+ * Usage: adv_swap_bench [minutes]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "EventQueueProbe.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace {
+
+typedef eq::EventQueueClassic<32> queue_t;
+typedef sim_stack::EventQueueProbe<32> probe_t;
+
+const int SLOT_COUNT = 3;
+const uint64_t NEVER = ~(uint64_t) 0;
+const uint64_t STACK_EVENT_MEAN_US = 5000;
+const uint64_t STACK_EVENT_COST_US = 1000;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+/// The frames as they go on air.
+class Frames {
+public:
+	Frames(const uint16_t* intervals) :
+		sent(0), missed(0), total_lateness_us(0), max_lateness_us(0), _intervals(intervals), _updates(0) {
+		std::fill(_last_us, _last_us + SLOT_COUNT, NEVER);
+	}
+
+	/// Start counting from the payload updates done so far.
+	void reset(uint64_t updates) {
+		_updates = updates;
+	}
+
+	/// An advertising event; updates is the count of payloads given to the
+	/// controller so far.
+	void add(const sim_ble::AdvertisingEvent& event, uint64_t updates) {
+		if (updates == _updates) {
+			return;
+		}
+		// the latest payload goes on air, those before it never will
+		missed += updates - _updates - 1;
+		_updates = updates;
+		++sent;
+		int slot = sim_stack::uidUrlTlmSlot(event);
+		if (slot < 0) {
+			return;
+		}
+		if (_last_us[slot] != NEVER) {
+			uint64_t due = _last_us[slot] + (uint64_t) _intervals[slot] * 1000;
+			uint64_t lateness = (event.us_time > due) ? event.us_time - due : 0;
+			total_lateness_us += lateness;
+			max_lateness_us = std::max(max_lateness_us, lateness);
+		}
+		_last_us[slot] = event.us_time;
+	}
+
+	uint64_t sent;
+	uint64_t missed;
+	uint64_t total_lateness_us;
+	uint64_t max_lateness_us;
+
+private:
+	const uint16_t* _intervals;
+	uint64_t _updates;
+	uint64_t _last_us[SLOT_COUNT];
+};
+
+void run(const char* name, const uint16_t* intervals, bool in_place, unsigned minutes) {
+	BLE& ble = BLE::Instance();
+	ble.gap().simReset();
+	ble.gattServer().simReset();
+	ble.gap().simSetFeatures(false, 1, in_place);
+
+	queue_t queue;
+	probe_t probe(queue);
+	sim_stack::StackLoad load(queue, STACK_EVENT_MEAN_US, STACK_EVENT_COST_US);
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, probe);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeUidUrlTlmSlots(intervals)) {
+		printf("slot configuration refused\n");
+		exit(1);
+	}
+
+	Frames frames(intervals);
+	ble.gap().simOnAdvertisingEvent([&](const sim_ble::AdvertisingEvent& event) {
+		frames.add(event, ble.gap().simCounters().payloadUpdates);
+	});
+
+	uint64_t start = sim_hal::us_now();
+	sim_ble::Counters counters = ble.gap().simCounters();
+	frames.reset(counters.payloadUpdates);
+	probe.reset_class_stats();
+	service->startEddystoneBeaconAdvertisements();
+	load.start();
+	sim_stack::dispatchUntil(queue, start + (uint64_t) minutes * 60 * 1000 * 1000);
+
+	const sim_ble::Counters& now = ble.gap().simCounters();
+	const probe_t::ClassStats& radio = probe.get_class_stats(probe_t::priority_t::RADIO);
+	uint64_t updates = now.payloadUpdates - counters.payloadUpdates;
+	printf("%-14s %-8s %8.2f %9.3f %7llu %8.3f %10.2f %8.1f %8.1f %8.1f\n",
+		name, in_place ? "in place" : "restart",
+		updates / (minutes * 60.0),
+		(double) (now.advertisingEvents - counters.advertisingEvents) / updates,
+		(unsigned long long) frames.missed,
+		(double) (now.gapCalls - counters.gapCalls) / updates,
+		(double) (now.radioUs - counters.radioUs) / updates / 1000,
+		(double) frames.total_lateness_us / frames.sent / 1000,
+		frames.max_lateness_us / 1000.0,
+		radio.count ? (double) radio.total_run_us / radio.count : 0);
+
+	load.stop();
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned minutes = (argc > 1) ? atoi(argv[1]) : 60;
+	const uint16_t spread[SLOT_COUNT] = { 700, 1000, 1500 };
+	const uint16_t busy[SLOT_COUNT] = { 100, 200, 300 };
+
+	printf("%u simulated minutes\n", minutes);
+	printf("%-14s %-8s %8s %9s %7s %8s %10s %8s %8s %8s\n",
+		"slots ms", "swap", "frames/s", "events/f", "missed", "calls/f", "radio ms/f", "late ms", "max late",
+		"swap us");
+	run("700/1000/1500", spread, false, minutes);
+	run("700/1000/1500", spread, true, minutes);
+	run("100/200/300", busy, false, minutes);
+	run("100/200/300", busy, true, minutes);
+	return 0;
+}
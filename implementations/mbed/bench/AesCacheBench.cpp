@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of EIDFrame::update and TLMFrame::encryptData with and without the
+ * AesKeyCache, on the simulated stack of bench/stack.
+ *
+ * An EID slot (2^10 s rotation) is updated at every rotation and an eTLM
+ * frame is encrypted every 1.5 s, like the eTLM slot of a beacon, sharing
+ * one AesKeyCache. Per call, the cache is cleared after every call, so the
+ * key schedule runs for every AES operation as it did before the cache;
+ * cached keeps the key schedules. Both draw the same eTLM salts from the
+ * simulated RNG and must give the same frames.
+ *
+ * The AES of bench/stack is a stand-in which takes the simulated time of
+ * sim_stack::costs() (an nRF51 at 16 MHz): the times are the key schedules
+ * and blocks run, weighted by those costs, not measured AES.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/AesCacheBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o aes_cache_bench
+ *
+ * Usage: aes_cache_bench [hours]
+ */
+
+#include "AesKeyCache.h"
+#include "EIDFrame.h"
+#include "TLMFrame.h"
+#include "SimStack.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+const uint8_t ROTATION_PERIOD_EXP = 10;
+const uint32_t TLM_INTERVAL_MS = 1500;
+
+const EidIdentityKey_t IDENTITY_KEY = {
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf
+};
+const uint8_t NULL_EID[EIDFrame::EID_LENGTH] = { 0 };
+
+/// AES work of the calls of an operation.
+struct Cost {
+	Cost() : calls(0), setkeys(0), blocks(0), total_us(0), max_us(0) {
+	}
+
+	uint64_t calls;
+	uint64_t setkeys;
+	uint64_t blocks;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+/// Accounts the AES work done during its lifetime to a Cost.
+class Measure {
+public:
+	Measure(Cost& cost) :
+		_cost(cost), _counters(sim_stack::counters()), _start_us(sim_hal::us_now()) {
+	}
+
+	~Measure() {
+		const sim_stack::Counters& counters = sim_stack::counters();
+		uint64_t us = sim_hal::us_now() - _start_us;
+		++_cost.calls;
+		_cost.setkeys += counters.aesSetkeys - _counters.aesSetkeys;
+		_cost.blocks += counters.aesBlocks - _counters.aesBlocks;
+		_cost.total_us += us;
+		_cost.max_us = std::max(_cost.max_us, us);
+	}
+
+private:
+	Cost& _cost;
+	sim_stack::Counters _counters;
+	uint64_t _start_us;
+};
+
+/// FNV-1a of the frames produced.
+uint32_t hash(uint32_t h, const uint8_t* data, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		h = (h ^ data[i]) * 16777619u;
+	}
+	return h;
+}
+
+struct Result {
+	Cost eid;
+	Cost tlm;
+	uint32_t eid_hash;
+	uint32_t tlm_hash;
+};
+
+Result run(unsigned hours, bool per_call) {
+	// both runs draw the same eTLM salts
+	sim_stack::rng_state() = 1;
+	AesKeyCache keys;
+	EIDFrame eidFrame(keys);
+	TLMFrame tlmFrame(keys);
+	EidIdentityKey_t identityKey;
+	memcpy(identityKey, IDENTITY_KEY, sizeof(identityKey));
+	EidTempKey_t tempKey;
+	memset(&tempKey, 0, sizeof(tempKey));
+	Slot_t eid;
+	Slot_t tlm;
+	memset(eid, 0, sizeof(eid));
+	memset(tlm, 0, sizeof(tlm));
+	Result result;
+	result.eid_hash = 2166136261u;
+	result.tlm_hash = 2166136261u;
+
+	uint64_t end_ms = (uint64_t) hours * 3600 * 1000;
+	uint64_t next_rotation_ms = 0;
+	for (uint64_t now_ms = 0; now_ms < end_ms; now_ms += TLM_INTERVAL_MS) {
+		if (now_ms >= next_rotation_ms) {
+			eidFrame.setData(eid, 0, NULL_EID);
+			{
+				Measure measure(result.eid);
+				eidFrame.update(eid, identityKey, ROTATION_PERIOD_EXP, (uint32_t) (next_rotation_ms / 1000), &tempKey);
+			}
+			if (per_call) {
+				keys.clear();
+			}
+			result.eid_hash = hash(result.eid_hash, eid, sizeof(eid));
+			next_rotation_ms += (1000 << ROTATION_PERIOD_EXP);
+		}
+
+		tlmFrame.updateTimeSinceLastBoot((uint32_t) now_ms);
+		tlmFrame.setData(tlm);
+		{
+			Measure measure(result.tlm);
+			tlmFrame.encryptData(tlm, identityKey, ROTATION_PERIOD_EXP, (uint32_t) (now_ms / 1000));
+		}
+		if (per_call) {
+			keys.clear();
+		}
+		result.tlm_hash = hash(result.tlm_hash, tlm, sizeof(tlm));
+	}
+	return result;
+}
+
+void print(const char* op, const char* keys, const Cost& cost) {
+	printf("%-5s %-9s %8llu %12.3f %12.3f %8.1f %8llu\n",
+		op, keys, (unsigned long long) cost.calls,
+		cost.calls ? (double) cost.setkeys / cost.calls : 0,
+		cost.calls ? (double) cost.blocks / cost.calls : 0,
+		cost.calls ? (double) cost.total_us / cost.calls : 0,
+		(unsigned long long) cost.max_us);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned hours = (argc > 1) ? atoi(argv[1]) : 24;
+
+	printf("%u simulated hours, key schedule %llu us, block %llu us\n", hours,
+		(unsigned long long) sim_stack::costs().aesSetkey,
+		(unsigned long long) sim_stack::costs().aesBlock);
+	Result before = run(hours, true);
+	Result after = run(hours, false);
+	printf("%-5s %-9s %8s %12s %12s %8s %8s\n",
+		"op", "keys", "calls", "setkeys/call", "blocks/call", "us/call", "max us");
+	print("eid", "per call", before.eid);
+	print("eid", "cached", after.eid);
+	print("etlm", "per call", before.tlm);
+	print("etlm", "cached", after.tlm);
+
+	if (before.eid_hash != after.eid_hash || before.tlm_hash != after.tlm_hash) {
+		printf("FAILED: the cached keys give other frames\n");
+		return 1;
+	}
+	if (after.eid.setkeys > before.eid.setkeys || after.tlm.setkeys > before.tlm.setkeys) {
+		printf("FAILED: the cache runs more key schedules\n");
+		return 1;
+	}
+	return 0;
+}
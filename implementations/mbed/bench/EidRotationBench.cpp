@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Frame swap latency of EddystoneService at EID rotations, on
+ * eq::EventQueueClassic and the simulated stack of bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, an
+ * EID (2^10 s rotation) and an eTLM slot, at 700, 1000 and 1500 ms, and
+ * advertised by the legacy advertising backend (restart for every frame).
+ * The stack, mbedtls and the entropy source take the simulated times of
+ * sim_stack::costs(). A HOUSEKEEPING event prepares each rotation ahead;
+ * the RADIO event which swaps in the EID frame of a new rotation period
+ * only commits it, unless the rotation was not prepared (inline: the EID,
+ * the DRBG seed and the MAC address are computed in the swap).
+ *
+ * Swap is the run time of the RADIO events (manageRadio), rot. max the
+ * worst of those which rotated the MAC address, late the time from the
+ * deadline of a RADIO event to its start and hk max the longest
+ * HOUSEKEEPING callback.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/EidRotationBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o eid_rotation_bench
+ *
+ * Usage: eid_rotation_bench [hours]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "EventQueueProbe.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace {
+
+typedef eq::EventQueueClassic<16> queue_t;
+typedef sim_stack::EventQueueProbe<16> probe_t;
+
+const uint8_t ROTATION_PERIOD_EXP = 10;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+const uint8_t UID_DATA[] = {
+	sim_stack::SLOT_DATA_UID,
+	0x8b, 0x0c, 0xa7, 0x50, 0xe7, 0xa7, 0x4e, 0x14, 0xbd, 0x99, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+};
+const uint8_t EID_DATA[] = {
+	sim_stack::SLOT_DATA_EID,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	ROTATION_PERIOD_EXP
+};
+const uint8_t TLM_DATA[] = { sim_stack::SLOT_DATA_TLM };
+
+/// Latencies of a kind of event.
+struct Latency {
+	Latency() : count(0), total_us(0), max_us(0) {
+	}
+
+	void add(uint64_t us) {
+		++count;
+		total_us += us;
+		max_us = std::max(max_us, us);
+	}
+
+	double mean_us() const {
+		return count ? (double) total_us / count : 0;
+	}
+
+	uint64_t count;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned hours = (argc > 1) ? atoi(argv[1]) : 24;
+
+	BLE& ble = BLE::Instance();
+	queue_t queue;
+	probe_t probe(queue);
+
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, probe);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeSlot(0, 700, UID_DATA, sizeof(UID_DATA)) ||
+		!sim_stack::writeSlot(1, 1000, EID_DATA, sizeof(EID_DATA)) ||
+		!sim_stack::writeSlot(2, 1500, TLM_DATA, sizeof(TLM_DATA))) {
+		printf("slot configuration refused\n");
+		return 1;
+	}
+
+	// what each event did is the difference of the counters around it
+	Latency swaps;
+	Latency rotation_swaps;
+	Latency lateness;
+	uint64_t rotations = 0;
+	uint64_t inline_rotations = 0;
+	sim_ble::Counters gap = ble.gap().simCounters();
+	sim_stack::Counters stack = sim_stack::counters();
+	probe.on_record([&](const probe_t::Record& record) {
+		const sim_ble::Counters& gap_now = ble.gap().simCounters();
+		const sim_stack::Counters& stack_now = sim_stack::counters();
+		if (record.priority == probe_t::priority_t::RADIO) {
+			uint64_t swap_us = record.us_end - record.us_start;
+			swaps.add(swap_us);
+			lateness.add(record.us_start - record.us_deadline);
+			if (gap_now.addressChanges != gap.addressChanges) {
+				++rotations;
+				rotation_swaps.add(swap_us);
+				if (stack_now.drbgSeeds != stack.drbgSeeds) {
+					++inline_rotations;
+				}
+			}
+		}
+		gap = gap_now;
+		stack = stack_now;
+	});
+
+	uint64_t start = sim_hal::us_now();
+	service->startEddystoneBeaconAdvertisements();
+	gap = ble.gap().simCounters();
+	stack = sim_stack::counters();
+	sim_stack::dispatchUntil(queue, start + (uint64_t) hours * 60 * 60 * 1000 * 1000);
+
+	const probe_t::ClassStats& housekeeping = probe.get_class_stats(probe_t::priority_t::HOUSEKEEPING);
+	printf("%u simulated hours, 2^%u s EID rotation\n", hours, (unsigned) ROTATION_PERIOD_EXP);
+	printf("%9s %9s %9s %9s %9s %9s %10s %6s %9s\n", "swaps", "swap us", "max us", "rot. max",
+		"late ms", "max ms", "hk max us", "rot/h", "inline/h");
+	printf("%9llu %9.1f %9llu %9llu %9.1f %9.1f %10llu %6.1f %9.1f\n",
+		(unsigned long long) swaps.count, swaps.mean_us(), (unsigned long long) swaps.max_us,
+		(unsigned long long) rotation_swaps.max_us, lateness.mean_us() / 1000, lateness.max_us / 1000.0,
+		(unsigned long long) housekeeping.max_run_us, (double) rotations / hours,
+		(double) inline_rotations / hours);
+
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+	return 0;
+}
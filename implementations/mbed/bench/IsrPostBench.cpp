@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Time spent by eq::EventQueueClassic with interrupts masked, on the
+ * simulated HAL of bench/hal.
+ *
+ * The queue holds the events of a beacon: 3 slots posted with post_every
+ * and the radio callback posted 100 ms after each frame, from the thread,
+ * and fills up with periodic timers of 1 to 10 s posted with a 10%
+ * tolerance. Meanwhile a simulated BLE stack interrupt posts processEvents,
+ * like scheduleBleEventsProcessing in main.cpp, at random times (every 5 ms
+ * on average), and a button interrupt posts a task with a delay now and
+ * then; the button bounces, and the bounce interrupt cancels the task and
+ * posts it again, so the task has to run once per press. The thread
+ * dispatches after every ticker interrupt and every post from an interrupt.
+ *
+ * Every section run with interrupts masked is timed on the host clock. The
+ * simulation is deterministic, so it is run several times and each section
+ * keeps the shortest of its durations: a section preempted by the host in
+ * one run is not in the others. The figures are in ns above an empty masked
+ * section, timed the same way, which measures the cost of the timing itself.
+ *
+ * Built with ISR_POST_BENCH_BASELINE, the bench runs the EventQueueClassic
+ * of bench/baseline, the queue as it was before the interrupt staging rings
+ * (102e1e1), which masks interrupts around every post, cancel and dispatch.
+ * It takes no tolerance, so its timers are periodic.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Ibench/hal -Isource/EventQueue bench/IsrPostBench.cpp -o isr_post_bench
+ *   g++ -O2 -std=c++11 -DISR_POST_BENCH_BASELINE -Ibench/hal -Ibench/baseline -Ibench/baseline/EventQueue bench/IsrPostBench.cpp -o isr_post_bench_baseline
+ *
+ * Usage: isr_post_bench [minutes [runs]]
+ */
+
+#include "EventQueueClassic.h"
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+const int SLOT_COUNT = 3;
+const eq::EventQueue::ms_time_t SLOT_INTERVALS[SLOT_COUNT] = { 700, 1000, 1500 };
+const eq::EventQueue::ms_time_t RADIO_INTERVAL = 100;
+const uint64_t BLE_EVENT_MEAN_US = 5000;
+const unsigned BUTTON_PERIOD = 1000;            /// one BLE event in BUTTON_PERIOD is a button press
+const unsigned BUTTON_BOUNCE = 2;               /// and BUTTON_BOUNCE BLE events later, its bounce
+const eq::EventQueue::ms_time_t BUTTON_DELAY = 750;
+const unsigned FREE_EVENTS = 4;                 /// room left for the radio and interrupt events
+const unsigned CALIBRATION_SECTIONS = 100000;
+
+#ifdef ISR_POST_BENCH_BASELINE
+const char* const QUEUE_NAME = "baseline";
+#else
+const char* const QUEUE_NAME = "rings";
+#endif
+
+/// The slot scheduling of EddystoneService.
+class Beacon {
+public:
+	Beacon(eq::EventQueue& queue) : _queue(queue), _queued_frames(0), _radio_handle(NULL) {
+	}
+
+	void start() {
+		for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+			_queue.post_every(&Beacon::enqueueFrame, this, slot, SLOT_INTERVALS[slot]);
+		}
+	}
+
+private:
+	void enqueueFrame(int slot) {
+		(void) slot;
+		++_queued_frames;
+		if (!_radio_handle) {
+			manageRadio();
+		}
+	}
+
+	void manageRadio() {
+		_radio_handle = NULL;
+		if (_queued_frames) {
+			--_queued_frames;
+			_radio_handle = _queue.post_in(&Beacon::manageRadio, this, RADIO_INTERVAL);
+		}
+	}
+
+	eq::EventQueue& _queue;
+	uint32_t _queued_frames;
+	eq::EventQueue::event_handle_t _radio_handle;
+};
+
+/// The BLE stack and the button, run from interrupt handlers.
+struct Peripherals {
+	Peripherals() : processed(0), presses(0), button_tasks(0), posts(0), failed_posts(0), button_handle(NULL) {
+	}
+
+	void processEvents() {
+		++processed;
+	}
+
+	void buttonTask() {
+		++button_tasks;
+	}
+
+	uint32_t processed;
+	uint32_t presses;
+	uint32_t button_tasks;
+	uint32_t posts;
+	uint32_t failed_posts;
+	eq::EventQueue::event_handle_t button_handle;
+};
+
+void timer() {
+}
+
+uint64_t random_us(uint64_t mean) {
+	return 1 + (uint64_t) rand() % (2 * mean);
+}
+
+/// Keep in shortest the shortest duration of each section of trace.
+/// @return false if the runs did not mask the same sections.
+bool keep_shortest(std::vector<uint32_t>& shortest, const std::vector<uint32_t>& trace, bool first) {
+	if (first) {
+		shortest = trace;
+		return true;
+	}
+	if (trace.size() != shortest.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i < trace.size(); ++i) {
+		shortest[i] = std::min(shortest[i], trace[i]);
+	}
+	return true;
+}
+
+/// Duration of the section at fraction of the sorted durations.
+uint64_t percentile(const std::vector<uint32_t>& sorted, double fraction) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	std::size_t index = (std::size_t) (fraction * sorted.size());
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/// p50 of an empty masked section, shortest of runs
+uint64_t calibrate(unsigned runs) {
+	std::vector<uint32_t> trace;
+	std::vector<uint32_t> shortest;
+	sim_hal::masked_trace() = &trace;
+	for (unsigned run = 0; run < runs; ++run) {
+		trace.clear();
+		for (unsigned i = 0; i < CALIBRATION_SECTIONS; ++i) {
+			::mbed::util::CriticalSectionLock lock;
+		}
+		keep_shortest(shortest, trace, run == 0);
+	}
+	sim_hal::masked_trace() = NULL;
+	std::sort(shortest.begin(), shortest.end());
+	return percentile(shortest, 0.5);
+}
+
+uint64_t above(uint64_t ns, uint64_t overhead) {
+	return ns > overhead ? ns - overhead : 0;
+}
+
+/// One run of the simulation, from time 0.
+template<std::size_t EventCount>
+void simulate(unsigned minutes, Peripherals& peripherals) {
+	sim_hal::us_now() = 0;
+	eq::EventQueueClassic<EventCount> queue;
+	Beacon beacon(queue);
+	srand(1);
+	beacon.start();
+	for (unsigned i = SLOT_COUNT; i < EventCount - FREE_EVENTS; ++i) {
+		eq::EventQueue::ms_time_t period = 1000 + rand() % 9000;
+#ifdef ISR_POST_BENCH_BASELINE
+		queue.post_every(timer, period);
+#else
+		queue.post_every(timer, period, eq::EventQueue::ms_tolerance_t(period / 10));
+#endif
+	}
+	queue.dispatch();
+
+	std::vector<uint32_t>* trace = sim_hal::masked_trace();
+	trace->clear();
+	uint64_t end = sim_hal::us_now() + (uint64_t) minutes * 60 * 1000 * 1000;
+	uint64_t next_interrupt = sim_hal::us_now() + random_us(BLE_EVENT_MEAN_US);
+	while (sim_hal::us_now() < end) {
+		if (sim_hal::run_until(next_interrupt) == false) {
+			sim_hal::InterruptContext isr;
+			eq::EventQueue::event_handle_t handle;
+			if ((peripherals.posts % BUTTON_PERIOD) == 0) {
+				++peripherals.presses;
+				handle = queue.post_in(&Peripherals::buttonTask, &peripherals, BUTTON_DELAY);
+				peripherals.button_handle = handle;
+			} else if ((peripherals.posts % BUTTON_PERIOD) == BUTTON_BOUNCE && peripherals.button_handle) {
+				queue.cancel(peripherals.button_handle);
+				handle = queue.post_in(&Peripherals::buttonTask, &peripherals, BUTTON_DELAY);
+				peripherals.button_handle = handle;
+			} else {
+				handle = queue.post(&Peripherals::processEvents, &peripherals);
+			}
+			++peripherals.posts;
+			if (handle == NULL) {
+				++peripherals.failed_posts;
+			}
+			next_interrupt = sim_hal::us_now() + random_us(BLE_EVENT_MEAN_US);
+		}
+		queue.dispatch();
+	}
+	// the last press may not have run its task yet
+	sim_hal::run_until(sim_hal::us_now() + BUTTON_DELAY * 1000 + 1000);
+	queue.dispatch();
+}
+
+/// @return false if a button press did not run its task exactly once, or
+/// if the runs did not mask the same sections.
+template<std::size_t EventCount>
+bool run(unsigned minutes, unsigned runs, uint64_t overhead) {
+	std::vector<uint32_t> trace;
+	std::vector<uint32_t> shortest;
+	Peripherals peripherals;
+	bool ok = true;
+	sim_hal::masked_trace() = &trace;
+	for (unsigned run = 0; run < runs; ++run) {
+		peripherals = Peripherals();
+		simulate<EventCount>(minutes, peripherals);
+		ok = ok && peripherals.presses == peripherals.button_tasks;
+		ok = ok && keep_shortest(shortest, trace, run == 0);
+	}
+	sim_hal::masked_trace() = NULL;
+	std::sort(shortest.begin(), shortest.end());
+
+	printf("%-8s %6u %10u %8u %8u %8u %10llu %8llu %8llu %8llu %8llu\n",
+		QUEUE_NAME, (unsigned) EventCount, peripherals.posts, peripherals.failed_posts,
+		peripherals.presses, peripherals.button_tasks,
+		(unsigned long long) shortest.size(),
+		(unsigned long long) above(percentile(shortest, 0.5), overhead),
+		(unsigned long long) above(percentile(shortest, 0.99), overhead),
+		(unsigned long long) above(percentile(shortest, 0.9999), overhead),
+		(unsigned long long) above(shortest.empty() ? 0 : shortest.back(), overhead));
+	return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned minutes = (argc > 1) ? atoi(argv[1]) : 30;
+	unsigned runs = (argc > 2) ? atoi(argv[2]) : 15;
+	if (runs == 0) {
+		runs = 1;
+	}
+
+	uint64_t overhead = calibrate(runs);
+	printf("%u simulated minutes, shortest of %u runs, empty masked section %llu ns\n",
+		minutes, runs, (unsigned long long) overhead);
+	printf("%-8s %6s %10s %8s %8s %8s %10s %8s %8s %8s %8s\n",
+		"queue", "events", "isr posts", "failed", "presses", "tasks", "masked", "p50 ns", "p99 ns", "p99.99", "max ns");
+	bool ok = run<10>(minutes, runs, overhead);
+	ok = run<64>(minutes, runs, overhead) && ok;
+	if (!ok) {
+		printf("FAILED: a button press did not run its task once, or the runs differ\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Latency of the radio frame swaps of EddystoneService on
+ * eq::EventQueueClassic, with the priority classes it posts its events in
+ * and with every event in one class, on the simulated stack of bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, an
+ * EID (2^10 s rotation) and an eTLM slot, at 700, 1000 and 1500 ms, and
+ * advertised by the legacy advertising backend (restart for every frame).
+ * The rest of the BLE stack posts 1 ms callbacks every 5 ms on average.
+ * With ECDH, a client writes a server public key to the EID slot every
+ * 10 s, from a BLE stack event: the service runs the key exchange as two
+ * HOUSEKEEPING events, the 300 ms Curve25519 point multiplication then the
+ * key derivation and the new EID frame.
+ *
+ * With classes, the events keep the class they are posted in: the frame
+ * swaps are RADIO, the stack events BLE_STACK, the EID preparation and the
+ * key exchange HOUSEKEEPING. Without, EventQueueProbe posts them all in
+ * BLE_STACK, and due events run by deadline. A callback is never
+ * interrupted: a swap which becomes due during the point multiplication
+ * waits for it either way; classes spare it the backlog of stack events
+ * queued meanwhile.
+ *
+ * The lateness of an event is the time it starts minus its deadline.
+ *
+ * First, the bench checks that a client reading back the identity key and
+ * the slot data right after writing a server key gets the derived key and
+ * the EID frame, as with the exchange in the write callback: the read
+ * finishes the exchange. It exits with 1 otherwise.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/PriorityBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o priority_bench
+ *
+ * Usage: priority_bench [minutes]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "EventQueueProbe.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+typedef eq::EventQueueClassic<128, 128> queue_t;
+typedef sim_stack::EventQueueProbe<128> probe_t;
+
+const uint8_t ROTATION_PERIOD_EXP = 10;
+const uint8_t EID_SLOT = 1;
+const probe_t::ms_time_t KEY_WRITE_PERIOD = 10000;
+const uint64_t STACK_EVENT_MEAN_US = 5000;
+const uint64_t STACK_EVENT_COST_US = 1000;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+const uint8_t EID_DATA[] = {
+	sim_stack::SLOT_DATA_EID,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	ROTATION_PERIOD_EXP
+};
+/// A server public ECDH key and the rotation period exponent.
+const uint8_t ECDH_DATA[] = {
+	sim_stack::SLOT_DATA_EID,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	ROTATION_PERIOD_EXP
+};
+
+/// Sorted latenesses, in us.
+class Latencies {
+public:
+	void add(uint64_t us) {
+		_values.push_back(us);
+	}
+
+	size_t count() const {
+		return _values.size();
+	}
+
+	uint64_t percentile(double p) {
+		if (_values.empty()) {
+			return 0;
+		}
+		std::sort(_values.begin(), _values.end());
+		return _values[(size_t) (p * (_values.size() - 1))];
+	}
+
+	size_t above(uint64_t us) const {
+		size_t count = 0;
+		for (size_t i = 0; i < _values.size(); ++i) {
+			count += _values[i] > us;
+		}
+		return count;
+	}
+
+private:
+	std::vector<uint64_t> _values;
+};
+
+/// The client writing a server key, in a BLE stack event.
+void writeServerKey() {
+	sim_stack::writeSlot(EID_SLOT, 1000, ECDH_DATA, sizeof(ECDH_DATA));
+}
+
+/// Offset and length of the EID in the slot data read from an EID slot.
+const size_t SLOT_DATA_EID_OFFSET = 6;
+const size_t SLOT_DATA_EID_LENGTH = 8;
+
+/**
+ * Write a server key to the EID slot and read the encrypted identity key
+ * and the slot data back at once, then once the events have run.
+ * @return true if both reads got the key derived by the exchange.
+ */
+bool checkKeyReadBack() {
+	BLE& ble = BLE::Instance();
+	ble.gap().simReset();
+	ble.gattServer().simReset();
+	GattServer& server = ble.gattServer();
+
+	queue_t queue;
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, queue);
+	service->startEddystoneConfigService();
+	std::vector<uint8_t> keyBefore, key, keyAfter, data, dataAfter;
+	bool ok = sim_stack::writeSlot(EID_SLOT, 1000, EID_DATA, sizeof(EID_DATA)) &&
+		server.simRead(UUID(UUID_EID_IDENTITY_KEY_CHAR), keyBefore) == AUTH_CALLBACK_REPLY_SUCCESS &&
+		sim_stack::writeSlot(EID_SLOT, 1000, ECDH_DATA, sizeof(ECDH_DATA)) &&
+		server.simRead(UUID(UUID_EID_IDENTITY_KEY_CHAR), key) == AUTH_CALLBACK_REPLY_SUCCESS &&
+		server.simRead(UUID(UUID_ADV_SLOT_DATA_CHAR), data) == AUTH_CALLBACK_REPLY_SUCCESS;
+	if (ok) {
+		sim_stack::dispatchUntil(queue, sim_hal::us_now() + 1000 * 1000);
+		ok = server.simRead(UUID(UUID_EID_IDENTITY_KEY_CHAR), keyAfter) == AUTH_CALLBACK_REPLY_SUCCESS &&
+			server.simRead(UUID(UUID_ADV_SLOT_DATA_CHAR), dataAfter) == AUTH_CALLBACK_REPLY_SUCCESS;
+	}
+	ok = ok && key != keyBefore && key == keyAfter &&
+		data.size() == SLOT_DATA_EID_OFFSET + SLOT_DATA_EID_LENGTH && data[0] == sim_stack::SLOT_DATA_EID &&
+		dataAfter.size() == data.size() &&
+		std::equal(data.begin() + SLOT_DATA_EID_OFFSET, data.end(), dataAfter.begin() + SLOT_DATA_EID_OFFSET);
+	delete service;
+	return ok;
+}
+
+void run(bool classes, bool ecdh, unsigned minutes) {
+	BLE& ble = BLE::Instance();
+	ble.gap().simReset();
+	ble.gattServer().simReset();
+
+	queue_t queue;
+	probe_t probe(queue);
+	probe.set_single_class(!classes);
+	sim_stack::StackLoad load(probe, STACK_EVENT_MEAN_US, STACK_EVENT_COST_US);
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, probe);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeSlot(0, 700, sim_stack::UID_SLOT_DATA, sizeof(sim_stack::UID_SLOT_DATA)) ||
+		!sim_stack::writeSlot(EID_SLOT, 1000, EID_DATA, sizeof(EID_DATA)) ||
+		!sim_stack::writeSlot(2, 1500, sim_stack::TLM_SLOT_DATA, sizeof(sim_stack::TLM_SLOT_DATA))) {
+		printf("slot configuration refused\n");
+		exit(1);
+	}
+
+	Latencies swaps;
+	Latencies stack_events;
+	probe.on_record([&](const probe_t::Record& record) {
+		uint64_t lateness = (record.us_start > record.us_deadline) ? record.us_start - record.us_deadline : 0;
+		if (record.priority == probe_t::priority_t::RADIO) {
+			swaps.add(lateness);
+		} else if (record.priority == probe_t::priority_t::BLE_STACK) {
+			stack_events.add(lateness);
+		}
+	});
+
+	uint64_t start = sim_hal::us_now();
+	uint64_t ecp_muls = sim_stack::counters().ecpMuls;
+	probe.reset_class_stats();
+	service->startEddystoneBeaconAdvertisements();
+	load.start();
+	if (ecdh) {
+		probe.post_every(&writeServerKey, KEY_WRITE_PERIOD);
+	}
+	sim_stack::dispatchUntil(queue, start + (uint64_t) minutes * 60 * 1000 * 1000);
+
+	const probe_t::ClassStats& housekeeping = probe.get_class_stats(probe_t::priority_t::HOUSEKEEPING);
+	printf("%-8s %-5s %7u %8llu %8llu %8llu %8llu %7u %8llu %8llu %6llu %8llu\n",
+		classes ? "posted" : "single", ecdh ? "10 s" : "none", (unsigned) swaps.count(),
+		(unsigned long long) swaps.percentile(0.5),
+		(unsigned long long) swaps.percentile(0.99),
+		(unsigned long long) swaps.percentile(0.999),
+		(unsigned long long) swaps.percentile(1),
+		(unsigned) swaps.above(1000),
+		(unsigned long long) stack_events.percentile(0.99),
+		(unsigned long long) housekeeping.max_run_us,
+		(unsigned long long) (sim_stack::counters().ecpMuls - ecp_muls),
+		(unsigned long long) load.dropped());
+
+	load.stop();
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned minutes = (argc > 1) ? atoi(argv[1]) : 60;
+
+	if (!checkKeyReadBack()) {
+		printf("FAIL: a read right after a server key write did not get the derived key\n");
+		return 1;
+	}
+	printf("read back after a server key write: derived key\n");
+	printf("%u simulated minutes, lateness in us\n", minutes);
+	printf("%-8s %-5s %7s %8s %8s %8s %8s %7s %8s %8s %6s %8s\n",
+		"classes", "ecdh", "swaps", "p50", "p99", "p99.9", "max", ">1 ms", "ble p99", "hk max", "ecdh", "dropped");
+	run(true, false, minutes);
+	run(false, false, minutes);
+	run(true, true, minutes);
+	run(false, true, minutes);
+	return 0;
+}
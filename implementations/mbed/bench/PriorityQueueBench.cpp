@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host microbenchmark of eq::PriorityQueue against the sorted singly linked
+ * list it replaced. Both hold N events of the size of an EventQueueClassic
+ * event; the queue is kept at N events while it is measured:
+ *
+ *   push    push B events (N - B -> N)
+ *   cancel  erase B random events through their handle (N -> N - B)
+ *   update  move a random event to a later deadline, as reschedule_event
+ *           does for periodic events
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Isource/EventQueue bench/PriorityQueueBench.cpp -o priority_queue_bench
+ *
+ * Usage: priority_queue_bench [rounds]
+ */
+
+#include "PriorityQueue.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+/// stand in for EventQueueClassic::Event: a 32 byte Thunk and two times
+struct Event {
+	Event() : deadline(0) { }
+
+	explicit Event(uint32_t deadline) : deadline(deadline) { }
+
+	friend bool operator<(const Event& lhs, const Event& rhs) {
+		return lhs.deadline < rhs.deadline;
+	}
+
+	uint32_t deadline;
+	uint32_t period;
+	char thunk[32];
+};
+
+/// The previous eq::PriorityQueue: a sorted singly linked list, new and
+/// updated elements go after the elements which compare equal.
+template<typename T, std::size_t Capacity>
+class SortedListQueue {
+public:
+	struct Node {
+		T element;
+		Node* next;
+	};
+
+	SortedListQueue() : free_nodes(nodes), head(NULL) {
+		for (std::size_t i = 0; i < Capacity; ++i) {
+			nodes[i].next = (i + 1 < Capacity) ? &nodes[i + 1] : NULL;
+		}
+	}
+
+	Node* push(const T& element) {
+		Node* n = free_nodes;
+		free_nodes = n->next;
+		n->element = element;
+		insert(n);
+		return n;
+	}
+
+	bool erase(Node* n) {
+		for (Node** link = &head; *link; link = &(*link)->next) {
+			if (*link == n) {
+				*link = n->next;
+				n->next = free_nodes;
+				free_nodes = n;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void update(Node* n) {
+		for (Node** link = &head; *link; link = &(*link)->next) {
+			if (*link == n) {
+				*link = n->next;
+				break;
+			}
+		}
+		insert(n);
+	}
+
+	T& get(Node* n) { return n->element; }
+
+private:
+	void insert(Node* n) {
+		Node** link = &head;
+		while (*link && !(n->element < (*link)->element)) {
+			link = &(*link)->next;
+		}
+		n->next = *link;
+		*link = n;
+	}
+
+	Node nodes[Capacity];
+	Node* free_nodes;
+	Node* head;
+};
+
+/// Adapts eq::PriorityQueue to the interface of SortedListQueue.
+template<typename T, std::size_t Capacity>
+class HeapQueue {
+	typedef eq::PriorityQueue<T, Capacity> queue_t;
+
+public:
+	typedef typename queue_t::Node Node;
+
+	Node* push(const T& element) { return queue.push(element).get_node(); }
+
+	bool erase(Node* n) { return queue.erase(n); }
+
+	void update(Node* n) { queue.update(n); }
+
+	T& get(Node* n) { return n->storage.get(); }
+
+private:
+	queue_t queue;
+};
+
+/** xorshift64* generator so that runs are reproducible */
+struct Random {
+	uint64_t state;
+	explicit Random(uint64_t seed) : state(seed) { }
+	uint32_t next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (uint32_t)((state * 2685821657736338717ULL) >> 32);
+	}
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+double nanoseconds(bench_clock::duration d) {
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+struct Result {
+	double push_ns;
+	double cancel_ns;
+	double update_ns;
+};
+
+/// Random deadlines within 10 s, in ms, like the slots and housekeeping
+/// timers of a beacon.
+const uint32_t HORIZON_MS = 10000;
+
+template<typename Queue, std::size_t N>
+Result measure(std::size_t rounds) {
+	static Queue queue;
+	typedef typename Queue::Node Node;
+	const std::size_t batch = (N / 2) ? N / 2 : 1;
+	std::vector<Node*> handles;
+	Random rnd(N);
+	Result result = Result();
+	bench_clock::duration push_time(0), cancel_time(0), update_time(0);
+
+	for (std::size_t i = 0; i < N - batch; ++i) {
+		handles.push_back(queue.push(Event(rnd.next() % HORIZON_MS)));
+	}
+
+	std::vector<Event> to_push;
+	std::vector<std::size_t> to_cancel;
+	for (std::size_t round = 0; round < rounds; ++round) {
+		to_push.clear();
+		for (std::size_t i = 0; i < batch; ++i) {
+			to_push.push_back(Event(rnd.next() % HORIZON_MS));
+		}
+		bench_clock::time_point start = bench_clock::now();
+		for (std::size_t i = 0; i < batch; ++i) {
+			handles.push_back(queue.push(to_push[i]));
+		}
+		push_time += bench_clock::now() - start;
+
+		// update is measured at N events, one event at a time, through the
+		// stored handles
+		Node* target = handles[rnd.next() % N];
+		uint32_t deadline = queue.get(target).deadline + 1 + rnd.next() % HORIZON_MS;
+		start = bench_clock::now();
+		queue.get(target).deadline = deadline;
+		queue.update(target);
+		update_time += bench_clock::now() - start;
+
+		// swap the events to cancel to the end of the handles
+		to_cancel.clear();
+		for (std::size_t i = 0; i < batch; ++i) {
+			std::size_t j = rnd.next() % (N - i);
+			std::swap(handles[j], handles[N - 1 - i]);
+		}
+		start = bench_clock::now();
+		for (std::size_t i = 0; i < batch; ++i) {
+			queue.erase(handles[N - 1 - i]);
+		}
+		cancel_time += bench_clock::now() - start;
+		handles.resize(N - batch);
+	}
+
+	// remove the cost of reading the clock
+	bench_clock::duration overhead(0);
+	for (std::size_t round = 0; round < rounds; ++round) {
+		bench_clock::time_point start = bench_clock::now();
+		overhead += bench_clock::now() - start;
+	}
+
+	result.push_ns = (nanoseconds(push_time) - nanoseconds(overhead)) / (rounds * batch);
+	result.cancel_ns = (nanoseconds(cancel_time) - nanoseconds(overhead)) / (rounds * batch);
+	result.update_ns = (nanoseconds(update_time) - nanoseconds(overhead)) / rounds;
+	for (std::size_t i = 0; i < handles.size(); ++i) {
+		queue.erase(handles[i]);
+	}
+	return result;
+}
+
+template<std::size_t N>
+void compare(std::size_t rounds) {
+	Result list = measure<SortedListQueue<Event, N>, N>(rounds);
+	Result heap = measure<HeapQueue<Event, N>, N>(rounds);
+	printf("%6zu  %-12s %8.1f %9.1f %9.1f\n", N, "sorted list", list.push_ns, list.cancel_ns, list.update_ns);
+	printf("%6zu  %-12s %8.1f %9.1f %9.1f\n", N, "heap", heap.push_ns, heap.cancel_ns, heap.update_ns);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	std::size_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 0) : 200000;
+
+	printf("events  queue         push ns cancel ns update ns\n");
+	compare<8>(rounds);
+	compare<32>(rounds);
+	compare<256>(rounds);
+	return 0;
+}
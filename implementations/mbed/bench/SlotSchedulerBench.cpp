@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Slot scheduling of EddystoneService, earliest deadline first from
+ * manageRadio, on eq::EventQueueClassic and the simulated stack of
+ * bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, a
+ * URL and a TLM slot and advertised by LegacyAdvertisingBackend, restarting
+ * advertising for every frame: manageRadio advertises the due slot with the
+ * earliest deadline (the lowest slot on ties) for 100 ms, or stops until
+ * the earliest deadline, without tolerance. The simulated controller sends
+ * the first advertising event of a frame 0 to 10 ms after advertising
+ * starts.
+ *
+ * Timers is the largest number of events of the beacon pending at once.
+ * The deviation of a slot is the difference between the time between two of
+ * its frames and its interval.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/SlotSchedulerBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o slot_scheduler_bench
+ *
+ * Usage: slot_scheduler_bench [minutes]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "EventQueueProbe.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+typedef eq::EventQueueClassic<16> queue_t;
+typedef sim_stack::EventQueueProbe<16> probe_t;
+
+const int SLOT_COUNT = 3;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+void run(const char* name, const uint16_t* intervals, unsigned minutes) {
+	BLE& ble = BLE::Instance();
+	ble.gap().simReset();
+	ble.gattServer().simReset();
+
+	queue_t queue;
+	probe_t probe(queue);
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, probe);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeUidUrlTlmSlots(intervals)) {
+		printf("slot configuration refused\n");
+		exit(1);
+	}
+
+	sim_stack::IntervalDeviation deviations[SLOT_COUNT];
+	uint64_t frames = 0;
+	ble.gap().simOnAdvertisingEvent([&](const sim_ble::AdvertisingEvent& event) {
+		int slot = sim_stack::uidUrlTlmSlot(event);
+		if (slot >= 0) {
+			++frames;
+			deviations[slot].add(event.us_time, intervals[slot]);
+		}
+	});
+
+	uint64_t start = sim_hal::us_now();
+	uint32_t wakeups = queue.get_wakeup_count();
+	service->startEddystoneBeaconAdvertisements();
+	sim_stack::dispatchUntil(queue, start + (uint64_t) minutes * 60 * 1000 * 1000);
+
+	double seconds = minutes * 60.0;
+	for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+		if (slot == 0) {
+			printf("%-14s %6u %9.2f %8.2f", name, (unsigned) probe.get_max_pending(),
+				(queue.get_wakeup_count() - wakeups) / seconds, frames / seconds);
+		} else {
+			printf("%-14s %6s %9s %8s", "", "", "", "");
+		}
+		printf(" %4d %6u %8.1f %8.1f\n", slot, (unsigned) intervals[slot],
+			deviations[slot].mean_ms(), deviations[slot].max_ms());
+	}
+
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned minutes = (argc > 1) ? atoi(argv[1]) : 60;
+	const uint16_t spread[SLOT_COUNT] = { 700, 1000, 1500 };
+	const uint16_t coincident[SLOT_COUNT] = { 1000, 1000, 1000 };
+	const uint16_t busy[SLOT_COUNT] = { 100, 200, 300 };
+
+	printf("%u simulated minutes, deviations in ms\n", minutes);
+	printf("%-14s %6s %9s %8s %4s %6s %8s %8s\n",
+		"slots ms", "timers", "wakeups/s", "frames/s", "slot", "ms", "mean dev", "max dev");
+	run("700/1000/1500", spread, minutes);
+	run("1000/1000/1000", coincident, minutes);
+	run("100/200/300", busy, minutes);
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * CPU wakeups of eq::EventQueueClassic per minute on a 3-slot
+ * EddystoneService, with the tolerance of its events scaled, on the
+ * simulated stack of bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, a
+ * URL and a TLM slot, at 700, 1000 and 1500 ms, and advertised by
+ * LegacyAdvertisingBackend: manageRadio advertises the due slot with the
+ * earliest deadline for 100 ms (a RADIO event without tolerance), or stops
+ * and waits for the earliest deadline with the slot tolerance. The beacon
+ * sends its slots on time by default; this bench is built with
+ * EDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER=8, a tolerance of an
+ * eighth of the slot interval, which EventQueueProbe scales by 0, 1, 2 and
+ * 4; every interrupt of the queue timer is a wakeup.
+ *
+ * Late is the largest time from the deadline of a RADIO event to its start.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -DEDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER=8 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/SlotWakeupBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o slot_wakeup_bench
+ *
+ * Usage: slot_wakeup_bench [minutes]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueClassic.h"
+#include "EventQueueProbe.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if EDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER != 8
+#error "build with -DEDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER=8"
+#endif
+
+namespace {
+
+typedef eq::EventQueueClassic<16> queue_t;
+typedef sim_stack::EventQueueProbe<16> probe_t;
+
+const int SLOT_COUNT = 3;
+const uint16_t SLOT_INTERVALS[SLOT_COUNT] = { 700, 1000, 1500 };
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+void run(const char* name, unsigned num, unsigned den, unsigned minutes) {
+	BLE& ble = BLE::Instance();
+	ble.gap().simReset();
+	ble.gattServer().simReset();
+
+	queue_t queue;
+	probe_t probe(queue);
+	probe.set_tolerance_scale(num, den);
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, probe);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeUidUrlTlmSlots(SLOT_INTERVALS)) {
+		printf("slot configuration refused\n");
+		exit(1);
+	}
+
+	uint64_t frames = 0;
+	ble.gap().simOnAdvertisingEvent([&](const sim_ble::AdvertisingEvent& event) {
+		if (sim_stack::uidUrlTlmSlot(event) >= 0) {
+			++frames;
+		}
+	});
+
+	uint64_t start = sim_hal::us_now();
+	uint32_t wakeups = queue.get_wakeup_count();
+	probe.reset_class_stats();
+	service->startEddystoneBeaconAdvertisements();
+	sim_stack::dispatchUntil(queue, start + (uint64_t) minutes * 60 * 1000 * 1000);
+
+	printf("%-12s %10.1f %10.1f %10.1f\n",
+		name,
+		(double) (queue.get_wakeup_count() - wakeups) / minutes,
+		(double) frames / minutes,
+		probe.get_class_stats(probe_t::priority_t::RADIO).max_lateness_us / 1000.0
+	);
+
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned minutes = (argc > 1) ? atoi(argv[1]) : 60;
+
+	printf("slots: %u, %u, %u ms; %u minutes\n",
+		(unsigned) SLOT_INTERVALS[0], (unsigned) SLOT_INTERVALS[1], (unsigned) SLOT_INTERVALS[2], minutes);
+	printf("%-12s %10s %10s %10s\n", "tolerance", "wakeups/m", "frames/m", "late ms");
+	run("0", 0, 1, minutes);
+	run("interval/8", 1, 1, minutes);
+	run("interval/4", 2, 1, minutes);
+	run("interval/2", 4, 1, minutes);
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Copies of the callable of an event made by eq::EventQueueClassic, from its
+ * post to the end of its dispatch, on the simulated HAL of bench/hal.
+ *
+ * Events bind a member function to an argument which counts its copies
+ * (constructions and assignments). The copies made by make_thunk and the
+ * conversion to a Thunk, before the queue is given the event, are measured
+ * apart and not counted. Periodic events are counted per run.
+ *
+ * The time per event is for batches of 8 events posted, then dispatched,
+ * on the host; for periodic events, the dispatch of a batch of 8 due ones.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Ibench/hal -Isource/EventQueue bench/ThunkCopyBench.cpp -o thunk_copy_bench
+ *
+ * Usage: thunk_copy_bench
+ */
+
+#include "EventQueueClassic.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+namespace {
+
+typedef eq::EventQueueClassic<16> queue_t;
+typedef std::chrono::steady_clock clock_type;
+
+const unsigned BATCH = 8;
+const unsigned ROUNDS = 100000;
+
+/// Argument counting its copies.
+struct Counted {
+	Counted() {
+	}
+
+	Counted(const Counted&) {
+		++copies();
+	}
+
+	Counted& operator=(const Counted&) {
+		++copies();
+		return *this;
+	}
+
+	static uint64_t& copies() {
+		static uint64_t count = 0;
+		return count;
+	}
+};
+
+struct Target {
+	Target() : calls(0) {
+	}
+
+	void run(const Counted&) {
+		++calls;
+	}
+
+	uint64_t calls;
+};
+
+/// Copies made before the queue is given an event.
+uint64_t thunk_copies(Target& target, const Counted& counted) {
+	uint64_t before = Counted::copies();
+	eq::Thunk thunk = eq::make_thunk(&Target::run, &target, counted);
+	(void) thunk;
+	return Counted::copies() - before;
+}
+
+double ns_per_event(clock_type::duration elapsed, uint64_t events) {
+	return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / events;
+}
+
+void print(const char* name, uint64_t copies, uint64_t events, clock_type::duration elapsed) {
+	printf("%-18s %8.2f %8.1f\n", name, (double) copies / events, ns_per_event(elapsed, events));
+}
+
+/// One-shot events, posted from the thread or from an interrupt handler.
+void one_shot(bool from_interrupt) {
+	queue_t queue;
+	Target target;
+	Counted counted;
+	uint64_t outside = thunk_copies(target, counted);
+	uint64_t copies = 0;
+	clock_type::duration elapsed(0);
+
+	for (unsigned round = 0; round < ROUNDS; ++round) {
+		uint64_t before = Counted::copies();
+		clock_type::time_point start = clock_type::now();
+		for (unsigned i = 0; i < BATCH; ++i) {
+			if (from_interrupt) {
+				sim_hal::InterruptContext isr;
+				queue.post(&Target::run, &target, counted);
+			} else {
+				queue.post(&Target::run, &target, counted);
+			}
+		}
+		queue.dispatch();
+		elapsed += clock_type::now() - start;
+		copies += Counted::copies() - before - BATCH * outside;
+	}
+
+	print(from_interrupt ? "interrupt post" : "thread post", copies, target.calls, elapsed);
+}
+
+/// Periodic events, per run.
+void periodic() {
+	queue_t queue;
+	Target target;
+	Counted counted;
+	for (unsigned i = 0; i < BATCH; ++i) {
+		queue.post_every(&Target::run, &target, counted, 1);
+	}
+	uint64_t copies = 0;
+	clock_type::duration elapsed(0);
+
+	for (unsigned round = 0; round < ROUNDS; ++round) {
+		sim_hal::us_now() += 1000;
+		uint64_t before = Counted::copies();
+		clock_type::time_point start = clock_type::now();
+		queue.dispatch();
+		elapsed += clock_type::now() - start;
+		copies += Counted::copies() - before;
+	}
+
+	print("periodic run", copies, target.calls, elapsed);
+}
+
+} // namespace
+
+int main() {
+	printf("%-18s %8s %8s\n", "event", "copies", "ns");
+	one_shot(false);
+	one_shot(true);
+	periodic();
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Ticker path of eq::EventQueueClassic, on the simulated HAL of bench/hal.
+ *
+ * Two periodic events, every 100 and 250 ms, run for 100 s, once from
+ * timestamp 0 and once from 30 s before the 32-bit timestamp of the ticker
+ * wraps. Every occurrence must run at its deadline, counted from the post
+ * (late us is the worst delay, within a millisecond), and both runs must
+ * make the same calls to the ticker; otherwise the bench fails.
+ *
+ * Built with TICKER_BENCH_MS_CLOCK, the bench runs the EventQueueClassic of
+ * bench/baseline/ms_clock, the queue as it was before it used the HAL ticker
+ * (55088f1): a millisecond clock extending mbed::Timer, and an mbed::Ticker
+ * armed with a float delay.
+ *
+ * Per reschedule (a periodic event run), reads counts the reads of the clock
+ * (ticker_read, or Timer::read_us) and arms the arming of the timer
+ * (TimerEvent::insert, or Ticker::attach). The run time library calls they
+ * make on a Cortex-M0 are counted from the code: each Ticker::attach calls
+ * __aeabi_ui2f and __aeabi_fdiv for (float) ms_delay / 1000 in the queue,
+ * and __aeabi_fmul and __aeabi_f2uiz for t * 1000000.0f in mbed::Ticker;
+ * each read of the millisecond clock calls __aeabi_uldivmod to divide the
+ * 64-bit microsecond count by 1000. The ticker path makes none of them.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Ibench/hal -Isource/EventQueue bench/TickerBench.cpp -o ticker_bench
+ *   g++ -O2 -std=c++11 -DTICKER_BENCH_MS_CLOCK -Ibench/hal -Ibench/baseline/ms_clock -Ibench/baseline -Ibench/baseline/EventQueue bench/TickerBench.cpp -o ticker_bench_ms_clock
+ *
+ * Usage: ticker_bench
+ */
+
+#include "EventQueueClassic.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+typedef eq::EventQueueClassic<8> queue_t;
+
+const uint64_t RUN_US = 100ULL * 1000 * 1000;
+const uint64_t WRAP_START_US = (1ULL << 32) - 30ULL * 1000 * 1000;
+const uint64_t MAX_LATE_US = 1000;
+
+#ifdef TICKER_BENCH_MS_CLOCK
+const char* const CLOCK_NAME = "ms";
+const unsigned SOFT_FLOAT_PER_ARM = 4;          /// __aeabi_ui2f, __aeabi_fdiv, __aeabi_fmul, __aeabi_f2uiz
+const unsigned ULDIVMOD_PER_READ = 1;           /// _clock_us / 1000
+#else
+const char* const CLOCK_NAME = "us";
+const unsigned SOFT_FLOAT_PER_ARM = 0;
+const unsigned ULDIVMOD_PER_READ = 0;
+#endif
+
+/// A periodic event, checking that it runs at its deadlines.
+struct Periodic {
+	Periodic(eq::EventQueue::ms_time_t period) :
+		ms_period(period), us_start(0), runs(0), max_late_us(0), early(false) {
+	}
+
+	void post(queue_t& queue) {
+		us_start = sim_hal::us_now();
+		queue.post_every(&Periodic::run, this, ms_period);
+	}
+
+	void run() {
+		++runs;
+		uint64_t deadline = us_start + (uint64_t) runs * ms_period * 1000;
+		uint64_t now = sim_hal::us_now();
+		if (now < deadline) {
+			early = true;
+		} else if (now - deadline > max_late_us) {
+			max_late_us = now - deadline;
+		}
+	}
+
+	/// @return true if it ran every period of run_us, on time.
+	bool on_time(uint64_t run_us) const {
+		return !early && max_late_us <= MAX_LATE_US && runs == run_us / (ms_period * 1000);
+	}
+
+	eq::EventQueue::ms_time_t ms_period;
+	uint64_t us_start;
+	uint32_t runs;
+	uint64_t max_late_us;
+	bool early;
+};
+
+struct Result {
+	uint32_t reschedules;
+	uint64_t max_late_us;
+	uint64_t reads;
+	uint64_t arms;
+	bool on_time;
+};
+
+Result run(uint64_t start_us) {
+	sim_hal::us_now() = start_us;
+	queue_t queue;
+	Periodic fast(100);
+	Periodic slow(250);
+	sim_hal::ticker_calls() = sim_hal::TickerCalls();
+	fast.post(queue);
+	slow.post(queue);
+
+	uint64_t end = start_us + RUN_US;
+	queue.dispatch();
+	while (sim_hal::run_until(end)) {
+		queue.dispatch();
+	}
+
+	const sim_hal::TickerCalls& calls = sim_hal::ticker_calls();
+	Result result;
+	result.reschedules = fast.runs + slow.runs;
+	result.max_late_us = fast.max_late_us > slow.max_late_us ? fast.max_late_us : slow.max_late_us;
+#ifdef TICKER_BENCH_MS_CLOCK
+	result.reads = calls.timer_reads;
+	result.arms = calls.attaches;
+#else
+	result.reads = calls.reads;
+	result.arms = calls.inserts;
+#endif
+	result.on_time = fast.on_time(RUN_US) && slow.on_time(RUN_US);
+	return result;
+}
+
+void print(const char* start, const Result& result) {
+	double reads = (double) result.reads / result.reschedules;
+	double arms = (double) result.arms / result.reschedules;
+	printf("%-5s %-11s %6u %8llu %8.2f %8.2f %10.2f %9.2f\n",
+		CLOCK_NAME, start, result.reschedules, (unsigned long long) result.max_late_us,
+		reads, arms, arms * SOFT_FLOAT_PER_ARM, reads * ULDIVMOD_PER_READ);
+}
+
+} // namespace
+
+int main() {
+	Result zero = run(0);
+	Result wrap = run(WRAP_START_US);
+
+	printf("%-5s %-11s %6s %8s %8s %8s %10s %9s\n",
+		"clock", "start", "runs", "late us", "reads", "arms", "soft-float", "uldivmod");
+	print("0", zero);
+	print("2^32 - 30 s", wrap);
+
+	bool ok = true;
+	if (!zero.on_time || !wrap.on_time) {
+		printf("FAILED: a periodic event did not run at its deadlines\n");
+		ok = false;
+	}
+	if (zero.reschedules != wrap.reschedules || zero.reads != wrap.reads || zero.arms != wrap.arms) {
+		printf("FAILED: the ticker is not used the same way across the wrap\n");
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
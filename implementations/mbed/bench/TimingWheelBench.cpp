@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * eq::EventQueueTimingWheel against a heap queue scheduled like
+ * EventQueueClassic (eq::PriorityQueue of absolute deadlines), from 10 to 1M
+ * timers, on a virtual millisecond clock:
+ *
+ *   post    one-shot timers 0 to 10 s ahead, into an empty queue
+ *   cancel  the same timers, in random order
+ *   fire    periodic timers of 100 ms to 10 s, as the slots of simulated
+ *           beacons, dispatched every millisecond; total dispatch time per
+ *           event fired
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Isource/EventQueue bench/TimingWheelBench.cpp -o timing_wheel_bench
+ *
+ * Usage: timing_wheel_bench [maxTimers]
+ */
+
+#include "EventQueueTimingWheel.h"
+#include "PriorityQueue.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+/// virtual clock of the queues
+struct VirtualClock {
+	static uint64_t now;
+	static uint64_t ms_now() { return now; }
+};
+uint64_t VirtualClock::now = 0;
+
+/// Heap queue with the scheduling of EventQueueClassic, without the mbed
+/// Ticker.
+template<std::size_t EventCount>
+class HeapQueue: public eq::EventQueue {
+	struct Event {
+		Event(const function_t& f, uint64_t deadline, ms_time_t period) :
+			f(f), deadline(deadline), period(period) { }
+
+		friend bool operator<(const Event& lhs, const Event& rhs) {
+			return lhs.deadline < rhs.deadline;
+		}
+
+		function_t f;
+		uint64_t deadline;
+		ms_time_t period;
+	};
+
+	typedef eq::PriorityQueue<Event, EventCount> queue_t;
+
+public:
+	virtual bool cancel(event_handle_t handle) {
+		return _queue.erase(static_cast<typename queue_t::Node*>(handle));
+	}
+
+	void dispatch() {
+		uint64_t now = VirtualClock::ms_now();
+		while (!_queue.empty()) {
+			typename queue_t::iterator head = _queue.begin();
+			if (head->deadline > now) {
+				break;
+			}
+			function_t f(head->f);
+			if (head->period) {
+				head->deadline += head->period;
+				_queue.update(head);
+			} else {
+				_queue.pop();
+			}
+			f();
+		}
+	}
+
+private:
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) {
+		(void) ms_tolerance;
+		(void) priority;
+		if (_queue.full()) {
+			return NULL;
+		}
+		return _queue.push(Event(fn, VirtualClock::ms_now() + ms_delay, repeat ? ms_delay : 0)).get_node();
+	}
+
+	queue_t _queue;
+};
+
+/** xorshift64* generator so that runs are reproducible */
+struct Random {
+	uint64_t state;
+	explicit Random(uint64_t seed) : state(seed) { }
+	uint32_t next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (uint32_t)((state * 2685821657736338717ULL) >> 32);
+	}
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+double nanoseconds(bench_clock::duration d) {
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+uint64_t fired;
+
+void on_timer(uint32_t) {
+	++fired;
+}
+
+struct Result {
+	double post_ns;
+	double cancel_ns;
+	double fire_ns;
+	uint64_t events;
+	uint64_t duration_ms;
+};
+
+template<typename Queue>
+Result measure(std::size_t timers) {
+	Result result = Result();
+	// the clock of a queue never goes back
+	VirtualClock::now = 1000;
+	Queue* queue = new Queue;
+	Random rnd(timers);
+	std::vector<eq::EventQueue::event_handle_t> handles(timers);
+
+	// post then cancel one-shot timers
+	std::vector<uint32_t> delays(timers);
+	for (std::size_t i = 0; i < timers; ++i) {
+		delays[i] = rnd.next() % 10000;
+	}
+	bench_clock::time_point start = bench_clock::now();
+	for (std::size_t i = 0; i < timers; ++i) {
+		handles[i] = queue->post_in(&on_timer, (uint32_t) i, delays[i]);
+	}
+	result.post_ns = nanoseconds(bench_clock::now() - start) / timers;
+	for (std::size_t i = timers - 1; i > 0; --i) {
+		std::swap(handles[i], handles[rnd.next() % (i + 1)]);
+	}
+	start = bench_clock::now();
+	for (std::size_t i = 0; i < timers; ++i) {
+		queue->cancel(handles[i]);
+	}
+	result.cancel_ns = nanoseconds(bench_clock::now() - start) / timers;
+
+	// periodic timers with random phases, dispatched every ms for long
+	// enough to fire about 4M events (at least 10 s, at most 10 minutes)
+	uint64_t period_sum = 0;
+	std::vector<std::pair<uint32_t, uint32_t> > phases(timers);
+	for (std::size_t i = 0; i < timers; ++i) {
+		uint32_t period = 100 + rnd.next() % 9901;
+		phases[i] = std::make_pair(rnd.next() % period, period);
+		period_sum += period;
+	}
+	std::sort(phases.begin(), phases.end());
+	uint64_t start_ms = VirtualClock::now;
+	for (std::size_t i = 0; i < timers; ++i) {
+		VirtualClock::now = start_ms + phases[i].first;
+		queue->post_every(&on_timer, (uint32_t) i, phases[i].second);
+	}
+	VirtualClock::now = start_ms + 10000;
+	queue->dispatch();
+	result.duration_ms = (uint64_t) (4e6 * period_sum / timers / timers);
+	result.duration_ms = std::max<uint64_t>(10000, std::min<uint64_t>(600000, result.duration_ms));
+	fired = 0;
+	start = bench_clock::now();
+	for (uint64_t ms = 0; ms < result.duration_ms; ++ms) {
+		++VirtualClock::now;
+		queue->dispatch();
+	}
+	result.fire_ns = nanoseconds(bench_clock::now() - start) / (fired ? fired : 1);
+	result.events = fired;
+
+	delete queue;
+	return result;
+}
+
+template<std::size_t N>
+void compare(std::size_t max_timers) {
+	if (N > max_timers) {
+		return;
+	}
+	Result heap = measure<HeapQueue<N> >(N);
+	Result wheel = measure<eq::EventQueueTimingWheel<N, VirtualClock> >(N);
+	printf("%8zu  %-12s %8.1f %9.1f %8.1f %10llu %8llu\n", N, "heap", heap.post_ns, heap.cancel_ns,
+	       heap.fire_ns, (unsigned long long) heap.events, (unsigned long long) heap.duration_ms / 1000);
+	printf("%8zu  %-12s %8.1f %9.1f %8.1f %10llu %8llu\n", N, "timing wheel", wheel.post_ns, wheel.cancel_ns,
+	       wheel.fire_ns, (unsigned long long) wheel.events, (unsigned long long) wheel.duration_ms / 1000);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	std::size_t max_timers = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+
+	printf("  timers  queue         post ns cancel ns  fire ns     events  sim (s)\n");
+	compare<10>(max_timers);
+	compare<100>(max_timers);
+	compare<1000>(max_timers);
+	compare<10000>(max_timers);
+	compare<100000>(max_timers);
+	compare<1000000>(max_timers);
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A day of EddystoneService on eq::EventQueueVirtual and the simulated
+ * stack of bench/stack.
+ *
+ * The beacon is configured through its configuration service with a UID, an
+ * EID (2^10 s rotation) and an eTLM slot, at 700, 1000 and 1500 ms, and
+ * advertised by the legacy advertising backend. The costs of the stack are
+ * zeroed, so that callbacks take no time: the queue clock only moves with
+ * advance_to(), to the next event of the queue or of the simulated
+ * controller, whichever comes first.
+ *
+ * Every advertising event adds its time, its advertising set and its
+ * payload to a hash of the trace: two runs must give the same hash. Each run
+ * is a child process, since the beacon clock of the service and the
+ * simulated RNG are static.
+ *
+ * Build from implementations/mbed:
+ *   g++ -O2 -std=c++11 -Wall -Wno-format -Ibench/hal -Ibench/stack -Isource -Isource/EventQueue bench/VirtualTimeBench.cpp source/EddystoneService.cpp source/EIDFrame.cpp source/TLMFrame.cpp source/UIDFrame.cpp source/URLFrame.cpp source/aes_eax.cpp source/AesKeyCache.cpp source/AdvertisingBackend.cpp source/LegacyAdvertisingBackend.cpp source/MultiSetAdvertisingBackend.cpp bench/stack/SimStack.cpp -o virtual_time_bench
+ *
+ * Usage: virtual_time_bench [hours]
+ */
+
+#include "EddystoneService.h"
+#include "EventQueueVirtual.h"
+#include "SimBeacon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+typedef eq::EventQueueVirtual<16> queue_t;
+
+const uint8_t ROTATION_PERIOD_EXP = 10;
+
+const PowerLevels_t ADV_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t RADIO_TX_POWER_LEVELS = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+const uint8_t EID_DATA[] = {
+	sim_stack::SLOT_DATA_EID,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	ROTATION_PERIOD_EXP
+};
+
+/// FNV-1a of the advertising events.
+class Trace {
+public:
+	Trace() : events(0), hash(14695981039346656037ULL) {
+	}
+
+	void add(const sim_ble::AdvertisingEvent& event) {
+		++events;
+		mix(&event.us_time, sizeof(event.us_time));
+		mix(&event.handle, sizeof(event.handle));
+		mix(event.payload, event.payloadLen);
+	}
+
+	uint64_t events;
+	uint64_t hash;
+
+private:
+	void mix(const void* data, size_t len) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < len; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ULL;
+		}
+	}
+};
+
+void run(unsigned hours) {
+	sim_stack::costs() = sim_stack::Costs();
+	BLE& ble = BLE::Instance();
+	queue_t queue;
+
+	EddystoneService* service = new EddystoneService(ble, ADV_TX_POWER_LEVELS, RADIO_TX_POWER_LEVELS, queue);
+	service->startEddystoneConfigService();
+	if (!sim_stack::writeSlot(0, 700, sim_stack::UID_SLOT_DATA, sizeof(sim_stack::UID_SLOT_DATA)) ||
+		!sim_stack::writeSlot(1, 1000, EID_DATA, sizeof(EID_DATA)) ||
+		!sim_stack::writeSlot(2, 1500, sim_stack::TLM_SLOT_DATA, sizeof(sim_stack::TLM_SLOT_DATA))) {
+		printf("slot configuration refused\n");
+		exit(1);
+	}
+
+	Trace trace;
+	ble.gap().simOnAdvertisingEvent([&](const sim_ble::AdvertisingEvent& event) {
+		trace.add(event);
+	});
+
+	uint64_t us_end = sim_hal::us_now() + (uint64_t) hours * 60 * 60 * 1000 * 1000;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	service->startEddystoneBeaconAdvertisements();
+	queue.run_until_idle();
+	while (sim_hal::us_now() < us_end) {
+		// the controller interrupts may post to the queue
+		uint64_t ms_next;
+		uint64_t us_limit = us_end;
+		if (queue.next_deadline(ms_next)) {
+			us_limit = std::min(us_limit, ms_next * 1000);
+		}
+		sim_hal::run_until(us_limit);
+		queue.advance_to(sim_hal::us_now() / 1000);
+	}
+	double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%6u %10llu %10llu %10.1f %12.0f %016llx\n",
+		hours,
+		(unsigned long long) queue.get_dispatch_count(),
+		(unsigned long long) trace.events,
+		wall_ms,
+		queue.get_dispatch_count() / wall_ms * 1000,
+		(unsigned long long) trace.hash);
+
+	service->stopEddystoneBeaconAdvertisements();
+	delete service;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned hours = (argc > 1) ? atoi(argv[1]) : 24;
+
+	printf("%6s %10s %10s %10s %12s %16s\n", "hours", "events", "frames", "wall ms", "events/s", "trace hash");
+	for (int i = 0; i < 2; ++i) {
+		fflush(stdout);
+		pid_t child = fork();
+		if (child == 0) {
+			run(hours);
+			fflush(stdout);
+			_exit(0);
+		}
+		waitpid(child, NULL, 0);
+	}
+	return 0;
+}
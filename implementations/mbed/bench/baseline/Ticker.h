@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_BASELINE_TICKER_H_
+#define BENCH_BASELINE_TICKER_H_
+
+#include <stdint.h>
+#include <new>
+#include "cmsis.h"
+#include "TimerEvent.h"
+#include "us_ticker_api.h"
+
+namespace mbed {
+
+/**
+ * Host stand-in for mbed::Ticker, used by the baseline EventQueueClassic, on
+ * the simulated time of sim_hal::us_now(): calls a member function every
+ * interval, from sim_hal::run_until(). The callback is stored in place, as
+ * mbed's FunctionPointer does, so that attach() does not allocate.
+ */
+class Ticker : public TimerEvent {
+public:
+	Ticker() : TimerEvent(get_us_ticker_data()), _us_delay(0), _callback(NULL) {
+	}
+
+	template<typename T>
+	void attach(T* object, void (T::*member)(), float t) {
+		static_assert(sizeof(MemberCallback<T>) <= sizeof(_storage), "member callback too large");
+		++sim_hal::ticker_calls().attaches;
+		detach();
+		_callback = new (_storage) MemberCallback<T>(object, member);
+		_us_delay = (uint64_t) (t * 1000000.0f);
+		insert((timestamp_t) (sim_hal::us_now() + _us_delay));
+	}
+
+	void detach() {
+		remove();
+		_callback = NULL;
+	}
+
+protected:
+	virtual void handler() {
+		sim_hal::InterruptContext context;
+		insert((timestamp_t) (sim_hal::us_now() + _us_delay));
+		if (_callback) {
+			_callback->call();
+		}
+	}
+
+private:
+	struct Callback {
+		virtual void call() = 0;
+	};
+
+	template<typename T>
+	struct MemberCallback : Callback {
+		MemberCallback(T* object, void (T::*member)()) : _object(object), _member(member) {
+		}
+
+		virtual void call() {
+			(_object->*_member)();
+		}
+
+		T* _object;
+		void (T::*_member)();
+	};
+
+	struct Dummy {
+	};
+
+	uint64_t _us_delay;
+	Callback* _callback;
+	union {
+		void* _align;
+		char _storage[sizeof(MemberCallback<Dummy>)];
+	};
+};
+
+} // namespace mbed
+
+#endif /* BENCH_BASELINE_TICKER_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_BASELINE_TIMER_H_
+#define BENCH_BASELINE_TIMER_H_
+
+#include <stdint.h>
+#include "ticker_api.h"
+
+namespace mbed {
+
+/**
+ * Host stand-in for mbed::Timer, used by the baseline EventQueueClassic,
+ * counting the simulated time of sim_hal::us_now().
+ */
+class Timer {
+public:
+	Timer() : _running(false), _start(0), _elapsed(0) {
+	}
+
+	void start() {
+		if (!_running) {
+			_start = sim_hal::us_now();
+			_running = true;
+		}
+	}
+
+	void stop() {
+		_elapsed = read_us();
+		_running = false;
+	}
+
+	void reset() {
+		_start = sim_hal::us_now();
+		_elapsed = 0;
+	}
+
+	int read_us() {
+		++sim_hal::ticker_calls().timer_reads;
+		return (int) (_elapsed + (_running ? sim_hal::us_now() - _start : 0));
+	}
+
+	int read_ms() {
+		return read_us() / 1000;
+	}
+
+private:
+	bool _running;
+	uint64_t _start;
+	uint64_t _elapsed;
+};
+
+} // namespace mbed
+
+#endif /* BENCH_BASELINE_TIMER_H_ */
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BLE_API_SOURCE_MBEDCLASSICEVENTQUEUE_H_
+#define BLE_API_SOURCE_MBEDCLASSICEVENTQUEUE_H_
+
+#include <cmsis.h>
+#include "PriorityQueue.h"
+#include "Ticker.h"
+#include "Timer.h"
+#include <stdio.h>
+#include "Thunk.h"
+#include "MakeThunk.h"
+#include "EventQueue.h"
+
+#include <util/CriticalSectionLock.h>
+typedef ::mbed::util::CriticalSectionLock CriticalSection;
+
+namespace eq {
+
+/**
+ * Event queue for mbed classic, driven by a Ticker.
+ *
+ * Events are kept with their absolute deadline on a 64-bit millisecond clock
+ * that never goes back, so dispatching or canceling an event only looks at
+ * the head of the queue and never rewrites the other events. The Ticker is
+ * armed for the earliest deadline; its interrupt only wakes the CPU, and
+ * dispatch() runs the events which are due.
+ *
+ * A periodic event is rescheduled from its previous deadline, not from the
+ * time it was dispatched, so that its period does not drift by the dispatch
+ * latency.
+ */
+template<std::size_t EventCount>
+class EventQueueClassic: public EventQueue {
+
+	/// Time on the monotonic clock of the queue, in milliseconds.
+	typedef uint64_t ms_deadline_t;
+
+	/// Longest delay the Ticker is armed for. The clock of the queue extends
+	/// a 32-bit microsecond Timer, which has to be read at least every 71
+	/// minutes.
+	static const ms_time_t MAX_TICKER_DELAY_MS = 30 * 60 * 1000;
+
+	/// Describe an event.
+	/// An event is composed of a function f to execute at a deadline t.
+	/// Optionnaly, the event can be periodic and in this case the function f
+	/// is executed after each period p.
+	struct Event {
+		/// construct an event
+		/// @param f The function to execute when this event occur
+		/// @param ms_deadline time at which this event occurs
+		/// @param ms_repeat_period If the event is periodic, this parameter is the
+		/// period between to occurence of this event.
+		Event(const function_t& f, ms_deadline_t ms_deadline, ms_time_t ms_repeat_period = 0) :
+			_f(f),
+			_ms_deadline(ms_deadline),
+			_ms_repeat_period(ms_repeat_period) {
+		}
+
+		/// call the inner function within an event
+		void operator()() {
+			_f();
+		}
+
+		/// return a reference to the inner function
+		const function_t& get_function() const {
+			return _f;
+		}
+
+		/// comparison operator used by the priority queue.
+		/// compare the deadlines of two events
+		friend bool operator<(const Event& lhs, const Event& rhs) {
+			return lhs._ms_deadline < rhs._ms_deadline;
+		}
+
+		/// return the time at which this event occurs.
+		ms_deadline_t get_ms_deadline() const {
+			return _ms_deadline;
+		}
+
+		/// update the time at which this event occurs
+		void set_ms_deadline(ms_deadline_t new_deadline) {
+			_ms_deadline = new_deadline;
+		}
+
+		/// If an event is periodic, return the time between two occurence
+		ms_time_t get_ms_repeat_period() const {
+			return _ms_repeat_period;
+		}
+
+	private:
+		function_t _f;
+		ms_deadline_t _ms_deadline;
+		const ms_time_t _ms_repeat_period;
+	};
+
+	/// type of the internal queue
+	typedef PriorityQueue<Event, EventCount> priority_queue_t;
+
+	/// iterator for the queue type
+	typedef typename priority_queue_t::iterator q_iterator_t;
+
+	/// node type in the queue
+	typedef typename priority_queue_t::Node q_node_t;
+
+public:
+	/// Construct an empty event queue
+	EventQueueClassic() :
+		_events_queue(), _ticker(), _timer(), _clock_us(0), _last_timer_us(0), _ticker_deadline(0) {
+		_timer.start();
+	}
+
+	virtual ~EventQueueClassic() { }
+
+	virtual bool cancel(event_handle_t event_handle) {
+		// if the head is canceled, the ticker may fire for nothing; dispatch
+		// then rearms it for the new head
+		CriticalSection critical_section;
+		return _events_queue.erase(static_cast<q_node_t*>(event_handle));
+	}
+
+	void dispatch() {
+		while(true) {
+			function_t f;
+			// pick a task from the queue/ or leave
+			{
+				CriticalSection cs;
+				ms_deadline_t now = ms_now();
+				q_iterator_t event_it = _events_queue.begin();
+				if(event_it != _events_queue.end() && event_it->get_ms_deadline() <= now) {
+					f = event_it->get_function();
+					// if the event_it should be repeated, reschedule it
+					if (event_it->get_ms_repeat_period()) {
+						reschedule_event(event_it, now);
+					} else {
+						_events_queue.pop();
+					}
+				} else {
+					update_ticker(now);
+					break;
+				}
+			}
+			f();
+		}
+	}
+
+private:
+
+	/// Current time of the queue clock. Must be called with interrupts
+	/// disabled.
+	ms_deadline_t ms_now() {
+		uint32_t timer_us = _timer.read_us();
+		_clock_us += (uint32_t) (timer_us - _last_timer_us);
+		_last_timer_us = timer_us;
+		return _clock_us / 1000;
+	}
+
+	/// Arm the ticker for the head of the queue, unless it is already armed
+	/// for it. Must be called with interrupts disabled.
+	void update_ticker(ms_deadline_t now) {
+		q_iterator_t head = _events_queue.begin();
+		if (head == _events_queue.end()) {
+			return;
+		}
+
+		ms_deadline_t deadline = head->get_ms_deadline();
+		if (_ticker_deadline && _ticker_deadline <= deadline) {
+			return;
+		}
+
+		ms_time_t ms_delay = (deadline > now) ? deadline - now : 0;
+		if (ms_delay > MAX_TICKER_DELAY_MS) {
+			ms_delay = MAX_TICKER_DELAY_MS;
+		}
+		_ticker_deadline = now + ms_delay;
+		_ticker.detach();
+		_ticker.attach(this, &EventQueueClassic::on_ticker, ((float) ms_delay / 1000));
+	}
+
+	/// Ticker interrupt: waking up the CPU is enough, dispatch() runs the
+	/// events which are due and rearms the ticker.
+	void on_ticker() {
+		_ticker.detach();
+		_ticker_deadline = 0;
+	}
+
+	/// Move a periodic event to its next occurence after now, keeping it in
+	/// phase with its first deadline. Occurences missed while dispatch() was
+	/// not called are skipped rather than run back to back.
+	void reschedule_event(q_iterator_t& event_it, ms_deadline_t now) {
+		ms_time_t ms_period = event_it->get_ms_repeat_period();
+		ms_deadline_t deadline = event_it->get_ms_deadline() + ms_period;
+		if (deadline <= now) {
+			deadline += ((now - deadline) / ms_period + 1) * ms_period;
+		}
+		event_it->set_ms_deadline(deadline);
+		_events_queue.update(event_it);
+	}
+
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false) {
+		if(repeat && (ms_delay == 0)) {
+			return NULL;
+		}
+
+		CriticalSection critical_section;
+		if (_events_queue.full()) {
+			return NULL;
+		}
+
+		ms_deadline_t now = ms_now();
+		Event event(fn, now + ms_delay, repeat ? ms_delay : 0);
+		event_handle_t handle = _events_queue.push(event).get_node();
+
+		// there is no need to update timings if ms_delay == 0: the event is
+		// run by the next dispatch
+		if (ms_delay) {
+			update_ticker(now);
+		}
+
+		return handle;
+	}
+
+	priority_queue_t _events_queue;
+	mbed::Ticker _ticker;
+	mbed::Timer _timer;
+	uint64_t _clock_us;                 /// queue clock, in microseconds
+	uint32_t _last_timer_us;            /// _timer value when _clock_us was updated
+	ms_deadline_t _ticker_deadline;     /// time the ticker is armed for, 0 if not armed
+};
+
+} // namespace eq
+
+#endif /* BLE_API_SOURCE_MBEDCLASSICEVENTQUEUE_H_ */
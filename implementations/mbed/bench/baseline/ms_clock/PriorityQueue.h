@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef EVENTQUEUE_STACKPRIORITYQUEUE_H_
+#define EVENTQUEUE_STACKPRIORITYQUEUE_H_
+
+#include <cstddef>
+#include "AlignedStorage.h"
+
+namespace eq {
+
+/**
+ * Priority queue of Ts.
+ * Ts are ordered from the smaller to the bigger ( < ); elements which compare
+ * equal are ordered by insertion (or last update) time.
+ * Elements in the queue are mutable (this is a design choice).
+ * After a mutation the function update should be called to ensure that the
+ * queue is still properly sorted.
+ *
+ * The queue is a binary heap of pointers to nodes allocated from a fixed pool:
+ * push, pop, update and erase are O(log n) and never allocate. A node does not
+ * move while its element is in the queue, so pointers to nodes (handles) stay
+ * valid across reorders until the element is popped or erased.
+ *
+ * Iteration visits every element once, the head first, but the other elements
+ * are in heap order and not sorted.
+ * @tparam T type of elements in this queue
+ * @param capacity Number of elements that this queue can contain
+ */
+template<typename T, std::size_t Capacity>
+class PriorityQueue {
+
+public:
+	/**
+	 * Type of the nodes in this queue.
+	 */
+	struct Node {
+		AlignedStorage<T> storage;		/// storage for the T
+		Node* next;						/// pointer to the next free node
+		std::size_t position;			/// index of the node in the heap, Capacity if free
+		unsigned int sequence;			/// insertion order, breaks ties between equal elements
+	};
+
+	/**
+	 * Iterator for elements of the queue.
+	 */
+	class Iterator {
+		friend PriorityQueue;
+
+		/// Construct an iterator from a Node.
+		/// This constructor is private and can only be invoked from the PriorityQueue.
+		Iterator(const PriorityQueue* queue, Node* current) :
+			_queue(queue), _current(current) {
+		}
+
+	public:
+
+		/// Indirection operator.
+		/// return a reference to the inner T
+		T& operator*() {
+			return _current->storage.get();
+		}
+
+		/// Const version of indirection operator.
+		/// return a reference to the inner T
+		const T& operator*() const {
+			return _current->storage.get();
+		}
+
+		/// dereference operator.
+		/// Will invoke the operation on the inner T
+		T* operator->() {
+			return &(_current->storage.get());
+		}
+
+		/// const dereference operator.
+		/// Will invoke the operation on the inner T
+		const T* operator->() const {
+			return &(_current->storage.get());
+		}
+
+		/// pre incrementation to the next T in the heap
+		Iterator& operator++() {
+			_current = _queue->next_in_heap(_current);
+			return *this;
+		}
+
+		/// post incrementation to the next T in the heap
+		Iterator operator++(int) {
+			Iterator tmp(*this);
+			_current = _queue->next_in_heap(_current);
+			return tmp;
+		}
+
+		/// Equality operator
+		friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+			return lhs._current == rhs._current;
+		}
+
+		/// Unequality operator
+		friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+			return !(lhs == rhs);
+		}
+
+		/// return the internal node.
+		Node* get_node() {
+			return _current;
+		}
+
+	private:
+		const PriorityQueue* _queue;
+		Node* _current;
+	};
+
+	typedef Iterator iterator;
+
+	/// Construct an empty priority queue.
+	PriorityQueue() : nodes(), free_nodes(NULL), heap(), used_nodes_count(0), next_sequence(0) {
+		initialize();
+	}
+
+	/// Copy construct a priority queue.
+	/// The queue will have the same content has other.
+	PriorityQueue(const PriorityQueue& other) :
+		nodes(), free_nodes(NULL), heap(), used_nodes_count(0), next_sequence(0) {
+		initialize();
+		copy(other);
+	}
+
+	/// destroy a priority queue.
+	~PriorityQueue() {
+		clear();
+	}
+
+	/// Copy assignemnent from another priority queue.
+	/// The content of the queue will be destroyed then the content from
+	/// other will be copied.
+	PriorityQueue& operator=(const PriorityQueue& other) {
+		if (&other == this) {
+			return *this;
+		}
+		copy(other);
+		return *this;
+	}
+
+	/// Push a new element to the queue.
+	/// It will be placed after the elements p in the queue where
+	/// element < p == false.
+	/// @return An iterator to the inserted element.
+	iterator push(const T& element) {
+		if (full()) {
+			return end();
+		}
+
+		// get a free node
+		Node* new_node = free_nodes;
+		free_nodes = free_nodes->next;
+		new_node->next = NULL;
+
+		// copy content
+		new (new_node->storage.get_storage()) T(element);
+		new_node->sequence = next_sequence++;
+
+		// append it to the heap then restore the heap order
+		new_node->position = used_nodes_count;
+		heap[used_nodes_count] = new_node;
+		++used_nodes_count;
+		sift_up(new_node);
+
+		return iterator(this, new_node);
+	}
+
+	/// pop the head of the queue.
+	bool pop() {
+		if (empty()) {
+			return false;
+		}
+		return erase(heap[0]);
+	}
+
+	/// If the content of an element is updated is updated after the insertion
+	/// then, the heap can be in an unordered state.
+	/// This function help; it update the position of an iterator in the heap.
+	/// The element is placed after the elements which compare equal to it.
+	void update(iterator it) {
+		update(it.get_node());
+	}
+
+	/// update the position of a node in the heap
+	void update(Node* target) {
+		// the node in parameter doesn't belong to this queue
+		if (!contains(target)) {
+			return;
+		}
+
+		target->sequence = next_sequence++;
+		if (!sift_up(target)) {
+			sift_down(target);
+		}
+	}
+
+	/// return an iterator to the begining of the queue, the smallest element.
+	iterator begin() {
+		return iterator(this, empty() ? NULL : heap[0]);
+	}
+
+	/// return an iterator to the end of the queue.
+	/// @note can't be dereferenced
+	iterator end() {
+		return iterator(this, NULL);
+	}
+
+	/// erase an iterator from the queue
+	bool erase(iterator it) {
+		return erase(it.get_node());
+	}
+
+	/// erase a node from the queue
+	bool erase(Node* n) {
+		if (!contains(n)) {
+			return false;
+		}
+
+		// replace the node by the last one of the heap, then move that one
+		// to its place
+		std::size_t position = n->position;
+		--used_nodes_count;
+		if (position != used_nodes_count) {
+			Node* last = heap[used_nodes_count];
+			heap[position] = last;
+			last->position = position;
+			if (!sift_up(last)) {
+				sift_down(last);
+			}
+		}
+
+		release(n);
+		return true;
+	}
+
+	/**
+	 * Indicate if the queue is empty or not.
+	 * @return true if the queue is empty and false otherwise.
+	 * @invariant the queue remains untouched.
+	 */
+	bool empty() const {
+		return used_nodes_count == 0;
+	}
+
+	/**
+	 * Indicate if the true is full or not.
+	 * @return true if the queue is full and false otherwise.
+	 * @invariant the queue remains untouched.
+	 */
+	bool full() const {
+		return free_nodes == NULL;
+	}
+
+	/**
+	 * Indicate the number of elements in the queue.
+	 * @return the number of elements currently held by the queue.
+	 * @invariant the queue remains untouched.
+	 */
+	std::size_t size() const {
+		return used_nodes_count;
+	}
+
+	/**
+	 * Expose the capacity of the queue in terms of number of elements the
+	 * queue can hold.
+	 * @return the capacity of the queue.
+	 * @invariant this function should always return Capacity.
+	 */
+	std::size_t capacity() const {
+		return Capacity;
+	}
+
+	/**
+	 * Clear the queue from all its elements.
+	 */
+	void clear() {
+		while (used_nodes_count) {
+			--used_nodes_count;
+			release(heap[used_nodes_count]);
+		}
+	}
+
+private:
+	void initialize() {
+		/// link all the nodes together
+		for (std::size_t i = 0; i < Capacity; ++i) {
+			nodes[i].next = (i + 1 < Capacity) ? &nodes[i + 1] : NULL;
+			nodes[i].position = Capacity;
+		}
+		/// set all the nodes as free
+		free_nodes = nodes;
+	}
+
+	void copy(const PriorityQueue& other) {
+		if (empty() == false) {
+			clear();
+		}
+
+		// the heap order only depends on the elements and their sequence, so
+		// copying the heap position by position keeps it valid
+		for (std::size_t i = 0; i < other.used_nodes_count; ++i) {
+			Node* to_copy = other.heap[i];
+
+			// pick a free node
+			Node* new_node = free_nodes;
+			free_nodes = free_nodes->next;
+			new_node->next = NULL;
+
+			// copy content
+			new (new_node->storage.get_storage()) T(to_copy->storage.get());
+			new_node->sequence = to_copy->sequence;
+			new_node->position = i;
+			heap[i] = new_node;
+		}
+		used_nodes_count = other.used_nodes_count;
+		next_sequence = other.next_sequence;
+	}
+
+	/// true if n is a node of this queue currently holding an element
+	bool contains(const Node* n) const {
+		return n >= nodes && n < nodes + Capacity &&
+		       n->position < used_nodes_count && heap[n->position] == n;
+	}
+
+	/// destroy the element of a node taken out of the heap and free the node
+	void release(Node* n) {
+		n->storage.get().~T();
+		n->position = Capacity;
+		n->next = free_nodes;
+		free_nodes = n;
+	}
+
+	/// ordering of the heap: by element, then by sequence. Sequences are
+	/// compared modulo their range, which is valid as long as the oldest
+	/// element in the queue is less than half the range of pushes old.
+	static bool before(const Node* lhs, const Node* rhs) {
+		if (lhs->storage.get() < rhs->storage.get()) {
+			return true;
+		}
+		if (rhs->storage.get() < lhs->storage.get()) {
+			return false;
+		}
+		return (lhs->sequence - rhs->sequence) > (~0u >> 1);
+	}
+
+	/// move a node toward the root until its parent is before it.
+	/// @return true if the node moved.
+	bool sift_up(Node* n) {
+		std::size_t position = n->position;
+		while (position > 0) {
+			std::size_t parent = (position - 1) / 2;
+			if (!before(n, heap[parent])) {
+				break;
+			}
+			heap[position] = heap[parent];
+			heap[position]->position = position;
+			position = parent;
+		}
+		bool moved = position != n->position;
+		heap[position] = n;
+		n->position = position;
+		return moved;
+	}
+
+	/// move a node toward the leaves until it is before its children.
+	void sift_down(Node* n) {
+		std::size_t position = n->position;
+		while (true) {
+			std::size_t child = 2 * position + 1;
+			if (child >= used_nodes_count) {
+				break;
+			}
+			if (child + 1 < used_nodes_count && before(heap[child + 1], heap[child])) {
+				++child;
+			}
+			if (!before(heap[child], n)) {
+				break;
+			}
+			heap[position] = heap[child];
+			heap[position]->position = position;
+			position = child;
+		}
+		heap[position] = n;
+		n->position = position;
+	}
+
+	/// successor of a node in heap order, NULL after the last node.
+	Node* next_in_heap(const Node* n) const {
+		std::size_t position = n->position + 1;
+		return (position < used_nodes_count) ? heap[position] : NULL;
+	}
+
+	Node nodes[Capacity];         //< Nodes of the queue
+	Node *free_nodes;             //< entry point for the list of free nodes
+	Node *heap[Capacity];         //< used nodes, as a binary heap
+	std::size_t used_nodes_count; // number of nodes used
+	unsigned int next_sequence;   // sequence of the next element pushed or updated
+};
+
+} // namespace eq
+
+#endif /* EVENTQUEUE_STACKPRIORITYQUEUE_H_ */
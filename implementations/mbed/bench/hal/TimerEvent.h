@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_HAL_TIMEREVENT_H_
+#define BENCH_HAL_TIMEREVENT_H_
+
+#include <stddef.h>
+#include "ticker_api.h"
+
+namespace mbed {
+
+/**
+ * Host stand-in for mbed::TimerEvent, on the simulated time of
+ * sim_hal::us_now(). Armed events fire from sim_hal::run_until().
+ */
+class TimerEvent {
+public:
+	TimerEvent(const ticker_data_t* data) :
+		_ticker_data(data), _armed(false), _timestamp(0), _next(NULL) {
+		_next = instances();
+		instances() = this;
+	}
+
+	virtual ~TimerEvent() {
+		for (TimerEvent** it = &instances(); *it; it = &(*it)->_next) {
+			if (*it == this) {
+				*it = _next;
+				break;
+			}
+		}
+	}
+
+	/// Fire the earliest armed event due before limit, moving the simulated
+	/// time to it. Otherwise move the time to limit and return false.
+	static bool fire_next(uint64_t limit) {
+		uint64_t now = sim_hal::us_now();
+		TimerEvent* first = NULL;
+		uint64_t first_time = 0;
+		for (TimerEvent* it = instances(); it; it = it->_next) {
+			if (it->_armed == false) {
+				continue;
+			}
+			// timestamps are 32-bit: take the difference as signed, like the
+			// ticker does, and fire events in the past right away
+			int32_t delta = (int32_t) (it->_timestamp - (timestamp_t) now);
+			uint64_t time = (delta > 0) ? now + delta : now;
+			if (first == NULL || time < first_time) {
+				first = it;
+				first_time = time;
+			}
+		}
+
+		if (first == NULL || first_time > limit) {
+			if (now < limit) {
+				sim_hal::us_now() = limit;
+			}
+			return false;
+		}
+
+		sim_hal::us_now() = first_time;
+		first->_armed = false;
+		first->handler();
+		return true;
+	}
+
+protected:
+	virtual void handler() = 0;
+
+	void insert(timestamp_t timestamp) {
+		++sim_hal::ticker_calls().inserts;
+		_armed = true;
+		_timestamp = timestamp;
+	}
+
+	void remove() {
+		_armed = false;
+	}
+
+	const ticker_data_t* _ticker_data;
+
+private:
+	static TimerEvent*& instances() {
+		static TimerEvent* head = NULL;
+		return head;
+	}
+
+	bool _armed;
+	timestamp_t _timestamp;
+	TimerEvent* _next;
+};
+
+} // namespace mbed
+
+namespace sim_hal {
+
+/// Sleep until the next timer event and fire it, or until limit.
+inline bool run_until(uint64_t limit) {
+	return mbed::TimerEvent::fire_next(limit);
+}
+
+} // namespace sim_hal
+
+#endif /* BENCH_HAL_TIMEREVENT_H_ */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_HAL_CMSIS_H_
+#define BENCH_HAL_CMSIS_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+// Host stand-in for the core functions of CMSIS. Nothing interrupts the
+// host: the simulated ticker fires from sim_hal::run_until() and benches
+// call interrupt handlers themselves, inside a sim_hal::InterruptContext.
+// PRIMASK is simulated so that benches can time how long interrupts stay
+// masked.
+
+namespace sim_hal {
+
+/// Statistics of the sections run with interrupts masked.
+struct MaskedStats {
+	static const unsigned BUCKET_NS = 1;
+	static const unsigned BUCKETS = 10000;
+
+	uint64_t count;				/// number of masked sections
+	uint64_t total_ns;			/// time spent masked
+	uint64_t max_ns;			/// longest masked section
+	uint64_t histogram[BUCKETS];	/// sections per BUCKET_NS, the last one open
+
+	/// smallest duration longer than fraction of the sections, to BUCKET_NS
+	uint64_t percentile_ns(double fraction) const {
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < BUCKETS; ++i) {
+			seen += histogram[i];
+			if (seen >= fraction * count) {
+				return (i + 1) * BUCKET_NS;
+			}
+		}
+		return max_ns;
+	}
+};
+
+inline MaskedStats& masked_stats() {
+	static MaskedStats stats = MaskedStats();
+	return stats;
+}
+
+/// When set, the duration in ns of every masked section is appended to it.
+inline std::vector<uint32_t>*& masked_trace() {
+	static std::vector<uint32_t>* trace = NULL;
+	return trace;
+}
+
+inline uint32_t& primask() {
+	static uint32_t mask = 0;
+	return mask;
+}
+
+inline std::chrono::steady_clock::time_point& masked_since() {
+	static std::chrono::steady_clock::time_point since;
+	return since;
+}
+
+inline uint32_t& ipsr() {
+	static uint32_t exception = 0;
+	return exception;
+}
+
+/// Scope of a simulated interrupt handler: __get_IPSR() is non zero in it.
+class InterruptContext {
+public:
+	InterruptContext() : _previous(ipsr()) {
+		ipsr() = 16;
+	}
+
+	~InterruptContext() {
+		ipsr() = _previous;
+	}
+
+private:
+	uint32_t _previous;
+};
+
+} // namespace sim_hal
+
+static inline uint32_t __get_PRIMASK() {
+	return sim_hal::primask();
+}
+
+static inline void __disable_irq() {
+	if (sim_hal::primask() == 0) {
+		sim_hal::masked_since() = std::chrono::steady_clock::now();
+	}
+	sim_hal::primask() = 1;
+}
+
+static inline void __set_PRIMASK(uint32_t mask) {
+	if (sim_hal::primask() && mask == 0) {
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - sim_hal::masked_since()
+		).count();
+		sim_hal::MaskedStats& stats = sim_hal::masked_stats();
+		++stats.count;
+		stats.total_ns += ns;
+		if (ns > stats.max_ns) {
+			stats.max_ns = ns;
+		}
+		unsigned bucket = ns / sim_hal::MaskedStats::BUCKET_NS;
+		if (bucket >= sim_hal::MaskedStats::BUCKETS) {
+			bucket = sim_hal::MaskedStats::BUCKETS - 1;
+		}
+		++stats.histogram[bucket];
+		if (sim_hal::masked_trace()) {
+			sim_hal::masked_trace()->push_back((uint32_t) ns);
+		}
+	}
+	sim_hal::primask() = mask;
+}
+
+static inline uint32_t __get_IPSR() {
+	return sim_hal::ipsr();
+}
+
+static inline void __DMB() {
+	__sync_synchronize();
+}
+
+#endif /* BENCH_HAL_CMSIS_H_ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_HAL_TICKER_API_H_
+#define BENCH_HAL_TICKER_API_H_
+
+#include <stdint.h>
+
+typedef uint32_t timestamp_t;
+
+struct ticker_data_t {
+	int unused;
+};
+
+namespace sim_hal {
+
+/// Simulated time, in microseconds. Benches move it forward.
+inline uint64_t& us_now() {
+	static uint64_t us = 0;
+	return us;
+}
+
+/// Calls to the simulated ticker, and to the Ticker and Timer of
+/// bench/baseline.
+struct TickerCalls {
+	uint64_t reads;                 /// ticker_read
+	uint64_t inserts;               /// TimerEvent::insert
+	uint64_t timer_reads;           /// mbed::Timer::read_us of bench/baseline
+	uint64_t attaches;              /// mbed::Ticker::attach of bench/baseline
+};
+
+inline TickerCalls& ticker_calls() {
+	static TickerCalls calls = TickerCalls();
+	return calls;
+}
+
+} // namespace sim_hal
+
+inline timestamp_t ticker_read(const ticker_data_t*) {
+	++sim_hal::ticker_calls().reads;
+	return (timestamp_t) sim_hal::us_now();
+}
+
+#endif /* BENCH_HAL_TICKER_API_H_ */
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_HAL_US_TICKER_API_H_
+#define BENCH_HAL_US_TICKER_API_H_
+
+#include "ticker_api.h"
+
+inline const ticker_data_t* get_us_ticker_data() {
+	static ticker_data_t data;
+	return &data;
+}
+
+#endif /* BENCH_HAL_US_TICKER_API_H_ */
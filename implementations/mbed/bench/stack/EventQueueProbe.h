@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_EVENTQUEUEPROBE_H_
+#define BENCH_STACK_EVENTQUEUEPROBE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include "EventQueue.h"
+#include "TimerEvent.h"
+
+namespace sim_stack {
+
+/**
+ * Event queue which forwards every post to another queue, and measures the
+ * events when they run: their lateness from their deadline and their run
+ * time, both on the simulated clock, per priority class they were posted
+ * in.
+ *
+ * It can also change the posts on their way: scale the tolerances, or post
+ * every event in the BLE_STACK class, which lets a bench compare the
+ * scheduling of the same code with and without these features.
+ *
+ * @tparam Capacity Maximum number of pending events.
+ */
+template<std::size_t Capacity>
+class EventQueueProbe: public eq::EventQueue {
+
+	/// A pending event, whose handle is its address.
+	struct Entry {
+		function_t f;
+		event_handle_t inner;           /// handle of the event in the inner queue
+		uint64_t us_deadline;
+		uint64_t us_period;             /// period of a periodic event, 0 otherwise
+		priority_t::class_t priority;
+		bool in_use;
+	};
+
+	/// What the inner queue runs for an entry.
+	struct Fire {
+		void operator()() const {
+			probe->fire(entry);
+		}
+
+		EventQueueProbe* probe;
+		Entry* entry;
+	};
+
+public:
+	/// Measures of the events of a class.
+	struct ClassStats {
+		uint64_t count;
+		uint64_t total_lateness_us;
+		uint64_t max_lateness_us;
+		uint64_t total_run_us;
+		uint64_t max_run_us;
+	};
+
+	/// An event which ran.
+	struct Record {
+		priority_t::class_t priority;
+		uint64_t us_deadline;
+		uint64_t us_start;
+		uint64_t us_end;
+		uint64_t ns_host;               /// run time on the host
+	};
+
+	EventQueueProbe(eq::EventQueue& inner) :
+		_inner(inner), _entries(), _tolerance_num(1), _tolerance_den(1), _single_class(false), _stats(),
+		_max_pending(0) {
+	}
+
+	/// Post the events with their tolerance times num / den.
+	void set_tolerance_scale(unsigned num, unsigned den) {
+		_tolerance_num = num;
+		_tolerance_den = den;
+	}
+
+	/// Post every event in the BLE_STACK class, the class of the events
+	/// posted without one; the measures stay by the class posted.
+	void set_single_class(bool single_class) {
+		_single_class = single_class;
+	}
+
+	/// Called after every event, with its measures.
+	void on_record(const std::function<void(const Record&)>& observer) {
+		_observer = observer;
+	}
+
+	const ClassStats& get_class_stats(priority_t::class_t priority) const {
+		return _stats[priority];
+	}
+
+	void reset_class_stats() {
+		std::fill(_stats, _stats + priority_t::CLASS_COUNT, ClassStats());
+	}
+
+	/// Largest number of events pending at once.
+	std::size_t get_max_pending() const {
+		return _max_pending;
+	}
+
+	virtual bool cancel(event_handle_t event_handle) {
+		Entry* entry = static_cast<Entry*>(event_handle);
+		if (entry < _entries || entry >= _entries + Capacity || !entry->in_use) {
+			return false;
+		}
+		bool canceled = _inner.cancel(entry->inner);
+		entry->in_use = false;
+		return canceled;
+	}
+
+	virtual const eq::EventQueueStats* get_stats() const {
+		return _inner.get_stats();
+	}
+
+private:
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) {
+		Entry* entry = acquire();
+		if (entry == NULL) {
+			return NULL;
+		}
+
+		entry->f = fn;
+		entry->us_deadline = sim_hal::us_now() + (uint64_t) ms_delay * 1000;
+		entry->us_period = repeat ? (uint64_t) ms_delay * 1000 : 0;
+		entry->priority = priority.value;
+
+		Fire fire = { this, entry };
+		ms_tolerance_t tolerance(ms_tolerance * _tolerance_num / _tolerance_den);
+		priority_t inner_priority(_single_class ? priority_t::BLE_STACK : priority.value);
+		if (repeat) {
+			entry->inner = _inner.post_every(fire, ms_delay, tolerance, inner_priority);
+		} else {
+			entry->inner = _inner.post_in(fire, ms_delay, tolerance, inner_priority);
+		}
+		if (entry->inner == NULL) {
+			entry->in_use = false;
+			return NULL;
+		}
+		return entry;
+	}
+
+	Entry* acquire() {
+		Entry* entry = NULL;
+		std::size_t pending = 1;
+		for (std::size_t i = 0; i < Capacity; ++i) {
+			if (_entries[i].in_use) {
+				++pending;
+			} else if (entry == NULL) {
+				entry = &_entries[i];
+			}
+		}
+		if (entry != NULL) {
+			entry->in_use = true;
+			_max_pending = std::max(_max_pending, pending);
+		}
+		return entry;
+	}
+
+	void fire(Entry* entry) {
+		Record record;
+		record.priority = entry->priority;
+		record.us_start = sim_hal::us_now();
+
+		// like the queue, run a periodic event for its latest occurence
+		if (entry->us_period) {
+			while (entry->us_deadline + entry->us_period <= record.us_start) {
+				entry->us_deadline += entry->us_period;
+			}
+		}
+		record.us_deadline = entry->us_deadline;
+
+		// a one-shot entry is free once its callback starts, which may post
+		std::chrono::steady_clock::time_point host_start = std::chrono::steady_clock::now();
+		if (entry->us_period) {
+			entry->us_deadline += entry->us_period;
+			entry->f();
+		} else {
+			function_t f(entry->f);
+			entry->in_use = false;
+			f();
+		}
+		record.ns_host = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - host_start).count();
+		record.us_end = sim_hal::us_now();
+
+		ClassStats& stats = _stats[record.priority];
+		uint64_t lateness = (record.us_start > record.us_deadline) ? record.us_start - record.us_deadline : 0;
+		++stats.count;
+		stats.total_lateness_us += lateness;
+		stats.max_lateness_us = std::max(stats.max_lateness_us, lateness);
+		stats.total_run_us += record.us_end - record.us_start;
+		stats.max_run_us = std::max(stats.max_run_us, record.us_end - record.us_start);
+		if (_observer) {
+			_observer(record);
+		}
+	}
+
+	eq::EventQueue& _inner;
+	Entry _entries[Capacity];
+	unsigned _tolerance_num;
+	unsigned _tolerance_den;
+	bool _single_class;
+	ClassStats _stats[priority_t::CLASS_COUNT];
+	std::size_t _max_pending;
+	std::function<void(const Record&)> _observer;
+};
+
+} // namespace sim_stack
+
+#endif /* BENCH_STACK_EVENTQUEUEPROBE_H_ */
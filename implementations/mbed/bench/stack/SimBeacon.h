@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_SIMBEACON_H_
+#define BENCH_STACK_SIMBEACON_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include "ble/BLE.h"
+#include "EddystoneTypes.h"
+#include "EventQueue.h"
+#include "SimStack.h"
+#include "TimerEvent.h"
+#include "cmsis.h"
+#include "us_ticker_api.h"
+
+// Helpers of the benches which run EddystoneService: configuring its slots
+// as a client of the configuration service does, and running the firmware
+// main loop on the simulated time, with the load of the rest of the stack.
+
+namespace sim_stack {
+
+/// Frame format bytes of the slot data characteristic.
+const uint8_t SLOT_DATA_UID = 0x00;
+const uint8_t SLOT_DATA_URL = 0x10;
+const uint8_t SLOT_DATA_TLM = 0x20;
+const uint8_t SLOT_DATA_EID = 0x30;
+
+/// Slot data of the benches.
+const uint8_t UID_SLOT_DATA[] = {
+	SLOT_DATA_UID,
+	0x8b, 0x0c, 0xa7, 0x50, 0xe7, 0xa7, 0x4e, 0x14, 0xbd, 0x99, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+};
+const uint8_t URL_SLOT_DATA[] = {
+	SLOT_DATA_URL,
+	0x03, 'g', 'o', 'o', '.', 'g', 'l', '/', 'e', 'd', 'd', 'y'
+};
+const uint8_t TLM_SLOT_DATA[] = { SLOT_DATA_TLM };
+
+/// Offset of the frame type in an advertising payload of the beacon: after
+/// the flags, the service UUID list and the header of the service data.
+const uint8_t FRAME_TYPE_OFFSET = 11;
+
+/**
+ * Write a slot through the configuration service, which must be started:
+ * the active slot, its advertising interval, then its slot data.
+ * @param slotData The slot data: the frame format byte then its data.
+ * @return true if every write was authorized.
+ */
+inline bool writeSlot(uint8_t slot, uint16_t msInterval, const uint8_t* slotData, uint16_t len) {
+	GattServer& server = BLE::Instance().gattServer();
+	uint8_t beInterval[2] = { (uint8_t) (msInterval >> 8), (uint8_t) msInterval };
+	return server.simWrite(UUID(UUID_ACTIVE_SLOT_CHAR), &slot, sizeof(slot)) == AUTH_CALLBACK_REPLY_SUCCESS &&
+		server.simWrite(UUID(UUID_ADV_INTERVAL_CHAR), beInterval, sizeof(beInterval)) == AUTH_CALLBACK_REPLY_SUCCESS &&
+		server.simWrite(UUID(UUID_ADV_SLOT_DATA_CHAR), slotData, len) == AUTH_CALLBACK_REPLY_SUCCESS;
+}
+
+/**
+ * Configure slots 0, 1 and 2 with a UID, a URL and a TLM frame.
+ * @param msIntervals The advertising intervals of the 3 slots.
+ */
+inline bool writeUidUrlTlmSlots(const uint16_t* msIntervals) {
+	return writeSlot(0, msIntervals[0], UID_SLOT_DATA, sizeof(UID_SLOT_DATA)) &&
+		writeSlot(1, msIntervals[1], URL_SLOT_DATA, sizeof(URL_SLOT_DATA)) &&
+		writeSlot(2, msIntervals[2], TLM_SLOT_DATA, sizeof(TLM_SLOT_DATA));
+}
+
+/**
+ * The frame an advertising event sent.
+ * @return the slot data format byte of the frame (SLOT_DATA_UID...), or
+ *         0xff for a payload which is not an Eddystone frame.
+ */
+inline uint8_t frameType(const sim_ble::AdvertisingEvent& event) {
+	return (event.payloadLen > FRAME_TYPE_OFFSET) ? event.payload[FRAME_TYPE_OFFSET] : 0xff;
+}
+
+/**
+ * The slot of writeUidUrlTlmSlots an advertising event sent.
+ * @return 0, 1 or 2, or -1 for any other frame.
+ */
+inline int uidUrlTlmSlot(const sim_ble::AdvertisingEvent& event) {
+	switch (frameType(event)) {
+		case SLOT_DATA_UID:
+			return 0;
+		case SLOT_DATA_URL:
+			return 1;
+		case SLOT_DATA_TLM:
+			return 2;
+		default:
+			return -1;
+	}
+}
+
+/// Deviations of the times between two frames of a slot from its interval.
+class IntervalDeviation {
+public:
+	IntervalDeviation() : _last_us(NEVER), _count(0), _total_us(0), _max_us(0) {
+	}
+
+	void add(uint64_t us_time, uint16_t msInterval) {
+		if (_last_us != NEVER) {
+			uint64_t actual = us_time - _last_us;
+			uint64_t target = (uint64_t) msInterval * 1000;
+			uint64_t deviation = (actual > target) ? actual - target : target - actual;
+			++_count;
+			_total_us += deviation;
+			_max_us = std::max(_max_us, deviation);
+		}
+		_last_us = us_time;
+	}
+
+	uint64_t count() const {
+		return _count;
+	}
+
+	double mean_ms() const {
+		return _count ? _total_us / 1000.0 / _count : 0;
+	}
+
+	double max_ms() const {
+		return _max_us / 1000.0;
+	}
+
+private:
+	static const uint64_t NEVER = ~(uint64_t) 0;
+
+	uint64_t _last_us;
+	uint64_t _count;
+	uint64_t _total_us;
+	uint64_t _max_us;
+};
+
+/**
+ * The firmware main loop until the simulated time reaches us_end: sleep
+ * until the next interrupt, then dispatch the queue.
+ */
+template<typename Queue>
+void dispatchUntil(Queue& queue, uint64_t us_end) {
+	queue.dispatch();
+	while (sim_hal::us_now() < us_end) {
+		sim_hal::run_until(us_end);
+		queue.dispatch();
+	}
+}
+
+/**
+ * The rest of the BLE stack: an interrupt every us_mean on average (1 to
+ * 2 * us_mean us apart) posts a callback in the BLE_STACK class, which
+ * takes us_cost to run, as the SoftDevice event handler does.
+ */
+class StackLoad: public mbed::TimerEvent {
+public:
+	StackLoad(eq::EventQueue& queue, uint64_t us_mean, uint64_t us_cost) :
+		mbed::TimerEvent(get_us_ticker_data()), _queue(queue), _us_mean(us_mean), _us_cost(us_cost),
+		_random(1), _posts(0), _dropped(0) {
+	}
+
+	void start() {
+		arm();
+	}
+
+	void stop() {
+		remove();
+	}
+
+	/// Callbacks posted so far.
+	uint64_t posts() const {
+		return _posts;
+	}
+
+	/// Callbacks the queue had no room for.
+	uint64_t dropped() const {
+		return _dropped;
+	}
+
+protected:
+	virtual void handler() {
+		sim_hal::InterruptContext context;
+		if (_queue.post(&StackLoad::processEvents, this)) {
+			++_posts;
+		} else {
+			++_dropped;
+		}
+		arm();
+	}
+
+private:
+	void arm() {
+		_random = _random * 6364136223846793005ULL + 1442695040888963407ULL;
+		insert((timestamp_t) (sim_hal::us_now() + 1 + (_random >> 33) % (2 * _us_mean)));
+	}
+
+	void processEvents() {
+		busy(_us_cost);
+	}
+
+	eq::EventQueue& _queue;
+	uint64_t _us_mean;
+	uint64_t _us_cost;
+	uint64_t _random;
+	uint64_t _posts;
+	uint64_t _dropped;
+};
+
+} // namespace sim_stack
+
+#endif /* BENCH_STACK_SIMBEACON_H_ */
@@ -0,0 +1,768 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Implementation of the stand-ins of bench/stack: the BLE API and its
+// simulated controller, mbedtls, and the platform functions of
+// EddystoneService (entropy source and persistent storage) for nRF targets.
+
+#include "SimStack.h"
+#include "ble/BLE.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/md.h"
+#include "cmsis.h"
+#include "us_ticker_api.h"
+#include "EntropySource/EntropySource.h"
+#include "PersistentStorageHelper/ConfigParamsPersistence.h"
+
+namespace {
+
+/// 64 bit mix of the bytes of data into hash (FNV-1a).
+uint64_t mix(uint64_t hash, const unsigned char* data, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/// Fill output with bytes derived from a seed.
+void expand(uint64_t seed, unsigned char* output, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		output[i] = (unsigned char) (seed >> 56);
+	}
+}
+
+} // namespace
+
+// BLE API
+
+ble_error_t GapAdvertisingData::addData(DataType type, const uint8_t* data, uint8_t len) {
+	if (_payloadLen + 2u + len > GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+		return BLE_ERROR_BUFFER_OVERFLOW;
+	}
+	++sim_stack::counters().advDataFields;
+	_payload[_payloadLen++] = len + 1;
+	_payload[_payloadLen++] = type;
+	memcpy(_payload + _payloadLen, data, len);
+	_payloadLen += len;
+	return BLE_ERROR_NONE;
+}
+
+/// An advertising set of the simulated controller, and the timer events of
+/// the start and the end of its advertising events.
+class Gap::Set {
+public:
+	class Event : public mbed::TimerEvent {
+	public:
+		Event(Gap& gap, Set& set, bool start) :
+			mbed::TimerEvent(get_us_ticker_data()), _gap(gap), _set(set), _start(start) {
+		}
+
+		void arm(uint64_t us_time) {
+			insert((timestamp_t) us_time);
+		}
+
+		void disarm() {
+			remove();
+		}
+
+	protected:
+		virtual void handler() {
+			sim_hal::InterruptContext context;
+			if (_start) {
+				_gap.startEvent(_set);
+			} else {
+				_gap.endEvent(_set);
+			}
+		}
+
+	private:
+		Gap& _gap;
+		Set& _set;
+		bool _start;
+	};
+
+	Set(Gap& gap, ble::advertising_handle_t handle) :
+		handle(handle), created(handle == ble::LEGACY_ADVERTISING_HANDLE), running(false), connectable(true),
+		us_interval(1000000), txPower(0), payload(), start(gap, *this, true), end(gap, *this, false) {
+	}
+
+	ble::advertising_handle_t handle;
+	bool created;
+	bool running;
+	bool connectable;
+	uint64_t us_interval;
+	int8_t txPower;
+	GapAdvertisingData payload;
+	Event start;
+	Event end;
+};
+
+Gap::Gap() :
+	_extendedAdvertising(false), _maxSets(1), _radioNotificationSupported(true), _radioNotificationEnabled(false),
+	_radioBusyUntil(0), _random(1), _counters() {
+	for (uint8_t handle = 0; handle < MAX_SETS; ++handle) {
+		_sets[handle] = new Set(*this, handle);
+	}
+}
+
+Gap::~Gap() {
+	for (uint8_t handle = 0; handle < MAX_SETS; ++handle) {
+		delete _sets[handle];
+	}
+}
+
+ble_error_t Gap::call(ble::advertising_handle_t handle) {
+	// the SoftDevice call takes its time before it acts
+	++_counters.gapCalls;
+	sim_stack::busy(sim_stack::costs().gapCall);
+	if (handle >= MAX_SETS || !_sets[handle]->created) {
+		return BLE_ERROR_INVALID_PARAM;
+	}
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::setAdvertisingType(GapAdvertisingParams::AdvertisingType_t type) {
+	call();
+	_sets[ble::LEGACY_ADVERTISING_HANDLE]->connectable = (type == GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED ||
+		type == GapAdvertisingParams::ADV_CONNECTABLE_DIRECTED);
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::setAdvertisingInterval(uint16_t interval) {
+	call();
+	if (interval < getMinAdvertisingInterval() || interval > getMaxAdvertisingInterval()) {
+		return BLE_ERROR_PARAM_OUT_OF_RANGE;
+	}
+	_sets[ble::LEGACY_ADVERTISING_HANDLE]->us_interval = (uint64_t) interval * 1000;
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::setAdvertisingPayload(const GapAdvertisingData& payload) {
+	call();
+	++_counters.payloadUpdates;
+	_sets[ble::LEGACY_ADVERTISING_HANDLE]->payload = payload;
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::clearAdvertisingPayload() {
+	call();
+	++_counters.payloadUpdates;
+	_sets[ble::LEGACY_ADVERTISING_HANDLE]->payload.clear();
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::accumulateAdvertisingPayload(uint8_t flags) {
+	call();
+	++_counters.payloadUpdates;
+	return _sets[ble::LEGACY_ADVERTISING_HANDLE]->payload.addFlags(flags);
+}
+
+ble_error_t Gap::accumulateAdvertisingPayload(GapAdvertisingData::Appearance appearance) {
+	call();
+	++_counters.payloadUpdates;
+	return _sets[ble::LEGACY_ADVERTISING_HANDLE]->payload.addAppearance(appearance);
+}
+
+ble_error_t Gap::accumulateAdvertisingPayload(GapAdvertisingData::DataType type, const uint8_t* data, uint8_t len) {
+	call();
+	++_counters.payloadUpdates;
+	return _sets[ble::LEGACY_ADVERTISING_HANDLE]->payload.addData(type, data, len);
+}
+
+ble_error_t Gap::clearScanResponse() {
+	return call();
+}
+
+ble_error_t Gap::accumulateScanResponse(GapAdvertisingData::DataType type, const uint8_t* data, uint8_t len) {
+	(void) type;
+	(void) data;
+	(void) len;
+	return call();
+}
+
+ble_error_t Gap::setTxPower(int8_t txPower) {
+	call();
+	_sets[ble::LEGACY_ADVERTISING_HANDLE]->txPower = txPower;
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::setDeviceName(const uint8_t* deviceName) {
+	(void) deviceName;
+	return call();
+}
+
+ble_error_t Gap::startAdvertising() {
+	return startAdvertising(ble::LEGACY_ADVERTISING_HANDLE);
+}
+
+ble_error_t Gap::stopAdvertising() {
+	return stopAdvertising(ble::LEGACY_ADVERTISING_HANDLE);
+}
+
+Gap::GapState_t Gap::getState() const {
+	GapState_t state;
+	state.advertising = _sets[ble::LEGACY_ADVERTISING_HANDLE]->running;
+	state.connected = 0;
+	return state;
+}
+
+ble_error_t Gap::initRadioNotification() {
+	call();
+	if (!_radioNotificationSupported) {
+		return BLE_ERROR_NOT_IMPLEMENTED;
+	}
+	_radioNotificationEnabled = true;
+	return BLE_ERROR_NONE;
+}
+
+bool Gap::isFeatureSupported(ble::controller_supported_features_t feature) {
+	return feature.value == ble::controller_supported_features_t::LE_EXTENDED_ADVERTISING && _extendedAdvertising;
+}
+
+uint8_t Gap::getMaxAdvertisingSetNumber() {
+	return _extendedAdvertising ? _maxSets : 1;
+}
+
+ble_error_t Gap::createAdvertisingSet(ble::advertising_handle_t* handle, const ble::AdvertisingParameters& parameters) {
+	call();
+	if (!_extendedAdvertising) {
+		return BLE_ERROR_NOT_IMPLEMENTED;
+	}
+	for (uint8_t candidate = 1; candidate < _maxSets; ++candidate) {
+		if (!_sets[candidate]->created) {
+			_sets[candidate]->created = true;
+			*handle = candidate;
+			return setAdvertisingParameters(candidate, parameters);
+		}
+	}
+	return BLE_ERROR_NO_MEM;
+}
+
+ble_error_t Gap::destroyAdvertisingSet(ble::advertising_handle_t handle) {
+	ble_error_t error = call(handle);
+	if (error != BLE_ERROR_NONE || handle == ble::LEGACY_ADVERTISING_HANDLE) {
+		return BLE_ERROR_INVALID_PARAM;
+	}
+	if (_sets[handle]->running) {
+		return BLE_ERROR_OPERATION_NOT_PERMITTED;
+	}
+	_sets[handle]->created = false;
+	_sets[handle]->payload.clear();
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::setAdvertisingParameters(ble::advertising_handle_t handle, const ble::AdvertisingParameters& parameters) {
+	ble_error_t error = call(handle);
+	if (error != BLE_ERROR_NONE) {
+		return error;
+	}
+	Set& set = *_sets[handle];
+	set.connectable = (parameters.getType().value == ble::advertising_type_t::CONNECTABLE_UNDIRECTED);
+	set.us_interval = parameters.getMinPrimaryInterval().valueInUs();
+	set.txPower = parameters.getTxPower();
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::setAdvertisingPayload(ble::advertising_handle_t handle, mbed::Span<const uint8_t> payload) {
+	ble_error_t error = call(handle);
+	if (error != BLE_ERROR_NONE) {
+		return error;
+	}
+	if (payload.size() > GapAdvertisingData::GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+		return BLE_ERROR_INVALID_PARAM;
+	}
+	++_counters.payloadUpdates;
+	// the AD structures are copied as they are
+	GapAdvertisingData& data = _sets[handle]->payload;
+	data.clear();
+	size_t offset = 0;
+	while (offset + 1 < payload.size()) {
+		uint8_t length = payload.data()[offset];
+		if (length == 0 || offset + 1 + length > payload.size()) {
+			break;
+		}
+		data.addData((GapAdvertisingData::DataType) payload.data()[offset + 1], payload.data() + offset + 2, length - 1);
+		offset += 1 + length;
+	}
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::startAdvertising(ble::advertising_handle_t handle) {
+	ble_error_t error = call(handle);
+	if (error != BLE_ERROR_NONE) {
+		return error;
+	}
+	Set& set = *_sets[handle];
+	if (set.running) {
+		return BLE_ERROR_INVALID_STATE;
+	}
+	++_counters.startAdvertising;
+	set.running = true;
+	// the first advertising event starts after the random delay of the others
+	_random = _random * 1103515245 + 12345;
+	set.start.arm(sim_hal::us_now() + (_random >> 8) % 10001);
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t Gap::stopAdvertising(ble::advertising_handle_t handle) {
+	ble_error_t error = call(handle);
+	if (error != BLE_ERROR_NONE) {
+		return error;
+	}
+	Set& set = *_sets[handle];
+	if (!set.running) {
+		return BLE_ERROR_NONE;
+	}
+	++_counters.stopAdvertising;
+	// an advertising event in progress still ends
+	set.running = false;
+	set.start.disarm();
+	return BLE_ERROR_NONE;
+}
+
+void Gap::startEvent(Set& set) {
+	if (!set.running) {
+		return;
+	}
+
+	// the controller runs one advertising event at a time
+	uint64_t now = sim_hal::us_now();
+	if (now < _radioBusyUntil) {
+		++_counters.deferredEvents;
+		set.start.arm(_radioBusyUntil);
+		return;
+	}
+
+	// a PDU on each of the 3 advertising channels at 1 Mbit/s: preamble,
+	// access address, header, advertiser address, payload and CRC, with the
+	// radio ramp up and the channel switches
+	sim_ble::AdvertisingEvent event;
+	event.us_time = now;
+	event.us_duration = 140 + 3 * (16 + set.payload.getPayloadLen()) * 8 + 2 * 150;
+	event.handle = set.handle;
+	event.connectable = set.connectable;
+	event.txPower = set.txPower;
+	event.payloadLen = set.payload.getPayloadLen();
+	memcpy(event.payload, set.payload.getPayload(), event.payloadLen);
+
+	if (_radioNotificationEnabled && _radioNotification) {
+		_radioNotification(true);
+	}
+	++_counters.advertisingEvents;
+	_counters.radioUs += event.us_duration;
+	_radioBusyUntil = now + event.us_duration;
+	if (_observer) {
+		_observer(event);
+	}
+	set.end.arm(_radioBusyUntil);
+
+	// the next event is an interval plus a random delay of up to 10 ms later
+	_random = _random * 1103515245 + 12345;
+	set.start.arm(now + set.us_interval + (_random >> 8) % 10001);
+}
+
+void Gap::endEvent(Set& set) {
+	(void) set;
+	if (_radioNotificationEnabled && _radioNotification) {
+		_radioNotification(false);
+	}
+}
+
+void Gap::simSetFeatures(bool extendedAdvertising, uint8_t maxSets, bool radioNotification) {
+	_extendedAdvertising = extendedAdvertising;
+	_maxSets = (maxSets > MAX_SETS) ? MAX_SETS : maxSets;
+	_radioNotificationSupported = radioNotification;
+}
+
+void Gap::simReset() {
+	for (uint8_t handle = 0; handle < MAX_SETS; ++handle) {
+		Set& set = *_sets[handle];
+		set.start.disarm();
+		set.end.disarm();
+		set.running = false;
+		set.created = (handle == ble::LEGACY_ADVERTISING_HANDLE);
+		set.payload.clear();
+	}
+	_radioNotificationEnabled = false;
+	_radioBusyUntil = 0;
+	_random = 1;
+	_radioNotification = std::function<void(bool)>();
+	_observer = std::function<void(const sim_ble::AdvertisingEvent&)>();
+	_counters = sim_ble::Counters();
+}
+
+ble_error_t GattServer::addService(GattService& service) {
+	for (unsigned i = 0; i < service._count; ++i) {
+		GattCharacteristic* characteristic = service._characteristics[i];
+		characteristic->_handle = _nextHandle++;
+		_characteristics.push_back(characteristic);
+		// the stack keeps its own copy of the values
+		_values.push_back(std::vector<uint8_t>(characteristic->_value, characteristic->_value + characteristic->_len));
+	}
+	return BLE_ERROR_NONE;
+}
+
+ble_error_t GattServer::write(GattAttribute::Handle_t handle, const uint8_t* value, uint16_t size) {
+	sim_stack::busy(sim_stack::costs().gattWrite);
+	for (size_t i = 0; i < _characteristics.size(); ++i) {
+		if (_characteristics[i]->_handle == handle) {
+			if (size > _characteristics[i]->_maxLen) {
+				return BLE_ERROR_INVALID_PARAM;
+			}
+			_values[i].assign(value, value + size);
+			return BLE_ERROR_NONE;
+		}
+	}
+	return BLE_ERROR_INVALID_PARAM;
+}
+
+GattAuthCallbackReply_t GattServer::simWrite(const UUID& uuid, const uint8_t* value, uint16_t size) {
+	for (size_t i = 0; i < _characteristics.size(); ++i) {
+		GattCharacteristic& characteristic = *_characteristics[i];
+		if (!(characteristic._uuid == uuid)) {
+			continue;
+		}
+
+		if (characteristic._writeAuthorization) {
+			GattWriteAuthCallbackParams params = { 0, characteristic._handle, 0, size, value, AUTH_CALLBACK_REPLY_SUCCESS };
+			characteristic._writeAuthorization(&params);
+			if (params.authorizationReply != AUTH_CALLBACK_REPLY_SUCCESS) {
+				return params.authorizationReply;
+			}
+		}
+		_values[i].assign(value, value + size);
+
+		GattWriteCallbackParams params = { 0, characteristic._handle, 0, size, value };
+		for (size_t callback = 0; callback < _dataWritten.size(); ++callback) {
+			_dataWritten[callback](&params);
+		}
+		return AUTH_CALLBACK_REPLY_SUCCESS;
+	}
+	return AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
+}
+
+GattAuthCallbackReply_t GattServer::simRead(const UUID& uuid, std::vector<uint8_t>& value) {
+	for (size_t i = 0; i < _characteristics.size(); ++i) {
+		GattCharacteristic& characteristic = *_characteristics[i];
+		if (!(characteristic._uuid == uuid)) {
+			continue;
+		}
+
+		if (characteristic._readAuthorization) {
+			GattReadAuthCallbackParams params = { 0, characteristic._handle, 0, 0, NULL, AUTH_CALLBACK_REPLY_SUCCESS };
+			characteristic._readAuthorization(&params);
+			if (params.authorizationReply != AUTH_CALLBACK_REPLY_SUCCESS) {
+				return params.authorizationReply;
+			}
+		}
+		value = _values[i];
+		return AUTH_CALLBACK_REPLY_SUCCESS;
+	}
+	return AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED;
+}
+
+void GattServer::simReset() {
+	_nextHandle = 1;
+	_characteristics.clear();
+	_values.clear();
+	_dataWritten.clear();
+}
+
+ble_error_t BLE::setAddress(BLEProtocol::AddressType::Type type, const uint8_t address[6]) {
+	(void) type;
+	(void) address;
+	ble_error_t error = _gap.call();
+	// the address cannot change while advertising
+	if (_gap.getState().advertising) {
+		return BLE_ERROR_INVALID_STATE;
+	}
+	++_gap._counters.addressChanges;
+	return error;
+}
+
+// mbedtls
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+	(void) keybits;
+	++sim_stack::counters().aesSetkeys;
+	sim_stack::busy(sim_stack::costs().aesSetkey);
+	memcpy(ctx->key, key, sizeof(ctx->key));
+	return 0;
+}
+
+int mbedtls_aes_setkey_dec(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+	return mbedtls_aes_setkey_enc(ctx, key, keybits);
+}
+
+int mbedtls_aes_crypt_ecb(mbedtls_aes_context* ctx, int mode, const unsigned char input[16], unsigned char output[16]) {
+	++sim_stack::counters().aesBlocks;
+	sim_stack::busy(sim_stack::costs().aesBlock);
+	unsigned char block[16];
+	for (unsigned i = 0; i < 16; ++i) {
+		if (mode == MBEDTLS_AES_ENCRYPT) {
+			block[i] = (unsigned char) ((input[(i + 1) & 15] ^ ctx->key[i]) + 0x3b);
+		} else {
+			block[(i + 1) & 15] = (unsigned char) ((input[i] - 0x3b) ^ ctx->key[i]);
+		}
+	}
+	memcpy(output, block, sizeof(block));
+	return 0;
+}
+
+int mbedtls_aes_crypt_cbc(mbedtls_aes_context* ctx, int mode, size_t length, unsigned char iv[16],
+	const unsigned char* input, unsigned char* output) {
+	for (size_t offset = 0; offset + 16 <= length; offset += 16) {
+		unsigned char block[16];
+		if (mode == MBEDTLS_AES_ENCRYPT) {
+			for (unsigned i = 0; i < 16; ++i) {
+				block[i] = input[offset + i] ^ iv[i];
+			}
+			mbedtls_aes_crypt_ecb(ctx, mode, block, output + offset);
+			memcpy(iv, output + offset, 16);
+		} else {
+			memcpy(block, input + offset, 16);
+			mbedtls_aes_crypt_ecb(ctx, mode, block, output + offset);
+			for (unsigned i = 0; i < 16; ++i) {
+				output[offset + i] ^= iv[i];
+			}
+			memcpy(iv, block, 16);
+		}
+	}
+	return 0;
+}
+
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+	unsigned char stream_block[16], const unsigned char* input, unsigned char* output) {
+	size_t n = *nc_off;
+	for (size_t i = 0; i < length; ++i) {
+		if (n == 0) {
+			mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, nonce_counter, stream_block);
+			for (int c = 15; c >= 0; --c) {
+				if (++nonce_counter[c] != 0) {
+					break;
+				}
+			}
+		}
+		output[i] = input[i] ^ stream_block[n];
+		n = (n + 1) & 15;
+	}
+	*nc_off = n;
+	return 0;
+}
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) {
+	ctx->source = NULL;
+	ctx->data = NULL;
+}
+
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx) {
+	mbedtls_entropy_init(ctx);
+}
+
+int mbedtls_entropy_add_source(mbedtls_entropy_context* ctx, mbedtls_entropy_f_source_ptr f_source, void* p_source,
+	size_t threshold, int strong) {
+	(void) threshold;
+	(void) strong;
+	ctx->source = f_source;
+	ctx->data = p_source;
+	return 0;
+}
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+	mbedtls_entropy_context* ctx = static_cast<mbedtls_entropy_context*>(data);
+	if (ctx->source == NULL) {
+		return -1;
+	}
+	size_t done = 0;
+	while (done < len) {
+		size_t olen = 0;
+		if (ctx->source(ctx->data, output + done, len - done, &olen) != 0 || olen == 0) {
+			return -1;
+		}
+		done += olen;
+	}
+	return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) {
+	ctx->state = 0;
+}
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx) {
+	ctx->state = 0;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+	void* p_entropy, const unsigned char* custom, size_t len) {
+	++sim_stack::counters().drbgSeeds;
+	unsigned char seed[48];
+	int rc = f_entropy(p_entropy, seed, sizeof(seed));
+	if (rc != 0) {
+		return rc;
+	}
+	sim_stack::busy(sim_stack::costs().drbgSeed);
+	ctx->state = mix(mix(0xcbf29ce484222325ULL, seed, sizeof(seed)), custom, custom ? len : 0);
+	return 0;
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len) {
+	mbedtls_ctr_drbg_context* ctx = static_cast<mbedtls_ctr_drbg_context*>(p_rng);
+	sim_stack::busy(sim_stack::costs().drbgBlock * ((output_len + 15) / 16));
+	ctx->state = mix(ctx->state, output, 0) + 1;
+	expand(ctx->state, output, output_len);
+	ctx->state = mix(ctx->state, output, output_len);
+	return 0;
+}
+
+int mbedtls_mpi_read_binary(mbedtls_mpi* X, const unsigned char* buf, size_t buflen) {
+	memset(X->p, 0, sizeof(X->p));
+	memcpy(X->p + sizeof(X->p) - buflen, buf, buflen);
+	return 0;
+}
+
+int mbedtls_mpi_write_binary(const mbedtls_mpi* X, unsigned char* buf, size_t buflen) {
+	memcpy(buf, X->p + sizeof(X->p) - buflen, buflen);
+	return 0;
+}
+
+int mbedtls_mpi_lset(mbedtls_mpi* X, int z) {
+	memset(X->p, 0, sizeof(X->p));
+	X->p[sizeof(X->p) - 1] = (unsigned char) z;
+	return 0;
+}
+
+int mbedtls_ecp_group_load(mbedtls_ecp_group* grp, mbedtls_ecp_group_id id) {
+	grp->id = id;
+	return 0;
+}
+
+void mbedtls_ecdh_init(mbedtls_ecdh_context* ctx) {
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_ecdh_free(mbedtls_ecdh_context* ctx) {
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_ecdh_gen_public(mbedtls_ecp_group* grp, mbedtls_mpi* d, mbedtls_ecp_point* Q,
+	int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+	(void) grp;
+	int rc = f_rng(p_rng, d->p, sizeof(d->p));
+	if (rc != 0) {
+		return rc;
+	}
+	++sim_stack::counters().ecpMuls;
+	sim_stack::busy(sim_stack::costs().ecpMul);
+	expand(mix(0x9e3779b97f4a7c15ULL, d->p, sizeof(d->p)), Q->X.p, sizeof(Q->X.p));
+	return 0;
+}
+
+int mbedtls_ecdh_calc_secret(mbedtls_ecdh_context* ctx, size_t* olen, unsigned char* buf, size_t blen,
+	int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+	(void) f_rng;
+	(void) p_rng;
+	if (blen < sizeof(ctx->z.p)) {
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+	}
+	++sim_stack::counters().ecpMuls;
+	sim_stack::busy(sim_stack::costs().ecpMul);
+	uint64_t hash = mix(mix(0x9e3779b97f4a7c15ULL, ctx->d.p, sizeof(ctx->d.p)), ctx->Qp.X.p, sizeof(ctx->Qp.X.p));
+	expand(hash, ctx->z.p, sizeof(ctx->z.p));
+	memcpy(buf, ctx->z.p, sizeof(ctx->z.p));
+	*olen = sizeof(ctx->z.p);
+	return 0;
+}
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+	static const mbedtls_md_info_t sha256 = { MBEDTLS_MD_SHA256 };
+	return (md_type == MBEDTLS_MD_SHA256) ? &sha256 : NULL;
+}
+
+void mbedtls_md_init(mbedtls_md_context_t* ctx) {
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md_free(mbedtls_md_context_t* ctx) {
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t* ctx, const mbedtls_md_info_t* md_info, int hmac) {
+	(void) hmac;
+	ctx->md_info = md_info;
+	return md_info ? 0 : -1;
+}
+
+int mbedtls_md_hmac_starts(mbedtls_md_context_t* ctx, const unsigned char* key, size_t keylen) {
+	expand(mix(0x6a09e667f3bcc908ULL, key, keylen), ctx->state, sizeof(ctx->state));
+	return 0;
+}
+
+int mbedtls_md_hmac_update(mbedtls_md_context_t* ctx, const unsigned char* input, size_t ilen) {
+	expand(mix(mix(0xbb67ae8584caa73bULL, ctx->state, sizeof(ctx->state)), input, ilen), ctx->state, sizeof(ctx->state));
+	return 0;
+}
+
+int mbedtls_md_hmac_finish(mbedtls_md_context_t* ctx, unsigned char* output) {
+	sim_stack::busy(sim_stack::costs().hmac);
+	memcpy(output, ctx->state, sizeof(ctx->state));
+	return 0;
+}
+
+// Platform functions of EddystoneService
+
+int eddystoneRegisterEntropySource(mbedtls_entropy_context* ctx) {
+	return mbedtls_entropy_add_source(ctx, eddystoneEntropyPoll, NULL, 32, MBEDTLS_ENTROPY_SOURCE_STRONG);
+}
+
+int eddystoneEntropyPoll(void* data, unsigned char* output, size_t len, size_t* olen) {
+	(void) data;
+	sim_stack::busy(sim_stack::costs().entropyByte * len);
+	sim_stack::rng_state() = sim_stack::rng_state() * 6364136223846793005ULL + 1;
+	expand(sim_stack::rng_state(), output, len);
+	*olen = len;
+	return 0;
+}
+
+bool loadEddystoneServiceConfigParams(EddystoneService::EddystoneParams_t* paramsP) {
+	(void) paramsP;
+	return false;
+}
+
+void saveEddystoneServiceConfigParams(const EddystoneService::EddystoneParams_t* paramsP) {
+	(void) paramsP;
+	++sim_stack::counters().nvmWrites;
+	sim_stack::busy(sim_stack::costs().nvmWrite);
+}
+
+void saveEddystoneTimeParams(const TimeParams_t* timeP) {
+	(void) timeP;
+	++sim_stack::counters().nvmWrites;
+	sim_stack::busy(sim_stack::costs().nvmWrite);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_SIMSTACK_H_
+#define BENCH_STACK_SIMSTACK_H_
+
+#include <stdint.h>
+#include "TimerEvent.h"
+
+namespace sim_stack {
+
+/**
+ * Simulated time taken by the stand-ins of bench/stack, in us. The defaults
+ * are assumptions for an nRF51 at 16 MHz: the S130 SoftDevice behind the BLE
+ * API, mbedtls in software, the hardware RNG and pstorage, which only queues
+ * flash writes.
+ */
+struct Costs {
+	uint64_t gapCall;               /// a SoftDevice call of Gap, or of BLE::setAddress
+	uint64_t gattWrite;             /// a GattServer::write of a characteristic value
+	uint64_t aesSetkey;             /// an AES-128 key schedule
+	uint64_t aesBlock;              /// an AES-128 block
+	uint64_t entropyByte;           /// a byte of the hardware RNG, bias correction on
+	uint64_t drbgSeed;              /// CTR_DRBG seeding, on top of its 48 bytes of entropy
+	uint64_t drbgBlock;             /// 16 bytes of CTR_DRBG output
+	uint64_t ecpMul;                /// a Curve25519 point multiplication
+	uint64_t hmac;                  /// an HMAC-SHA256 of up to 64 bytes
+	uint64_t nvmWrite;              /// a pstorage update, queued
+};
+
+inline Costs default_costs() {
+	Costs costs;
+	costs.gapCall = 15;
+	costs.gattWrite = 20;
+	costs.aesSetkey = 100;
+	costs.aesBlock = 150;
+	costs.entropyByte = 110;
+	costs.drbgSeed = 400;
+	costs.drbgBlock = 150;
+	costs.ecpMul = 300000;
+	costs.hmac = 600;
+	costs.nvmWrite = 150;
+	return costs;
+}
+
+/// The costs in use; benches may change them, e.g. zero them all.
+inline Costs& costs() {
+	static Costs costs = default_costs();
+	return costs;
+}
+
+/// Counts of the work done by the stand-ins.
+struct Counters {
+	uint64_t advDataFields;          /// AD structures added to a GapAdvertisingData
+	uint64_t aesSetkeys;
+	uint64_t aesBlocks;
+	uint64_t drbgSeeds;
+	uint64_t ecpMuls;
+	uint64_t nvmWrites;
+};
+
+inline Counters& counters() {
+	static Counters counters = Counters();
+	return counters;
+}
+
+/// State of the simulated hardware RNG; benches may reset it to draw the
+/// same bytes again.
+inline uint64_t& rng_state() {
+	static uint64_t state = 0x853c49e6748fea9bULL;
+	return state;
+}
+
+/// The running code takes us of simulated time, during which the timer
+/// events (the event queue ticker, the controller) keep firing.
+inline void busy(uint64_t us) {
+	if (us == 0) {
+		return;
+	}
+	uint64_t end = sim_hal::us_now() + us;
+	while (sim_hal::run_until(end)) {
+	}
+}
+
+} // namespace sim_stack
+
+#endif /* BENCH_STACK_SIMSTACK_H_ */
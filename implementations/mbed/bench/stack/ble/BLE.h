@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_BLE_BLE_H_
+#define BENCH_STACK_BLE_BLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+#include "TimerEvent.h"
+
+// Host stand-in for the part of the mbed BLE API that EddystoneService and
+// its advertising backends use, so that the benches compile and run the
+// real sources. Gap simulates a controller on the time of sim_hal::us_now():
+// the legacy advertiser and the advertising sets send advertising events
+// from timer events, with radio notifications around them, and the benches
+// observe what went on air. Calls into the stack take the simulated time of
+// sim_stack::costs().
+
+enum ble_error_t {
+	BLE_ERROR_NONE = 0,
+	BLE_ERROR_BUFFER_OVERFLOW = 1,
+	BLE_ERROR_NOT_IMPLEMENTED = 2,
+	BLE_ERROR_PARAM_OUT_OF_RANGE = 3,
+	BLE_ERROR_INVALID_PARAM = 4,
+	BLE_STACK_BUSY = 5,
+	BLE_ERROR_INVALID_STATE = 6,
+	BLE_ERROR_NO_MEM = 7,
+	BLE_ERROR_OPERATION_NOT_PERMITTED = 8,
+	BLE_ERROR_UNSPECIFIED = 11
+};
+
+namespace mbed {
+
+/// View of a contiguous sequence of Ts.
+template<typename T>
+class Span {
+public:
+	Span(T* data, size_t size) : _data(data), _size(size) {
+	}
+
+	T* data() const { return _data; }
+	size_t size() const { return _size; }
+
+private:
+	T* _data;
+	size_t _size;
+};
+
+} // namespace mbed
+
+namespace BLEProtocol {
+
+struct AddressType {
+	enum Type {
+		PUBLIC = 0,
+		RANDOM_STATIC,
+		RANDOM_PRIVATE_RESOLVABLE,
+		RANDOM_PRIVATE_NON_RESOLVABLE
+	};
+};
+
+} // namespace BLEProtocol
+
+/// 128 or 16 bit UUID.
+class UUID {
+public:
+	UUID(const uint8_t longUUID[16]) : _short(0) {
+		memcpy(_long, longUUID, sizeof(_long));
+	}
+
+	UUID(uint16_t shortUUID) : _short(shortUUID) {
+		memset(_long, 0, sizeof(_long));
+	}
+
+	bool operator==(const UUID& other) const {
+		return _short == other._short && memcmp(_long, other._long, sizeof(_long)) == 0;
+	}
+
+private:
+	uint8_t _long[16];
+	uint16_t _short;
+};
+
+/// Payload of advertising packets or scan responses: AD structures of up to
+/// 31 bytes in all.
+class GapAdvertisingData {
+public:
+	static const unsigned GAP_ADVERTISING_DATA_MAX_PAYLOAD = 31;
+
+	enum DataType_t {
+		FLAGS = 0x01,
+		COMPLETE_LIST_16BIT_SERVICE_IDS = 0x03,
+		COMPLETE_LIST_128BIT_SERVICE_IDS = 0x07,
+		COMPLETE_LOCAL_NAME = 0x09,
+		TX_POWER_LEVEL = 0x0A,
+		SERVICE_DATA = 0x16,
+		APPEARANCE = 0x19
+	};
+	typedef enum DataType_t DataType;
+
+	enum Flags_t {
+		LE_LIMITED_DISCOVERABLE = 0x01,
+		LE_GENERAL_DISCOVERABLE = 0x02,
+		BREDR_NOT_SUPPORTED = 0x04
+	};
+
+	enum Appearance_t {
+		UNKNOWN = 0,
+		GENERIC_TAG = 512
+	};
+	typedef enum Appearance_t Appearance;
+
+	GapAdvertisingData() : _payloadLen(0) {
+		memset(_payload, 0, sizeof(_payload));
+	}
+
+	ble_error_t addData(DataType type, const uint8_t* data, uint8_t len);
+
+	ble_error_t addFlags(uint8_t flags) {
+		return addData(FLAGS, &flags, 1);
+	}
+
+	ble_error_t addAppearance(Appearance appearance) {
+		uint8_t data[2] = { (uint8_t) appearance, (uint8_t) (appearance >> 8) };
+		return addData(APPEARANCE, data, sizeof(data));
+	}
+
+	void clear() {
+		_payloadLen = 0;
+	}
+
+	const uint8_t* getPayload() const { return _payload; }
+	uint8_t getPayloadLen() const { return _payloadLen; }
+
+private:
+	uint8_t _payload[GAP_ADVERTISING_DATA_MAX_PAYLOAD];
+	uint8_t _payloadLen;
+};
+
+class GapAdvertisingParams {
+public:
+	enum AdvertisingType_t {
+		ADV_CONNECTABLE_UNDIRECTED,
+		ADV_CONNECTABLE_DIRECTED,
+		ADV_SCANNABLE_UNDIRECTED,
+		ADV_NON_CONNECTABLE_UNDIRECTED
+	};
+	typedef enum AdvertisingType_t AdvertisingType;
+};
+
+namespace ble {
+
+typedef uint8_t advertising_handle_t;
+
+const advertising_handle_t LEGACY_ADVERTISING_HANDLE = 0x00;
+const advertising_handle_t INVALID_ADVERTISING_HANDLE = 0xFF;
+
+struct controller_supported_features_t {
+	enum type {
+		LE_ENCRYPTION = 0,
+		LE_EXTENDED_ADVERTISING = 12
+	};
+
+	controller_supported_features_t(type value) : value(value) { }
+	type value;
+};
+
+struct advertising_type_t {
+	enum type {
+		CONNECTABLE_UNDIRECTED,
+		SCANNABLE_UNDIRECTED,
+		NON_CONNECTABLE_UNDIRECTED
+	};
+
+	advertising_type_t(type value) : value(value) { }
+	type value;
+};
+
+struct millisecond_t {
+	explicit millisecond_t(uint32_t ms) : ms(ms) { }
+	uint32_t value() const { return ms; }
+	uint32_t ms;
+};
+
+/// Advertising interval, in units of 0.625 ms.
+struct adv_interval_t {
+	adv_interval_t(millisecond_t ms) : units(ms.value() * 1000 / 625) { }
+	uint32_t value() const { return units; }
+	uint32_t valueInUs() const { return units * 625; }
+	uint32_t units;
+};
+
+class AdvertisingParameters {
+public:
+	AdvertisingParameters(advertising_type_t type = advertising_type_t::CONNECTABLE_UNDIRECTED,
+		adv_interval_t minInterval = adv_interval_t(millisecond_t(1000)),
+		adv_interval_t maxInterval = adv_interval_t(millisecond_t(1000))) :
+		_type(type), _minInterval(minInterval), _maxInterval(maxInterval), _txPower(0) {
+	}
+
+	AdvertisingParameters& setTxPower(int8_t txPower) {
+		_txPower = txPower;
+		return *this;
+	}
+
+	advertising_type_t getType() const { return _type; }
+	adv_interval_t getMinPrimaryInterval() const { return _minInterval; }
+	adv_interval_t getMaxPrimaryInterval() const { return _maxInterval; }
+	int8_t getTxPower() const { return _txPower; }
+
+private:
+	advertising_type_t _type;
+	adv_interval_t _minInterval;
+	adv_interval_t _maxInterval;
+	int8_t _txPower;
+};
+
+} // namespace ble
+
+namespace sim_ble {
+
+/// An advertising event the controller sent.
+struct AdvertisingEvent {
+	uint64_t us_time;                   /// start of the event
+	uint64_t us_duration;               /// radio time of the event
+	ble::advertising_handle_t handle;   /// set which sent it
+	bool connectable;
+	int8_t txPower;
+	uint8_t payloadLen;
+	uint8_t payload[GapAdvertisingData::GAP_ADVERTISING_DATA_MAX_PAYLOAD];
+};
+
+/// Calls made to the stack.
+struct Counters {
+	uint64_t gapCalls;                  /// every Gap call, the getters excepted
+	uint64_t startAdvertising;
+	uint64_t stopAdvertising;
+	uint64_t payloadUpdates;            /// advertising payloads given to the controller
+	uint64_t addressChanges;
+	uint64_t advertisingEvents;
+	uint64_t deferredEvents;            /// events the radio was busy for
+	uint64_t radioUs;                   /// radio time of the advertising events
+};
+
+} // namespace sim_ble
+
+class Gap {
+public:
+	struct GapState_t {
+		unsigned advertising : 1;
+		unsigned connected : 1;
+	};
+
+	Gap();
+	~Gap();
+
+	// Legacy advertising, which is the set LEGACY_ADVERTISING_HANDLE
+
+	ble_error_t setAdvertisingType(GapAdvertisingParams::AdvertisingType_t type);
+	ble_error_t setAdvertisingInterval(uint16_t interval);
+	uint16_t getMinAdvertisingInterval() const { return 20; }
+	uint16_t getMinNonConnectableAdvertisingInterval() const { return 100; }
+	uint16_t getMaxAdvertisingInterval() const { return 10240; }
+	ble_error_t setAdvertisingPayload(const GapAdvertisingData& payload);
+	ble_error_t clearAdvertisingPayload();
+	ble_error_t accumulateAdvertisingPayload(uint8_t flags);
+	ble_error_t accumulateAdvertisingPayload(GapAdvertisingData::Appearance appearance);
+	ble_error_t accumulateAdvertisingPayload(GapAdvertisingData::DataType type, const uint8_t* data, uint8_t len);
+	ble_error_t clearScanResponse();
+	ble_error_t accumulateScanResponse(GapAdvertisingData::DataType type, const uint8_t* data, uint8_t len);
+	ble_error_t setTxPower(int8_t txPower);
+	ble_error_t setDeviceName(const uint8_t* deviceName);
+	ble_error_t startAdvertising();
+	ble_error_t stopAdvertising();
+	GapState_t getState() const;
+
+	/// The radio notification callback runs in interrupt context, with true
+	/// before an advertising event and false after it.
+	template<typename T>
+	void onRadioNotification(T* object, void (T::*member)(bool)) {
+		_radioNotification = std::bind(member, object, std::placeholders::_1);
+	}
+
+	ble_error_t initRadioNotification();
+
+	// Advertising sets
+
+	bool isFeatureSupported(ble::controller_supported_features_t feature);
+	uint8_t getMaxAdvertisingSetNumber();
+	ble_error_t createAdvertisingSet(ble::advertising_handle_t* handle, const ble::AdvertisingParameters& parameters);
+	ble_error_t destroyAdvertisingSet(ble::advertising_handle_t handle);
+	ble_error_t setAdvertisingParameters(ble::advertising_handle_t handle, const ble::AdvertisingParameters& parameters);
+	ble_error_t setAdvertisingPayload(ble::advertising_handle_t handle, mbed::Span<const uint8_t> payload);
+	ble_error_t startAdvertising(ble::advertising_handle_t handle);
+	ble_error_t stopAdvertising(ble::advertising_handle_t handle);
+
+	// Simulation, for the benches
+
+	/// Controller features: advertising sets (maxSets of them, the legacy
+	/// advertiser included) and radio notifications.
+	void simSetFeatures(bool extendedAdvertising, uint8_t maxSets, bool radioNotification);
+
+	/// Called from interrupt context at the start of every advertising event.
+	void simOnAdvertisingEvent(const std::function<void(const sim_ble::AdvertisingEvent&)>& observer) {
+		_observer = observer;
+	}
+
+	const sim_ble::Counters& simCounters() const { return _counters; }
+
+	/// Stop every set and forget the callbacks and counters.
+	void simReset();
+
+	static const uint8_t MAX_SETS = 4;
+
+private:
+	class Set;
+	friend class Set;
+	friend class BLE;
+
+	ble_error_t call(ble::advertising_handle_t handle = ble::LEGACY_ADVERTISING_HANDLE);
+	void startEvent(Set& set);
+	void endEvent(Set& set);
+
+	Set* _sets[MAX_SETS];
+	bool _extendedAdvertising;
+	uint8_t _maxSets;
+	bool _radioNotificationSupported;
+	bool _radioNotificationEnabled;
+	uint64_t _radioBusyUntil;
+	uint32_t _random;
+	std::function<void(bool)> _radioNotification;
+	std::function<void(const sim_ble::AdvertisingEvent&)> _observer;
+	sim_ble::Counters _counters;
+};
+
+class GattAttribute {
+public:
+	typedef uint16_t Handle_t;
+};
+
+enum GattAuthCallbackReply_t {
+	AUTH_CALLBACK_REPLY_SUCCESS = 0x00,
+	AUTH_CALLBACK_REPLY_ATTERR_INVALID_OFFSET = 0x0107,
+	AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED = 0x0102,
+	AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED = 0x0103,
+	AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH = 0x010D
+};
+
+struct GattWriteAuthCallbackParams {
+	uint16_t connHandle;
+	GattAttribute::Handle_t handle;
+	uint16_t offset;
+	uint16_t len;
+	const uint8_t* data;
+	GattAuthCallbackReply_t authorizationReply;
+};
+
+struct GattReadAuthCallbackParams {
+	uint16_t connHandle;
+	GattAttribute::Handle_t handle;
+	uint16_t offset;
+	uint16_t len;
+	uint8_t* data;
+	GattAuthCallbackReply_t authorizationReply;
+};
+
+struct GattWriteCallbackParams {
+	uint16_t connHandle;
+	GattAttribute::Handle_t handle;
+	uint16_t offset;
+	uint16_t len;
+	const uint8_t* data;
+};
+
+class GattCharacteristic {
+public:
+	enum Properties_t {
+		BLE_GATT_CHAR_PROPERTIES_NONE = 0x00,
+		BLE_GATT_CHAR_PROPERTIES_READ = 0x02,
+		BLE_GATT_CHAR_PROPERTIES_WRITE = 0x08
+	};
+
+	GattCharacteristic(const UUID& uuid, uint8_t* valuePtr = NULL, uint16_t len = 0, uint16_t maxLen = 0,
+		uint8_t properties = BLE_GATT_CHAR_PROPERTIES_NONE) :
+		_uuid(uuid), _value(valuePtr), _len(len), _maxLen(maxLen), _properties(properties), _handle(0) {
+	}
+
+	virtual ~GattCharacteristic() { }
+
+	template<typename T>
+	void setReadAuthorizationCallback(T* object, void (T::*member)(GattReadAuthCallbackParams*)) {
+		_readAuthorization = std::bind(member, object, std::placeholders::_1);
+	}
+
+	template<typename T>
+	void setWriteAuthorizationCallback(T* object, void (T::*member)(GattWriteAuthCallbackParams*)) {
+		_writeAuthorization = std::bind(member, object, std::placeholders::_1);
+	}
+
+	GattAttribute::Handle_t getValueHandle() const { return _handle; }
+	const UUID& getUUID() const { return _uuid; }
+
+private:
+	friend class GattServer;
+
+	UUID _uuid;
+	uint8_t* _value;
+	uint16_t _len;
+	uint16_t _maxLen;
+	uint8_t _properties;
+	GattAttribute::Handle_t _handle;
+	std::function<void(GattReadAuthCallbackParams*)> _readAuthorization;
+	std::function<void(GattWriteAuthCallbackParams*)> _writeAuthorization;
+};
+
+template<typename T>
+class ReadWriteGattCharacteristic : public GattCharacteristic {
+public:
+	ReadWriteGattCharacteristic(const UUID& uuid, T* valuePtr) :
+		GattCharacteristic(uuid, reinterpret_cast<uint8_t*>(valuePtr), sizeof(T), sizeof(T),
+			BLE_GATT_CHAR_PROPERTIES_READ | BLE_GATT_CHAR_PROPERTIES_WRITE) {
+	}
+};
+
+template<typename T>
+class WriteOnlyGattCharacteristic : public GattCharacteristic {
+public:
+	WriteOnlyGattCharacteristic(const UUID& uuid, T* valuePtr) :
+		GattCharacteristic(uuid, reinterpret_cast<uint8_t*>(valuePtr), sizeof(T), sizeof(T),
+			BLE_GATT_CHAR_PROPERTIES_WRITE) {
+	}
+};
+
+template<typename T, unsigned NUM_ELEMENTS>
+class ReadOnlyArrayGattCharacteristic : public GattCharacteristic {
+public:
+	ReadOnlyArrayGattCharacteristic(const UUID& uuid, T valuePtr[NUM_ELEMENTS]) :
+		GattCharacteristic(uuid, reinterpret_cast<uint8_t*>(valuePtr), sizeof(T) * NUM_ELEMENTS,
+			sizeof(T) * NUM_ELEMENTS, BLE_GATT_CHAR_PROPERTIES_READ) {
+	}
+};
+
+template<typename T, unsigned NUM_ELEMENTS>
+class ReadWriteArrayGattCharacteristic : public GattCharacteristic {
+public:
+	ReadWriteArrayGattCharacteristic(const UUID& uuid, T valuePtr[NUM_ELEMENTS]) :
+		GattCharacteristic(uuid, reinterpret_cast<uint8_t*>(valuePtr), sizeof(T) * NUM_ELEMENTS,
+			sizeof(T) * NUM_ELEMENTS, BLE_GATT_CHAR_PROPERTIES_READ | BLE_GATT_CHAR_PROPERTIES_WRITE) {
+	}
+};
+
+class GattService {
+public:
+	GattService(const UUID& uuid, GattCharacteristic* characteristics[], unsigned count) :
+		_uuid(uuid), _characteristics(characteristics), _count(count) {
+	}
+
+private:
+	friend class GattServer;
+
+	UUID _uuid;
+	GattCharacteristic** _characteristics;
+	unsigned _count;
+};
+
+class GattServer {
+public:
+	GattServer() : _nextHandle(1) { }
+
+	ble_error_t addService(GattService& service);
+	ble_error_t write(GattAttribute::Handle_t handle, const uint8_t* value, uint16_t size);
+
+	template<typename T>
+	void onDataWritten(T* object, void (T::*member)(const GattWriteCallbackParams*)) {
+		_dataWritten.push_back(std::bind(member, object, std::placeholders::_1));
+	}
+
+	// Simulation, for the benches
+
+	/// A client writes value to the characteristic of a UUID: the write
+	/// authorization callback runs, then the value is written and the data
+	/// written callbacks run.
+	/// @return The authorization reply, or AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED
+	/// if no characteristic has that UUID.
+	GattAuthCallbackReply_t simWrite(const UUID& uuid, const uint8_t* value, uint16_t size);
+
+	/// A client reads the characteristic of a UUID: the read authorization
+	/// callback runs, then the stack's copy of the value is read.
+	/// @param value Receives the value read, if authorized.
+	/// @return The authorization reply, or AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED
+	/// if no characteristic has that UUID.
+	GattAuthCallbackReply_t simRead(const UUID& uuid, std::vector<uint8_t>& value);
+
+	/// Forget the services and callbacks.
+	void simReset();
+
+private:
+	GattAttribute::Handle_t _nextHandle;
+	std::vector<GattCharacteristic*> _characteristics;
+	std::vector<std::vector<uint8_t> > _values;     /// the stack's copy of the values
+	std::vector<std::function<void(const GattWriteCallbackParams*)> > _dataWritten;
+};
+
+class BLE {
+public:
+	struct InitializationCompleteCallbackContext {
+		BLE& ble;
+		ble_error_t error;
+	};
+
+	static BLE& Instance() {
+		static BLE instance;
+		return instance;
+	}
+
+	Gap& gap() { return _gap; }
+	GattServer& gattServer() { return _gattServer; }
+
+	ble_error_t setAddress(BLEProtocol::AddressType::Type type, const uint8_t address[6]);
+
+private:
+	BLE() { }
+
+	Gap _gap;
+	GattServer _gattServer;
+};
+
+#endif /* BENCH_STACK_BLE_BLE_H_ */
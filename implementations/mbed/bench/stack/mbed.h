@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_MBED_H_
+#define BENCH_STACK_MBED_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "SimStack.h"
+
+// Host stand-in for the part of mbed.h that EddystoneService uses, on the
+// simulated time of sim_hal::us_now().
+
+// The BLE API of bench/stack/ble is the one of mbed OS 5.10, with
+// advertising sets
+#define MBED_MAJOR_VERSION 5
+#define MBED_MINOR_VERSION 10
+#define MBED_PATCH_VERSION 0
+
+/// Timer counting simulated time.
+class Timer {
+public:
+	Timer() : _running(false), _start(0), _elapsed(0) {
+	}
+
+	void start() {
+		if (!_running) {
+			_start = sim_hal::us_now();
+			_running = true;
+		}
+	}
+
+	void stop() {
+		_elapsed = read_us_64();
+		_running = false;
+	}
+
+	void reset() {
+		_start = sim_hal::us_now();
+		_elapsed = 0;
+	}
+
+	int read_us() { return (int) read_us_64(); }
+	int read_ms() { return (int) (read_us_64() / 1000); }
+	float read() { return read_us_64() / 1000000.0f; }
+
+private:
+	uint64_t read_us_64() const {
+		return _elapsed + (_running ? sim_hal::us_now() - _start : 0);
+	}
+
+	bool _running;
+	uint64_t _start;
+	uint64_t _elapsed;
+};
+
+inline void wait_ms(int ms) {
+	sim_stack::busy((uint64_t) ms * 1000);
+}
+
+inline void error(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+#endif /* BENCH_STACK_MBED_H_ */
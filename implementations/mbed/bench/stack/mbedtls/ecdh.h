@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_MBEDTLS_ECDH_H_
+#define BENCH_STACK_MBEDTLS_ECDH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for mbedtls ECDH on Curve25519. It is not ECDH: keys and
+// shared secrets are mixes of their inputs, and every point multiplication
+// takes the simulated time of sim_stack::costs().
+
+#define MBEDTLS_ERR_ECP_BAD_INPUT_DATA -0x4F80
+
+typedef enum {
+	MBEDTLS_ECP_DP_NONE = 0,
+	MBEDTLS_ECP_DP_CURVE25519
+} mbedtls_ecp_group_id;
+
+typedef struct {
+	unsigned char p[32];
+} mbedtls_mpi;
+
+typedef struct {
+	mbedtls_ecp_group_id id;
+} mbedtls_ecp_group;
+
+typedef struct {
+	mbedtls_mpi X;
+	mbedtls_mpi Y;
+	mbedtls_mpi Z;
+} mbedtls_ecp_point;
+
+typedef struct {
+	mbedtls_ecp_group grp;
+	mbedtls_mpi d;
+	mbedtls_ecp_point Q;
+	mbedtls_ecp_point Qp;
+	mbedtls_mpi z;
+} mbedtls_ecdh_context;
+
+int mbedtls_mpi_read_binary(mbedtls_mpi* X, const unsigned char* buf, size_t buflen);
+int mbedtls_mpi_write_binary(const mbedtls_mpi* X, unsigned char* buf, size_t buflen);
+int mbedtls_mpi_lset(mbedtls_mpi* X, int z);
+int mbedtls_ecp_group_load(mbedtls_ecp_group* grp, mbedtls_ecp_group_id id);
+void mbedtls_ecdh_init(mbedtls_ecdh_context* ctx);
+void mbedtls_ecdh_free(mbedtls_ecdh_context* ctx);
+int mbedtls_ecdh_gen_public(mbedtls_ecp_group* grp, mbedtls_mpi* d, mbedtls_ecp_point* Q,
+	int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+int mbedtls_ecdh_calc_secret(mbedtls_ecdh_context* ctx, size_t* olen, unsigned char* buf, size_t blen,
+	int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+
+#endif /* BENCH_STACK_MBEDTLS_ECDH_H_ */
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_MBEDTLS_ENTROPY_H_
+#define BENCH_STACK_MBEDTLS_ENTROPY_H_
+
+#include <stddef.h>
+
+// Host stand-in for the mbedtls entropy accumulator: it polls the source
+// added to it, the simulated hardware RNG of SimStack.cpp.
+
+#define MBEDTLS_ENTROPY_SOURCE_STRONG 1
+
+typedef int (*mbedtls_entropy_f_source_ptr)(void* data, unsigned char* output, size_t len, size_t* olen);
+
+typedef struct {
+	mbedtls_entropy_f_source_ptr source;
+	void* data;
+} mbedtls_entropy_context;
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx);
+int mbedtls_entropy_add_source(mbedtls_entropy_context* ctx, mbedtls_entropy_f_source_ptr f_source, void* p_source,
+	size_t threshold, int strong);
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len);
+
+#endif /* BENCH_STACK_MBEDTLS_ENTROPY_H_ */
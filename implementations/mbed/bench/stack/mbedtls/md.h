@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BENCH_STACK_MBEDTLS_MD_H_
+#define BENCH_STACK_MBEDTLS_MD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the mbedtls HMAC-SHA256. It is not HMAC: the output is a
+// mix of the key and the data, and every HMAC takes the simulated time of
+// sim_stack::costs().
+
+typedef enum {
+	MBEDTLS_MD_NONE = 0,
+	MBEDTLS_MD_SHA256 = 6
+} mbedtls_md_type_t;
+
+typedef struct {
+	mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+typedef struct {
+	const mbedtls_md_info_t* md_info;
+	unsigned char state[32];
+} mbedtls_md_context_t;
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type);
+void mbedtls_md_init(mbedtls_md_context_t* ctx);
+void mbedtls_md_free(mbedtls_md_context_t* ctx);
+int mbedtls_md_setup(mbedtls_md_context_t* ctx, const mbedtls_md_info_t* md_info, int hmac);
+int mbedtls_md_hmac_starts(mbedtls_md_context_t* ctx, const unsigned char* key, size_t keylen);
+int mbedtls_md_hmac_update(mbedtls_md_context_t* ctx, const unsigned char* input, size_t ilen);
+int mbedtls_md_hmac_finish(mbedtls_md_context_t* ctx, unsigned char* output);
+
+#endif /* BENCH_STACK_MBEDTLS_MD_H_ */
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AdvertisingBackend.h"
+
+uint8_t AdvertisingBackend::earliestSlot(const SlotDeadlines_t& deadlines)
+{
+    uint8_t nextSlot = NO_SLOT_SCHEDULED;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        // strictly earlier, so that the lowest slot wins a tie
+        if (deadlines[slot] != SLOT_NOT_SCHEDULED &&
+            (nextSlot == NO_SLOT_SCHEDULED || deadlines[slot] < deadlines[nextSlot])) {
+            nextSlot = slot;
+        }
+    }
+    return nextSlot;
+}
+
+uint32_t AdvertisingBackend::slotTolerance(uint16_t interval)
+{
+#if EDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER
+    return interval / SLOT_INTERVAL_TOLERANCE_DIVIDER;
+#else
+    (void) interval;
+    return 0;
+#endif
+}
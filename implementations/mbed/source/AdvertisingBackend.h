@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVERTISINGBACKEND_H__
+#define __ADVERTISINGBACKEND_H__
+
+#include "ble/BLE.h"
+#include "Eddystone_config.h"
+
+/**
+ * How the frames of the beacon slots are put on air. The beacon (a
+ * SlotSource) owns the frames and their parameters; the backend decides when
+ * each frame is sent and drives the controller:
+ *
+ * - LegacyAdvertisingBackend multiplexes the slots on the single legacy
+ *   advertiser, one frame at a time.
+ * - MultiSetAdvertisingBackend runs every slot as its own advertising set of
+ *   a BLE 5 controller, with its own interval and TX power.
+ *
+ * A backend is started for a set of slots and stopped before any slot
+ * parameter changes.
+ */
+class AdvertisingBackend
+{
+public:
+    /**
+     * The slots advertised by a backend.
+     */
+    class SlotSource
+    {
+    public:
+        virtual ~SlotSource() { }
+
+        /**
+         * Time since boot, the clock of the slot deadlines.
+         *
+         * @return The time in ms.
+         */
+        virtual uint64_t getAdvertisingTimeMs(void) = 0;
+
+        /**
+         * Advertising interval of a slot.
+         *
+         * @return The interval in ms, or 0 if the slot is not advertised.
+         */
+        virtual uint16_t getSlotAdvInterval(uint8_t slot) = 0;
+
+        /**
+         * Radio TX power of a slot, in dBm.
+         */
+        virtual int8_t getSlotRadioTxPower(uint8_t slot) = 0;
+
+        /**
+         * Whether the frame of a slot changes from one frame to the next
+         * (TLM counters, EID rotation), so that its payload must be prepared
+         * again for every frame.
+         */
+        virtual bool isSlotFrameDynamic(uint8_t slot) = 0;
+
+        /**
+         * Prepare the next frame of a slot.
+         *
+         * @return The advertising payload of the frame. It stays valid until
+         *         the next call for the same slot.
+         */
+        virtual const GapAdvertisingData& prepareSlotFrame(uint8_t slot) = 0;
+
+        /**
+         * Account for advertising events sent by the backend.
+         *
+         * @param[in] count
+         *              The number of advertising events since the last call.
+         */
+        virtual void onSlotFramesAdvertised(uint32_t count) = 0;
+    };
+
+    virtual ~AdvertisingBackend() { }
+
+    /**
+     * Start advertising the slots of a source whose interval is not 0.
+     *
+     * @param[in] source
+     *              The slots to advertise. It must outlive the advertising.
+     * @param[in] connectable
+     *              Whether the frames are connectable.
+     *
+     * @return BLE_ERROR_NONE, or an error if the backend cannot advertise
+     *         the slots, in which case nothing is advertised.
+     */
+    virtual ble_error_t start(SlotSource& source, bool connectable) = 0;
+
+    /**
+     * Stop advertising and cancel the callbacks of the backend.
+     */
+    virtual void stop(void) = 0;
+
+protected:
+    static const uint8_t NO_SLOT_SCHEDULED = 0xff;
+
+    /**
+     * Deadline of a slot which is not scheduled.
+     */
+    static const uint64_t SLOT_NOT_SCHEDULED = ~(uint64_t) 0;
+
+    /**
+     * Type for the array of the deadlines of all the slots, in ms since boot
+     */
+    typedef uint64_t SlotDeadlines_t[MAX_ADV_SLOTS];
+
+    /**
+     * Earliest-deadline-first selection of a slot.
+     *
+     * @return The scheduled slot with the earliest deadline, the lowest one
+     *         on ties, or NO_SLOT_SCHEDULED if no slot is scheduled.
+     */
+    static uint8_t earliestSlot(const SlotDeadlines_t& deadlines);
+
+    /**
+     * How late a slot deadline may be met, per SLOT_INTERVAL_TOLERANCE_DIVIDER
+     * of Eddystone_config.h.
+     *
+     * @return The tolerance in ms, 0 if coalescing is off.
+     */
+    static uint32_t slotTolerance(uint16_t interval);
+};
+
+#endif  /* __ADVERTISINGBACKEND_H__ */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AesKeyCache.h"
+
+AesKeyCache::AesKeyCache() :
+    useCounter(0),
+    keyExpansions(0),
+    hits(0)
+{
+    for (int i = 0; i < AES_KEY_CACHE_ENTRIES; i++) {
+        memset(entries[i].key, 0, sizeof(entries[i].key));
+        entries[i].valid = 0;
+        entries[i].lastUsed = 0;
+        mbedtls_aes_init(&entries[i].ctx);
+    }
+}
+
+AesKeyCache::~AesKeyCache()
+{
+    clear();
+}
+
+mbedtls_aes_context* AesKeyCache::getEncryptContext(const uint8_t* key)
+{
+    return getContext(key, MBEDTLS_AES_ENCRYPT);
+}
+
+mbedtls_aes_context* AesKeyCache::getDecryptContext(const uint8_t* key)
+{
+    return getContext(key, MBEDTLS_AES_DECRYPT);
+}
+
+void AesKeyCache::encrypt(const uint8_t* key, const uint8_t* input, uint8_t* output)
+{
+    mbedtls_aes_crypt_ecb(getContext(key, MBEDTLS_AES_ENCRYPT), MBEDTLS_AES_ENCRYPT, input, output);
+}
+
+void AesKeyCache::decrypt(const uint8_t* key, const uint8_t* input, uint8_t* output)
+{
+    mbedtls_aes_crypt_ecb(getContext(key, MBEDTLS_AES_DECRYPT), MBEDTLS_AES_DECRYPT, input, output);
+}
+
+void AesKeyCache::invalidate(const uint8_t* key)
+{
+    for (int i = 0; i < AES_KEY_CACHE_ENTRIES; i++) {
+        if (entries[i].valid && memcmp(entries[i].key, key, sizeof(entries[i].key)) == 0) {
+            release(entries[i]);
+        }
+    }
+}
+
+void AesKeyCache::clear()
+{
+    for (int i = 0; i < AES_KEY_CACHE_ENTRIES; i++) {
+        release(entries[i]);
+    }
+}
+
+mbedtls_aes_context* AesKeyCache::getContext(const uint8_t* key, uint8_t mode)
+{
+    useCounter++;
+    Entry* victim = &entries[0];
+    for (int i = 0; i < AES_KEY_CACHE_ENTRIES; i++) {
+        Entry& entry = entries[i];
+        if (entry.valid) {
+            if (entry.mode == mode && memcmp(entry.key, key, sizeof(entry.key)) == 0) {
+                entry.lastUsed = useCounter;
+                hits++;
+                return &entry.ctx;
+            }
+            if (victim->valid && entry.lastUsed < victim->lastUsed) {
+                victim = &entry;
+            }
+        } else if (victim->valid) {
+            // Prefer a free entry over evicting a valid one
+            victim = &entry;
+        }
+    }
+
+    release(*victim);
+    if (mode == MBEDTLS_AES_ENCRYPT) {
+        mbedtls_aes_setkey_enc(&victim->ctx, key, 8 * sizeof(victim->key));
+    } else {
+        mbedtls_aes_setkey_dec(&victim->ctx, key, 8 * sizeof(victim->key));
+    }
+    memcpy(victim->key, key, sizeof(victim->key));
+    victim->mode = mode;
+    victim->valid = 1;
+    victim->lastUsed = useCounter;
+    keyExpansions++;
+    return &victim->ctx;
+}
+
+void AesKeyCache::release(Entry& entry)
+{
+    // mbedtls_aes_free zeroizes the key schedule
+    mbedtls_aes_free(&entry.ctx);
+    mbedtls_aes_init(&entry.ctx);
+    memset(entry.key, 0, sizeof(entry.key));
+    entry.valid = 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AESKEYCACHE_H__
+#define __AESKEYCACHE_H__
+
+#include <string.h>
+#include "EddystoneTypes.h"
+#include "mbedtls/aes.h"
+
+/**
+ * Small cache of expanded AES-128 key schedules. The beacon keeps using the
+ * same few keys (the EID Identity Key and temporary key of each slot and the
+ * unlock key), so the key expansion, which costs about as much as a block
+ * encryption, is only run the first time a key is used. Entries are looked up
+ * by key value and the least recently used one is replaced on a miss.
+ *
+ * A key must be invalidated before its storage is overwritten, so that no
+ * stale expanded copy of it is left in RAM.
+ */
+class AesKeyCache
+{
+public:
+    /**
+     * Construct an empty cache.
+     */
+    AesKeyCache();
+
+    /**
+     * Zeroize and free all cached key schedules.
+     */
+    ~AesKeyCache();
+
+    /**
+     * Get an encryption context for the given key, running the key schedule
+     * only if the key is not cached yet.
+     *
+     * @param[in] key
+     *              The 128-bit AES key.
+     *
+     * @return Pointer to the context. It stays valid until the key is
+     *         invalidated or evicted by another call to this class.
+     */
+    mbedtls_aes_context* getEncryptContext(const uint8_t* key);
+
+    /**
+     * Get a decryption context for the given key, running the key schedule
+     * only if the key is not cached yet.
+     *
+     * @param[in] key
+     *              The 128-bit AES key.
+     *
+     * @return Pointer to the context. It stays valid until the key is
+     *         invalidated or evicted by another call to this class.
+     */
+    mbedtls_aes_context* getDecryptContext(const uint8_t* key);
+
+    /**
+     * AES128 ECB Encrypts a 16-byte input array with a key, to an output array
+     *
+     * @param[in] *key
+     *              The encryption key
+     * @param[in] *input
+     *              The input array
+     * @param[in] *output
+     *              The output array (contains the encrypted data)
+     */
+    void encrypt(const uint8_t* key, const uint8_t* input, uint8_t* output);
+
+    /**
+     * AES128 ECB Decrypts a 16-byte input array with a key, to an output array
+     *
+     * @param[in] *key
+     *              The decryption key
+     * @param[in] *input
+     *              The input array
+     * @param[in] *output
+     *              The output array (containing the decrypted data)
+     */
+    void decrypt(const uint8_t* key, const uint8_t* input, uint8_t* output);
+
+    /**
+     * Drop the cached key schedules (encrypt and decrypt) of a key.
+     *
+     * @param[in] key
+     *              The 128-bit AES key that is about to be replaced.
+     */
+    void invalidate(const uint8_t* key);
+
+    /**
+     * Drop all cached key schedules.
+     */
+    void clear();
+
+    /**
+     * Number of key schedules run since construction.
+     */
+    uint32_t getKeyExpansions() const { return keyExpansions; }
+
+    /**
+     * Number of lookups served without running the key schedule.
+     */
+    uint32_t getHits() const { return hits; }
+
+private:
+    struct Entry {
+        uint8_t             key[sizeof(EidIdentityKey_t)];
+        uint8_t             mode;
+        uint8_t             valid;
+        uint32_t            lastUsed;
+        mbedtls_aes_context ctx;
+    };
+
+    /**
+     * Find or create the entry for key and mode (MBEDTLS_AES_ENCRYPT or
+     * MBEDTLS_AES_DECRYPT).
+     */
+    mbedtls_aes_context* getContext(const uint8_t* key, uint8_t mode);
+
+    /**
+     * Zeroize an entry and mark it as free.
+     */
+    void release(Entry& entry);
+
+    Entry       entries[AES_KEY_CACHE_ENTRIES];
+    uint32_t    useCounter;
+    uint32_t    keyExpansions;
+    uint32_t    hits;
+};
+
+#endif  /* __AESKEYCACHE_H__ */
@@ -19,7 +19,8 @@
 #include "EddystoneService.h"
 #include "EntropySource/EntropySource.h"
 
-EIDFrame::EIDFrame()
+EIDFrame::EIDFrame(AesKeyCache& aesKeysIn) :
+    aesKeys(aesKeysIn)
 {
     mbedtls_entropy_init(&entropy);
     // init entropy source
@@ -81,20 +82,39 @@ void EIDFrame::setAdvTxPower(uint8_t* rawFrame, int8_t advTxPower)
 }
 
 // Mote: This is only called after the rotation period is due, or on writing/creating a new eidIdentityKey
-void EIDFrame::update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp,  uint32_t timeSecs)
+void EIDFrame::update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp,  uint32_t timeSecs, EidTempKey_t* tempKeyCache)
 {  
-    // Calculate the temporary key datastructure 1
-    uint8_t ts[4]; // big endian representation of time
-    ts[0] = (timeSecs  >> 24) & 0xff;
-    ts[1] = (timeSecs >> 16) & 0xff;
+    // The temporary key only changes every 65536 seconds
+    uint16_t epoch = timeSecs >> 16;
+    uint8_t localTmpKey[16];
+    uint8_t* tmpKey = localTmpKey;
+    if (tempKeyCache != NULL) {
+        tmpKey = tempKeyCache->key;
+    }
 
-    uint8_t tmpEidDS1[16] = { 0,0,0,0,0,0,0,0,0,0,0, SALT, 0, 0, ts[0], ts[1] };
-    
-    // Perform the aes encryption to generate the final temporary key.
-    uint8_t tmpKey[16];
-    aes128Encrypt(eidIdentityKey, tmpEidDS1, tmpKey);
+    if (tempKeyCache == NULL || !tempKeyCache->valid || tempKeyCache->epoch != epoch) {
+        // Calculate the temporary key datastructure 1
+        uint8_t ts[2]; // big endian representation of the time epoch
+        ts[0] = (timeSecs  >> 24) & 0xff;
+        ts[1] = (timeSecs >> 16) & 0xff;
+
+        uint8_t tmpEidDS1[16] = { 0,0,0,0,0,0,0,0,0,0,0, SALT, 0, 0, ts[0], ts[1] };
+
+        if (tempKeyCache != NULL && tempKeyCache->valid) {
+            // Drop the expanded copy of the previous epoch's temporary key
+            aesKeys.invalidate(tempKeyCache->key);
+        }
+
+        // Perform the aes encryption to generate the final temporary key.
+        aes128Encrypt(eidIdentityKey, tmpEidDS1, tmpKey);
+        if (tempKeyCache != NULL) {
+            tempKeyCache->epoch = epoch;
+            tempKeyCache->valid = 1;
+        }
+    }
     
     // Compute the EID 
+    uint8_t ts[4]; // big endian representation of time
     uint8_t eid[16];
     uint32_t scaledTime = (timeSecs >> rotationPeriodExp) << rotationPeriodExp;
     ts[0] = (scaledTime  >> 24) & 0xff;
@@ -106,16 +126,17 @@ void EIDFrame::update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotati
     
     // copy the leading 8 bytes of the eid result (full result length = 16) into the ADV frame
     memcpy(rawFrame + 5, eid, EID_LENGTH); 
-    
+
+    if (tempKeyCache == NULL) {
+        // Nobody will reuse this temporary key, don't keep it expanded
+        aesKeys.invalidate(localTmpKey);
+    }
 }
 
 /** AES128 encrypts a 16-byte input array with a key, resulting in a 16-byte output array */
 void EIDFrame::aes128Encrypt(uint8_t key[], uint8_t input[], uint8_t output[]) {
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx); 
-    mbedtls_aes_setkey_enc(&ctx, key, 8 * sizeof(Lock_t));
-    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, input, output);
-    mbedtls_aes_free(&ctx);
+    // The key schedule is only run the first time a key is seen
+    aesKeys.encrypt(key, input, output);
 }
 
 int EIDFrame::genBeaconKeys(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t beaconPublicEcdhKey) {
@@ -141,6 +162,16 @@ int EIDFrame::genBeaconKeys(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey
 }
 
 int EIDFrame::genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t beaconPublicEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, EidIdentityKey_t eidIdentityKey) {
+  uint8_t sharedSecret[32];
+  int rc = genEcdhSharedSecret(beaconPrivateEcdhKey, serverPublicEcdhKey, sharedSecret);
+  if (rc != EID_SUCCESS) {
+      return rc;
+  }
+  deriveEidIdentityKey(sharedSecret, beaconPublicEcdhKey, serverPublicEcdhKey, eidIdentityKey);
+  return EID_SUCCESS;
+}
+
+int EIDFrame::genEcdhSharedSecret(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, uint8_t* sharedSecret) {
   int16_t ret = 0;
   uint8_t tmp[32];
   // initialize context
@@ -158,20 +189,24 @@ int EIDFrame::genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdh
 
   // ECDH point multiplication
   size_t olen; // actual size of shared secret 
-  uint8_t sharedSecret[32]; // shared ECDH secret
   memset(sharedSecret, 0, 32);
-  ret = mbedtls_ecdh_calc_secret( &ecdh_ctx, &olen, sharedSecret, sizeof(sharedSecret), NULL, NULL );
+  ret = mbedtls_ecdh_calc_secret( &ecdh_ctx, &olen, sharedSecret, 32, NULL, NULL );
+  mbedtls_ecdh_free( &ecdh_ctx );
   LOG(("size of olen= %d  ret=%x\r\n", olen, ret));
   EddystoneService::swapEndianArray(sharedSecret, tmp, 32);
   memcpy(sharedSecret, tmp, 32);
   LOG(("Shared secret=")); EddystoneService::logPrintHex(sharedSecret, 32);
-  if (olen != sizeof(sharedSecret)) {
+  if (olen != 32) {
       return EID_GENKEY_FAIL;
   }
   if (ret == MBEDTLS_ERR_ECP_BAD_INPUT_DATA) {
       return EID_RC_SS_IS_ZERO;
   }
+  return EID_SUCCESS;
+}
 
+void EIDFrame::deriveEidIdentityKey(const uint8_t* sharedSecret, PublicEcdhKey_t beaconPublicEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, EidIdentityKey_t eidIdentityKey) {
+  uint8_t tmp[32];
   // Convert the shared secret to key material using HKDF-SHA256. HKDF is used with 
   // the salt set to a concatenation of the resolver's public key and beacon's
   // public key, with a null context. 
@@ -187,7 +222,7 @@ int EIDFrame::genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdh
   mbedtls_md_init( &md_ctx );
   mbedtls_md_setup( &md_ctx, mbedtls_md_info_from_type( MBEDTLS_MD_SHA256 ), 1 );
   mbedtls_md_hmac_starts( &md_ctx, k, sizeof( k ) );
-  mbedtls_md_hmac_update( &md_ctx, sharedSecret, sizeof(sharedSecret) );
+  mbedtls_md_hmac_update( &md_ctx, sharedSecret, 32 );
   unsigned char prk[ 32 ];
   mbedtls_md_hmac_finish( &md_ctx, prk );
   mbedtls_md_hmac_starts( &md_ctx, prk, sizeof( prk ) );
@@ -201,6 +236,4 @@ int EIDFrame::genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdh
   LOG(("\r\nEIDIdentityKey=")); EddystoneService::logPrintHex(t, 32); LOG(("\r\n"));
 
   mbedtls_md_free( &md_ctx );
-  mbedtls_ecdh_free( &ecdh_ctx );
-  return EID_SUCCESS;
 }
@@ -26,6 +26,7 @@
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
 #include "aes_eax.h"
+#include "AesKeyCache.h"
 
 /**
  * Class that encapsulates data that belongs to the Eddystone-EID frame. For
@@ -44,8 +45,11 @@ public:
 
     /**
      * Construct a new instance of this class.
+     *
+     * @param[in] aesKeysIn
+     *              Cache of expanded AES keys used for the EID computation.
      */
-    EIDFrame();
+    EIDFrame(AesKeyCache& aesKeysIn);
     
     /**
      * Clear frame (internally represented by length = 0 )
@@ -162,9 +166,14 @@ public:
      *              EID rotation time as an exponent k : 2^k seconds
      * @param[in] timeSecs
      *              time in seconds
+     * @param[in,out] tempKeyCache
+     *              Optional cache of the temporary key for this slot. It is
+     *              reused while timeSecs stays in the same 65536 second epoch,
+     *              so a rotation costs a single AES operation. The caller must
+     *              clear it whenever eidIdentityKey changes.
      *
      */
-    void update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp,  uint32_t timeSecs);
+    void update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp,  uint32_t timeSecs, EidTempKey_t* tempKeyCache = NULL);
     
     /**
      * genEcdhSharedKey generates the eik value for inclusion in the EID ADV packet
@@ -179,6 +188,34 @@ public:
      *              Identity key for this beacon and server combination
      */
     int genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t beaconPublicEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, EidIdentityKey_t eidIdentityKey);
+
+    /**
+     * First step of genEcdhSharedKey: the Curve25519 point multiplication,
+     * which takes most of its time.
+     *
+     * @param[in] beaconPrivateEcdhKey
+     *              The beacon's private ECDH key, generated by genBeaconKeys()
+     * @param[in] serverPublicEcdhKey
+     *              The server's public ECDH key
+     * @param[out] sharedSecret
+     *              The 32-byte shared secret
+     */
+    int genEcdhSharedSecret(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, uint8_t* sharedSecret);
+
+    /**
+     * Second step of genEcdhSharedKey: the HKDF-SHA256 of the shared secret
+     * into the identity key.
+     *
+     * @param[in] sharedSecret
+     *              The 32-byte shared secret from genEcdhSharedSecret()
+     * @param[in] beaconPublicEcdhKey
+     *              The beacon's public ECDH key, generated by genBeaconKeys()
+     * @param[in] serverPublicEcdhKey
+     *              The server's public ECDH key
+     * @param[out] eidIdentityKey
+     *              Identity key for this beacon and server combination
+     */
+    void deriveEidIdentityKey(const uint8_t* sharedSecret, PublicEcdhKey_t beaconPublicEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, EidIdentityKey_t eidIdentityKey);
     
     /**
      *  The byte ID of an Eddystone-EID frame.
@@ -193,6 +230,11 @@ private:
     mbedtls_ecdh_context ecdh_ctx;
     mbedtls_md_context_t md_ctx;
 
+    /**
+     * Expanded identity and temporary keys
+     */
+    AesKeyCache& aesKeys;
+
     /**
      * The size (in bytes) of an Eddystone-EID frame.
      * This is the some of the Eddystone UUID(2 bytes), FrameType, AdvTxPower,
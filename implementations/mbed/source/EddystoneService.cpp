@@ -38,11 +38,17 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
     operationMode(EDDYSTONE_MODE_NONE),
     uidFrame(),
     urlFrame(),
-    tlmFrame(),
-    eidFrame(),
+    tlmFrame(aesKeyCache),
+    eidFrame(aesKeyCache),
+    eidPrepareCallbackHandle(NULL),
+    ecdhKeyExchangeHandle(NULL),
     tlmBatteryVoltageCallback(NULL),
     tlmBeaconTemperatureCallback(NULL),
-    radioManagerCallbackHandle(NULL),
+    legacyAdvBackend(bleIn, evQ),
+#ifdef ADV_MULTI_SET
+    multiSetAdvBackend(bleIn, evQ),
+#endif
+    advBackend(NULL),
     deviceName(DEFAULT_DEVICE_NAME),
     eventQueue(evQ),
     nextEidSlot(0)
@@ -83,11 +89,17 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
     operationMode(EDDYSTONE_MODE_NONE),
     uidFrame(),
     urlFrame(),
-    tlmFrame(),
-    eidFrame(),
+    tlmFrame(aesKeyCache),
+    eidFrame(aesKeyCache),
+    eidPrepareCallbackHandle(NULL),
+    ecdhKeyExchangeHandle(NULL),
     tlmBatteryVoltageCallback(NULL),
     tlmBeaconTemperatureCallback(NULL),
-    radioManagerCallbackHandle(NULL),
+    legacyAdvBackend(bleIn, evQ),
+#ifdef ADV_MULTI_SET
+    multiSetAdvBackend(bleIn, evQ),
+#endif
+    advBackend(NULL),
     deviceName(DEFAULT_DEVICE_NAME),
     eventQueue(evQ),
     nextEidSlot(0)
@@ -116,13 +128,14 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
     memcpy(unlockKey,   paramsIn.unlockKey,   sizeof(Lock_t));
     memcpy(unlockToken, paramsIn.unlockToken, sizeof(Lock_t));
     memcpy(challenge, paramsIn.challenge, sizeof(Lock_t));
-    memset(slotCallbackHandles, 0, sizeof(SlotCallbackHandles_t));
     memcpy(slotStorage, paramsIn.slotStorage, sizeof(SlotStorage_t));
     memcpy(slotFrameTypes, paramsIn.slotFrameTypes, sizeof(SlotFrameTypes_t));
     memcpy(slotEidRotationPeriodExps, paramsIn.slotEidRotationPeriodExps, sizeof(SlotEidRotationPeriodExps_t));
     memcpy(slotEidIdentityKeys, paramsIn.slotEidIdentityKeys, sizeof(SlotEidIdentityKeys_t));
     // Zero next EID slot rotation times to enforce rotation of each slot on restart
     memset(slotEidNextRotationTimes, 0, sizeof(SlotEidNextRotationTimes_t)); 
+    memset(slotEidTempKeys, 0, sizeof(SlotEidTempKeys_t));
+    memset(slotPreparedEidRotations, 0, sizeof(SlotPreparedEidRotations_t));
     remainConnectable   = paramsIn.remainConnectable;
 
     if (advConfigIntervalIn != 0) {
@@ -145,7 +158,7 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
             case EDDYSTONE_FRAME_EID:
                nextEidSlot = slot;
                eidFrame.setData(frame, slotAdvTxPowerLevels[slot], nullEid);
-               eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs());
+               eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs(), &slotEidTempKeys[slot]);
                break;
         }
     }
@@ -175,9 +188,6 @@ void EddystoneService::doFactoryReset(void)
     timeParams.timeInPriorBoots = 0;
     timeParams.timeSinceLastBoot = getTimeSinceLastBootMs() / 1000;
     nvmSaveTimeParams();
-    // Init callbacks
-    memset(slotCallbackHandles, 0, sizeof(SlotCallbackHandles_t));
-    radioManagerCallbackHandle = NULL;
     memcpy(capabilities, CAPABILITIES_DEFAULT, CAP_HDR_LEN);
     // Line above leaves powerlevels blank; Line below fills them in
     memcpy(capabilities + CAP_HDR_LEN, radioTxPowerLevels, sizeof(PowerLevels_t));
@@ -203,12 +213,17 @@ void EddystoneService::doFactoryReset(void)
     memset(challenge,        0,     sizeof(Lock_t)); // NOTE: challenge is randomized on first unlockChar read;
 
     // Generate ECDH Beacon Key Pair (Private/Public)
+    cancelEcdhKeyExchange();
     genEIDBeaconKeys();
     
     memcpy(slotEidIdentityKeys, slotDefaultEidIdentityKeys, sizeof(SlotEidIdentityKeys_t));
     uint8_t buf4[] = EDDYSTONE_DEFAULT_SLOT_EID_ROTATION_PERIOD_EXPS;
     memcpy(slotEidRotationPeriodExps, buf4, sizeof(SlotEidRotationPeriodExps_t));
     memset(slotEidNextRotationTimes, 0, sizeof(SlotEidNextRotationTimes_t));
+    memset(slotEidTempKeys, 0, sizeof(SlotEidTempKeys_t));
+    memset(slotPreparedEidRotations, 0, sizeof(SlotPreparedEidRotations_t));
+    aesKeyCache.clear();
+    tlmFrame.invalidateEaxContext();
     //  Slot Data Type Defaults
     uint8_t buf3[] = EDDYSTONE_DEFAULT_SLOT_TYPES;
     memcpy(slotFrameTypes, buf3, sizeof(SlotFrameTypes_t));
@@ -235,7 +250,7 @@ void EddystoneService::doFactoryReset(void)
             case EDDYSTONE_FRAME_EID:
                nextEidSlot = slot;
                eidFrame.setData(frame, slotAdvTxPowerLevels[slot], nullEid);
-               eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs());
+               eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs(), &slotEidTempKeys[slot]);
                break;
         }
     }
@@ -281,32 +296,32 @@ EddystoneService::EddystoneError_t EddystoneService::startEddystoneBeaconAdverti
 
     operationMode = EDDYSTONE_MODE_BEACON;
 
-    /* Configure advertisements initially at power of active slot*/
-    ble.gap().setTxPower(slotRadioTxPowerLevels[activeSlot]);
-
-    if (remainConnectable) {
-        ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED);
-    } else {
-         ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_NON_CONNECTABLE_UNDIRECTED);
+    /* The slots may have been written since the payloads and the EID
+     * rotations were last prepared */
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        invalidateAdvPayload(slot);
+        slotPreparedEidRotations[slot].valid = 0;
     }
-    ble.gap().setAdvertisingInterval(ble.gap().getMaxAdvertisingInterval());
+    scheduleEidPreparation();
 
-    /* Make sure the queue is currently empty */
-    advFrameQueue.reset();
-    /* Setup callbacks to periodically add frames to be advertised to the queue and
-     * add initial frame so that we have something to advertise on startup */
-    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
-        uint8_t* frame = slotToFrame(slot);
-        if (slotAdvIntervals[slot] && testValidFrame(frame)) {
-            advFrameQueue.push(slot);
-            slotCallbackHandles[slot] = eventQueue.post_every(
-                &EddystoneService::enqueueFrame, this, slot,
-                slotAdvIntervals[slot] /* ms */
-            );
+    /* Start advertising, with a set per slot if the controller has them */
+    advBackend = NULL;
+#ifdef ADV_MULTI_SET
+#ifdef EID_RANDOM_MAC
+    /* The sets would keep advertising while the MAC address of an EID slot
+     * rotates */
+    if (getEidSlot() == NO_EID_SLOT_SET)
+#endif
+    {
+        if (multiSetAdvBackend.start(*this, remainConnectable) == BLE_ERROR_NONE) {
+            advBackend = &multiSetAdvBackend;
         }
     }
-    /* Start advertising */
-    manageRadio();
+#endif
+    if (advBackend == NULL) {
+        advBackend = &legacyAdvBackend;
+        advBackend->start(*this, remainConnectable);
+    }
 
     return EDDYSTONE_ERROR_NONE;
 }
@@ -363,41 +378,68 @@ void EddystoneService::getEddystoneParams(EddystoneParams_t &params)
     params.remainConnectable        = remainConnectable;
 }
 
-void EddystoneService::swapAdvertisedFrame(int slot)
+uint64_t EddystoneService::getAdvertisingTimeMs(void)
+{
+    return getTimeSinceLastBootMs();
+}
+
+uint16_t EddystoneService::getSlotAdvInterval(uint8_t slot)
+{
+    return testValidFrame(slotToFrame(slot)) ? slotAdvIntervals[slot] : 0;
+}
+
+int8_t EddystoneService::getSlotRadioTxPower(uint8_t slot)
+{
+    return slotRadioTxPowerLevels[slot];
+}
+
+bool EddystoneService::isSlotFrameDynamic(uint8_t slot)
+{
+    return slotFrameTypes[slot] == EDDYSTONE_FRAME_TLM || slotFrameTypes[slot] == EDDYSTONE_FRAME_EID;
+}
+
+void EddystoneService::onSlotFramesAdvertised(uint32_t count)
+{
+    /* Increase the advertised packet count in TLM frame */
+    tlmFrame.updatePduCount(count);
+}
+
+const GapAdvertisingData& EddystoneService::prepareSlotFrame(uint8_t slot)
 {
     uint8_t* frame = slotToFrame(slot);
     uint8_t frameType = slotFrameTypes[slot];
     uint32_t timeSecs = getTimeSinceFirstBootSecs();
     switch (frameType) {
         case EDDYSTONE_FRAME_UID:
-            updateAdvertisementPacket(uidFrame.getAdvFrame(frame), uidFrame.getAdvFrameLength(frame));
+            if (slotAdvPayloadsDirty[slot]) {
+                updateAdvertisementPacket(slot, uidFrame.getAdvFrame(frame), uidFrame.getAdvFrameLength(frame));
+            }
             break;
         case EDDYSTONE_FRAME_URL:
-            updateAdvertisementPacket(urlFrame.getAdvFrame(frame), urlFrame.getAdvFrameLength(frame));
+            if (slotAdvPayloadsDirty[slot]) {
+                updateAdvertisementPacket(slot, urlFrame.getAdvFrame(frame), urlFrame.getAdvFrameLength(frame));
+            }
             break;
         case EDDYSTONE_FRAME_TLM:
+            // the TLM counters change every frame
             updateRawTLMFrame(frame);
-            updateAdvertisementPacket(tlmFrame.getAdvFrame(frame), tlmFrame.getAdvFrameLength(frame));
+            updateAdvertisementPacket(slot, tlmFrame.getAdvFrame(frame), tlmFrame.getAdvFrameLength(frame));
             break;
         case EDDYSTONE_FRAME_EID:
             // only update the frame if the rotation period is due
             if (timeSecs >= slotEidNextRotationTimes[slot]) {
-                eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], timeSecs);
-                slotEidNextRotationTimes[slot] = timeSecs + (1 << slotEidRotationPeriodExps[slot]);
-                // select a new random MAC address so the beacon is not trackable 
-                setRandomMacAddress(); 
-                // Store in NVM in case the beacon loses power
-                nvmSaveTimeParams(); 
-                LOG(("EID ROTATED: Time=%lu\r\n", timeSecs));
+                rotateEid(slot, timeSecs);
+            }
+            if (slotAdvPayloadsDirty[slot]) {
+                updateAdvertisementPacket(slot, eidFrame.getAdvFrame(frame), eidFrame.getAdvFrameLength(frame));
             }
-            updateAdvertisementPacket(eidFrame.getAdvFrame(frame), eidFrame.getAdvFrameLength(frame));
             break;
         default:
             //Some error occurred
             error("Frame to swap in does not specify a valid type");
             break;
     }
-    ble.gap().setTxPower(slotRadioTxPowerLevels[slot]);
+    return slotAdvPayloads[slot];
 }
 
 
@@ -425,59 +467,24 @@ void EddystoneService::updateRawTLMFrame(uint8_t* frame)
     }
 }
 
-void EddystoneService::updateAdvertisementPacket(const uint8_t* rawFrame, size_t rawFrameLength)
+void EddystoneService::updateAdvertisementPacket(int slot, const uint8_t* rawFrame, size_t rawFrameLength)
 {
-    ble.gap().clearAdvertisingPayload();
-    ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
-    ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, EDDYSTONE_UUID, sizeof(EDDYSTONE_UUID));
-    ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::SERVICE_DATA, rawFrame, rawFrameLength);
+    GapAdvertisingData& payload = slotAdvPayloads[slot];
+    payload.clear();
+    payload.addFlags(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
+    payload.addData(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, EDDYSTONE_UUID, sizeof(EDDYSTONE_UUID));
+    payload.addData(GapAdvertisingData::SERVICE_DATA, rawFrame, rawFrameLength);
+    slotAdvPayloadsDirty[slot] = false;
 }
 
-uint8_t* EddystoneService::slotToFrame(int slot)
+void EddystoneService::invalidateAdvPayload(uint8_t slot)
 {
-   return reinterpret_cast<uint8_t *>(&slotStorage[slot * sizeof(Slot_t)]);
+    slotAdvPayloadsDirty[slot] = true;
 }
 
-void EddystoneService::enqueueFrame(int slot)
-{
-    advFrameQueue.push(slot);
-    if (!radioManagerCallbackHandle) {
-        /* Advertising stopped and there is not callback posted in the event queue. Just
-         * execute the manager to resume advertising */
-        manageRadio();
-    }
-}
-
-void EddystoneService::manageRadio(void)
+uint8_t* EddystoneService::slotToFrame(int slot)
 {
-    uint8_t slot;
-    uint64_t  startTimeManageRadio = getTimeSinceLastBootMs();
-
-    /* Signal that there is currently no callback posted */
-    radioManagerCallbackHandle = NULL;
-
-    if (advFrameQueue.pop(slot)) {
-        /* We have something to advertise */
-        if (ble.gap().getState().advertising) {
-            ble.gap().stopAdvertising();
-        }
-        swapAdvertisedFrame(slot);
-        ble.gap().startAdvertising();
-
-        /* Increase the advertised packet count in TLM frame */
-        tlmFrame.updatePduCount();
-
-        /* Post a callback to itself to stop the advertisement or pop the next
-         * frame from the queue. However, take into account the time taken to
-         * swap in this frame. */
-        radioManagerCallbackHandle = eventQueue.post_in(
-            &EddystoneService::manageRadio, this,
-            ble.gap().getMinNonConnectableAdvertisingInterval() - (getTimeSinceLastBootMs() - startTimeManageRadio) /* ms */
-        );
-    } else if (ble.gap().getState().advertising) {
-        /* Nothing else to advertise, stop advertising and do not schedule any callbacks */
-        ble.gap().stopAdvertising();
-    }
+   return reinterpret_cast<uint8_t *>(&slotStorage[slot * sizeof(Slot_t)]);
 }
 
 void EddystoneService::startEddystoneConfigService(void)
@@ -575,17 +582,13 @@ void EddystoneService::freeConfigCharacteristics(void)
 void EddystoneService::stopEddystoneBeaconAdvertisements(void)
 {
     /* Unschedule callbacks */
-
-    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
-        if (slotCallbackHandles[slot]) {
-            eventQueue.cancel(slotCallbackHandles[slot]);
-            slotCallbackHandles[slot] = NULL;
-        }
+    if (eidPrepareCallbackHandle) {
+        eventQueue.cancel(eidPrepareCallbackHandle);
+        eidPrepareCallbackHandle = NULL;
     }
-
-    if (radioManagerCallbackHandle) {
-        eventQueue.cancel(radioManagerCallbackHandle);
-        radioManagerCallbackHandle = NULL;
+    if (advBackend) {
+        advBackend->stop();
+        advBackend = NULL;
     }
 
     /* Stop any current Advs (ES Config or Beacon) */
@@ -811,6 +814,7 @@ void EddystoneService::readBasicTestLockAuthorizationCallback(GattReadAuthCallba
 void EddystoneService::readEidIdentityAuthorizationCallback(GattReadAuthCallbackParams *authParams)
 {
     LOG(("\r\nDO READ EID IDENTITY slot=%d\r\n", activeSlot));
+    finishEcdhKeyExchange();
     aes128Encrypt(unlockKey, slotEidIdentityKeys[activeSlot], encryptedEidIdentityKey);
     int sum = 0;
     // Test if the IdentityKey is all zeros for this slot
@@ -844,6 +848,7 @@ void EddystoneService::readPublicEcdhKeyAuthorizationCallback(GattReadAuthCallba
 void EddystoneService::readDataAuthorizationCallback(GattReadAuthCallbackParams *authParams)
 {
     LOG(("\r\nDO READ ADV-DATA : slot=%d\r\n", activeSlot));
+    finishEcdhKeyExchange();
     uint8_t frameType = slotFrameTypes[activeSlot];
     uint8_t* frame = slotToFrame(activeSlot);
     uint8_t slotLength = 1;
@@ -1012,6 +1017,7 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
             memcpy(encryptedNewKey, (writeParams->data)+1, sizeof(Lock_t));
             // Decrypt the new key
             aes128Decrypt(unlockKey, encryptedNewKey, newKey);
+            aesKeyCache.invalidate(unlockKey);
             memcpy(unlockKey, newKey, sizeof(Lock_t));
         }
         ble.gattServer().write(lockStateChar->getValueHandle(), reinterpret_cast<uint8_t *>(&lockState), sizeof(uint8_t));
@@ -1049,6 +1055,10 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
         
         memcpy(writeData, (writeParams->data) + 1, writeFrameLen);
         LOG(("ADV Data Write=%d,%d\r\n", writeFrameFormat, writeFrameLen));
+        // A write supersedes the key exchange in progress for the slot
+        if (ecdhKeyExchangeHandle && ecdhKeyExchange.slot == activeSlot) {
+            cancelEcdhKeyExchange();
+        }
         switch(writeFrameFormat) {
             case UIDFrame::FRAME_TYPE_UID:
                 if (writeFrameLen == 16) {
@@ -1084,6 +1094,7 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                 if (writeFrameLen == 17) {
                     // Least secure
                     LOG(("EID Insecure branch\r\n"));
+                    invalidateEidKeys(activeSlot);
                     aes128Decrypt(unlockKey, writeData, slotEidIdentityKeys[activeSlot]);
                     slotEidRotationPeriodExps[activeSlot] = writeData[16]; // index 16 is the exponent
                     ble.gattServer().write(eidIdentityKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&writeData), sizeof(EidIdentityKey_t));
@@ -1092,18 +1103,13 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                     memcpy(serverPublicEcdhKey, writeData, 32);
                     ble.gattServer().write(publicEcdhKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&serverPublicEcdhKey), sizeof(PublicEcdhKey_t));
                     LOG(("ServerPublicEcdhKey=")); logPrintHex(serverPublicEcdhKey, 32);
-                    slotEidRotationPeriodExps[activeSlot] = writeData[32]; // index 32 is the exponent
-                    LOG(("Exponent=%i\r\n", writeData[32]));
+                    LOG(("Exponent=%i\r\n", writeData[32])); // index 32 is the exponent
                     LOG(("genBeaconKeyRC=%x\r\n", genBeaconKeyRC));
                     LOG(("BeaconPrivateEcdhKey=")); logPrintHex(privateEcdhKey, 32);
                     LOG(("BeaconPublicEcdhKey=")); logPrintHex(publicEcdhKey, 32);
-                    LOG(("genECDHShareKey\r\n"));
-                    int rc = eidFrame.genEcdhSharedKey(privateEcdhKey, publicEcdhKey, serverPublicEcdhKey, slotEidIdentityKeys[activeSlot]);
-                    LOG(("Gen Keys RC = %x\r\n", rc));
-                    LOG(("Generated eidIdentityKey=")); logPrintHex(slotEidIdentityKeys[activeSlot], 16);
-                    aes128Encrypt(unlockKey, slotEidIdentityKeys[activeSlot], encryptedEidIdentityKey);
-                    LOG(("encryptedEidIdentityKey=")); logPrintHex(encryptedEidIdentityKey, 16);      
-                    ble.gattServer().write(eidIdentityKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&encryptedEidIdentityKey), sizeof(EidIdentityKey_t));
+                    // The slot becomes an EID slot once the key exchange completes
+                    startEcdhKeyExchange(activeSlot, serverPublicEcdhKey, writeData[32]);
+                    break;
                 } else if (writeFrameLen == 0) {
                     // Reset eidFrame
                     eidFrame.clearFrame(frame);
@@ -1118,13 +1124,14 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                 // Generate EID ADV frame packet 
                 eidFrame.setData(frame, advTxPower, nullEid);
                 // Fill in the correct EID Value from the Identity Key/exp/clock
-                eidFrame.update(frame, slotEidIdentityKeys[activeSlot], slotEidRotationPeriodExps[activeSlot], getTimeSinceFirstBootSecs() );
+                eidFrame.update(frame, slotEidIdentityKeys[activeSlot], slotEidRotationPeriodExps[activeSlot], getTimeSinceFirstBootSecs(), &slotEidTempKeys[activeSlot]);
                 LOG(("END update Eid Frame\r\n"));
                 break;
             default:
                 frame[0] = 0; // Frame format unknown so clear the entire frame by writing 0 to its length
                 break;
         }
+        invalidateAdvPayload(activeSlot);
         // Read takes care of setting the Characteristic  Value
     // CHAR-11 FACTORY RESET
     } else if (handle == factoryResetChar->getValueHandle() && (*((uint8_t *)writeParams->data) != 0)) {
@@ -1154,8 +1161,11 @@ void EddystoneService::setFrameTxPower(uint8_t slot, int8_t advTxPower) {
            break;
         case EIDFrame::FRAME_TYPE_EID:
            eidFrame.setAdvTxPower(frame, advTxPower);
+           // The prepared rotation holds a copy of the frame with the old power
+           slotPreparedEidRotations[slot].valid = 0;
            break;
     }
+    invalidateAdvPayload(slot);
 }
 
 uint8_t EddystoneService::radioTxPowerToIndex(int8_t txPower) {
@@ -1172,20 +1182,23 @@ uint8_t EddystoneService::radioTxPowerToIndex(int8_t txPower) {
 
 /** AES128 encrypts a 16-byte input array with a key, resulting in a 16-byte output array */
 void EddystoneService::aes128Encrypt(uint8_t key[], uint8_t input[], uint8_t output[]) {
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx);
-    mbedtls_aes_setkey_enc(&ctx, key, 8 * sizeof(Lock_t));
-    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, input, output);
-    mbedtls_aes_free(&ctx);
+    aesKeyCache.encrypt(key, input, output);
 }
 
 /** AES128 decrypts a 16-byte input array with a key, resulting in a 16-byte output array */
 void EddystoneService::aes128Decrypt(uint8_t key[], uint8_t input[], uint8_t output[]) {
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx);
-    mbedtls_aes_setkey_dec(&ctx, key, 8 * sizeof(Lock_t));
-    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_DECRYPT, input, output);
-    mbedtls_aes_free(&ctx);
+    aesKeyCache.decrypt(key, input, output);
+}
+
+/** Drops the expanded identity and temporary keys of a slot before its identity key is replaced */
+void EddystoneService::invalidateEidKeys(uint8_t slot) {
+    aesKeyCache.invalidate(slotEidIdentityKeys[slot]);
+    tlmFrame.invalidateEaxContext();
+    if (slotEidTempKeys[slot].valid) {
+        aesKeyCache.invalidate(slotEidTempKeys[slot].key);
+        slotEidTempKeys[slot].valid = 0;
+    }
+    slotPreparedEidRotations[slot].valid = 0;
 }
 
 
@@ -1252,24 +1265,194 @@ void EddystoneService::logPrintHex(uint8_t* a, int len) {
     LOG(("\r\n"));
 }
 
-void EddystoneService::setRandomMacAddress(void) {
+void EddystoneService::generateRandomMacAddress(uint8_t* macAddress) {
 #ifdef EID_RANDOM_MAC
-    uint8_t macAddress[6]; // 48 bit Mac Address
-    generateRandom(macAddress, 6);
+    generateRandom(macAddress, 6); // 48 bit Mac Address
     macAddress[5] |= 0xc0; // Ensure upper two bits are 11's for Random Add
+#else
+    (void) macAddress;
+#endif
+}
+
+void EddystoneService::setRandomMacAddress(const uint8_t* macAddress) {
+#ifdef EID_RANDOM_MAC
+    // The address cannot change while advertising; the advertising backend restarts it
+    if (ble.gap().getState().advertising) {
+        ble.gap().stopAdvertising();
+    }
     ble.setAddress(BLEProtocol::AddressType::RANDOM_STATIC, macAddress);
+#else
+    (void) macAddress;
 #endif
 }
 
+void EddystoneService::rotateEid(uint8_t slot, uint32_t timeSecs) {
+    uint8_t* frame = slotToFrame(slot);
+    uint8_t rotationPeriodExp = slotEidRotationPeriodExps[slot];
+    PreparedEidRotation_t& prepared = slotPreparedEidRotations[slot];
+    if (prepared.valid && prepared.scaledTime == ((timeSecs >> rotationPeriodExp) << rotationPeriodExp)) {
+        // Prepared off the radio path, only copies are left
+        memcpy(frame, prepared.frame, sizeof(Slot_t));
+        // select a new random MAC address so the beacon is not trackable
+        setRandomMacAddress(prepared.macAddress);
+    } else {
+        eidFrame.update(frame, slotEidIdentityKeys[slot], rotationPeriodExp, timeSecs, &slotEidTempKeys[slot]);
+        uint8_t macAddress[6];
+        generateRandomMacAddress(macAddress);
+        setRandomMacAddress(macAddress);
+    }
+    prepared.valid = 0;
+    slotEidNextRotationTimes[slot] = timeSecs + (1 << rotationPeriodExp);
+    invalidateAdvPayload(slot);
+    // Store in NVM in case the beacon loses power, once the frame is on air
+    if (!eventQueue.post(&EddystoneService::nvmSaveTimeParams, this,
+                         event_queue_t::priority_t(event_queue_t::priority_t::HOUSEKEEPING))) {
+        nvmSaveTimeParams();
+    }
+    scheduleEidPreparation();
+    LOG(("EID ROTATED: Time=%lu\r\n", timeSecs));
+}
+
+void EddystoneService::prepareEidRotations(void) {
+    eidPrepareCallbackHandle = NULL;
+    uint32_t timeSecs = getTimeSinceFirstBootSecs();
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        PreparedEidRotation_t& prepared = slotPreparedEidRotations[slot];
+        // Twice the lead, since the callback may run up to a second early on
+        // the truncated times
+        if (slotFrameTypes[slot] != EDDYSTONE_FRAME_EID || slotAdvIntervals[slot] == 0 || prepared.valid ||
+            slotEidNextRotationTimes[slot] > timeSecs + 2 * EID_PREPARE_LEAD_SECS) {
+            continue;
+        }
+        // The EID of the period of the rotation, computed like rotateEid() would
+        uint32_t rotationTime = (slotEidNextRotationTimes[slot] > timeSecs) ? slotEidNextRotationTimes[slot] : timeSecs;
+        uint8_t rotationPeriodExp = slotEidRotationPeriodExps[slot];
+        memcpy(prepared.frame, slotToFrame(slot), sizeof(Slot_t));
+        eidFrame.update(prepared.frame, slotEidIdentityKeys[slot], rotationPeriodExp, rotationTime, &slotEidTempKeys[slot]);
+        generateRandomMacAddress(prepared.macAddress);
+        prepared.scaledTime = (rotationTime >> rotationPeriodExp) << rotationPeriodExp;
+        prepared.valid = 1;
+    }
+    scheduleEidPreparation();
+}
+
+void EddystoneService::scheduleEidPreparation(void) {
+    if (eidPrepareCallbackHandle) {
+        eventQueue.cancel(eidPrepareCallbackHandle);
+        eidPrepareCallbackHandle = NULL;
+    }
+    bool found = false;
+    uint32_t prepareTime = 0;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (slotFrameTypes[slot] != EDDYSTONE_FRAME_EID || slotAdvIntervals[slot] == 0 ||
+            slotPreparedEidRotations[slot].valid) {
+            continue;
+        }
+        uint32_t rotationTime = slotEidNextRotationTimes[slot];
+        uint32_t slotPrepareTime = (rotationTime > EID_PREPARE_LEAD_SECS) ? rotationTime - EID_PREPARE_LEAD_SECS : 0;
+        if (!found || slotPrepareTime < prepareTime) {
+            prepareTime = slotPrepareTime;
+            found = true;
+        }
+    }
+    if (!found) {
+        return;
+    }
+    uint32_t timeSecs = getTimeSinceFirstBootSecs();
+    // Half the lead of tolerance, so that it still runs ahead of the rotation
+    eidPrepareCallbackHandle = eventQueue.post_in(
+        &EddystoneService::prepareEidRotations, this,
+        (prepareTime > timeSecs) ? (prepareTime - timeSecs) * 1000 : 0 /* ms */,
+        event_queue_t::ms_tolerance_t(EID_PREPARE_LEAD_SECS * 1000 / 2),
+        event_queue_t::priority_t(event_queue_t::priority_t::HOUSEKEEPING)
+    );
+}
+
+void EddystoneService::startEcdhKeyExchange(uint8_t slot, const uint8_t* serverPublicEcdhKey, uint8_t rotationPeriodExp) {
+    cancelEcdhKeyExchange();
+    ecdhKeyExchange.slot = slot;
+    ecdhKeyExchange.rotationPeriodExp = rotationPeriodExp;
+    memcpy(ecdhKeyExchange.serverPublicEcdhKey, serverPublicEcdhKey, sizeof(PublicEcdhKey_t));
+    ecdhKeyExchange.sharedSecretComputed = false;
+    ecdhKeyExchangeHandle = eventQueue.post(&EddystoneService::computeEcdhSharedSecret, this,
+                                            event_queue_t::priority_t(event_queue_t::priority_t::HOUSEKEEPING));
+    if (!ecdhKeyExchangeHandle) {
+        computeEcdhSharedSecret();
+    }
+}
+
+void EddystoneService::computeEcdhSharedSecret(void) {
+    ecdhKeyExchangeHandle = NULL;
+    LOG(("genECDHShareKey\r\n"));
+    int rc = eidFrame.genEcdhSharedSecret(privateEcdhKey, ecdhKeyExchange.serverPublicEcdhKey, ecdhKeyExchange.sharedSecret);
+    LOG(("Gen Keys RC = %x\r\n", rc));
+    if (rc != EIDFrame::EID_SUCCESS) {
+        return;
+    }
+    ecdhKeyExchange.sharedSecretComputed = true;
+    // The key derivation in its own event, to let the events due meanwhile run
+    ecdhKeyExchangeHandle = eventQueue.post(&EddystoneService::completeEcdhKeyExchange, this,
+                                            event_queue_t::priority_t(event_queue_t::priority_t::HOUSEKEEPING));
+    if (!ecdhKeyExchangeHandle) {
+        completeEcdhKeyExchange();
+    }
+}
+
+void EddystoneService::completeEcdhKeyExchange(void) {
+    ecdhKeyExchangeHandle = NULL;
+    uint8_t slot = ecdhKeyExchange.slot;
+    invalidateEidKeys(slot);
+    eidFrame.deriveEidIdentityKey(ecdhKeyExchange.sharedSecret, publicEcdhKey, ecdhKeyExchange.serverPublicEcdhKey, slotEidIdentityKeys[slot]);
+    memset(ecdhKeyExchange.sharedSecret, 0, sizeof(ecdhKeyExchange.sharedSecret));
+    slotEidRotationPeriodExps[slot] = ecdhKeyExchange.rotationPeriodExp;
+    LOG(("Generated eidIdentityKey=")); logPrintHex(slotEidIdentityKeys[slot], 16);
+    if (slot == activeSlot) {
+        aes128Encrypt(unlockKey, slotEidIdentityKeys[slot], encryptedEidIdentityKey);
+        LOG(("encryptedEidIdentityKey=")); logPrintHex(encryptedEidIdentityKey, 16);
+        ble.gattServer().write(eidIdentityKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&encryptedEidIdentityKey), sizeof(EidIdentityKey_t));
+    }
+    // Establish the new frame type
+    slotFrameTypes[slot] = EDDYSTONE_FRAME_EID;
+    nextEidSlot = slot; // This was the last one updated
+    uint8_t* frame = slotToFrame(slot);
+    eidFrame.setData(frame, slotAdvTxPowerLevels[slot], nullEid);
+    eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs(), &slotEidTempKeys[slot]);
+    invalidateAdvPayload(slot);
+}
+
+void EddystoneService::finishEcdhKeyExchange(void) {
+    if (!ecdhKeyExchangeHandle) {
+        return;
+    }
+    eventQueue.cancel(ecdhKeyExchangeHandle);
+    ecdhKeyExchangeHandle = NULL;
+    if (!ecdhKeyExchange.sharedSecretComputed) {
+        LOG(("genECDHShareKey on read\r\n"));
+        int rc = eidFrame.genEcdhSharedSecret(privateEcdhKey, ecdhKeyExchange.serverPublicEcdhKey, ecdhKeyExchange.sharedSecret);
+        if (rc != EIDFrame::EID_SUCCESS) {
+            return;
+        }
+    }
+    completeEcdhKeyExchange();
+}
+
+void EddystoneService::cancelEcdhKeyExchange(void) {
+    if (ecdhKeyExchangeHandle) {
+        eventQueue.cancel(ecdhKeyExchangeHandle);
+        ecdhKeyExchangeHandle = NULL;
+    }
+    memset(ecdhKeyExchange.sharedSecret, 0, sizeof(ecdhKeyExchange.sharedSecret));
+}
+
 int EddystoneService::getEidSlot(void) {
     int eidSlot = NO_EID_SLOT_SET; // by default;
     for (int i = 0; i < MAX_ADV_SLOTS; i++) {
         if (slotFrameTypes[nextEidSlot] == EDDYSTONE_FRAME_EID) {
              eidSlot = nextEidSlot;
-             nextEidSlot = (nextEidSlot-1) % MAX_ADV_SLOTS;
+             nextEidSlot = (nextEidSlot + MAX_ADV_SLOTS - 1) % MAX_ADV_SLOTS;
              break;
         }
-        nextEidSlot = (nextEidSlot-1) % MAX_ADV_SLOTS; // ensure the slot numbers wrap
+        nextEidSlot = (nextEidSlot + MAX_ADV_SLOTS - 1) % MAX_ADV_SLOTS; // ensure the slot numbers wrap
     }
     return eidSlot;
 }
@@ -1302,8 +1485,13 @@ uint32_t EddystoneService::getTimeSinceFirstBootSecs(void) {
  */
 uint64_t EddystoneService::getTimeSinceLastBootMs(void) {
     static uint64_t time64bit = 0;
-    time64bit += timeSinceBootTimer.read_ms();
+    static uint32_t remainderUs = 0;
+    // Carry the sub-millisecond part of every reading over to the next one,
+    // or the clock loses up to 1 ms per call and runs slow
+    uint32_t elapsedUs = timeSinceBootTimer.read_us() + remainderUs;
     timeSinceBootTimer.reset();
+    time64bit += elapsedUs / 1000;
+    remainderUs = elapsedUs % 1000;
     return time64bit;
 }
 
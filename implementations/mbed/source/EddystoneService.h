@@ -26,6 +26,9 @@
 #include "URLFrame.h"
 #include "TLMFrame.h"
 #include "EIDFrame.h"
+#include "AesKeyCache.h"
+#include "LegacyAdvertisingBackend.h"
+#include "MultiSetAdvertisingBackend.h"
 #include <string.h>
 #include "mbedtls/aes.h"
 #include "mbedtls/entropy.h"
@@ -34,10 +37,8 @@
 
 #ifdef YOTTA_CFG_MBED_OS
     #include "mbed-drivers/mbed.h"
-    #include "mbed-drivers/CircularBuffer.h"
 #else
     #include "mbed.h"
-    #include "CircularBuffer.h"
 #endif
 
 #include "stdio.h"
@@ -49,7 +50,7 @@
  * Protocol Specification as defined in the publicly available specification at
  * https://github.com/google/eddystone/blob/master/protocol-specification.md.
  */
-class EddystoneService
+class EddystoneService : private AdvertisingBackend::SlotSource
 {
 public:
     /**
@@ -498,6 +499,12 @@ private:
     static const uint8_t REMAIN_CONNECTABLE_UNSET = 0x00;
     
     static const uint8_t CONFIG_FRAME_HDR_LEN = 4;
+
+    /**
+     * An EID rotation is prepared this many seconds before it is due, so
+     * that the frame swap at the rotation only commits it.
+     */
+    static const uint32_t EID_PREPARE_LEAD_SECS = 5;
      
     /**
      * Helper funtion that will be registered as an initialization complete
@@ -513,52 +520,69 @@ private:
     void bleInitComplete(BLE::InitializationCompleteCallbackContext* initContext);
 
     /**
-     * When in EDDYSTONE_MODE_BEACON this function is called to update the
-     * advertising payload to contain the information related to the specified
-     * FrameType.
-     *
-     * @param[in] slot
-     *              The slot to populate the advertising payload with.
+     * Time since boot, for the advertising backend.
+     */
+    virtual uint64_t getAdvertisingTimeMs(void);
+
+    /**
+     * Advertising interval of a slot, 0 if its frame is not valid.
+     */
+    virtual uint16_t getSlotAdvInterval(uint8_t slot);
+
+    /**
+     * Radio TX power of a slot.
      */
-    void swapAdvertisedFrame(int slot);
+    virtual int8_t getSlotRadioTxPower(uint8_t slot);
 
     /**
-     * Helper function that manages the BLE radio that is used to broadcast
-     * advertising packets. To advertise frames at the configured intervals
-     * the actual advertising interval of the BLE instance is set to the value
-     * returned by Gap::getMaxAdvertisingInterval() from the BLE API. When a
-     * frame needs to be advertised, the enqueueFrame() callbacks add the frame
-     * type to the advFrameQueue and post a manageRadio() callback. When the
-     * callback is executed, the frame is dequeued and advertised using the
-     * radio (by updating the advertising payload). manageRadio() also posts a
-     * callback to itself Gap::getMinNonConnectableAdvertisingInterval()
-     * milliseconds later. In this callback, manageRadio() will advertise the
-     * next frame in the queue, yet if there is none it calls
-     * Gap::stopAdvertising() and does not post any further callbacks.
+     * Whether the frame of a slot changes from one frame to the next: TLM
+     * and EID frames do.
      */
-    void manageRadio(void);
+    virtual bool isSlotFrameDynamic(uint8_t slot);
 
     /**
-     * Regular callbacks posted at the rate of slotAdvPeriod[slot] milliseconds
-     * enqueue frames to be advertised. If the
-     * frame queue is currently empty, then this function directly calls
-     * manageRadio() to broadcast the required FrameType.
+     * When in EDDYSTONE_MODE_BEACON this function is called by the
+     * advertising backend before a frame of a slot is advertised, to update
+     * the advertising payload of the slot to the information related to its
+     * FrameType. It rotates the EID of an EID slot when its rotation period
+     * is due.
      *
-     * @param[in] frameType
-     *              The FrameType to enqueue for broadcasting.
+     * @param[in] slot
+     *              The slot to populate the advertising payload with.
+     *
+     * @return The advertising payload of the slot.
+     */
+    virtual const GapAdvertisingData& prepareSlotFrame(uint8_t slot);
+
+    /**
+     * Adds the advertising events sent by the advertising backend to the
+     * PDU count of the TLM frame.
      */
-    void enqueueFrame(int slot);
+    virtual void onSlotFramesAdvertised(uint32_t count);
 
     /**
-     * Helper function that updates the advertising payload when in
-     * EDDYSTONE_MODE_BEACON to contain a new frame.
+     * Helper function that rebuilds the advertising payload of a slot, set
+     * by prepareSlotFrame() when in EDDYSTONE_MODE_BEACON, to contain a
+     * new frame.
      *
+     * @param[in] slot
+     *              The slot whose payload is rebuilt.
      * @param[in] rawFrame
      *              The raw bytes of the frame to advertise.
      * @param[in] rawFrameLength
      *              The length in bytes of the array pointed to by @p rawFrame.
      */
-    void updateAdvertisementPacket(const uint8_t* rawFrame, size_t rawFrameLength);
+    void updateAdvertisementPacket(int slot, const uint8_t* rawFrame, size_t rawFrameLength);
+
+    /**
+     * Mark the advertising payload of a slot to be rebuilt before the slot
+     * is next advertised. Must be called whenever the frame of the slot, its
+     * type or its adv TX power changes.
+     *
+     * @param[in] slot
+     *              The slot whose frame changed.
+     */
+    void invalidateAdvPayload(uint8_t slot);
 
     /**
      * Helper function that updates the information in the Eddystone-TLM frames
@@ -797,6 +821,15 @@ private:
      */
     void aes128Decrypt(uint8_t *key, uint8_t *input, uint8_t *output);
 
+    /**
+     * Drop the cached key schedules and temporary key of a slot. Must be
+     * called before the slot EID Identity Key is overwritten.
+     *
+     * @param[in] slot
+     *              The slot whose EID Identity Key is about to change
+     */
+    void invalidateEidKeys(uint8_t slot);
+
 
 
     /**
@@ -825,14 +858,94 @@ private:
     uint16_t correctAdvertisementPeriod(uint16_t beaconPeriodIn) const;
     
     /**
-     * Swaps the endianess of a 16-bit unsigned int
+     * Generates a random static MAC address, if EID_RANDOM_MAC is defined.
+     * It reseeds a DRBG from the entropy source, so it is kept off the radio
+     * path.
      *
-     * @param[in] arg
-     *              The value with the byte order to be reversed
+     * @param[out] macAddress
+     *              The 6-byte address.
+     */
+    void generateRandomMacAddress(uint8_t* macAddress);
+
+    /**
+     * Sets the random static MAC address of the beacon, if EID_RANDOM_MAC is
+     * defined, stopping advertising if it runs.
      *
-     * @return The resulting 16-bit value with byte order reversed
+     * @param[in] macAddress
+     *              The 6-byte address from generateRandomMacAddress().
      */
-    void setRandomMacAddress(void);     
+    void setRandomMacAddress(const uint8_t* macAddress);
+
+    /**
+     * Rotates the EID of a slot whose rotation is due: commits the rotation
+     * prepared by prepareEidRotations() if it is for the current rotation
+     * period, or computes it, then posts the NVM save of the time as a
+     * HOUSEKEEPING event.
+     *
+     * @param[in] slot
+     *              The EID slot.
+     * @param[in] timeSecs
+     *              The current beacon time, in seconds.
+     */
+    void rotateEid(uint8_t slot, uint32_t timeSecs);
+
+    /**
+     * Prepares, off the radio path, the EID rotations due within twice
+     * EID_PREPARE_LEAD_SECS: the frame with the EID of the next rotation
+     * period and the random MAC address to advertise it with. Runs as a
+     * HOUSEKEEPING event and posts itself again for the next rotation.
+     */
+    void prepareEidRotations(void);
+
+    /**
+     * Posts prepareEidRotations() EID_PREPARE_LEAD_SECS before the earliest
+     * EID rotation of an advertised slot which is not prepared yet.
+     */
+    void scheduleEidPreparation(void);
+
+    /**
+     * Starts the ECDH key exchange of an EID slot with a server public key
+     * written to it: the shared secret and the identity key are computed by
+     * computeEcdhSharedSecret() and completeEcdhKeyExchange(), as HOUSEKEEPING
+     * events, so the GATT write callback does not hold the event queue for
+     * the Curve25519 point multiplication. An exchange in progress is
+     * canceled. A read of the slot identity key or data before the exchange
+     * completes finishes it first, see finishEcdhKeyExchange().
+     *
+     * @param[in] slot
+     *              The slot written.
+     * @param[in] serverPublicEcdhKey
+     *              The 32-byte server public key.
+     * @param[in] rotationPeriodExp
+     *              The EID rotation period exponent written with the key.
+     */
+    void startEcdhKeyExchange(uint8_t slot, const uint8_t* serverPublicEcdhKey, uint8_t rotationPeriodExp);
+
+    /**
+     * First step of the ECDH key exchange: computes the shared secret, then
+     * posts completeEcdhKeyExchange().
+     */
+    void computeEcdhSharedSecret(void);
+
+    /**
+     * Last step of the ECDH key exchange: derives the identity key of the
+     * slot from the shared secret and sets the slot to an EID frame.
+     */
+    void completeEcdhKeyExchange(void);
+
+    /**
+     * Runs the steps left of the ECDH key exchange in progress, if any, in
+     * the calling callback. The read authorization callbacks call it, so
+     * that a client reading back the slot right after writing a server
+     * public key gets the derived identity key and EID frame, as it did
+     * when the exchange ran in the write callback.
+     */
+    void finishEcdhKeyExchange(void);
+
+    /**
+     * Cancels the ECDH key exchange in progress, if any.
+     */
+    void cancelEcdhKeyExchange(void);
     
     /**
      * Finds the first EID slot set
@@ -988,6 +1101,11 @@ private:
      */
     //SlotEidPublicEcdhKeys_t                                         slotEidPublicEcdhKeys;
 
+    /**
+     * Expanded AES keys shared by the service, the EID frame and the TLM frame
+     */
+    AesKeyCache                                                     aesKeyCache;
+
     /**
      * Instance of the UID frame.
      */
@@ -1105,6 +1223,29 @@ private:
      */
     SlotEidNextRotationTimes_t                                      slotEidNextRotationTimes;
 
+    /**
+     * EID: Cached temporary key of each slot, only recomputed once every
+     * 65536 seconds or when the slot EID Identity Key changes
+     */
+    SlotEidTempKeys_t                                               slotEidTempKeys;
+
+    /**
+     * EID: Rotation of each slot prepared ahead of its time, invalidated when
+     * the slot EID Identity Key changes or beacon advertising restarts
+     */
+    SlotPreparedEidRotations_t                                      slotPreparedEidRotations;
+
+    /**
+     * Callback handle of prepareEidRotations()
+     */
+    event_queue_t::event_handle_t                                   eidPrepareCallbackHandle;
+
+    /**
+     * EID: ECDH key exchange in progress, and the handle of its next step
+     */
+    EcdhKeyExchange_t                                               ecdhKeyExchange;
+    event_queue_t::event_handle_t                                   ecdhKeyExchangeHandle;
+
     /**
      * EID: Storage for the current slot encrypted EID Identity Key
      */
@@ -1122,9 +1263,26 @@ private:
     SlotFrameTypes_t                                                slotFrameTypes;
 
     /**
-     * Circular buffer that represents of Eddystone frames to be advertised.
+     * Type for the array of the advertising payloads of all the slots
+     */
+    typedef GapAdvertisingData SlotAdvPayloads_t[MAX_ADV_SLOTS];
+
+    /**
+     * The advertising payload (flags, service UUID and frame) of each slot,
+     * rebuilt only when the slot frame changes so that a frame swap is a
+     * single payload update
      */
-    CircularBuffer<uint8_t, MAX_ADV_SLOTS>                          advFrameQueue;
+    SlotAdvPayloads_t                                               slotAdvPayloads;
+
+    /**
+     * Type for the array of the payload states of all the slots
+     */
+    typedef bool SlotAdvPayloadsDirty_t[MAX_ADV_SLOTS];
+
+    /**
+     * Whether the payload of each slot must be rebuilt before it is advertised
+     */
+    SlotAdvPayloadsDirty_t                                          slotAdvPayloadsDirty;
 
     /**
      * The registered callback to update the Eddystone-TLM frame Battery
@@ -1139,19 +1297,22 @@ private:
     TlmUpdateCallback_t                                             tlmBeaconTemperatureCallback;
 
     /**
-     * Type for the array of callback handles for all the slot timers
+     * Advertising backend multiplexing the slots on the legacy advertiser.
      */
-    typedef event_queue_t::event_handle_t SlotCallbackHandles_t[MAX_ADV_SLOTS];
+    LegacyAdvertisingBackend                                        legacyAdvBackend;
 
+#ifdef ADV_MULTI_SET
     /**
-     * An array of all the slot timer callbacks handles
+     * Advertising backend running an advertising set per slot.
      */
-    SlotCallbackHandles_t                                           slotCallbackHandles;
+    MultiSetAdvertisingBackend                                      multiSetAdvBackend;
+#endif
 
     /**
-     * Callback handle to keep track of manageRadio() callbacks.
+     * The backend advertising the beacon slots, NULL when they are not
+     * advertised.
      */
-    event_queue_t::event_handle_t                                   radioManagerCallbackHandle;
+    AdvertisingBackend                                              *advBackend;
 
     /**
      * GattCharacteristic table used to populate the BLE ATT table in the
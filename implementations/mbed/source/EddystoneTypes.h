@@ -203,6 +203,52 @@ typedef uint32_t SlotEidNextRotationTimes_t[MAX_ADV_SLOTS];
  */
 typedef EidIdentityKey_t SlotEidIdentityKeys_t[MAX_ADV_SLOTS];
 
+/**
+ * Type representing a cached EID temporary key. The temporary key only
+ * depends on the top 16 bits of the beacon time, so it stays valid for a
+ * whole 65536 second epoch.
+ */
+typedef struct {
+    uint16_t         epoch;
+    uint8_t          valid;
+    EidIdentityKey_t key;
+} EidTempKey_t;
+
+/**
+ * Type representing the cached EID temporary keys for each slot
+ */
+typedef EidTempKey_t SlotEidTempKeys_t[MAX_ADV_SLOTS];
+
+/**
+ * Type representing an EID rotation prepared ahead of its time: the slot
+ * frame with the EID of the next rotation period, and the random MAC address
+ * to advertise it with.
+ */
+typedef struct {
+    uint32_t         scaledTime;     // beacon time of the EID, rounded down to its rotation period
+    uint8_t          valid;
+    Slot_t           frame;
+    uint8_t          macAddress[6];
+} PreparedEidRotation_t;
+
+/**
+ * Type representing the prepared EID rotations for each slot
+ */
+typedef PreparedEidRotation_t SlotPreparedEidRotations_t[MAX_ADV_SLOTS];
+
+/**
+ * Type representing an ECDH key exchange of an EID slot in progress: the
+ * server public key written to the slot and the shared secret computed from
+ * it, between the HOUSEKEEPING events that make up the exchange.
+ */
+typedef struct {
+    uint8_t          slot;
+    uint8_t          rotationPeriodExp;
+    PublicEcdhKey_t  serverPublicEcdhKey;
+    bool             sharedSecretComputed;
+    uint8_t          sharedSecret[32];
+} EcdhKeyExchange_t;
+
 /**
  * Size in bytes of UID namespace ID.
  */
@@ -80,6 +80,12 @@
  *   GEN_BEACON_KEYS_AT_INIT:  Debugging flag to help test entropy source
  *   HARDWARE_RANDOM_NUM_GENERATOR: include if the target supports a hardware RNG
  *   EID_RANDOM_MAC: include if you want to randomize the mac address for each eid rotation
+ *   ADV_PAYLOAD_UPDATE_IN_PLACE: opt-in, include if the BLE stack takes a new advertising payload while
+ *       advertising and supports radio notifications (Nordic SoftDevices): frames are swapped without restarting
+ *       advertising, which halves the calls to the stack but sends frames later (see README)
+ *   ADV_MULTI_SET: include if the BLE API has advertising sets (mbed OS 5.10 and later, newer than the one of
+ *       mbed-os.lib): on a BLE 5 controller with a set per slot, each slot is advertised by its own set, at its own
+ *       interval; needs no EID slot with EID_RANDOM_MAC
  *   INCLUDE_CONFIG_URL: Includes configuration url when in Configuration Mode
  *   DONT_REMAIN_CONNECTABLE: Debugging flag; remain connectable during beaconing for easy testing
  *   NO_4SEC_START_DELAY: Debugging flag to pause 4s before starting; allow time to connect virtual terminal
@@ -89,6 +95,8 @@
 #define GEN_BEACON_KEYS_AT_INIT
 #define HARDWARE_RANDOM_NUM_GENERATOR
 #define EID_RANDOM_MAC
+// #define ADV_PAYLOAD_UPDATE_IN_PLACE
+// #define ADV_MULTI_SET
 #define INCLUDE_CONFIG_URL
 #define DONT_REMAIN_CONNECTABLE
 #define NO_4SEC_START_DELAY
@@ -115,6 +123,11 @@
 #define EDDYSTONE_DEFAULT_MAX_ADV_SLOTS 3
 #define EDDYSTONE_DEFAULT_CONFIG_ADV_INTERVAL 1000
 #define EDDYSTONE_DEFAULT_CONFIG_ADVERTISEMENT_TIMEOUT_SECONDS 60
+#define EDDYSTONE_DEFAULT_AES_KEY_CACHE_ENTRIES 2
+// 0 (no tolerance) unless set in the macros of mbed_app.json
+#ifndef EDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER
+#define EDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER 0
+#endif
 
 #define EDDYSTONE_DEFAULT_UNLOCK_KEY { \
     0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF \
@@ -165,6 +178,25 @@
  */
 const uint8_t MAX_ADV_SLOTS = EDDYSTONE_DEFAULT_MAX_ADV_SLOTS;
 
+/**
+ * Number of expanded AES keys kept by the AesKeyCache. Each entry holds an
+ * mbedtls AES context and takes 304 bytes of RAM for the life of the beacon.
+ * The default of 2 covers one EID slot (its EID Identity Key and temporary
+ * key), for about 600 bytes on an nRF51 with 16 kB of RAM; the unlock key
+ * then evicts them while configuring. (2 * MAX_ADV_SLOTS) + 2 entries keep
+ * every key of every slot and the unlock key, about 2.4 kB with 3 slots.
+ */
+const uint8_t AES_KEY_CACHE_ENTRIES = EDDYSTONE_DEFAULT_AES_KEY_CACHE_ENTRIES;
+
+/**
+ * When not 0, the advertising backends may send a slot up to
+ * 1/SLOT_INTERVAL_TOLERANCE_DIVIDER of its interval late, so that the event
+ * queue can wake the CPU once for the backend and other events. The default
+ * of 0 sends every slot on time: coalescing saves few wakeups and delays
+ * frames by up to a quarter of their interval with a divider of 4 (see README).
+ */
+const uint16_t SLOT_INTERVAL_TOLERANCE_DIVIDER = EDDYSTONE_DEFAULT_SLOT_INTERVAL_TOLERANCE_DIVIDER;
+
 /**
  * Slot and Power and Interval Constants
  */
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include "Thunk.h"
 #include "MakeThunk.h"
+#include "EventQueueStats.h"
 
 namespace eq {
 
@@ -38,6 +39,32 @@ public:
 	/// type used for time
 	typedef std::size_t ms_time_t;
 
+	/// Slack of an event: the event may run at any time between its deadline
+	/// and its deadline plus the tolerance, which lets the queue run events
+	/// whose windows overlap with a single wakeup.
+	/// It has its own type so that overloads taking a tolerance cannot be
+	/// mistaken for the ones binding an argument.
+	struct ms_tolerance_t {
+		explicit ms_tolerance_t(ms_time_t ms = 0) : ms(ms) { }
+		ms_time_t ms;
+	};
+
+	/// Priority class of an event: among the events which are due, queues
+	/// which support classes run those of the highest class first.
+	/// Like ms_tolerance_t, it has its own type.
+	struct priority_t {
+		enum class_t {
+			RADIO = 0,              /// radio critical work, e.g. swapping the advertised frame
+			BLE_STACK = 1,          /// events of the BLE stack, and events posted without class
+			HOUSEKEEPING = 2        /// work which can wait, e.g. saving to persistent storage
+		};
+
+		static const unsigned CLASS_COUNT = 3;
+
+		explicit priority_t(class_t value = BLE_STACK) : value(value) { }
+		class_t value;
+	};
+
 	/// Construct an empty event queue
 	EventQueue() { }
 
@@ -47,11 +74,12 @@ public:
 	 * Post a callable to the event queue.
 	 * It will be executed during the next dispatch cycle.
 	 * @param f The callbable to be executed by the event queue.
+	 * @param priority The priority class of the event.
 	 * @return the handle to the event.
 	 */
 	template<typename F>
-	event_handle_t post(const F& fn) {
-		return do_post(fn);
+	event_handle_t post(const F& fn, priority_t priority = priority_t()) {
+		return do_post(fn, 0, false, 0, priority);
 	}
 
 	/**
@@ -59,67 +87,112 @@ public:
 	 * It will be executed during the next dispatch cycle.
 	 * @param f The callbable to be bound with arg0.
 	 * @param arg0 The first argument to bind to f.
+	 * @param priority The priority class of the event.
 	 * @return the handle to the event.
 	 */
 	template<typename F, typename Arg0>
-	event_handle_t post(const F& fn, const Arg0& arg0) {
-		return do_post(make_thunk(fn, arg0));
+	event_handle_t post(const F& fn, const Arg0& arg0, priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0), 0, false, 0, priority);
 	}
 
 	template<typename F, typename Arg0, typename Arg1>
-	event_handle_t post(const F& fn, const Arg0& arg0, const Arg1& arg1) {
-		return do_post(make_thunk(fn, arg0, arg1));
+	event_handle_t post(const F& fn, const Arg0& arg0, const Arg1& arg1, priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0, arg1), 0, false, 0, priority);
 	}
 
 	template<typename F, typename Arg0, typename Arg1, typename Arg2>
-	event_handle_t post(const F& fn, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2) {
-		return do_post(make_thunk(fn, arg0, arg1, arg2));
+	event_handle_t post(const F& fn, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0, arg1, arg2), 0, false, 0, priority);
 	}
 
+	/**
+	 * Post a callable to the event queue, to be executed after a delay.
+	 * Arguments given before the delay are bound to the callable.
+	 * @param ms_delay The delay, in milliseconds.
+	 * @param tolerance How late the event may run after its delay.
+	 * @param priority The priority class of the event.
+	 * @return the handle to the event.
+	 */
 	template<typename F>
-	event_handle_t post_in(const F& fn, ms_time_t ms_delay) {
-		return do_post(fn, ms_delay);
+	event_handle_t post_in(const F& fn, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(fn, ms_delay, false, tolerance.ms, priority);
 	}
 
 	template<typename F, typename Arg0>
-	event_handle_t post_in(const F& fn, const Arg0& arg0, ms_time_t ms_delay) {
-		return do_post(make_thunk(fn, arg0), ms_delay);
+	event_handle_t post_in(const F& fn, const Arg0& arg0, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0), ms_delay, false, tolerance.ms, priority);
 	}
 
 	template<typename F, typename Arg0, typename Arg1>
-	event_handle_t post_in(const F& fn, const Arg0& arg0, const Arg1& arg1, ms_time_t ms_delay) {
-		return do_post(make_thunk(fn, arg0, arg1), ms_delay);
+	event_handle_t post_in(const F& fn, const Arg0& arg0, const Arg1& arg1, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0, arg1), ms_delay, false, tolerance.ms, priority);
 	}
 
 	template<typename F, typename Arg0, typename Arg1, typename Arg2>
-	event_handle_t post_in(const F& fn, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, ms_time_t ms_delay) {
-		return do_post(make_thunk(fn, arg0, arg1, arg2), ms_delay);
+	event_handle_t post_in(const F& fn, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0, arg1, arg2), ms_delay, false, tolerance.ms, priority);
 	}
 
+	/**
+	 * Post a callable to the event queue, to be executed periodically.
+	 * Arguments given before the period are bound to the callable.
+	 * @param ms_delay The period, in milliseconds.
+	 * @param tolerance How late each occurence may run.
+	 * @param priority The priority class of the event.
+	 * @return the handle to the event.
+	 */
 	template<typename F>
-	event_handle_t post_every(const F& fn, ms_time_t ms_delay) {
-		return do_post(fn, ms_delay, true);
+	event_handle_t post_every(const F& fn, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(fn, ms_delay, true, tolerance.ms, priority);
 	}
 
 	template<typename F, typename Arg0>
-	event_handle_t post_every(const F& fn, const Arg0& arg0, ms_time_t ms_delay) {
-		return do_post(make_thunk(fn, arg0), ms_delay, true);
+	event_handle_t post_every(const F& fn, const Arg0& arg0, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0), ms_delay, true, tolerance.ms, priority);
 	}
 
 	template<typename F, typename Arg0, typename Arg1>
-	event_handle_t post_every(const F& fn, const Arg0& arg0, const Arg1& arg1, ms_time_t ms_delay) {
-		return do_post(make_thunk(fn, arg0, arg1), ms_delay, true);
+	event_handle_t post_every(const F& fn, const Arg0& arg0, const Arg1& arg1, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0, arg1), ms_delay, true, tolerance.ms, priority);
 	}
 
 	template<typename F, typename Arg0, typename Arg1, typename Arg2>
-	event_handle_t post_every(const F& fn, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, ms_time_t ms_delay) {
-		return do_post(make_thunk(fn, arg0, arg1, arg2), ms_delay, true);
+	event_handle_t post_every(const F& fn, const Arg0& arg0, const Arg1& arg1, const Arg2& arg2, ms_time_t ms_delay,
+		ms_tolerance_t tolerance = ms_tolerance_t(), priority_t priority = priority_t()) {
+		return do_post(make_thunk(fn, arg0, arg1, arg2), ms_delay, true, tolerance.ms, priority);
 	}
 
+	/**
+	 * Cancel a posted event, a one-shot event which has not run yet or a
+	 * periodic event.
+	 * Backends whose queue belongs to the dispatching thread (e.g.
+	 * EventQueueClassic) give events posted from interrupt handlers a handle
+	 * of their own, and stage the cancels made from interrupt handlers until
+	 * the next dispatch: such a cancel returns true once staged, and the
+	 * event still runs if it was already selected to run.
+	 * @param event_handle The handle returned by the post.
+	 * @return true if the event was canceled (or the cancel staged).
+	 */
 	virtual bool cancel(event_handle_t event_handle) = 0;
 
+	/**
+	 * Scheduling statistics of the queue, kept if EVENTQUEUE_STATS is 1.
+	 * @return The statistics, or NULL if the backend does not keep any.
+	 */
+	virtual const EventQueueStats* get_stats() const {
+		return NULL;
+	}
+
 private:
-	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false) = 0;
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) = 0;
 };
 
 } // namespace eq
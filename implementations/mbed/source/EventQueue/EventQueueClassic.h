@@ -17,37 +17,159 @@
 #ifndef BLE_API_SOURCE_MBEDCLASSICEVENTQUEUE_H_
 #define BLE_API_SOURCE_MBEDCLASSICEVENTQUEUE_H_
 
+#include <new>
+#include <stdint.h>
 #include <cmsis.h>
 #include "PriorityQueue.h"
-#include "Ticker.h"
-#include "Timer.h"
+#include "MpscRing.h"
+#include "TimerEvent.h"
+#include "ticker_api.h"
+#include "us_ticker_api.h"
+#if EVENTQUEUE_CLASSIC_LP_TICKER
+#include "lp_ticker_api.h"
+#endif
 #include <stdio.h>
 #include "Thunk.h"
 #include "MakeThunk.h"
 #include "EventQueue.h"
 
-#include <util/CriticalSectionLock.h>
-typedef ::mbed::util::CriticalSectionLock CriticalSection;
-
 namespace eq {
 
-template<std::size_t EventCount>
+/**
+ * Event queue for mbed classic, driven by the HAL ticker.
+ *
+ * Events are kept with their absolute deadline on a 64-bit microsecond clock
+ * that never goes back, so dispatching or canceling an event only looks at
+ * the head of the queue and never rewrites the other events. A timer event of
+ * the HAL ticker is armed for the earliest deadline; its interrupt only wakes
+ * the CPU, and dispatch() runs the events which are due.
+ *
+ * The clock and the timer event use the integer timestamps of the ticker
+ * directly: unlike mbed::Ticker and mbed::Timer, rescheduling needs no
+ * float conversion and no division, which are library calls on a Cortex-M0.
+ * The us ticker is used, or the low power ticker if
+ * EVENTQUEUE_CLASSIC_LP_TICKER is defined to 1.
+ *
+ * A periodic event is rescheduled from its previous deadline, not from the
+ * time it was dispatched, so that its period does not drift by the dispatch
+ * latency.
+ *
+ * An event posted with a tolerance may run at any time between its deadline
+ * and its deadline plus the tolerance. The timer event is armed for the
+ * earliest of these latest times, and the dispatch which follows runs every
+ * event whose deadline has passed: events whose windows overlap share a
+ * single wakeup.
+ *
+ * The queue of events belongs to the thread which dispatches, so the queue
+ * never masks interrupts to update it. Events posted from interrupt handlers
+ * go through a lock-free staging ring which dispatch() drains into the
+ * queue; if the ring is full the post fails. Their handle is a ticket, the
+ * position of the post in the ring, carried by the event once it is in the
+ * queue: canceling it from the thread drains the ring, then looks the
+ * ticket up among the pending events. Tickets are reused after 2^31 posts
+ * from interrupt handlers. cancel() called from an interrupt handler goes
+ * through a second staging ring, which dispatch() drains after the posts
+ * and before running any event; it returns true if the cancel was staged,
+ * and the event still runs if dispatch() had already selected it.
+ *
+ * Every event has a priority class. Among the events which are due,
+ * dispatch() runs those of the highest class first, then those of the same
+ * class by deadline: a radio event is not held back by a queue of stack or
+ * housekeeping events which became due before it. Events leave the heap
+ * when they become due, in deadline order, for the ready list of their
+ * class, so picking the next event only looks at the head of each list. A
+ * callback is never
+ * interrupted though, so a long housekeeping callback still delays the
+ * events which become due while it runs. dispatch() can also be given a
+ * time budget, after which it returns between two callbacks, letting the
+ * caller service anything else before dispatching the rest.
+ *
+ * An event is constructed in its node of the queue, and dispatch() calls it
+ * there: the callable is copied once when it is posted, twice when it is
+ * posted from an interrupt handler, and never when it runs. A one-shot
+ * event is detached from the queue while it runs and its node freed after;
+ * a periodic event stays in the queue, and if its callback cancels it,
+ * dispatch() erases it once the callback returns.
+ *
+ * @tparam EventCount Maximum number of pending events.
+ * @tparam StagingCount Maximum number of events posted, and of cancels,
+ * from interrupt handlers and not yet drained by dispatch(), a power of two.
+ */
+template<std::size_t EventCount, std::size_t StagingCount = 8>
 class EventQueueClassic: public EventQueue {
 
+	/// Time on the monotonic clock of the queue, in microseconds.
+	typedef uint64_t us_deadline_t;
+
+	/// Longest delay the timer event is armed for. The clock of the queue
+	/// extends the 32-bit timestamps of the ticker, which has to be read at
+	/// least every 71 minutes, and the ticker only orders timestamps less
+	/// than 2^31 us apart.
+	static const uint32_t MAX_TICKER_DELAY_US = 30UL * 60 * 1000 * 1000;
+
+	/// Largest tolerance of an event; longer tolerances are clamped to it.
+	static const ms_time_t MAX_TOLERANCE_MS = MAX_TICKER_DELAY_US / 1000;
+
+	/// Ticket of the events posted from the thread. Tickets are odd, so
+	/// that they never compare equal to the address of a node.
+	static const uint32_t NO_TICKET = 0;
+
+	/// Timer event on the HAL ticker, taking absolute timestamps.
+	class QueueTimerEvent: public mbed::TimerEvent {
+	public:
+		QueueTimerEvent(EventQueueClassic& queue) :
+			mbed::TimerEvent(ticker_data()), _queue(queue) {
+		}
+
+		/// current timestamp of the ticker, in microseconds
+		timestamp_t read() const {
+			return ticker_read(_ticker_data);
+		}
+
+		/// fire at an absolute timestamp of the ticker
+		void arm(timestamp_t timestamp) {
+			remove();
+			insert(timestamp);
+		}
+
+	private:
+		static const ticker_data_t* ticker_data() {
+#if EVENTQUEUE_CLASSIC_LP_TICKER
+			return get_lp_ticker_data();
+#else
+			return get_us_ticker_data();
+#endif
+		}
+
+		virtual void handler() {
+			_queue.on_ticker();
+		}
+
+		EventQueueClassic& _queue;
+	};
+
 	/// Describe an event.
-	/// An event is composed of a function f to execute after a a time t.
+	/// An event is composed of a function f to execute at a deadline t.
 	/// Optionnaly, the event can be periodic and in this case the function f
 	/// is executed after each period p.
 	struct Event {
 		/// construct an event
 		/// @param f The function to execute when this event occur
-		/// @param ms_remaining_time remaining time before this event occurence
+		/// @param us_deadline time at which this event occurs
 		/// @param ms_repeat_period If the event is periodic, this parameter is the
 		/// period between to occurence of this event.
-		Event(const function_t& f, ms_time_t ms_remaining_time, ms_time_t ms_repeat_period = 0) :
+		/// @param us_tolerance how long after its deadline the event may run
+		/// @param priority class of the event
+		/// @param ticket handle of an event posted from an interrupt handler,
+		/// NO_TICKET for the others
+		Event(const function_t& f, us_deadline_t us_deadline, ms_time_t ms_repeat_period = 0, uint32_t us_tolerance = 0,
+			priority_t::class_t priority = priority_t::BLE_STACK, uint32_t ticket = NO_TICKET) :
 			_f(f),
-			_ms_remaining_time(ms_remaining_time),
-			_ms_repeat_period(ms_repeat_period) {
+			_us_deadline(us_deadline),
+			_ms_repeat_period(ms_repeat_period),
+			_us_tolerance(us_tolerance),
+			_priority(priority),
+			_ticket(ticket) {
 		}
 
 		/// call the inner function within an event
@@ -61,19 +183,29 @@ class EventQueueClassic: public EventQueue {
 		}
 
 		/// comparison operator used by the priority queue.
-		/// comaprare remaining time between two events
+		/// compare the deadlines of two events
 		friend bool operator<(const Event& lhs, const Event& rhs) {
-			return lhs._ms_remaining_time < rhs._ms_remaining_time;
+			return lhs._us_deadline < rhs._us_deadline;
 		}
 
-		/// return the time remaining when this event was inserted into the priority queue.
-		ms_time_t get_ms_remaining_time() const {
-			return _ms_remaining_time;
+		/// return the time at which this event occurs.
+		us_deadline_t get_us_deadline() const {
+			return _us_deadline;
 		}
 
-		/// update the remaining time for this event
-		void set_ms_remaining_time(ms_time_t new_remaining_time) {
-			_ms_remaining_time = new_remaining_time;
+		/// update the time at which this event occurs
+		void set_us_deadline(us_deadline_t new_deadline) {
+			_us_deadline = new_deadline;
+		}
+
+		/// return the latest time at which this event can run
+		us_deadline_t get_us_latest() const {
+			return _us_deadline + _us_tolerance;
+		}
+
+		/// return how long after its deadline this event may run
+		uint32_t get_us_tolerance() const {
+			return _us_tolerance;
 		}
 
 		/// If an event is periodic, return the time between two occurence
@@ -81,10 +213,23 @@ class EventQueueClassic: public EventQueue {
 			return _ms_repeat_period;
 		}
 
+		/// return the priority class of the event
+		priority_t::class_t get_priority() const {
+			return _priority;
+		}
+
+		/// return the ticket of an event posted from an interrupt handler
+		uint32_t get_ticket() const {
+			return _ticket;
+		}
+
 	private:
 		function_t _f;
-		ms_time_t _ms_remaining_time;
+		us_deadline_t _us_deadline;
 		const ms_time_t _ms_repeat_period;
+		const uint32_t _us_tolerance;
+		const priority_t::class_t _priority;
+		const uint32_t _ticket;
 	};
 
 	/// type of the internal queue
@@ -99,151 +244,408 @@ class EventQueueClassic: public EventQueue {
 public:
 	/// Construct an empty event queue
 	EventQueueClassic() :
-		_events_queue(), _ticker(), _timer(), _timed_event_pending(false) {
+		_events_queue(), _timer_event(*this), _clock_us(0), _last_ticker_us(_timer_event.read()),
+		_staged_events(), _staged_cancels(), _ticker_deadline(0), _ticker_armed(false), _wakeup_count(0),
+		_running_periodic(NULL), _running_periodic_canceled(false), _ready_count(0), _stats(EventCount) {
+		for (unsigned priority = 0; priority < priority_t::CLASS_COUNT; ++priority) {
+			_ready_events[priority] = NULL;
+		}
 	}
 
-	virtual ~EventQueueClassic() { }
+	virtual ~EventQueueClassic() {
+		for (unsigned priority = 0; priority < priority_t::CLASS_COUNT; ++priority) {
+			while (q_node_t* node = _ready_events[priority]) {
+				_ready_events[priority] = node->next;
+				_events_queue.release(node);
+			}
+		}
+	}
 
 	virtual bool cancel(event_handle_t event_handle) {
-		CriticalSection critical_section;
-		bool success = _events_queue.erase(static_cast<q_node_t*>(event_handle));
-		if (success) {
-			// update the timers and events remaining time
-			updateTime();
+		if (in_interrupt()) {
+			return _staged_cancels.push(event_handle);
+		}
+
+		if (is_ticket(event_handle)) {
+			// the event may still be in the staging ring
+			us_deadline_t now = us_now();
+			drain_staged_events(now);
+			update_ticker(now);
 		}
-		return success;
+		return cancel_event(event_handle);
 	}
 
-	void dispatch() {
+	virtual const EventQueueStats* get_stats() const {
+		return &_stats;
+	}
+
+	/**
+	 * Run the events which are due, highest priority class first.
+	 * @param us_budget If not 0, stop running callbacks once they have run
+	 * for this long, even if events are still due. The timer event is not
+	 * rearmed then: dispatch() has to be called again before sleeping.
+	 * @return true if dispatch() stopped on its budget with events still due.
+	 */
+	bool dispatch(uint32_t us_budget = 0) {
+		us_deadline_t start = us_now();
 		while(true) {
-			function_t f;
 			// pick a task from the queue/ or leave
-			{
-				CriticalSection cs;
-				q_iterator_t event_it = _events_queue.begin();
-				if(event_it != _events_queue.end() && event_it->get_ms_remaining_time() == 0) {
-					f = event_it->get_function();
-					// if the event_it should be repeated, reschedule it
-					if (event_it->get_ms_repeat_period()) {
-						reschedule_event(event_it);
-					} else {
-						_events_queue.pop();
-					}
-				} else {
-					break;
+			us_deadline_t now = us_now();
+			drain_staged_events(now);
+			ready_due_events(now);
+			q_node_t* node = first_ready_event();
+			if (node == NULL) {
+				update_ticker(now);
+				return false;
+			}
+
+			if (us_budget && (now - start) >= us_budget) {
+				return true;
+			}
+
+			unlink_ready_event(node);
+			Event& event = node->storage.get();
+#if EVENTQUEUE_STATS
+			us_deadline_t lateness = now - event.get_us_deadline();
+#endif
+			// if the event should be repeated, reschedule it, otherwise
+			// free its node once it has run; either way it runs in its node
+			if (event.get_ms_repeat_period()) {
+				reschedule_event(node, now);
+				_running_periodic = node;
+				_running_periodic_canceled = false;
+				event();
+				_running_periodic = NULL;
+				if (_running_periodic_canceled) {
+					_events_queue.erase(node);
 				}
+			} else {
+				event();
+				_events_queue.release(node);
 			}
-			f();
+#if EVENTQUEUE_STATS
+			_stats.record_dispatch(lateness, us_now() - now);
+#endif
 		}
 	}
 
+	/// Number of times the timer event of the queue has woken up the CPU.
+	/// Comparing it over a period of time shows how many wakeups
+	/// tolerances save.
+	uint32_t get_wakeup_count() const {
+		return _wakeup_count;
+	}
+
 private:
 
-	void update_ticker(ms_time_t ms_delay) {
-		_timed_event_pending = true;
-		_ticker.detach();
-		_ticker.attach(this, &EventQueueClassic::updateTime, ((float) ms_delay / 1000));
+	/// Arguments of a post from an interrupt handler.
+	struct StagedPost {
+		const function_t* f;
+		timestamp_t posted_at;
+		ms_time_t ms_delay;
+		ms_time_t ms_tolerance;
+		bool repeat;
+		priority_t::class_t priority;
+	};
+
+	/// An event posted from an interrupt handler, waiting in the staging ring.
+	/// It is constructed in its cell from the arguments of the post.
+	struct StagedEvent {
+		StagedEvent(const StagedPost& post) :
+			f(*post.f), posted_at(post.posted_at), ms_delay(post.ms_delay),
+			ms_tolerance(post.ms_tolerance), repeat(post.repeat), priority(post.priority) {
+		}
+
+		function_t f;
+		timestamp_t posted_at;          /// ticker timestamp of the post
+		ms_time_t ms_delay;
+		ms_time_t ms_tolerance;
+		bool repeat;
+		priority_t::class_t priority;
+	};
+
+	/// true if the caller runs in an interrupt handler
+	static bool in_interrupt() {
+		return __get_IPSR() != 0;
+	}
+
+	/// Ticket of the post at a position of the staging ring.
+	static uint32_t ticket_of(uint32_t position) {
+		return (position << 1) | 1;
 	}
 
-	void update_ticker(q_node_t* ref, ms_time_t ms_delay) {
-		// look if the node inserted is the first node with a delay
+	/// true if a handle is the ticket of a post from an interrupt handler
+	/// rather than the address of a node
+	static bool is_ticket(event_handle_t event_handle) {
+		return ((uintptr_t) event_handle & 1) != 0;
+	}
+
+	/// Node of the event of a handle, or NULL if no pending event has the
+	/// ticket it holds.
+	q_node_t* find_event(event_handle_t event_handle) {
+		if (is_ticket(event_handle) == false) {
+			return static_cast<q_node_t*>(event_handle);
+		}
+
+		uint32_t ticket = (uint32_t) (uintptr_t) event_handle;
+		if (_running_periodic && _running_periodic->storage.get().get_ticket() == ticket) {
+			return _running_periodic;
+		}
 		for (q_iterator_t it = _events_queue.begin(); it != _events_queue.end(); ++it) {
-			if(it->get_ms_remaining_time()) {
-				if (it.get_node() == ref) {
-					// update the ticker to ms_delay if the first event
-					// with a delay is the one inserted
-					update_ticker(ms_delay);
+			if (it->get_ticket() == ticket) {
+				return it.get_node();
+			}
+		}
+		for (unsigned priority = 0; priority < priority_t::CLASS_COUNT; ++priority) {
+			for (q_node_t* node = _ready_events[priority]; node; node = node->next) {
+				if (node->storage.get().get_ticket() == ticket) {
+					return node;
 				}
-				break;
 			}
 		}
+		return NULL;
 	}
 
-	void update_events_remaining_time(ms_time_t elapsed_time) {
-		bool ticker_updated = false;
+	/// Cancel the event of a handle, from the thread which dispatches.
+	bool cancel_event(event_handle_t event_handle) {
+		q_node_t* node = find_event(event_handle);
+
+		// the periodic event running in place is erased when its callback
+		// returns
+		if (node != NULL && node == _running_periodic) {
+			bool canceled = !_running_periodic_canceled;
+			_running_periodic_canceled = true;
+			_stats.record_cancel(canceled);
+			return canceled;
+		}
 
-		for (q_iterator_t it = _events_queue.begin();
-		     it != _events_queue.end(); ++it) {
-			ms_time_t remaining_time = it->get_ms_remaining_time();
-			if(remaining_time) {
-				if(remaining_time <= elapsed_time) {
-					it->set_ms_remaining_time(0);
-				} else {
-					it->set_ms_remaining_time(remaining_time - elapsed_time);
-					if (!ticker_updated) {
-						update_ticker(it->get_ms_remaining_time());
-						_timer.start();
-						ticker_updated = true;
-					}
+		// if the head is canceled, the ticker may fire for nothing; dispatch
+		// then rearms it for the new head
+		bool canceled = false;
+		if (node != NULL) {
+			if (_events_queue.erase(node)) {
+				canceled = true;
+			} else if (unlink_ready_event(node)) {
+				_events_queue.release(node);
+				canceled = true;
+			}
+		}
+		_stats.record_cancel(canceled);
+		return canceled;
+	}
+
+	/// Current time of the queue clock.
+	us_deadline_t us_now() {
+		timestamp_t ticker_us = _timer_event.read();
+		_clock_us += (uint32_t) (ticker_us - _last_ticker_us);
+		_last_ticker_us = ticker_us;
+		return _clock_us;
+	}
+
+	/// Latest time at which the next dispatch has to happen: the smallest
+	/// latest time of the events. Only events whose deadline is before the
+	/// latest time of the head can lower it, so the others are skipped.
+	us_deadline_t next_wakeup(q_iterator_t head) {
+		us_deadline_t wakeup = head->get_us_latest();
+		if (head->get_us_tolerance() == 0) {
+			return wakeup;
+		}
+
+		for (q_iterator_t it = _events_queue.begin(); it != _events_queue.end(); ++it) {
+			if (it->get_us_deadline() < wakeup && it->get_us_latest() < wakeup) {
+				wakeup = it->get_us_latest();
+			}
+		}
+		return wakeup;
+	}
+
+	/// Move the events which are due from the heap to the ready list of
+	/// their class. They leave the heap in deadline order, so they are
+	/// appended, unless a staged event drained late is due before them.
+	void ready_due_events(us_deadline_t now) {
+		q_iterator_t head = _events_queue.begin();
+		while (head != _events_queue.end() && head->get_us_deadline() <= now) {
+			q_node_t* node = head.get_node();
+			_events_queue.detach(node);
+			q_node_t** link = &_ready_events[node->storage.get().get_priority()];
+			while (*link && (*link)->storage.get().get_us_deadline() <= node->storage.get().get_us_deadline()) {
+				link = &(*link)->next;
+			}
+			node->next = *link;
+			*link = node;
+			++_ready_count;
+			head = _events_queue.begin();
+		}
+	}
+
+	/// The event to run next: the head of the ready list of the highest
+	/// class, NULL if no event is due.
+	q_node_t* first_ready_event() const {
+		for (unsigned priority = 0; priority < priority_t::CLASS_COUNT; ++priority) {
+			if (_ready_events[priority]) {
+				return _ready_events[priority];
+			}
+		}
+		return NULL;
+	}
+
+	/// Take a node out of the ready list of its class. The node may be a
+	/// stale handle, so its element is not read.
+	/// @return false if the node is in no ready list.
+	bool unlink_ready_event(q_node_t* node) {
+		for (unsigned priority = 0; priority < priority_t::CLASS_COUNT; ++priority) {
+			for (q_node_t** link = &_ready_events[priority]; *link; link = &(*link)->next) {
+				if (*link == node) {
+					*link = node->next;
+					node->next = NULL;
+					--_ready_count;
+					return true;
 				}
 			}
 		}
+		return false;
 	}
 
-	void updateTime() {
-		CriticalSection critical_section;
-		ms_time_t elapsed_time = _timer.read_ms();
-		_timed_event_pending = false;
-		_timer.stop();
-		_timer.reset();
-		_ticker.detach();
-		update_events_remaining_time(elapsed_time);
+	/// Arm the timer event for the next wakeup, unless it is already armed
+	/// for it. now is the value just returned by us_now().
+	void update_ticker(us_deadline_t now) {
+		q_iterator_t head = _events_queue.begin();
+		if (head == _events_queue.end()) {
+			return;
+		}
+
+		us_deadline_t deadline = next_wakeup(head);
+		if (_ticker_armed && _ticker_deadline <= deadline) {
+			return;
+		}
+
+		uint32_t us_delay = MAX_TICKER_DELAY_US;
+		if (deadline < now + MAX_TICKER_DELAY_US) {
+			us_delay = (deadline > now) ? (uint32_t) (deadline - now) : 0;
+		}
+		_ticker_deadline = now + us_delay;
+		_ticker_armed = true;
+		_timer_event.arm(_last_ticker_us + us_delay);
 	}
 
-	void reschedule_event(q_iterator_t& event_it) {
-		ms_time_t ms_period = event_it->get_ms_repeat_period();
+	/// Ticker interrupt: waking up the CPU is enough, dispatch() runs the
+	/// events which are due and rearms the timer event.
+	void on_ticker() {
+		_ticker_armed = false;
+		++_wakeup_count;
+	}
 
-		if (_timed_event_pending ==  false) {
-			update_ticker(ms_period);
-			_timer.start();
-			event_it->set_ms_remaining_time(ms_period);
-			_events_queue.update(event_it);
-		} else {
-			int elapsed_time = _timer.read_ms();
-			event_it->set_ms_remaining_time(elapsed_time + ms_period);
-			_events_queue.update(event_it);
-			update_ticker(event_it.get_node(), ms_period);
+	/// Put a periodic event taken from its ready list back in the heap, at
+	/// its next occurence after now, keeping it in phase with its first
+	/// deadline. Occurences missed while dispatch() was not called are
+	/// skipped rather than run back to back.
+	void reschedule_event(q_node_t* node, us_deadline_t now) {
+		Event& event = node->storage.get();
+		uint64_t us_period = (uint64_t) event.get_ms_repeat_period() * 1000;
+		us_deadline_t deadline = event.get_us_deadline() + us_period;
+		if (deadline <= now) {
+			deadline += ((now - deadline) / us_period + 1) * us_period;
 		}
+		event.set_us_deadline(deadline);
+		_events_queue.insert(node);
 	}
 
-	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false) {
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) {
 		if(repeat && (ms_delay == 0)) {
 			return NULL;
 		}
 
-		Event event(fn, ms_delay, repeat ? ms_delay : 0);
+		if (ms_tolerance > MAX_TOLERANCE_MS) {
+			ms_tolerance = MAX_TOLERANCE_MS;
+		}
 
-		CriticalSection critical_section;
-		if (_events_queue.full()) {
-			return NULL;
+		if (in_interrupt()) {
+			return stage_event(fn, ms_delay, repeat, ms_tolerance, priority.value);
 		}
 
-		// there is no need to update timings if ms_delay == 0
-		if (!ms_delay) {
-			return _events_queue.push(event).get_node();
+		us_deadline_t now = us_now();
+		event_handle_t handle = push_event(
+			fn, now + (uint64_t) ms_delay * 1000, repeat ? ms_delay : 0, ms_tolerance, priority.value
+		);
+
+		// there is no need to update timings if ms_delay == 0: the event is
+		// run by the next dispatch
+		if (handle && ms_delay) {
+			update_ticker(now);
 		}
 
-		// if there is no pending timed event, just add this one and start timers
-		if (_timed_event_pending ==  false) {
-			update_ticker(ms_delay);
-			_timer.start();
-			return _events_queue.push(event).get_node();
+		return handle;
+	}
+
+	/// Push an event in the queue, return its handle or NULL if the queue is
+	/// full.
+	event_handle_t push_event(const function_t& fn, us_deadline_t deadline, ms_time_t ms_period, ms_time_t ms_tolerance,
+		priority_t::class_t priority, uint32_t ticket = NO_TICKET) {
+		q_node_t* node = _events_queue.acquire();
+		if (node == NULL) {
+			_stats.record_dropped_post();
+			return NULL;
 		}
+		new (node->storage.get_storage()) Event(fn, deadline, ms_period, ms_tolerance * 1000, priority, ticket);
+		_events_queue.insert(node);
+		_stats.record_post(_events_queue.size() + _ready_count);
+		return node;
+	}
 
-		int elapsed_time = _timer.read_ms();
+	/// Post from an interrupt handler: construct the event in the staging ring,
+	/// dispatch() moves it to the queue. The handle returned is the ticket of
+	/// the event, NULL if the ring was full.
+	event_handle_t stage_event(const function_t& fn, ms_time_t ms_delay, bool repeat, ms_time_t ms_tolerance,
+		priority_t::class_t priority) {
+		StagedPost post = { &fn, _timer_event.read(), ms_delay, ms_tolerance, repeat, priority };
+		uint32_t position;
+		if (_staged_events.push(post, &position) == false) {
+			_stats.record_dropped_interrupt_post();
+			return NULL;
+		}
+		return (event_handle_t) (uintptr_t) ticket_of(position);
+	}
 
-		// update remaining time and post the event
-		event.set_ms_remaining_time(ms_delay + elapsed_time);
-		event_handle_t handle = _events_queue.push(event).get_node();
-		update_ticker(static_cast<q_node_t*>(handle), ms_delay);
+	/// Move the events posted from interrupt handlers to the queue. Their
+	/// delay runs from the time they were posted, so that they are ordered
+	/// by their post time with the events of their class. now is the value
+	/// just returned by us_now(). Events which do not fit in the queue are
+	/// dropped. The cancels staged by interrupt handlers are applied after
+	/// the posts, which they may refer to.
+	void drain_staged_events(us_deadline_t now) {
+		while (StagedEvent* staged = _staged_events.front()) {
+			// the post may have happened after now was read
+			int32_t elapsed = (int32_t) (_last_ticker_us - staged->posted_at);
+			if (elapsed < 0) {
+				elapsed = 0;
+			}
+			us_deadline_t deadline = now - elapsed + (uint64_t) staged->ms_delay * 1000;
+			push_event(staged->f, deadline, staged->repeat ? staged->ms_delay : 0, staged->ms_tolerance,
+				staged->priority, ticket_of(_staged_events.front_position()));
+			_staged_events.pop();
+		}
 
-		return handle;
+		event_handle_t event_handle;
+		while (_staged_cancels.pop(event_handle)) {
+			cancel_event(event_handle);
+		}
 	}
 
 	priority_queue_t _events_queue;
-	mbed::Ticker _ticker;
-	mbed::Timer _timer;
-	bool _timed_event_pending;
+	QueueTimerEvent _timer_event;
+	us_deadline_t _clock_us;            /// queue clock
+	timestamp_t _last_ticker_us;        /// ticker timestamp when _clock_us was updated
+	MpscRing<StagedEvent, StagingCount> _staged_events;
+	MpscRing<event_handle_t, StagingCount> _staged_cancels;
+	us_deadline_t _ticker_deadline;     /// time the timer event is armed for, if _ticker_armed
+	volatile bool _ticker_armed;        /// cleared by the timer event interrupt
+	volatile uint32_t _wakeup_count;    /// number of timer event interrupts
+	q_node_t* _running_periodic;        /// periodic event whose callback runs, or NULL
+	bool _running_periodic_canceled;    /// _running_periodic has been canceled by its callback
+	q_node_t* _ready_events[priority_t::CLASS_COUNT];  /// due events of each class, by deadline, linked by next
+	std::size_t _ready_count;           /// number of events in the ready lists
+	EventQueueStats _stats;
 };
 
 } // namespace eq
@@ -36,9 +36,14 @@ public:
 
 private:
 
-	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false) {
+	/// minar has no priority classes, the priority is not used.
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) {
+        (void) priority;
+
         // convert ms to minar time
         minar::tick_t tick = minar::milliseconds(ms_delay);
+        minar::tick_t tolerance = minar::milliseconds(ms_tolerance);
 
         // convert thunk to minar FunctionPointerBind
         mbed::util::Event func(
@@ -52,9 +57,9 @@ private:
         }
 
         if (repeat == false) {
-            return minar::Scheduler::postCallback(func).delay(tick).tolerance(0).getHandle();
+            return minar::Scheduler::postCallback(func).delay(tick).tolerance(tolerance).getHandle();
         } else {
-            return minar::Scheduler::postCallback(func).period(tick).tolerance(0).getHandle();
+            return minar::Scheduler::postCallback(func).period(tick).tolerance(tolerance).getHandle();
         }
 	}
 
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef EVENTQUEUE_EVENTQUEUESTATS_H_
+#define EVENTQUEUE_EVENTQUEUESTATS_H_
+
+#include <stdint.h>
+#include <cstddef>
+
+/// Set to 1, for every translation unit, to keep statistics in the event
+/// queues.
+#ifndef EVENTQUEUE_STATS
+#define EVENTQUEUE_STATS 0
+#endif
+
+namespace eq {
+
+/**
+ * Scheduling statistics of an event queue: lateness of the events it
+ * dispatches (time run minus deadline), run time of their callbacks, high
+ * water mark of the queue, posts dropped because the queue was full, and
+ * cancels.
+ *
+ * Lateness and run times are counted in histograms of log2 buckets: bucket 0
+ * holds 0 us, bucket i holds [2^(i-1), 2^i) us, and the last one everything
+ * from 2^(HISTOGRAM_BUCKETS - 2) us.
+ *
+ * dump() serializes the statistics in a small little endian format, read on
+ * the host by tools/eq_stats.py.
+ *
+ * Unless EVENTQUEUE_STATS is 1, the statistics are not kept: the record
+ * functions do nothing and dump() writes nothing.
+ */
+class EventQueueStats {
+public:
+	static const unsigned HISTOGRAM_BUCKETS = 16;
+
+	/// first bytes of a dump
+	static const uint8_t DUMP_MAGIC_0 = 'E';
+	static const uint8_t DUMP_MAGIC_1 = 'Q';
+	static const uint8_t DUMP_VERSION = 1;
+
+	/// size of a dump, in bytes
+	static const std::size_t DUMP_SIZE =
+		3 +                                         // magic and version
+		4 * 2 +                                     // capacity, high water mark
+		4 * 4 +                                     // drops and cancels
+		2 * (4 + 4 + 8 + 4 * HISTOGRAM_BUCKETS);    // lateness and run time
+
+#if EVENTQUEUE_STATS
+
+	/// Histogram with the count, total and max of the values recorded.
+	struct Histogram {
+		uint32_t count;
+		uint32_t max_us;
+		uint64_t total_us;
+		uint32_t buckets[HISTOGRAM_BUCKETS];
+	};
+
+	EventQueueStats(std::size_t capacity = 0) :
+		_capacity(capacity), _high_water_mark(0), _dropped_posts(0), _dropped_interrupt_posts(0),
+		_cancels(0), _failed_cancels(0), _lateness(), _run_time() {
+	}
+
+	/// An event was dispatched lateness_us after its deadline, and its
+	/// callback ran for run_time_us.
+	void record_dispatch(uint64_t lateness_us, uint64_t run_time_us) {
+		record(_lateness, lateness_us);
+		record(_run_time, run_time_us);
+	}
+
+	/// An event was posted; the queue now holds size events.
+	void record_post(std::size_t size) {
+		if (size > _high_water_mark) {
+			_high_water_mark = size;
+		}
+	}
+
+	/// A post failed because the queue was full.
+	void record_dropped_post() {
+		++_dropped_posts;
+	}
+
+	/// A post from an interrupt handler failed because the staging area was
+	/// full. Only called from interrupt handlers.
+	void record_dropped_interrupt_post() {
+		++_dropped_interrupt_posts;
+	}
+
+	/// An event was canceled, or could not be.
+	void record_cancel(bool canceled) {
+		if (canceled) {
+			++_cancels;
+		} else {
+			++_failed_cancels;
+		}
+	}
+
+	std::size_t get_capacity() const { return _capacity; }
+	std::size_t get_high_water_mark() const { return _high_water_mark; }
+	uint32_t get_dropped_posts() const { return _dropped_posts + _dropped_interrupt_posts; }
+	uint32_t get_cancels() const { return _cancels; }
+	uint32_t get_failed_cancels() const { return _failed_cancels; }
+	const Histogram& get_lateness() const { return _lateness; }
+	const Histogram& get_run_time() const { return _run_time; }
+
+	/**
+	 * Serialize the statistics.
+	 * @param buffer Where to write the dump.
+	 * @param size Size of buffer, at least DUMP_SIZE.
+	 * @return The number of bytes written, 0 if buffer is too small.
+	 */
+	std::size_t dump(uint8_t* buffer, std::size_t size) const {
+		if (size < DUMP_SIZE) {
+			return 0;
+		}
+
+		uint8_t* out = buffer;
+		*out++ = DUMP_MAGIC_0;
+		*out++ = DUMP_MAGIC_1;
+		*out++ = DUMP_VERSION;
+		out = put(out, (uint32_t) _capacity);
+		out = put(out, (uint32_t) _high_water_mark);
+		out = put(out, _dropped_posts);
+		out = put(out, _dropped_interrupt_posts);
+		out = put(out, _cancels);
+		out = put(out, _failed_cancels);
+		out = put(out, _lateness);
+		out = put(out, _run_time);
+		return out - buffer;
+	}
+
+private:
+	static unsigned bucket(uint64_t value_us) {
+		unsigned index = 0;
+		while (value_us && index < HISTOGRAM_BUCKETS - 1) {
+			value_us >>= 1;
+			++index;
+		}
+		return index;
+	}
+
+	static void record(Histogram& histogram, uint64_t value_us) {
+		uint32_t value = (value_us > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) value_us;
+		++histogram.count;
+		histogram.total_us += value;
+		if (value > histogram.max_us) {
+			histogram.max_us = value;
+		}
+		++histogram.buckets[bucket(value)];
+	}
+
+	static uint8_t* put(uint8_t* out, uint32_t value) {
+		for (unsigned i = 0; i < 4; ++i) {
+			*out++ = (uint8_t) (value >> (8 * i));
+		}
+		return out;
+	}
+
+	static uint8_t* put(uint8_t* out, uint64_t value) {
+		out = put(out, (uint32_t) value);
+		return put(out, (uint32_t) (value >> 32));
+	}
+
+	static uint8_t* put(uint8_t* out, const Histogram& histogram) {
+		out = put(out, histogram.count);
+		out = put(out, histogram.max_us);
+		out = put(out, histogram.total_us);
+		for (unsigned i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+			out = put(out, histogram.buckets[i]);
+		}
+		return out;
+	}
+
+	std::size_t _capacity;
+	std::size_t _high_water_mark;
+	uint32_t _dropped_posts;
+	volatile uint32_t _dropped_interrupt_posts;
+	uint32_t _cancels;
+	uint32_t _failed_cancels;
+	Histogram _lateness;
+	Histogram _run_time;
+
+#else
+
+	EventQueueStats(std::size_t capacity = 0) {
+		(void) capacity;
+	}
+
+	void record_dispatch(uint64_t, uint64_t) { }
+	void record_post(std::size_t) { }
+	void record_dropped_post() { }
+	void record_dropped_interrupt_post() { }
+	void record_cancel(bool) { }
+
+	std::size_t dump(uint8_t*, std::size_t) const {
+		return 0;
+	}
+
+#endif
+};
+
+} // namespace eq
+
+#endif /* EVENTQUEUE_EVENTQUEUESTATS_H_ */
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef EVENTQUEUE_EVENTQUEUETIMINGWHEEL_H_
+#define EVENTQUEUE_EVENTQUEUETIMINGWHEEL_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include "AlignedStorage.h"
+#include "EventQueue.h"
+#include "util/SteadyClock.h"
+
+namespace eq {
+
+/**
+ * Event queue based on a hierarchical timing wheel, for hosts running many
+ * timers (e.g. gateways simulating thousands of beacons on Linux).
+ *
+ * Time is counted in milliseconds. The wheel has LEVELS levels of SLOTS
+ * slots; a slot of level L spans SLOTS^L ms. An event goes to the lowest
+ * level whose current span contains its deadline, in the slot of its
+ * deadline, and moves down a level each time the wheel reaches that slot
+ * (cascading). Events more than 2^32 ms (49 days) ahead wait in an overflow
+ * list. Every slot is an intrusive doubly linked list, so post and cancel
+ * are O(1); each event is moved at most LEVELS times before it expires.
+ * Bitmaps of the non empty slots let the wheel skip idle milliseconds.
+ *
+ * Periodic events are rescheduled from their previous deadline, like in
+ * EventQueueClassic. Events expiring in the same millisecond run in no
+ * particular order.
+ *
+ * The queue does not lock: post, cancel and dispatch must be called from the
+ * thread which dispatches.
+ *
+ * @tparam EventCount Maximum number of pending events.
+ * @tparam Clock Type with a static member function ms_now() returning the
+ * current time in ms as a uint64_t; it must never go back.
+ */
+template<std::size_t EventCount, typename Clock = SteadyClock>
+class EventQueueTimingWheel: public EventQueue {
+
+	/// Time on the clock of the queue, in milliseconds.
+	typedef uint64_t ms_deadline_t;
+
+	static const unsigned SLOT_BITS = 8;
+	static const unsigned SLOTS = 1 << SLOT_BITS;
+	static const unsigned LEVELS = 4;
+	static const unsigned BITMAP_WORDS = SLOTS / 64;
+
+	/// Lists holding the events: the wheel slots, level by level, then the
+	/// overflow list and the list of events ready to run.
+	static const unsigned OVERFLOW_LIST = LEVELS * SLOTS;
+	static const unsigned READY_LIST = OVERFLOW_LIST + 1;
+	static const unsigned LIST_COUNT = READY_LIST + 1;
+	/// list of a node which holds no event
+	static const unsigned NO_LIST = LIST_COUNT;
+	/// time of an empty wheel
+	static const ms_deadline_t NO_DEADLINE = ~ms_deadline_t(0);
+
+	/// Event and its links in the list of its slot.
+	struct Node {
+		AlignedStorage<function_t> function;	/// the callable, constructed while in use
+		ms_deadline_t deadline;					/// time at which the event occurs
+		ms_time_t period;						/// period of a periodic event, 0 otherwise
+		Node* prev;								/// previous node in the list
+		Node* next;								/// next node in the list, or free node
+		unsigned list;							/// list holding the node, NO_LIST if free
+	};
+
+public:
+	/// Construct an empty event queue
+	EventQueueTimingWheel() :
+		_nodes(), _free_nodes(NULL), _lists(), _bitmaps(), _ms_current(Clock::ms_now()), _ms_next(NO_DEADLINE),
+		_size(0), _stats(EventCount) {
+		for (std::size_t i = 0; i < EventCount; ++i) {
+			_nodes[i].next = (i + 1 < EventCount) ? &_nodes[i + 1] : NULL;
+			_nodes[i].list = NO_LIST;
+		}
+		_free_nodes = _nodes;
+	}
+
+	virtual ~EventQueueTimingWheel() {
+		for (std::size_t i = 0; i < EventCount; ++i) {
+			if (_nodes[i].list != NO_LIST) {
+				_nodes[i].function.get().~function_t();
+			}
+		}
+	}
+
+	virtual bool cancel(event_handle_t event_handle) {
+		Node* node = static_cast<Node*>(event_handle);
+		if (!contains(node)) {
+			_stats.record_cancel(false);
+			return false;
+		}
+		unlink(node);
+		release(node);
+		_stats.record_cancel(true);
+		return true;
+	}
+
+	/// Lateness and run times are only known to the millisecond of Clock.
+	virtual const EventQueueStats* get_stats() const {
+		return &_stats;
+	}
+
+	/**
+	 * Run the events which are due, periodic events included.
+	 */
+	void dispatch() {
+		ms_deadline_t now = Clock::ms_now();
+		advance(now);
+
+		while (_lists[READY_LIST]) {
+			Node* node = _lists[READY_LIST];
+			unlink(node);
+			function_t f(node->function.get());
+#if EVENTQUEUE_STATS
+			ms_deadline_t lateness = (now > node->deadline) ? now - node->deadline : 0;
+			ms_deadline_t start = Clock::ms_now();
+#endif
+			if (node->period) {
+				reschedule(node);
+			} else {
+				release(node);
+			}
+			f();
+#if EVENTQUEUE_STATS
+			_stats.record_dispatch(lateness * 1000, (Clock::ms_now() - start) * 1000);
+#endif
+		}
+	}
+
+	/**
+	 * Time until the next event is due, 0 if events are ready.
+	 * The wheel only knows the slot of its farthest events, so this can be
+	 * earlier than the event: a caller sleeping that long then calling
+	 * dispatch() wakes up early at worst.
+	 * @return The delay, or the largest ms_time_t if the queue is empty.
+	 */
+	ms_time_t ms_until_next_event() const {
+		if (_lists[READY_LIST]) {
+			return 0;
+		}
+
+		ms_deadline_t start = next_slot_start(false);
+		if (start == NO_DEADLINE) {
+			return ~ms_time_t(0);
+		}
+		ms_deadline_t now = Clock::ms_now();
+		return (start > now) ? start - now : 0;
+	}
+
+	/**
+	 * Number of pending events.
+	 */
+	std::size_t size() const {
+		return _size;
+	}
+
+	/**
+	 * Indicate if no more events can be posted.
+	 */
+	bool full() const {
+		return _free_nodes == NULL;
+	}
+
+private:
+	/// true if node is a node of this queue currently holding an event
+	bool contains(const Node* node) const {
+		return node >= _nodes && node < _nodes + EventCount && node->list != NO_LIST;
+	}
+
+	/// append a node to a list
+	void link(Node* node, unsigned list) {
+		Node* head = _lists[list];
+		if (head) {
+			node->prev = head->prev;
+			node->next = head;
+			head->prev->next = node;
+			head->prev = node;
+		} else {
+			node->prev = node;
+			node->next = node;
+			_lists[list] = node;
+			if (list < OVERFLOW_LIST) {
+				_bitmaps[list / SLOTS][(list % SLOTS) / 64] |= uint64_t(1) << (list % 64);
+			}
+		}
+		node->list = list;
+	}
+
+	/// remove a node from its list
+	void unlink(Node* node) {
+		unsigned list = node->list;
+		if (node->next == node) {
+			_lists[list] = NULL;
+			if (list < OVERFLOW_LIST) {
+				_bitmaps[list / SLOTS][(list % SLOTS) / 64] &= ~(uint64_t(1) << (list % 64));
+			}
+		} else {
+			node->prev->next = node->next;
+			node->next->prev = node->prev;
+			if (_lists[list] == node) {
+				_lists[list] = node->next;
+			}
+		}
+	}
+
+	/// destroy the event of a node out of any list and free the node
+	void release(Node* node) {
+		node->function.get().~function_t();
+		node->list = NO_LIST;
+		node->next = _free_nodes;
+		_free_nodes = node;
+		--_size;
+	}
+
+	/// put a node in the list matching its deadline
+	void schedule(Node* node) {
+		ms_deadline_t deadline = node->deadline;
+		if (deadline < _ms_current) {
+			link(node, READY_LIST);
+			return;
+		}
+
+		ms_deadline_t slot_start = ((_ms_current >> 32) + 1) << 32;
+		unsigned list = OVERFLOW_LIST;
+		for (unsigned level = 0; level < LEVELS; ++level) {
+			unsigned shift = SLOT_BITS * level;
+			if ((deadline >> (shift + SLOT_BITS)) == (_ms_current >> (shift + SLOT_BITS))) {
+				slot_start = (deadline >> shift) << shift;
+				list = level * SLOTS + ((deadline >> shift) & (SLOTS - 1));
+				break;
+			}
+		}
+		link(node, list);
+		if (slot_start < _ms_next) {
+			_ms_next = slot_start;
+		}
+	}
+
+	/// Move a periodic event to its next occurence after the current time,
+	/// keeping it in phase with its first deadline.
+	void reschedule(Node* node) {
+		ms_deadline_t now = _ms_current - 1;
+		ms_deadline_t deadline = node->deadline + node->period;
+		if (deadline <= now) {
+			deadline += ((now - deadline) / node->period + 1) * node->period;
+		}
+		node->deadline = deadline;
+		schedule(node);
+	}
+
+	/// reschedule every node of a list. The list is detached first: events
+	/// of the overflow list can go back to it.
+	void cascade(unsigned list) {
+		Node* node = _lists[list];
+		if (node == NULL) {
+			return;
+		}
+		_lists[list] = NULL;
+		if (list < OVERFLOW_LIST) {
+			_bitmaps[list / SLOTS][(list % SLOTS) / 64] &= ~(uint64_t(1) << (list % 64));
+		}
+
+		node->prev->next = NULL;
+		while (node) {
+			Node* next = node->next;
+			schedule(node);
+			node = next;
+		}
+	}
+
+	/// first non empty slot of a level at or after from, -1 if none
+	int next_slot(unsigned level, unsigned from) const {
+		for (unsigned word = from / 64; word < BITMAP_WORDS; ++word) {
+			uint64_t bits = _bitmaps[level][word];
+			if (word == from / 64) {
+				bits &= ~uint64_t(0) << (from % 64);
+			}
+			if (bits) {
+				return word * 64 + __builtin_ctzll(bits);
+			}
+		}
+		return -1;
+	}
+
+	/// Start of the earliest non empty slot, or NO_DEADLINE if the wheel is
+	/// empty. If current_done, the current slots have been expired or
+	/// cascaded; otherwise the wheel may have stopped at the start of a span,
+	/// before cascading the current slots of the upper levels.
+	ms_deadline_t next_slot_start(bool current_done) const {
+		if (!current_done && (_ms_current & (SLOTS - 1)) == 0) {
+			if ((_ms_current & 0xFFFFFFFF) == 0 && _lists[OVERFLOW_LIST]) {
+				return _ms_current;
+			}
+			for (unsigned level = 1; level < LEVELS; ++level) {
+				unsigned shift = SLOT_BITS * level;
+				if ((_ms_current & ((ms_deadline_t(1) << shift) - 1)) != 0) {
+					break;
+				}
+				if (_lists[level * SLOTS + ((_ms_current >> shift) & (SLOTS - 1))]) {
+					return _ms_current;
+				}
+			}
+		}
+
+		for (unsigned level = 0; level < LEVELS; ++level) {
+			unsigned shift = SLOT_BITS * level;
+			unsigned index = (_ms_current >> shift) & (SLOTS - 1);
+			int slot = next_slot(level, (level == 0 && !current_done) ? index : index + 1);
+			if (slot >= 0) {
+				return ((_ms_current >> shift) - index + slot) << shift;
+			}
+		}
+
+		return _lists[OVERFLOW_LIST] ? ((_ms_current >> 32) + 1) << 32 : NO_DEADLINE;
+	}
+
+	/// Move the events due at or before now to the ready list.
+	void advance(ms_deadline_t now) {
+		// nothing to expire or cascade before _ms_next
+		if (now < _ms_next) {
+			if (_ms_current <= now) {
+				_ms_current = now + 1;
+			}
+			return;
+		}
+
+		while (_ms_current <= now) {
+			unsigned index = _ms_current & (SLOTS - 1);
+			if (index == 0) {
+				// entering a new span of level 0: bring down the events of the
+				// upper levels, highest first so that they can land in the
+				// slots cascaded next
+				if ((_ms_current & 0xFFFFFFFF) == 0) {
+					cascade(OVERFLOW_LIST);
+				}
+				for (unsigned level = LEVELS - 1; level > 0; --level) {
+					unsigned shift = SLOT_BITS * level;
+					if ((_ms_current & ((ms_deadline_t(1) << shift) - 1)) == 0) {
+						cascade(level * SLOTS + ((_ms_current >> shift) & (SLOTS - 1)));
+					}
+				}
+			}
+
+			// expire the current slot
+			while (_lists[index]) {
+				Node* node = _lists[index];
+				unlink(node);
+				link(node, READY_LIST);
+			}
+
+			// skip to the next slot holding events: the slots in between are
+			// empty, at every level, so nothing is missed by not visiting them
+			ms_deadline_t next = next_slot_start(true);
+			_ms_next = next;
+			_ms_current = (next <= now) ? next : now + 1;
+		}
+	}
+
+	/// The tolerance and the priority class are not used: events run in the
+	/// millisecond of their deadline, in the order they were posted.
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) {
+		(void) ms_tolerance;
+		(void) priority;
+
+		if (repeat && (ms_delay == 0)) {
+			return NULL;
+		}
+
+		if (_free_nodes == NULL) {
+			_stats.record_dropped_post();
+			return NULL;
+		}
+
+		Node* node = _free_nodes;
+		_free_nodes = node->next;
+		++_size;
+		_stats.record_post(_size);
+
+		new (node->function.get_storage()) function_t(fn);
+		node->deadline = Clock::ms_now() + ms_delay;
+		node->period = repeat ? ms_delay : 0;
+		schedule(node);
+		return node;
+	}
+
+	Node _nodes[EventCount];                        /// nodes of the queue
+	Node* _free_nodes;                              /// entry point of the free nodes
+	Node* _lists[LIST_COUNT];                       /// head of each list
+	uint64_t _bitmaps[LEVELS][BITMAP_WORDS];        /// non empty wheel slots
+	ms_deadline_t _ms_current;                      /// next millisecond to expire
+	ms_deadline_t _ms_next;                         /// no slot holds events before this time
+	std::size_t _size;                              /// number of pending events
+	EventQueueStats _stats;
+};
+
+} // namespace eq
+
+#endif /* EVENTQUEUE_EVENTQUEUETIMINGWHEEL_H_ */
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef EVENTQUEUE_EVENTQUEUEVIRTUAL_H_
+#define EVENTQUEUE_EVENTQUEUEVIRTUAL_H_
+
+#include <stdint.h>
+#include <new>
+#include "PriorityQueue.h"
+#include "Thunk.h"
+#include "MakeThunk.h"
+#include "EventQueue.h"
+
+namespace eq {
+
+/**
+ * Event queue on a virtual clock, for simulations and tests on a host: the
+ * time only goes forward when advance_to() is called, so hours of
+ * scheduling run in as long as their callbacks take.
+ *
+ * Time is counted in milliseconds from 0, the time the queue is
+ * constructed. advance_to() moves the clock from event to event: every
+ * event runs exactly at its deadline, with now() returning that deadline, so
+ * the events its callback posts are scheduled from it. Events run in a
+ * deterministic order: by deadline, then by priority class, then in the
+ * order they were posted (or last rescheduled, for periodic events).
+ * Tolerances are not used, an event runs at its deadline.
+ *
+ * Like in EventQueueClassic, events run in their node; a periodic event is
+ * rescheduled from its previous deadline before its callback runs.
+ *
+ * The queue does not lock: post, cancel, advance_to and run_until_idle must
+ * be called from the same thread, and advance_to and run_until_idle must not
+ * be called from a callback.
+ *
+ * @tparam EventCount Maximum number of pending events.
+ */
+template<std::size_t EventCount>
+class EventQueueVirtual: public EventQueue {
+
+	/// Time on the virtual clock, in milliseconds.
+	typedef uint64_t ms_deadline_t;
+
+	/// An event, ordered by deadline then priority class.
+	struct Event {
+		Event(const function_t& f, ms_deadline_t deadline, ms_time_t period, priority_t::class_t priority) :
+			f(f), deadline(deadline), period(period), priority(priority) {
+		}
+
+		friend bool operator<(const Event& lhs, const Event& rhs) {
+			if (lhs.deadline != rhs.deadline) {
+				return lhs.deadline < rhs.deadline;
+			}
+			return lhs.priority < rhs.priority;
+		}
+
+		function_t f;
+		ms_deadline_t deadline;
+		const ms_time_t period;							/// period of a periodic event, 0 otherwise
+		const priority_t::class_t priority;
+	};
+
+	typedef PriorityQueue<Event, EventCount> priority_queue_t;
+	typedef typename priority_queue_t::iterator q_iterator_t;
+	typedef typename priority_queue_t::Node q_node_t;
+
+public:
+	/// Construct an empty event queue, at time 0.
+	EventQueueVirtual() :
+		_events_queue(), _ms_now(0), _running_periodic(NULL), _running_periodic_canceled(false),
+		_dispatched(0), _stats(EventCount) {
+	}
+
+	virtual ~EventQueueVirtual() { }
+
+	virtual bool cancel(event_handle_t event_handle) {
+		// the periodic event running in place is erased when its callback
+		// returns
+		if (event_handle == _running_periodic) {
+			bool canceled = !_running_periodic_canceled;
+			_running_periodic_canceled = true;
+			_stats.record_cancel(canceled);
+			return canceled;
+		}
+
+		bool canceled = _events_queue.erase(static_cast<q_node_t*>(event_handle));
+		_stats.record_cancel(canceled);
+		return canceled;
+	}
+
+	/// Events run at their deadline: their lateness is always 0, and so is
+	/// the run time of their callbacks on the virtual clock.
+	virtual const EventQueueStats* get_stats() const {
+		return &_stats;
+	}
+
+	/**
+	 * Current time of the virtual clock, in ms.
+	 */
+	ms_deadline_t now() const {
+		return _ms_now;
+	}
+
+	/**
+	 * Move the clock forward to ms_time, running on the way every event due
+	 * by then, including the events posted by their callbacks. If ms_time is
+	 * not after now(), only the events due at now() run.
+	 */
+	void advance_to(ms_deadline_t ms_time) {
+		while (run_next(ms_time)) {
+		}
+		if (ms_time > _ms_now) {
+			_ms_now = ms_time;
+		}
+	}
+
+	/**
+	 * Run the events due at now(), including the events posted by their
+	 * callbacks with no delay, without moving the clock.
+	 */
+	void run_until_idle() {
+		advance_to(_ms_now);
+	}
+
+	/**
+	 * Deadline of the next event.
+	 * @return false if the queue is empty.
+	 */
+	bool next_deadline(ms_deadline_t& deadline) {
+		q_iterator_t head = _events_queue.begin();
+		if (head == _events_queue.end()) {
+			return false;
+		}
+		deadline = head->deadline;
+		return true;
+	}
+
+	/**
+	 * Number of callbacks run since the queue was constructed.
+	 */
+	uint64_t get_dispatch_count() const {
+		return _dispatched;
+	}
+
+	/**
+	 * Number of pending events.
+	 */
+	std::size_t size() const {
+		return _events_queue.size();
+	}
+
+private:
+	/// Run the next event if it is due by limit, moving the clock to its
+	/// deadline.
+	/// @return false if no event is due by limit.
+	bool run_next(ms_deadline_t limit) {
+		q_iterator_t event_it = _events_queue.begin();
+		if (event_it == _events_queue.end() || event_it->deadline > limit) {
+			return false;
+		}
+
+		q_node_t* node = event_it.get_node();
+		Event& event = node->storage.get();
+		if (event.deadline > _ms_now) {
+			_ms_now = event.deadline;
+		}
+
+		++_dispatched;
+		_stats.record_dispatch(0, 0);
+		if (event.period) {
+			event.deadline += event.period;
+			_events_queue.update(event_it);
+			_running_periodic = node;
+			_running_periodic_canceled = false;
+			event.f();
+			_running_periodic = NULL;
+			if (_running_periodic_canceled) {
+				_events_queue.erase(node);
+			}
+		} else {
+			_events_queue.detach(node);
+			event.f();
+			_events_queue.release(node);
+		}
+		return true;
+	}
+
+	virtual event_handle_t do_post(const function_t& fn, ms_time_t ms_delay = 0, bool repeat = false,
+		ms_time_t ms_tolerance = 0, priority_t priority = priority_t()) {
+		(void) ms_tolerance;
+
+		if (repeat && (ms_delay == 0)) {
+			return NULL;
+		}
+
+		q_node_t* node = _events_queue.acquire();
+		if (node == NULL) {
+			_stats.record_dropped_post();
+			return NULL;
+		}
+		new (node->storage.get_storage()) Event(fn, _ms_now + ms_delay, repeat ? ms_delay : 0, priority.value);
+		_events_queue.insert(node);
+		_stats.record_post(_events_queue.size());
+		return node;
+	}
+
+	priority_queue_t _events_queue;
+	ms_deadline_t _ms_now;              /// virtual clock
+	q_node_t* _running_periodic;        /// periodic event whose callback runs, or NULL
+	bool _running_periodic_canceled;    /// _running_periodic has been canceled by its callback
+	uint64_t _dispatched;
+	EventQueueStats _stats;
+};
+
+} // namespace eq
+
+#endif /* EVENTQUEUE_EVENTQUEUEVIRTUAL_H_ */
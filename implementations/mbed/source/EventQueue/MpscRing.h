@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef EVENTQUEUE_MPSCRING_H_
+#define EVENTQUEUE_MPSCRING_H_
+
+#include <stdint.h>
+#include <new>
+#include <cmsis.h>
+#include "AlignedStorage.h"
+#include <util/CriticalSectionLock.h>
+
+namespace eq {
+
+/**
+ * Bounded lock-free ring with many producers and a single consumer.
+ *
+ * Interrupt handlers push into it, whatever their priority, and the thread
+ * which dispatches pops from it. Every cell carries a sequence number
+ * telling whether it is free for the producer of a position or holds the
+ * element of that position for the consumer: a producer only has to reserve
+ * its position with a compare and swap, then it copies its element and
+ * publishes the cell without blocking anyone.
+ *
+ * On ARMv7-M the compare and swap uses LDREX/STREX. ARMv6-M (Cortex-M0) has
+ * no exclusive accesses, the compare and swap masks interrupts for its load,
+ * compare and store.
+ *
+ * @tparam T Type of the elements, copy constructible and assignable.
+ * @tparam Capacity Number of cells, a power of two.
+ */
+template<typename T, std::size_t Capacity>
+class MpscRing {
+
+	/// Fails to compile if Capacity is not a power of two: positions wrap
+	/// around at 2^32, which has to be a multiple of Capacity.
+	typedef char capacity_is_a_power_of_two[(Capacity && (Capacity & (Capacity - 1)) == 0) ? 1 : -1];
+
+	/// Cell of the ring.
+	struct Cell {
+		AlignedStorage<T> storage;			/// element of the cell
+		volatile uint32_t sequence;			/// position the cell is ready for
+	};
+
+public:
+	/// Construct an empty ring.
+	MpscRing() : _cells(), _tail(0), _head(0) {
+		for (uint32_t i = 0; i < Capacity; ++i) {
+			_cells[i].sequence = i;
+		}
+	}
+
+	~MpscRing() {
+		for (uint32_t position = _head; is_ready(position); ++position) {
+			_cells[position & (Capacity - 1)].storage.get().~T();
+		}
+	}
+
+	/**
+	 * Construct an element from source at the end of the ring, in its cell:
+	 * source can be the element to copy, or anything T can be constructed
+	 * from. Safe to call from interrupt handlers, and from several of them
+	 * at once.
+	 * @param position_out If not NULL, set to the position of the element in
+	 * the ring, which front_position() returns when it is first.
+	 * @return false if the ring is full.
+	 */
+	template<typename U>
+	bool push(const U& source, uint32_t* position_out = NULL) {
+		uint32_t position = _tail;
+		Cell* cell;
+		while (true) {
+			cell = &_cells[position & (Capacity - 1)];
+			int32_t distance = (int32_t) (cell->sequence - position);
+			if (distance == 0) {
+				if (compare_and_swap(&_tail, position, position + 1)) {
+					break;
+				}
+			} else if (distance < 0) {
+				// the cell still holds the element of the previous lap
+				return false;
+			}
+			position = _tail;
+		}
+
+		new (cell->storage.get_storage()) T(source);
+		__DMB();
+		cell->sequence = position + 1;
+		if (position_out) {
+			*position_out = position;
+		}
+		return true;
+	}
+
+	/**
+	 * Move the first element of the ring into element. Must only be called
+	 * by the consumer.
+	 * @return false if the ring is empty.
+	 */
+	bool pop(T& element) {
+		T* first = front();
+		if (first == NULL) {
+			return false;
+		}
+
+		element = *first;
+		pop();
+		return true;
+	}
+
+	/**
+	 * First element of the ring, which the consumer can use in place until
+	 * it calls pop(). Must only be called by the consumer.
+	 * @return NULL if the ring is empty.
+	 */
+	T* front() {
+		if (is_ready(_head) == false) {
+			return NULL;
+		}
+
+		__DMB();
+		return &_cells[_head & (Capacity - 1)].storage.get();
+	}
+
+	/// Destroy the first element of the ring and free its cell for the
+	/// producers. Must only be called by the consumer, after front()
+	/// returned the element.
+	void pop() {
+		Cell& cell = _cells[_head & (Capacity - 1)];
+		cell.storage.get().~T();
+		__DMB();
+		cell.sequence = _head + Capacity;
+		++_head;
+	}
+
+	/// Position of the element returned by front(), counted from the first
+	/// push and wrapping around at 2^32. Must only be called by the consumer.
+	uint32_t front_position() const {
+		return _head;
+	}
+
+	/// true if the consumer has no element to pop
+	bool empty() const {
+		return is_ready(_head) == false;
+	}
+
+private:
+	/// true if the element of position has been published
+	bool is_ready(uint32_t position) const {
+		return _cells[position & (Capacity - 1)].sequence == position + 1;
+	}
+
+	/// Store desired in *target if it holds expected, atomically.
+	static bool compare_and_swap(volatile uint32_t* target, uint32_t expected, uint32_t desired) {
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+		do {
+			if (__LDREXW(target) != expected) {
+				__CLREX();
+				return false;
+			}
+		} while (__STREXW(desired, target));
+		return true;
+#else
+		::mbed::util::CriticalSectionLock lock;
+		if (*target != expected) {
+			return false;
+		}
+		*target = desired;
+		return true;
+#endif
+	}
+
+	Cell _cells[Capacity];
+	volatile uint32_t _tail;				/// next position to reserve by producers
+	uint32_t _head;							/// next position to pop, owned by the consumer
+};
+
+} // namespace eq
+
+#endif /* EVENTQUEUE_MPSCRING_H_ */
@@ -24,10 +24,19 @@ namespace eq {
 
 /**
  * Priority queue of Ts.
- * Ts are ordered from the smaller to the bigger ( < ).
+ * Ts are ordered from the smaller to the bigger ( < ); elements which compare
+ * equal are ordered by insertion (or last update) time.
  * Elements in the queue are mutable (this is a design choice).
  * After a mutation the function update should be called to ensure that the
  * queue is still properly sorted.
+ *
+ * The queue is a binary heap of pointers to nodes allocated from a fixed pool:
+ * push, pop, update and erase are O(log n) and never allocate. A node does not
+ * move while its element is in the queue, so pointers to nodes (handles) stay
+ * valid across reorders until the element is popped or erased.
+ *
+ * Iteration visits every element once, the head first, but the other elements
+ * are in heap order and not sorted.
  * @tparam T type of elements in this queue
  * @param capacity Number of elements that this queue can contain
  */
@@ -40,7 +49,9 @@ public:
 	 */
 	struct Node {
 		AlignedStorage<T> storage;		/// storage for the T
-		Node* next;						/// pointer to the next node
+		Node* next;						/// pointer to the next free node, or the owner's link while detached
+		std::size_t position;			/// index of the node in the heap, Capacity if free
+		unsigned int sequence;			/// insertion order, breaks ties between equal elements
 	};
 
 	/**
@@ -51,8 +62,8 @@ public:
 
 		/// Construct an iterator from a Node.
 		/// This constructor is private and can only be invoked from the PriorityQueue.
-		Iterator(Node* current) :
-			_current(current) {
+		Iterator(const PriorityQueue* queue, Node* current) :
+			_queue(queue), _current(current) {
 		}
 
 	public:
@@ -81,16 +92,16 @@ public:
 			return &(_current->storage.get());
 		}
 
-		/// pre incrementation to the next T in the list
+		/// pre incrementation to the next T in the heap
 		Iterator& operator++() {
-			_current = _current->next;
+			_current = _queue->next_in_heap(_current);
 			return *this;
 		}
 
-		/// post incrementation to the next T in the list
+		/// post incrementation to the next T in the heap
 		Iterator operator++(int) {
 			Iterator tmp(*this);
-			_current = _current->next;
+			_current = _queue->next_in_heap(_current);
 			return tmp;
 		}
 
@@ -110,20 +121,21 @@ public:
 		}
 
 	private:
+		const PriorityQueue* _queue;
 		Node* _current;
 	};
 
 	typedef Iterator iterator;
 
 	/// Construct an empty priority queue.
-	PriorityQueue() : nodes(), free_nodes(NULL), head(NULL), used_nodes_count(0) {
+	PriorityQueue() : nodes(), free_nodes(NULL), heap(), used_nodes_count(0), next_sequence(0) {
 		initialize();
 	}
 
 	/// Copy construct a priority queue.
 	/// The queue will have the same content has other.
 	PriorityQueue(const PriorityQueue& other) :
-		nodes(), free_nodes(NULL), head(NULL), used_nodes_count(0) {
+		nodes(), free_nodes(NULL), heap(), used_nodes_count(0), next_sequence(0) {
 		initialize();
 		copy(other);
 	}
@@ -145,163 +157,136 @@ public:
 	}
 
 	/// Push a new element to the queue.
-	/// It will be added before the first element p in the queue where
-	/// element < p == true.
+	/// It will be placed after the elements p in the queue where
+	/// element < p == false.
 	/// @return An iterator to the inserted element.
 	iterator push(const T& element) {
+		Node* new_node = acquire();
+		if (new_node == NULL) {
+			return end();
+		}
+
+		// copy content
+		new (new_node->storage.get_storage()) T(element);
+		return insert(new_node);
+	}
+
+	/// Take a free node, for the caller to construct an element in its
+	/// storage and then insert() it; this saves the copy of push().
+	/// @return The node, NULL if the queue is full.
+	Node* acquire() {
 		if (full()) {
 			return NULL;
 		}
 
-		// get a free node
 		Node* new_node = free_nodes;
 		free_nodes = free_nodes->next;
 		new_node->next = NULL;
+		return new_node;
+	}
 
-		++used_nodes_count;
-
-		// copy content
-		new (new_node->storage.get_storage()) T(element);
-
-		// if there is no node in the queue, just link the head
-		// to the new node and return
-		if (head == NULL) {
-			head = new_node;
-			return new_node;
-		}
-
-		// if the new node has an higher priority than the node in head
-		// just link it as the head
-		if (element < head->storage.get()) {
-			new_node->next = head;
-			head = new_node;
-			return new_node;
-		}
+	/// Insert a node returned by acquire(), whose element has been
+	/// constructed, like push() does, or a node taken out by detach().
+	/// @return An iterator to the inserted element.
+	iterator insert(Node* new_node) {
+		new_node->sequence = next_sequence++;
 
-		// insert the node after head
-		insert_after(head, new_node);
+		// append it to the heap then restore the heap order
+		new_node->position = used_nodes_count;
+		heap[used_nodes_count] = new_node;
+		++used_nodes_count;
+		sift_up(new_node);
 
-		return new_node;
+		return iterator(this, new_node);
 	}
 
 	/// pop the head of the queue.
 	bool pop() {
-		if (!head) {
+		if (empty()) {
 			return false;
 		}
-
-		Node* target = head;
-		target->storage.get().~T();
-		head = target->next;
-		target->next = free_nodes;
-		free_nodes = target;
-		--used_nodes_count;
-		return true;
+		return erase(heap[0]);
 	}
 
 	/// If the content of an element is updated is updated after the insertion
-	/// then, the list can be in an unordered state.
-	/// This function help; it update the position of an iterator in the list.
+	/// then, the heap can be in an unordered state.
+	/// This function help; it update the position of an iterator in the heap.
+	/// The element is placed after the elements which compare equal to it.
 	void update(iterator it) {
-		Node* target = it.get_node();
-		Node* hint = head;
+		update(it.get_node());
+	}
 
-		if (target == NULL) {
+	/// update the position of a node in the heap
+	void update(Node* target) {
+		// the node in parameter doesn't belong to this queue
+		if (!contains(target)) {
 			return;
 		}
 
-		// remove the node from the list
-		if (target == head) {
-			// if it is the only node in the list, just return
-			// it is not needed to update its position
-			if (target->next == NULL) {
-				return;
-			}
-
-			// if the order is already correct, just return
-			if (target->storage.get() < target->next->storage.get()) {
-				return;
-			}
-
-			// otherwise remove the node from the list
-			// and update the hint
-			head = target->next;
-			hint = head;
-		} else {
-			bool node_found = false;
-			for (Node* current = head; current != NULL; current = current->next) {
-				if (current->next == target) {
-					// check if it is needed to move the node
-					if (current->storage.get() < target->storage.get()) {
-						if (target->next == NULL) {
-							return;
-						}
-
-						if (target->storage.get() < target->next->storage.get()) {
-							return;
-						}
-
-						// there is no need to iterate again the whole list
-						// just mark the hint has the current node
-						hint = current;
-					}
-
-					// remove the node from the list and break out of the loop
-					current->next = target->next;
-					node_found = true;
-					break;
-				}
-			}
-
-			// the node in parameter doesn't belong to this queue
-			if (!node_found) {
-				return;
-			}
+		target->sequence = next_sequence++;
+		if (!sift_up(target)) {
+			sift_down(target);
 		}
-
-		// insert the node after hint
-		insert_after(hint, target);
 	}
 
-	/// return an iterator to the begining of the queue.
+	/// return an iterator to the begining of the queue, the smallest element.
 	iterator begin() {
-		return head;
+		return iterator(this, empty() ? NULL : heap[0]);
 	}
 
 	/// return an iterator to the end of the queue.
 	/// @note can't be dereferenced
 	iterator end() {
-		return NULL;
+		return iterator(this, NULL);
 	}
 
-	/// erase an iterator from the list
+	/// erase an iterator from the queue
 	bool erase(iterator it) {
 		return erase(it.get_node());
 	}
 
-	/// erase a node from the list
+	/// erase a node from the queue
 	bool erase(Node* n) {
-		if (n == NULL) {
+		if (!detach(n)) {
 			return false;
 		}
 
-		if (head == n) {
-			return pop();
+		release(n);
+		return true;
+	}
+
+	/// Take a node out of the queue without destroying its element, which
+	/// stays valid, and the node unused, until release() or insert() is
+	/// called. Meanwhile the caller may link the node through its next.
+	/// @return false if the node is not in the queue.
+	bool detach(Node* n) {
+		if (!contains(n)) {
+			return false;
 		}
 
-		Node* current = head;
-		while (current->next) {
-			if (current->next == n) {
-				current->next = n->next;
-				n->storage.get().~T();
-				n->next = free_nodes;
-				free_nodes = n;
-				--used_nodes_count;
-				return true;
+		// replace the node by the last one of the heap, then move that one
+		// to its place
+		std::size_t position = n->position;
+		--used_nodes_count;
+		if (position != used_nodes_count) {
+			Node* last = heap[used_nodes_count];
+			heap[position] = last;
+			last->position = position;
+			if (!sift_up(last)) {
+				sift_down(last);
 			}
-			current = current->next;
 		}
-		return false;
+
+		n->position = Capacity;
+		return true;
+	}
+
+	/// destroy the element of a node taken out of the heap and free the node
+	void release(Node* n) {
+		n->storage.get().~T();
+		n->position = Capacity;
+		n->next = free_nodes;
+		free_nodes = n;
 	}
 
 	/**
@@ -310,7 +295,7 @@ public:
 	 * @invariant the queue remains untouched.
 	 */
 	bool empty() const {
-		return head == NULL;
+		return used_nodes_count == 0;
 	}
 
 	/**
@@ -345,24 +330,19 @@ public:
 	 * Clear the queue from all its elements.
 	 */
 	void clear() {
-		while (head) {
-			head->storage.get().~T();
-			Node* tmp = head;
-			head = head->next;
-			tmp->next = free_nodes;
-			free_nodes = tmp;
+		while (used_nodes_count) {
+			--used_nodes_count;
+			release(heap[used_nodes_count]);
 		}
-		used_nodes_count = 0;
 	}
 
 private:
 	void initialize() {
 		/// link all the nodes together
-		for (std::size_t i = 0; i < (Capacity - 1); ++i) {
-			nodes[i].next = &nodes[i + 1];
+		for (std::size_t i = 0; i < Capacity; ++i) {
+			nodes[i].next = (i + 1 < Capacity) ? &nodes[i + 1] : NULL;
+			nodes[i].position = Capacity;
 		}
-		/// the last node does not have a next node
-		nodes[Capacity - 1].next = NULL;
 		/// set all the nodes as free
 		free_nodes = nodes;
 	}
@@ -372,9 +352,11 @@ private:
 			clear();
 		}
 
-		Node *to_copy = other.head;
-		Node *previous = NULL;
-		while (to_copy) {
+		// the heap order only depends on the elements and their sequence, so
+		// copying the heap position by position keeps it valid
+		for (std::size_t i = 0; i < other.used_nodes_count; ++i) {
+			Node* to_copy = other.heap[i];
+
 			// pick a free node
 			Node* new_node = free_nodes;
 			free_nodes = free_nodes->next;
@@ -382,35 +364,85 @@ private:
 
 			// copy content
 			new (new_node->storage.get_storage()) T(to_copy->storage.get());
+			new_node->sequence = to_copy->sequence;
+			new_node->position = i;
+			heap[i] = new_node;
+		}
+		used_nodes_count = other.used_nodes_count;
+		next_sequence = other.next_sequence;
+	}
 
-			// link into the queue or update head then update previous pointer
-			if (previous) {
-				previous->next = new_node;
-			} else {
-				head = new_node;
-			}
-			previous = new_node;
+	/// true if n is a node of this queue currently holding an element
+	bool contains(const Node* n) const {
+		return n >= nodes && n < nodes + Capacity &&
+		       n->position < used_nodes_count && heap[n->position] == n;
+	}
 
-			// update the node to copy
-			to_copy = to_copy->next;
+	/// ordering of the heap: by element, then by sequence. Sequences are
+	/// compared modulo their range, which is valid as long as the oldest
+	/// element in the queue is less than half the range of pushes old.
+	static bool before(const Node* lhs, const Node* rhs) {
+		if (lhs->storage.get() < rhs->storage.get()) {
+			return true;
 		}
-		used_nodes_count = other.used_nodes_count;
+		if (rhs->storage.get() < lhs->storage.get()) {
+			return false;
+		}
+		return (lhs->sequence - rhs->sequence) > (~0u >> 1);
 	}
 
-	void insert_after(Node* prev, Node* to_insert) {
-		for (; prev != NULL; prev = prev->next) {
-			if (prev->next == NULL || to_insert->storage.get() < prev->next->storage.get()) {
-				to_insert->next = prev->next;
-				prev->next = to_insert;
+	/// move a node toward the root until its parent is before it.
+	/// @return true if the node moved.
+	bool sift_up(Node* n) {
+		std::size_t position = n->position;
+		while (position > 0) {
+			std::size_t parent = (position - 1) / 2;
+			if (!before(n, heap[parent])) {
 				break;
 			}
+			heap[position] = heap[parent];
+			heap[position]->position = position;
+			position = parent;
 		}
+		bool moved = position != n->position;
+		heap[position] = n;
+		n->position = position;
+		return moved;
+	}
+
+	/// move a node toward the leaves until it is before its children.
+	void sift_down(Node* n) {
+		std::size_t position = n->position;
+		while (true) {
+			std::size_t child = 2 * position + 1;
+			if (child >= used_nodes_count) {
+				break;
+			}
+			if (child + 1 < used_nodes_count && before(heap[child + 1], heap[child])) {
+				++child;
+			}
+			if (!before(heap[child], n)) {
+				break;
+			}
+			heap[position] = heap[child];
+			heap[position]->position = position;
+			position = child;
+		}
+		heap[position] = n;
+		n->position = position;
+	}
+
+	/// successor of a node in heap order, NULL after the last node.
+	Node* next_in_heap(const Node* n) const {
+		std::size_t position = n->position + 1;
+		return (position < used_nodes_count) ? heap[position] : NULL;
 	}
 
 	Node nodes[Capacity];         //< Nodes of the queue
 	Node *free_nodes;             //< entry point for the list of free nodes
-	Node *head;                   //< head of the queue
+	Node *heap[Capacity];         //< used nodes, as a binary heap
 	std::size_t used_nodes_count; // number of nodes used
+	unsigned int next_sequence;   // sequence of the next element pushed or updated
 };
 
 } // namespace eq
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef EVENTQUEUE_UTIL_STEADYCLOCK_H_
+#define EVENTQUEUE_UTIL_STEADYCLOCK_H_
+
+#include <stdint.h>
+#include <chrono>
+
+namespace eq {
+
+/**
+ * Millisecond clock of hosted (Linux) event queues, based on
+ * std::chrono::steady_clock. It never goes back.
+ */
+struct SteadyClock {
+	static uint64_t ms_now() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()
+		).count();
+	}
+};
+
+} // namespace eq
+
+#endif /* EVENTQUEUE_UTIL_STEADYCLOCK_H_ */
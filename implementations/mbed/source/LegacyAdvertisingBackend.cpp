@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LegacyAdvertisingBackend.h"
+
+LegacyAdvertisingBackend::LegacyAdvertisingBackend(BLE &bleIn, event_queue_t &eventQueueIn) :
+    ble(bleIn),
+    eventQueue(eventQueueIn),
+    slotSource(NULL),
+    radioManagerCallbackHandle(NULL),
+    payloadUpdateInPlace(false),
+    frameState(FRAME_IDLE)
+{
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        slotDeadlines[slot] = SLOT_NOT_SCHEDULED;
+    }
+}
+
+ble_error_t LegacyAdvertisingBackend::start(SlotSource& source, bool connectable)
+{
+    stop();
+    slotSource = &source;
+
+    if (connectable) {
+        ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED);
+    } else {
+        ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_NON_CONNECTABLE_UNDIRECTED);
+    }
+#ifdef ADV_PAYLOAD_UPDATE_IN_PLACE
+    /* Frames are swapped in the running advertiser at the end of its
+     * advertising events, if the stack notifies them */
+    ble.gap().onRadioNotification(this, &LegacyAdvertisingBackend::radioNotificationCallback);
+    payloadUpdateInPlace = (ble.gap().initRadioNotification() == BLE_ERROR_NONE);
+#else
+    payloadUpdateInPlace = false;
+#endif
+    if (payloadUpdateInPlace) {
+        /* Every advertising event sends a frame */
+        ble.gap().setAdvertisingInterval(ble.gap().getMinNonConnectableAdvertisingInterval());
+    } else {
+        /* Advertising is restarted for every frame, which sends it right
+         * away; there is no other advertising event in the frame time */
+        ble.gap().setAdvertisingInterval(ble.gap().getMaxAdvertisingInterval());
+    }
+
+    /* Schedule the slots to advertise, all due now so that we have something
+     * to advertise on startup */
+    uint64_t now = source.getAdvertisingTimeMs();
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        slotDeadlines[slot] = source.getSlotAdvInterval(slot) ? now : SLOT_NOT_SCHEDULED;
+    }
+    /* Start advertising */
+    manageRadio();
+
+    return BLE_ERROR_NONE;
+}
+
+void LegacyAdvertisingBackend::stop(void)
+{
+    /* Unschedule callbacks */
+    if (radioManagerCallbackHandle) {
+        eventQueue.cancel(radioManagerCallbackHandle);
+        radioManagerCallbackHandle = NULL;
+    }
+    /* An onFrameSent() callback already posted does nothing */
+    frameState = FRAME_IDLE;
+    slotSource = NULL;
+
+    if (ble.gap().getState().advertising) {
+        ble.gap().stopAdvertising();
+    }
+}
+
+void LegacyAdvertisingBackend::swapAdvertisedFrame(uint8_t slot)
+{
+    const GapAdvertisingData& payload = slotSource->prepareSlotFrame(slot);
+    int8_t txPower = slotSource->getSlotRadioTxPower(slot);
+
+    ble_error_t payloadError = ble.gap().setAdvertisingPayload(payload);
+    ble_error_t txPowerError = ble.gap().setTxPower(txPower);
+    if ((payloadError != BLE_ERROR_NONE || txPowerError != BLE_ERROR_NONE) && ble.gap().getState().advertising) {
+        /* The stack does not update a running advertiser: stop it so that
+         * manageRadio() restarts it with the frame */
+        ble.gap().stopAdvertising();
+        ble.gap().setAdvertisingPayload(payload);
+        ble.gap().setTxPower(txPower);
+    }
+}
+
+void LegacyAdvertisingBackend::manageRadio(void)
+{
+    uint64_t  startTimeManageRadio = slotSource->getAdvertisingTimeMs();
+
+    /* Signal that there is currently no callback posted */
+    radioManagerCallbackHandle = NULL;
+
+    uint8_t slot = earliestSlot(slotDeadlines);
+    if (slot == NO_SLOT_SCHEDULED) {
+        /* No slot to advertise, stop advertising and do not schedule any callbacks */
+        if (ble.gap().getState().advertising) {
+            ble.gap().stopAdvertising();
+        }
+        return;
+    }
+
+    if (slotDeadlines[slot] <= startTimeManageRadio) {
+        /* The slot with the earliest deadline is due, advertise it */
+        if (!payloadUpdateInPlace && ble.gap().getState().advertising) {
+            ble.gap().stopAdvertising();
+        }
+        swapAdvertisedFrame(slot);
+        if (payloadUpdateInPlace) {
+            /* Armed once the payload is set, and before advertising starts,
+             * so that the next advertising event to start sends the frame */
+            frameState = FRAME_SWAPPED;
+        }
+        if (!ble.gap().getState().advertising) {
+            ble.gap().startAdvertising();
+        }
+
+        /* Increase the advertised packet count in TLM frame */
+        slotSource->onSlotFramesAdvertised(1);
+
+        /* The next frame of the slot is due one interval after this one, but
+         * a slot more than an interval late does not catch up in a burst */
+        slotDeadlines[slot] += slotSource->getSlotAdvInterval(slot);
+        if (slotDeadlines[slot] < startTimeManageRadio) {
+            slotDeadlines[slot] = startTimeManageRadio;
+        }
+
+        if (payloadUpdateInPlace) {
+            /* radioNotificationCallback() runs manageRadio() again once an
+             * advertising event has sent this frame */
+            return;
+        }
+
+        /* Post a callback to itself to stop the advertisement or advertise
+         * the next due slot. However, take into account the time taken to
+         * swap in this frame. */
+        radioManagerCallbackHandle = eventQueue.post_in(
+            &LegacyAdvertisingBackend::manageRadio, this,
+            ble.gap().getMinNonConnectableAdvertisingInterval() - (slotSource->getAdvertisingTimeMs() - startTimeManageRadio) /* ms */,
+            event_queue_t::ms_tolerance_t(),
+            event_queue_t::priority_t(event_queue_t::priority_t::RADIO)
+        );
+    } else {
+        /* Nothing to advertise until the earliest deadline, stop advertising
+         * and wake up at that deadline */
+        if (ble.gap().getState().advertising) {
+            ble.gap().stopAdvertising();
+        }
+        radioManagerCallbackHandle = eventQueue.post_in(
+            &LegacyAdvertisingBackend::manageRadio, this,
+            slotDeadlines[slot] - startTimeManageRadio /* ms */,
+            event_queue_t::ms_tolerance_t(slotTolerance(slotSource->getSlotAdvInterval(slot))),
+            event_queue_t::priority_t(event_queue_t::priority_t::RADIO)
+        );
+    }
+}
+
+void LegacyAdvertisingBackend::radioNotificationCallback(bool radioActive)
+{
+    /* Interrupt context: only an advertising event which starts after the
+     * swap sends the frame, and only its end is of interest, once */
+    if (radioActive) {
+        if (frameState == FRAME_SWAPPED) {
+            frameState = FRAME_ON_AIR;
+        }
+    } else if (frameState == FRAME_ON_AIR) {
+        frameState = FRAME_SENT;
+        if (!eventQueue.post(&LegacyAdvertisingBackend::onFrameSent, this,
+                             event_queue_t::priority_t(event_queue_t::priority_t::RADIO))) {
+            /* The queue is full: the frame is sent again and the end of that
+             * advertising event swaps it */
+            frameState = FRAME_ON_AIR;
+        }
+    }
+}
+
+void LegacyAdvertisingBackend::onFrameSent(void)
+{
+    /* Advertising may have been stopped since the frame was sent */
+    if (frameState != FRAME_SENT) {
+        return;
+    }
+    frameState = FRAME_IDLE;
+    manageRadio();
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LEGACYADVERTISINGBACKEND_H__
+#define __LEGACYADVERTISINGBACKEND_H__
+
+#include "EventQueue/EventQueue.h"
+#include "AdvertisingBackend.h"
+
+/**
+ * Advertising backend multiplexing the slots in time on the legacy
+ * advertiser: one frame is on air at a time, for at least
+ * Gap::getMinNonConnectableAdvertisingInterval() milliseconds.
+ */
+class LegacyAdvertisingBackend : public AdvertisingBackend
+{
+public:
+    typedef eq::EventQueue event_queue_t;
+
+    /**
+     * @param[in] bleIn
+     *              The BLE instance.
+     * @param[in] eventQueueIn
+     *              The event queue used to schedule the slots.
+     */
+    LegacyAdvertisingBackend(BLE &bleIn, event_queue_t &eventQueueIn);
+
+    virtual ble_error_t start(SlotSource& source, bool connectable);
+
+    virtual void stop(void);
+
+private:
+    /**
+     * States of the advertised frame when frames are swapped in place: no
+     * frame, a frame in the payload waiting for an advertising event to
+     * start, a frame sent by the running advertising event, or a frame sent
+     * by an advertising event and waiting for onFrameSent().
+     */
+    static const uint8_t FRAME_IDLE = 0;
+    static const uint8_t FRAME_SWAPPED = 1;
+    static const uint8_t FRAME_ON_AIR = 2;
+    static const uint8_t FRAME_SENT = 3;
+
+    /**
+     * Put the next frame of a slot in the advertising payload. If
+     * advertising runs and the stack does not update it, it is stopped.
+     *
+     * @param[in] slot
+     *              The slot to advertise.
+     */
+    void swapAdvertisedFrame(uint8_t slot);
+
+    /**
+     * Manages the radio used to broadcast the frames. Every slot has the
+     * deadline of its next frame, one advertising interval after the
+     * previous one, and manageRadio() is the only callback scheduling them.
+     * When a slot is due, manageRadio() advertises the frame of the due slot
+     * with the earliest deadline (the lowest slot on ties) by updating the
+     * advertising payload. When no slot is due, it calls
+     * Gap::stopAdvertising() and posts a callback to itself at the earliest
+     * deadline.
+     *
+     * If the stack notifies the radio events (ADV_PAYLOAD_UPDATE_IN_PLACE),
+     * the advertising interval of the BLE instance is
+     * Gap::getMinNonConnectableAdvertisingInterval() and the frame is swapped
+     * in the running advertiser; manageRadio() runs again when an advertising
+     * event has sent it. Otherwise the advertising interval is
+     * Gap::getMaxAdvertisingInterval(), advertising is restarted to send every
+     * frame right away, and manageRadio() posts a callback to itself
+     * Gap::getMinNonConnectableAdvertisingInterval() milliseconds later.
+     */
+    void manageRadio(void);
+
+    /**
+     * Radio notification handler, run in interrupt context when the radio
+     * becomes active or inactive. At the end of an advertising event which
+     * started after the frame was swapped in, and so sent it, posts
+     * onFrameSent(). The end of an event already running at the swap is
+     * ignored: that event may have sent the previous payload.
+     *
+     * @param[in] radioActive
+     *              true when the radio is about to be active, false when it
+     *              has become inactive.
+     */
+    void radioNotificationCallback(bool radioActive);
+
+    /**
+     * Runs manageRadio() once the advertised frame has been sent, unless
+     * advertising has been stopped since.
+     */
+    void onFrameSent(void);
+
+    /**
+     * BLE instance the slots are advertised on.
+     */
+    BLE                                 &ble;
+
+    /**
+     * The event queue running manageRadio().
+     */
+    event_queue_t                       &eventQueue;
+
+    /**
+     * The slots advertised, NULL when stopped.
+     */
+    SlotSource                          *slotSource;
+
+    /**
+     * The time since last boot (ms) at which the next frame of each slot is
+     * due, or SLOT_NOT_SCHEDULED if the slot is not advertised
+     */
+    SlotDeadlines_t                     slotDeadlines;
+
+    /**
+     * Callback handle to keep track of manageRadio() callbacks, the only
+     * timer of the beacon slots.
+     */
+    event_queue_t::event_handle_t       radioManagerCallbackHandle;
+
+    /**
+     * Whether frames are swapped in the running advertiser, at the end of its
+     * advertising events, rather than by restarting advertising.
+     */
+    bool                                payloadUpdateInPlace;
+
+    /**
+     * State of the advertised frame when frames are swapped in place, shared
+     * with radioNotificationCallback().
+     */
+    volatile uint8_t                    frameState;
+};
+
+#endif  /* __LEGACYADVERTISINGBACKEND_H__ */
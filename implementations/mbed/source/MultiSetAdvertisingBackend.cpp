@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MultiSetAdvertisingBackend.h"
+
+#ifdef ADV_MULTI_SET
+
+MultiSetAdvertisingBackend::MultiSetAdvertisingBackend(BLE &bleIn, event_queue_t &eventQueueIn) :
+    ble(bleIn),
+    eventQueue(eventQueueIn),
+    slotSource(NULL),
+    radioEventsNotified(false),
+    radioEventCount(0),
+    radioEventsCounted(0),
+    refreshCallbackHandle(NULL)
+{
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        slotHandles[slot] = ble::INVALID_ADVERTISING_HANDLE;
+        slotStartTimes[slot] = SLOT_NOT_SCHEDULED;
+        slotEventsCounted[slot] = 0;
+        refreshDeadlines[slot] = SLOT_NOT_SCHEDULED;
+    }
+}
+
+ble_error_t MultiSetAdvertisingBackend::start(SlotSource& source, bool connectable)
+{
+    stop();
+
+    uint8_t advertisedSlots = 0;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (source.getSlotAdvInterval(slot)) {
+            advertisedSlots++;
+        }
+    }
+    if (!ble.gap().isFeatureSupported(ble::controller_supported_features_t::LE_EXTENDED_ADVERTISING)) {
+        return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+    if (advertisedSlots > ble.gap().getMaxAdvertisingSetNumber()) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    slotSource = &source;
+    /* Count the events the controller sends, if it notifies them */
+    ble.gap().onRadioNotification(this, &MultiSetAdvertisingBackend::radioNotificationCallback);
+    radioEventsNotified = (ble.gap().initRadioNotification() == BLE_ERROR_NONE);
+    radioEventsCounted = radioEventCount;
+    bool legacySetUsed = false;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (source.getSlotAdvInterval(slot) == 0) {
+            continue;
+        }
+        ble_error_t error = BLE_ERROR_NONE;
+        if (legacySetUsed) {
+            ble::AdvertisingParameters params;
+            error = ble.gap().createAdvertisingSet(&slotHandles[slot], params);
+        } else {
+            slotHandles[slot] = ble::LEGACY_ADVERTISING_HANDLE;
+            legacySetUsed = true;
+        }
+        if (error == BLE_ERROR_NONE) {
+            error = startSlot(slot, connectable);
+        }
+        if (error != BLE_ERROR_NONE) {
+            stop();
+            return error;
+        }
+    }
+
+    refreshFrames();
+
+    return BLE_ERROR_NONE;
+}
+
+void MultiSetAdvertisingBackend::stop(void)
+{
+    if (refreshCallbackHandle) {
+        eventQueue.cancel(refreshCallbackHandle);
+        refreshCallbackHandle = NULL;
+    }
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (slotHandles[slot] != ble::INVALID_ADVERTISING_HANDLE) {
+            ble.gap().stopAdvertising(slotHandles[slot]);
+            if (slotHandles[slot] != ble::LEGACY_ADVERTISING_HANDLE) {
+                ble.gap().destroyAdvertisingSet(slotHandles[slot]);
+            }
+            slotHandles[slot] = ble::INVALID_ADVERTISING_HANDLE;
+        }
+        slotStartTimes[slot] = SLOT_NOT_SCHEDULED;
+        refreshDeadlines[slot] = SLOT_NOT_SCHEDULED;
+    }
+    slotSource = NULL;
+}
+
+ble_error_t MultiSetAdvertisingBackend::startSlot(uint8_t slot, bool connectable)
+{
+    uint16_t interval = slotSource->getSlotAdvInterval(slot);
+    ble::adv_interval_t advInterval = ble::adv_interval_t(ble::millisecond_t(interval));
+    ble::AdvertisingParameters params(
+        connectable ? ble::advertising_type_t::CONNECTABLE_UNDIRECTED : ble::advertising_type_t::NON_CONNECTABLE_UNDIRECTED,
+        advInterval,
+        advInterval
+    );
+    params.setTxPower(slotSource->getSlotRadioTxPower(slot));
+
+    ble_error_t error = ble.gap().setAdvertisingParameters(slotHandles[slot], params);
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+    error = setSlotPayload(slot, slotSource->prepareSlotFrame(slot));
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+    error = ble.gap().startAdvertising(slotHandles[slot]);
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+
+    uint64_t now = slotSource->getAdvertisingTimeMs();
+    slotStartTimes[slot] = now;
+    slotEventsCounted[slot] = 0;
+    if (slotSource->isSlotFrameDynamic(slot)) {
+        refreshDeadlines[slot] = now + interval;
+    }
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t MultiSetAdvertisingBackend::setSlotPayload(uint8_t slot, const GapAdvertisingData& payload)
+{
+    return ble.gap().setAdvertisingPayload(
+        slotHandles[slot],
+        mbed::Span<const uint8_t>(payload.getPayload(), payload.getPayloadLen())
+    );
+}
+
+void MultiSetAdvertisingBackend::refreshFrames(void)
+{
+    uint64_t now = slotSource->getAdvertisingTimeMs();
+
+    /* Signal that there is currently no callback posted */
+    refreshCallbackHandle = NULL;
+
+    uint8_t slot = earliestSlot(refreshDeadlines);
+    if (slot == NO_SLOT_SCHEDULED) {
+        /* Only static frames: the controller needs nothing more */
+        return;
+    }
+
+    uint16_t interval = slotSource->getSlotAdvInterval(slot);
+    if (refreshDeadlines[slot] <= now) {
+        /* Count before the refresh, so that a TLM frame has the events sent
+         * until now */
+        countAdvertisingEvents(now);
+        setSlotPayload(slot, slotSource->prepareSlotFrame(slot));
+
+        refreshDeadlines[slot] += interval;
+        if (refreshDeadlines[slot] < now) {
+            refreshDeadlines[slot] = now;
+        }
+        slot = earliestSlot(refreshDeadlines);
+        interval = slotSource->getSlotAdvInterval(slot);
+    }
+
+    refreshCallbackHandle = eventQueue.post_in(
+        &MultiSetAdvertisingBackend::refreshFrames, this,
+        (refreshDeadlines[slot] > now) ? refreshDeadlines[slot] - now : 0 /* ms */,
+        event_queue_t::ms_tolerance_t(slotTolerance(interval)),
+        event_queue_t::priority_t(event_queue_t::priority_t::RADIO)
+    );
+}
+
+void MultiSetAdvertisingBackend::countAdvertisingEvents(uint64_t now)
+{
+    uint32_t count = 0;
+    if (radioEventsNotified) {
+        /* A single writer, and a 32-bit read is atomic */
+        uint32_t events = radioEventCount;
+        count = events - radioEventsCounted;
+        radioEventsCounted = events;
+        if (count) {
+            slotSource->onSlotFramesAdvertised(count);
+        }
+        return;
+    }
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (slotStartTimes[slot] == SLOT_NOT_SCHEDULED) {
+            continue;
+        }
+        /* The first advertising event is sent at start, then one per
+         * interval plus the random delay of 0 to 10 ms the controller adds */
+        uint32_t events = (uint32_t) ((now - slotStartTimes[slot]) /
+                                      (slotSource->getSlotAdvInterval(slot) + ADV_DELAY_MEAN_MS)) + 1;
+        count += events - slotEventsCounted[slot];
+        slotEventsCounted[slot] = events;
+    }
+    if (count) {
+        slotSource->onSlotFramesAdvertised(count);
+    }
+}
+
+void MultiSetAdvertisingBackend::radioNotificationCallback(bool radioActive)
+{
+    /* Interrupt context: the end of any radio activity, which is an
+     * advertising event of a set unless a central is connected */
+    if (!radioActive) {
+        radioEventCount = radioEventCount + 1;
+    }
+}
+
+#endif  /* ADV_MULTI_SET */
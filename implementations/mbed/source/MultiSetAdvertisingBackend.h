@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MULTISETADVERTISINGBACKEND_H__
+#define __MULTISETADVERTISINGBACKEND_H__
+
+#include <stdint.h>
+#include "Eddystone_config.h"
+
+#ifdef ADV_MULTI_SET
+
+#include "mbed.h"
+#include "EventQueue/EventQueue.h"
+#include "AdvertisingBackend.h"
+
+/* Advertising sets came with the BLE API of mbed OS 5.10; the mbed OS that
+ * mbed-os.lib pins predates them, so ADV_MULTI_SET needs mbed-os.lib to be
+ * updated first */
+#if !defined(MBED_MAJOR_VERSION) || (MBED_MAJOR_VERSION < 5) || \
+    ((MBED_MAJOR_VERSION == 5) && (MBED_MINOR_VERSION < 10))
+#error "ADV_MULTI_SET needs the advertising sets of mbed OS 5.10 or later, update mbed-os.lib"
+#endif
+
+/**
+ * Advertising backend running every slot as its own advertising set of a
+ * BLE 5 controller (BLE API with extended advertising, mbed OS 5.10 and
+ * later). The controller sends the frames of each slot at the slot interval
+ * and TX power, with legacy PDUs; the CPU only wakes up to refresh the
+ * frames which change (TLM, EID), once per interval of their slot.
+ *
+ * The first slot runs on the legacy advertising set and the other ones on
+ * sets created at start, so start() fails if the controller does not support
+ * extended advertising or has fewer sets than advertised slots.
+ */
+class MultiSetAdvertisingBackend : public AdvertisingBackend
+{
+public:
+    typedef eq::EventQueue event_queue_t;
+
+    /**
+     * @param[in] bleIn
+     *              The BLE instance.
+     * @param[in] eventQueueIn
+     *              The event queue used to refresh the dynamic frames.
+     */
+    MultiSetAdvertisingBackend(BLE &bleIn, event_queue_t &eventQueueIn);
+
+    virtual ble_error_t start(SlotSource& source, bool connectable);
+
+    virtual void stop(void);
+
+private:
+    /**
+     * Mean of the random delay the controller adds to the interval of
+     * every advertising event, in ms.
+     */
+    static const uint16_t ADV_DELAY_MEAN_MS = 5;
+
+    /**
+     * Set up and start the advertising set of a slot.
+     */
+    ble_error_t startSlot(uint8_t slot, bool connectable);
+
+    /**
+     * Hand the payload of a slot frame to its advertising set.
+     */
+    ble_error_t setSlotPayload(uint8_t slot, const GapAdvertisingData& payload);
+
+    /**
+     * Refresh the dynamic frame with the earliest deadline if it is due,
+     * then post a callback to itself at the next deadline.
+     */
+    void refreshFrames(void);
+
+    /**
+     * Report the advertising events sent by all the sets since the last
+     * report: the events counted by radioNotificationCallback() if the stack
+     * notifies them, or else one per interval of each slot since it started.
+     */
+    void countAdvertisingEvents(uint64_t now);
+
+    /**
+     * Radio notification (interrupt context): counts the end of every
+     * advertising event of the sets.
+     */
+    void radioNotificationCallback(bool radioActive);
+
+    /**
+     * BLE instance the slots are advertised on.
+     */
+    BLE                                 &ble;
+
+    /**
+     * The event queue running refreshFrames().
+     */
+    event_queue_t                       &eventQueue;
+
+    /**
+     * The slots advertised, NULL when stopped.
+     */
+    SlotSource                          *slotSource;
+
+    /**
+     * Advertising set of each slot, or ble::INVALID_ADVERTISING_HANDLE
+     */
+    ble::advertising_handle_t           slotHandles[MAX_ADV_SLOTS];
+
+    /**
+     * The time since last boot (ms) at which each slot started advertising
+     */
+    SlotDeadlines_t                     slotStartTimes;
+
+    /**
+     * Advertising events of each slot reported to the source
+     */
+    uint32_t                            slotEventsCounted[MAX_ADV_SLOTS];
+
+    /**
+     * Whether radio notifications count the advertising events
+     */
+    bool                                radioEventsNotified;
+
+    /**
+     * Advertising events ended, written by radioNotificationCallback()
+     */
+    volatile uint32_t                   radioEventCount;
+
+    /**
+     * Value of radioEventCount at the last report to the source
+     */
+    uint32_t                            radioEventsCounted;
+
+    /**
+     * The time since last boot (ms) at which the frame of each dynamic slot
+     * is refreshed next, or SLOT_NOT_SCHEDULED for the other slots
+     */
+    SlotDeadlines_t                     refreshDeadlines;
+
+    /**
+     * Callback handle of refreshFrames(), the only timer of the backend.
+     */
+    event_queue_t::event_handle_t       refreshCallbackHandle;
+};
+
+#endif  /* ADV_MULTI_SET */
+
+#endif  /* __MULTISETADVERTISINGBACKEND_H__ */
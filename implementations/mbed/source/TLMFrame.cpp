@@ -17,11 +17,14 @@
 #include "TLMFrame.h"
 #include "EddystoneService.h"
 
-TLMFrame::TLMFrame(uint8_t  tlmVersionIn,
+TLMFrame::TLMFrame(AesKeyCache& aesKeysIn,
+                   uint8_t  tlmVersionIn,
                    uint16_t tlmBatteryVoltageIn,
                    uint16_t tlmBeaconTemperatureIn,
                    uint32_t tlmPduCountIn,
                    uint32_t tlmTimeSinceBootIn) :
+    aesKeys(aesKeysIn),
+    eaxValid(0),
     tlmVersion(tlmVersionIn),
     lastTimeSinceBootRead(0),
     tlmBatteryVoltage(tlmBatteryVoltageIn),
@@ -66,10 +69,14 @@ void TLMFrame::setData(uint8_t *rawFrame)  // add eidTime - a 4 byte quantity
 }
 
 void TLMFrame::encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs) {
-    // Initialize AES data
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx); 
-    mbedtls_aes_setkey_enc(&ctx, eidIdentityKey, sizeof(EidIdentityKey_t) *8 );
+    // Expanded identity key, only set up the first time this key is used
+    mbedtls_aes_context* ctx = aesKeys.getEncryptContext(eidIdentityKey);
+    // The EAX subkeys and empty header MAC only depend on the key
+    if (!eaxValid || memcmp(eaxKey, eidIdentityKey, sizeof(EidIdentityKey_t)) != 0) {
+        eddy_eax_setup(&eaxCtx, ctx);
+        memcpy(eaxKey, eidIdentityKey, sizeof(EidIdentityKey_t));
+        eaxValid = 1;
+    }
     // Change the TLM version number to the encrypted version
     rawFrame[VERSION_OFFSET] = ETLM_VERSION; // Encrypted TLM Version number
     // Create EAX Params
@@ -80,13 +87,12 @@ void TLMFrame::encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t r
     uint8_t* input = rawFrame + DATA_OFFSET;  // array size 12
     uint8_t output[ETLM_DATA_LEN]; // array size 16 (4 bytes are added: SALT[2], MIC[2])
     memset(output, 0, ETLM_DATA_LEN);
-    uint8_t emptyHeader[1]; // Empty header
     LOG(("EIDIdentityKey=\r\n")); EddystoneService::logPrintHex(eidIdentityKey, 16);
     LOG(("ETLM Encoder INPUT=\r\n")); EddystoneService::logPrintHex(input, 12);
     LOG(("ETLM SALT=\r\n")); EddystoneService::logPrintHex(nonce+4, 2);
     LOG(("ETLM Nonce=\r\n")); EddystoneService::logPrintHex(nonce, 6);
     // Encrypt the TLM to ETLM
-    eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), emptyHeader, 0, TLM_DATA_LEN, input, output, output + MIC_OFFSET, MIC_LEN);
+    eddy_eax_authcrypt(&eaxCtx, ctx, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), TLM_DATA_LEN, input, output, output + MIC_OFFSET, MIC_LEN);
 
 #ifndef NO_EAX_TEST
     // Part of test code to confirm x == EAX_DECRYPT( EAX_ENCRYPT(x) )
@@ -105,14 +111,12 @@ void TLMFrame::encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t r
     // Perform test to confirm x == EAX_DECRYPT( EAX_ENCRYPT(x) )
     uint8_t buf[ETLM_DATA_LEN];
     memset(buf, 0, ETLM_DATA_LEN);
-    int ret = eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_DECRYPT, nonce, sizeof(nonce), emptyHeader, 0, TLM_DATA_LEN, newinput, buf, newinput + MIC_OFFSET, MIC_LEN);
+    int ret = eddy_eax_authcrypt(&eaxCtx, ctx, MBEDTLS_AES_DECRYPT, nonce, sizeof(nonce), TLM_DATA_LEN, newinput, buf, newinput + MIC_OFFSET, MIC_LEN);
     LOG(("ETLM Decoder OUTPUT ret=%d buf=\r\n", ret)); EddystoneService::logPrintHex(buf, 12);
 #endif
         
     // fix the frame length to the encrypted length
     rawFrame[FRAME_LEN_OFFSET] = FRAME_SIZE_ETLM + EDDYSTONE_UUID_SIZE; 
-    // Free the AES data struture
-    mbedtls_aes_free(&ctx);
 }
     
 
@@ -159,9 +163,9 @@ void TLMFrame::updateBeaconTemperature(uint16_t tlmBeaconTemperatureIn)
     tlmBeaconTemperature = tlmBeaconTemperatureIn;
 }
 
-void TLMFrame::updatePduCount(void)
+void TLMFrame::updatePduCount(uint32_t count)
 {
-    tlmPduCount++;
+    tlmPduCount += count;
 }
 
 uint16_t TLMFrame::getBatteryVoltage(void) const
@@ -179,6 +183,12 @@ uint8_t TLMFrame::getTLMVersion(void) const
     return tlmVersion;
 }
 
+void TLMFrame::invalidateEaxContext(void) {
+    memset(&eaxCtx, 0, sizeof(eaxCtx));
+    memset(eaxKey, 0, sizeof(eaxKey));
+    eaxValid = 0;
+}
+
 int TLMFrame::generateEtlmNonce(uint8_t* nonce, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs) {
     int rc = 0;
     if (sizeof(nonce) != ETLM_NONCE_LEN) {
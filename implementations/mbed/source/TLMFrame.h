@@ -19,6 +19,7 @@
 
 #include "EddystoneTypes.h"
 #include "aes_eax.h"
+#include "AesKeyCache.h"
 
 /**
  * Class that encapsulates data that belongs to the Eddystone-TLM frame. For
@@ -30,6 +31,8 @@ public:
     /**
      * Construct a new instance of this class.
      *
+     * @param[in] aesKeysIn
+     *              Cache of expanded AES keys used for the ETLM encryption.
      * @param[in] tlmVersionIn
      *              Eddystone-TLM version number to use.
      * @param[in] tlmBatteryVoltageIn
@@ -42,7 +45,8 @@ public:
      *              Intitial value for the Eddystone-TLM time since boot timer.
      8              This timer has a 0.1 second resolution.
      */
-    TLMFrame(uint8_t  tlmVersionIn           = 0,
+    TLMFrame(AesKeyCache& aesKeysIn,
+             uint8_t  tlmVersionIn           = 0,
              uint16_t tlmBatteryVoltageIn    = 0,
              uint16_t tlmBeaconTemperatureIn = 0x8000,
              uint32_t tlmPduCountIn          = 0,
@@ -77,6 +81,12 @@ public:
      */
     void encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs);
 
+    /**
+     * Drop the cached EAX subkeys. Must be called before the EID Identity Key
+     * used for the ETLM encryption is overwritten.
+     */
+    void invalidateEaxContext(void);
+
     /**
      * Get the size of the Eddystone-TLM frame constructed with the
      * current state of the TLMFrame object.
@@ -155,9 +165,12 @@ public:
     void updateBeaconTemperature(uint16_t tlmBeaconTemperatureIn);
 
     /**
-     * Increment the current PDU counter by 1.
+     * Increment the current PDU counter.
+     *
+     * @param[in] count
+     *              The number of PDUs advertised since the last update.
      */
-    void updatePduCount(void);
+    void updatePduCount(uint32_t count = 1);
 
     /**
      * Get the current Battery Voltage.
@@ -246,6 +259,16 @@ private:
     static const uint8_t TLM_DATA_OFFSET = 3;
     static const uint8_t ADV_FRAME_OFFSET = 1;
 
+    /**
+     * Expanded EID Identity Keys used for the ETLM encryption.
+     */
+    AesKeyCache&         aesKeys;
+    /**
+     * EAX subkeys and empty header MAC of the identity key in eaxKey.
+     */
+    eddy_eax_context     eaxCtx;
+    uint8_t              eaxKey[sizeof(EidIdentityKey_t)];
+    uint8_t              eaxValid;
     /**
      * Eddystone-TLM version value.
      */
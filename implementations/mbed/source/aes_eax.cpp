@@ -17,11 +17,11 @@
  
 #include <string.h>
 
-// #include "aes_eax.h"
 // set defines before loading aes.h
 #define MBEDTLS_CIPHER_MODE_CBC
 #define MBEDTLS_CIPHER_MODE_CTR
 #include "mbedtls/aes.h"
+#include "aes_eax.h"
 
 #define EDDY_ERR_EAX_AUTH_FAILED    -0x000F /**< Authenticated decryption failed. */
 
@@ -37,7 +37,9 @@ void gf128_double_( unsigned char val[16] )
 	}
 }
 
-int compute_cmac_( mbedtls_aes_context *ctx,
+static int compute_cmac_subkeys_( mbedtls_aes_context *ctx,
+		          const unsigned char pad_full[16],
+		          const unsigned char pad_partial[16],
 		          const unsigned char *input,
 		          size_t length,
 		          unsigned char param,
@@ -50,12 +52,11 @@ int compute_cmac_( mbedtls_aes_context *ctx,
 	length += 16;
 
 	unsigned char pad[16];
-	memset(pad, 0, sizeof(pad));
-	mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, pad, pad);
-	gf128_double_(pad);
 	if (length & 15) {
-		gf128_double_(pad);
+		memcpy(pad, pad_partial, sizeof(pad));
 		pad[length & 15] ^= 0x80;
+	} else {
+		memcpy(pad, pad_full, sizeof(pad));
 	}
 
 	const unsigned char *tmp_input = buf;
@@ -77,6 +78,28 @@ int compute_cmac_( mbedtls_aes_context *ctx,
 	return 0;
 }
 
+static void compute_subkeys_( mbedtls_aes_context *ctx,
+		          unsigned char pad_full[16],
+		          unsigned char pad_partial[16] )
+{
+	memset(pad_full, 0, 16);
+	mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, pad_full, pad_full);
+	gf128_double_(pad_full);
+	memcpy(pad_partial, pad_full, 16);
+	gf128_double_(pad_partial);
+}
+
+int compute_cmac_( mbedtls_aes_context *ctx,
+		          const unsigned char *input,
+		          size_t length,
+		          unsigned char param,
+		          unsigned char mac[16] )
+{
+	unsigned char pad_full[16], pad_partial[16];
+	compute_subkeys_(ctx, pad_full, pad_partial);
+	return compute_cmac_subkeys_(ctx, pad_full, pad_partial, input, length, param, mac);
+}
+
 int eddy_aes_authcrypt_eax( mbedtls_aes_context *ctx,
                             int mode,                   
                             const unsigned char *nonce, 
@@ -119,3 +142,50 @@ int eddy_aes_authcrypt_eax( mbedtls_aes_context *ctx,
 	}
 	return 0;
 }
+
+void eddy_eax_setup( eddy_eax_context *eax,
+                     mbedtls_aes_context *ctx )
+{
+	compute_subkeys_(ctx, eax->pad_full, eax->pad_partial);
+	compute_cmac_subkeys_(ctx, eax->pad_full, eax->pad_partial, NULL, 0, 1, eax->header_mac);
+}
+
+int eddy_eax_authcrypt( const eddy_eax_context *eax,
+                        mbedtls_aes_context *ctx,
+                        int mode,
+                        const unsigned char *nonce,
+                        size_t nonce_length,
+                        size_t message_length,
+                        const unsigned char *input,
+                        unsigned char *output,
+                        unsigned char *tag,
+                        size_t tag_length )
+{
+	unsigned char nonce_mac[16];
+	unsigned char ciphertext_mac[16];
+	uint8_t i;
+	compute_cmac_subkeys_(ctx, eax->pad_full, eax->pad_partial, nonce, nonce_length, 0, nonce_mac);
+	if (mode == MBEDTLS_AES_DECRYPT) {
+		compute_cmac_subkeys_(ctx, eax->pad_full, eax->pad_partial, input, message_length, 2, ciphertext_mac);
+		unsigned char n_ok = 0;
+		for (i = 0; i < tag_length; i++) {
+			ciphertext_mac[i] ^= eax->header_mac[i];
+			ciphertext_mac[i] ^= nonce_mac[i];
+			ciphertext_mac[i] ^= tag[i];
+			n_ok |= ciphertext_mac[i];
+		}
+		if (n_ok)
+			return EDDY_ERR_EAX_AUTH_FAILED;
+	}
+	size_t nc_off = 0;
+	unsigned char nonce_copy[16];
+	memcpy(nonce_copy, nonce_mac, sizeof(nonce_mac));
+	unsigned char sb[16];
+	mbedtls_aes_crypt_ctr(ctx, message_length, &nc_off, nonce_copy, sb, input, output);
+	if (mode == MBEDTLS_AES_ENCRYPT) {
+		compute_cmac_subkeys_(ctx, eax->pad_full, eax->pad_partial, output, message_length, 2, ciphertext_mac);
+		for (i = 0; i < tag_length; i++)
+			tag[i] = eax->header_mac[i] ^ nonce_mac[i] ^ ciphertext_mac[i];
+	}
+	return 0;
+}
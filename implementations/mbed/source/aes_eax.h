@@ -30,6 +30,32 @@ int compute_cmac_( mbedtls_aes_context *ctx,
 		          
 void gf128_double_( unsigned char val[16] );   
 
+/*
+ * EAX state that only depends on the key: the CMAC padding subkeys
+ * (2L for complete and 4L for partial last blocks, with L = AES_K(0))
+ * and the MAC of the empty header used by Eddystone-ETLM.
+ * Set it up once per key with eddy_eax_setup().
+ */
+typedef struct {
+	unsigned char pad_full[16];
+	unsigned char pad_partial[16];
+	unsigned char header_mac[16];
+} eddy_eax_context;
+
+void eddy_eax_setup( eddy_eax_context *eax,
+                     mbedtls_aes_context *ctx );
+
+int eddy_eax_authcrypt( const eddy_eax_context *eax,
+                        mbedtls_aes_context *ctx,       /* Key eax was set up with */
+                        int mode,                       /* ENCRYPT/DECRYPT */
+                        const unsigned char *nonce,     /* 48-bit nonce */
+                        size_t nonce_length,            /* = 6 */
+                        size_t message_length,          /* Length of input & output buffers 12 */
+                        const unsigned char *input,
+                        unsigned char *output,
+                        unsigned char *tag,
+                        size_t tag_length );            /* = 2 */
+
 int eddy_aes_authcrypt_eax( mbedtls_aes_context *ctx,
                             int mode,                       /* ENCRYPT/DECRYPT */
                             const unsigned char *nonce,     /* 48-bit nonce */ 
@@ -46,6 +46,9 @@
 
 static event_queue_t eventQueue;
 
+/* Class of the work which can wait behind the radio and the BLE stack: LEDs, persistent storage. */
+static const event_queue_t::priority_t HOUSEKEEPING_PRIORITY(event_queue_t::priority_t::HOUSEKEEPING);
+
 EddystoneService *eddyServicePtr;
 
 /* Duration after power-on that config service is available. */
@@ -59,14 +62,41 @@ static const PowerLevels_t radioTxPowerLevels = EDDYSTONE_DEFAULT_RADIO_TX_POWER
 DigitalOut configLED(CONFIG_LED, LED_OFF);
 
 static const int BLINKY_MSEC = 500;                       // How long to cycle config LED on/off
+static const int BLINKY_TOLERANCE_MSEC = 50;              // How late the config LED may toggle
 static event_queue_t::event_handle_t handle = 0;         // For the config mode timeout
 static event_queue_t::event_handle_t BlinkyHandle = 0;   // For the blinking LED when in config mode
 
 static void blinky(void)  { configLED = !configLED; }
 
+#if EVENTQUEUE_STATS
+static const int EVENTQUEUE_STATS_DUMP_MSEC = 60000;      // How often to print the event queue statistics
+
+/**
+ * Print the statistics of the event queue on one line, in hex, for
+ * tools/eq_stats.py.
+ */
+static void dumpEventQueueStats(void)
+{
+    const eq::EventQueueStats *stats = eventQueue.get_stats();
+    if (!stats) {
+        return;
+    }
+
+    uint8_t dump[eq::EventQueueStats::DUMP_SIZE];
+    size_t size = stats->dump(dump, sizeof(dump));
+    printf("EQSTATS ");
+    for (size_t i = 0; i < size; i++) {
+        printf("%02x", dump[i]);
+    }
+    printf("\r\n");
+}
+#endif
+
 static void configLED_on(void) {
     configLED = !LED_OFF;
-    BlinkyHandle = eventQueue.post_every(blinky, BLINKY_MSEC);
+    BlinkyHandle = eventQueue.post_every(
+        blinky, BLINKY_MSEC, event_queue_t::ms_tolerance_t(BLINKY_TOLERANCE_MSEC), HOUSEKEEPING_PRIORITY
+    );
 }
 
 static void configLED_off(void) {
@@ -100,6 +130,16 @@ static void connectionCallback(const Gap::ConnectionCallbackParams_t *cbParams)
     eddyServicePtr->stopEddystoneBeaconAdvertisements();
 }
 
+/**
+ * Save the params of the service in persistent storage.
+ */
+static void saveConfigParams(void)
+{
+    EddystoneService::EddystoneParams_t params;
+    eddyServicePtr->getEddystoneParams(params);
+    saveEddystoneServiceConfigParams(&params);
+}
+
 /**
  * Callback triggered for a disconnection event.
  */
@@ -107,10 +147,11 @@ static void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *cbPa
 {
     (void) cbParams;
     BLE::Instance().gap().startAdvertising();
-    // Save params in persistent storage
-    EddystoneService::EddystoneParams_t params;
-    eddyServicePtr->getEddystoneParams(params);
-    saveEddystoneServiceConfigParams(&params);
+    // Save params in persistent storage, once the BLE stack events are processed,
+    // or right away if the queue is full
+    if (!eventQueue.post(saveConfigParams, HOUSEKEEPING_PRIORITY)) {
+        saveConfigParams();
+    }
     // Ensure LED is off at the end of Config Mode or during a connection
     configLED_off();
     // 0.5 Second callback to rapidly re-establish Beaconing Service
@@ -145,7 +186,7 @@ static void button_task(void) {
 	eddyServicePtr->stopEddystoneBeaconAdvertisements();
 	configLED_off();    // just in case it's still running...
 	shutdownLED_on();   // Flash shutdownLED to let user know we're turning off
-	eventQueue.post_in(shutdownLED_off, 1000);
+	eventQueue.post_in(shutdownLED_off, 1000, event_queue_t::ms_tolerance_t(), HOUSEKEEPING_PRIORITY);
     // only go into configMode if OFF or locked and not in configMode
     } else if (!beaconIsOn || (locked && BlinkyHandle == NULL)) {
 	eventQueue.cancel(handle); // kill any pending callback tasks
@@ -157,7 +198,7 @@ static void button_task(void) {
             CONFIG_ADVERTISEMENT_TIMEOUT_SECONDS * 1000 /* ms */
         );
     }
-    eventQueue.post_in(freeButtonBusy, 750 /* ms */);
+    eventQueue.post_in(freeButtonBusy, 750 /* ms */, event_queue_t::ms_tolerance_t(), HOUSEKEEPING_PRIORITY);
 }
 
 /**
@@ -260,6 +301,12 @@ void app_start(int, char *[])
     button.rise(&reset_rise);   // setup reset button
 #endif
 
+#if EVENTQUEUE_STATS
+    eventQueue.post_every(
+        dumpEventQueueStats, EVENTQUEUE_STATS_DUMP_MSEC, event_queue_t::ms_tolerance_t(), HOUSEKEEPING_PRIORITY
+    );
+#endif
+
     BLE &ble = BLE::Instance();
     ble.init(bleInitComplete);
 }
@@ -0,0 +1,155 @@
+#!/usr/bin/python
+#
+# Copyright (c) 2016, ARM Limited, All Rights Reserved
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Read the event queue statistics printed by the beacon.
+
+When the firmware is built with EVENTQUEUE_STATS=1, it prints the statistics
+of its event queue (eq::EventQueueStats::dump()) every minute, as a line
+"EQSTATS <hex>". This reads a serial log, or stdin, and prints every dump
+found: the queue high water mark, dropped posts, cancels, and the histograms
+of the lateness of the events and of the run time of their callbacks.
+
+"""
+
+from __future__ import print_function
+
+import binascii
+import struct
+import sys
+
+PREFIX = "EQSTATS "
+MAGIC = b"EQ"
+VERSION = 1
+BUCKETS = 16
+HEADER = struct.Struct("<2sB6I")
+HISTOGRAM = struct.Struct("<IIQ%dI" % BUCKETS)
+DUMP_SIZE = HEADER.size + 2 * HISTOGRAM.size
+BAR_WIDTH = 40
+
+
+def Usage():
+  """Print the usage and exits."""
+  print("""\
+Usage:
+    python eq_stats.py [<serial log>]
+
+    Prints the event queue statistics dumped in the log, or in stdin.""")
+  sys.exit(1)
+
+
+def ParseHistogram(data):
+  """Return a dict from the bytes of a histogram."""
+  fields = HISTOGRAM.unpack(data)
+  return {
+      "count": fields[0],
+      "max_us": fields[1],
+      "total_us": fields[2],
+      "buckets": fields[3:],
+  }
+
+
+def ParseDump(dump):
+  """Return a dict from the bytes of a dump, or None if it is not one."""
+  if len(dump) != DUMP_SIZE:
+    return None
+  header = HEADER.unpack(dump[:HEADER.size])
+  if header[0] != MAGIC or header[1] != VERSION:
+    return None
+  lateness = dump[HEADER.size:HEADER.size + HISTOGRAM.size]
+  run_time = dump[HEADER.size + HISTOGRAM.size:]
+  return {
+      "capacity": header[2],
+      "high_water_mark": header[3],
+      "dropped_posts": header[4],
+      "dropped_interrupt_posts": header[5],
+      "cancels": header[6],
+      "failed_cancels": header[7],
+      "lateness": ParseHistogram(lateness),
+      "run_time": ParseHistogram(run_time),
+  }
+
+
+def BucketLabel(index):
+  """Return the range of us counted by a bucket."""
+  if index == 0:
+    return "0"
+  low = 1 << (index - 1)
+  if index == BUCKETS - 1:
+    return ">= %d" % low
+  high = (1 << index) - 1
+  if low == high:
+    return "%d" % low
+  return "%d-%d" % (low, high)
+
+
+def PrintHistogram(name, histogram):
+  """Print a histogram, without its empty buckets at both ends."""
+  count = histogram["count"]
+  if count == 0:
+    print("  %s: no events" % name)
+    return
+  print("  %s: %d events, mean %d us, max %d us" % (
+      name, count, histogram["total_us"] // count, histogram["max_us"]))
+  buckets = histogram["buckets"]
+  used = [i for i, n in enumerate(buckets) if n]
+  largest = max(buckets)
+  for i in range(used[0], used[-1] + 1):
+    bar = "#" * ((buckets[i] * BAR_WIDTH + largest - 1) // largest)
+    print("    %14s us %10d %s" % (BucketLabel(i), buckets[i], bar))
+
+
+def PrintDump(stats):
+  """Print the statistics of a dump."""
+  print("  queue: %d/%d events at most, %d dropped posts (%d from interrupts)" % (
+      stats["high_water_mark"], stats["capacity"],
+      stats["dropped_posts"] + stats["dropped_interrupt_posts"],
+      stats["dropped_interrupt_posts"]))
+  print("  cancels: %d, failed: %d" % (
+      stats["cancels"], stats["failed_cancels"]))
+  PrintHistogram("lateness", stats["lateness"])
+  PrintHistogram("run time", stats["run_time"])
+
+
+def main():
+  if len(sys.argv) > 2 or (len(sys.argv) == 2 and sys.argv[1] in ("-h", "--help")):
+    Usage()
+  log = open(sys.argv[1]) if len(sys.argv) == 2 else sys.stdin
+
+  dumps = 0
+  for number, line in enumerate(log, 1):
+    start = line.find(PREFIX)
+    if start < 0:
+      continue
+    try:
+      dump = binascii.unhexlify(line[start + len(PREFIX):].strip())
+    except (TypeError, binascii.Error):
+      dump = b""
+    stats = ParseDump(dump)
+    if stats is None:
+      print("line %d: not a version %d dump" % (number, VERSION), file=sys.stderr)
+      continue
+    dumps += 1
+    print("dump %d (line %d)" % (dumps, number))
+    PrintDump(stats)
+
+  if dumps == 0:
+    print("no dump found", file=sys.stderr)
+    sys.exit(1)
+
+
+if __name__ == "__main__":
+  main()